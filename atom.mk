@@ -282,6 +282,7 @@ include $(CLEAR_VARS)
 LOCAL_MODULE := tst-arsdk
 LOCAL_C_INCLUDES := \
 	$(LOCAL_PATH)/src \
+	$(LOCAL_PATH)/libarsdk/src \
 	$(LOCAL_PATH)/tests
 
 LIBARSDKCTRL_GEN_DIR := $(call local-get-build-dir)/gen
@@ -298,6 +299,8 @@ LOCAL_SRC_FILES := \
 	tests/env/arsdk_test_env_mux_tip.c \
 	tests/env/arsdk_test_env_ctrl.c \
 	tests/arsdk_test_cmd_itf.c \
+	tests/arsdk_test_cmd_itf_loop.c \
+	tests/arsdk_test_cmd_itf_rtt.c \
 	tests/arsdk_test_enc_dec.c \
 	tests/arsdk_test_protoc.c \
 	tests/arsdk_test_protoc_ctrl.c \
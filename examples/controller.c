@@ -70,7 +70,6 @@ struct app {
 	int                             stopped;
 	enum arsdk_backend_type         backend_type;
 	struct pomp_loop                *loop;
-	struct pomp_timer               *timer;
 	struct arsdk_ctrl               *ctrl;
 	struct arsdkctrl_backend_mux    *backend_mux;
 	struct arsdk_discovery_mux      *discovery_mux;
@@ -191,7 +190,6 @@ static struct app s_app = {
 	.stopped = 0,
 	.backend_type = ARSDK_BACKEND_TYPE_UNKNOWN,
 	.loop = NULL,
-	.timer = NULL,
 	.ctrl = NULL,
 	.backend_net = NULL,
 	.backend_mux = NULL,
@@ -1161,6 +1159,20 @@ static void link_quality(struct arsdk_cmd_itf *itf,
 			rx_useful);
 }
 
+/**
+ */
+static void link_quality_rtt(struct arsdk_cmd_itf *itf,
+		int32_t srtt_ms,
+		int32_t rttvar_ms,
+		int32_t rto_ms,
+		void *userdata)
+{
+	LOGI("link_quality srtt:%dms rttvar:%dms rto:%dms",
+			srtt_ms,
+			rttvar_ms,
+			rto_ms);
+}
+
 static void subDeviceConnectionChanged(struct app *app,
 		const struct arsdk_cmd *cmd)
 {
@@ -1332,22 +1344,22 @@ static void recv_cmd(struct arsdk_cmd_itf *itf,
 
 /**
  */
-static void timer_cb(struct pomp_timer *timer, void *userdata)
+static int pcmd_fill(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd_desc *desc,
+		struct arsdk_cmd *cmd,
+		void *userdata)
 {
 	int res = 0;
 	struct app *app = userdata;
-	struct arsdk_cmd cmd;
 	const struct arsdk_device_info *dev_info = NULL;
 
 	res = arsdk_device_get_info(app->device, &dev_info);
 	if (res < 0) {
 		LOG_ERRNO("arsdk_device_get_info", -res);
-		return;
+		return res;
 	}
 
-	/* Create 'PCMD' command */
-	arsdk_cmd_init(&cmd);
-
+	/* Encode 'PCMD' command */
 	switch (dev_info->type) {
 	case ARSDK_DEVICE_TYPE_BEBOP :
 	case ARSDK_DEVICE_TYPE_BEBOP_2 :
@@ -1365,18 +1377,16 @@ static void timer_cb(struct pomp_timer *timer, void *userdata)
 	case ARSDK_DEVICE_TYPE_SKYCTRL_4 :
 	case ARSDK_DEVICE_TYPE_SKYCTRL_4_BLACK :
 	case ARSDK_DEVICE_TYPE_EVINRUDE :
-		res = arsdk_cmd_enc_Ardrone3_Piloting_PCMD(&cmd,
+		res = arsdk_cmd_enc_Ardrone3_Piloting_PCMD(cmd,
 				0 /*_flag*/,
 				0 /*_roll*/,
 				0 /*_pitch*/,
 				0 /*_yaw*/,
 				0 /*_gaz*/,
 				0 /*_timestampAndSeqNum*/);
-		if (res < 0) {
+		if (res < 0)
 			LOG_ERRNO("arsdk_cmd_enc", -res);
-			goto end;
-		}
-		break;
+		return res;
 	case ARSDK_DEVICE_TYPE_JS :
 	case ARSDK_DEVICE_TYPE_JS_EVO_LIGHT :
 	case ARSDK_DEVICE_TYPE_JS_EVO_RACE :
@@ -1388,18 +1398,8 @@ static void timer_cb(struct pomp_timer *timer, void *userdata)
 	case ARSDK_DEVICE_TYPE_RS3 :
 	case ARSDK_DEVICE_TYPE_WINGX :
 	default:
-		goto end;
-		break;
+		return -ENOTSUP;
 	}
-
-	/* Send command */
-	res = arsdk_cmd_itf_send(app->cmd_itf, &cmd, &send_status, app);
-	if (res < 0)
-		LOG_ERRNO("arsdk_cmd_itf_send", -res);
-
-end:
-	/* Cleanup */
-	arsdk_cmd_clear(&cmd);
 }
 
 /**
@@ -1509,15 +1509,20 @@ static void connected(struct arsdk_device *device,
 	cmd_cbs.recv_cmd = &recv_cmd;
 	cmd_cbs.cmd_send_status = &send_status;
 	cmd_cbs.link_quality = &link_quality;
+	cmd_cbs.link_quality_rtt = &link_quality_rtt;
 	res = arsdk_device_create_cmd_itf(device, &cmd_cbs, &app->cmd_itf);
 	if (res < 0)
 		LOG_ERRNO("arsdk_device_create_cmd_itf", -res);
 
-	/* Setup periodic timer to send 'PCMD' commands */
+	/* Send 'PCMD' commands periodically */
 	pcmd_period = get_pcmd_period(info);
-	res = pomp_timer_set_periodic(app->timer, pcmd_period, pcmd_period);
-	if (res < 0)
-		LOG_ERRNO("pomp_timer_set", -res);
+	if (app->cmd_itf != NULL && pcmd_period != 0) {
+		res = arsdk_cmd_itf_periodic_add(app->cmd_itf,
+				&g_arsdk_cmd_desc_Ardrone3_Piloting_PCMD,
+				pcmd_period, &pcmd_fill, app);
+		if (res < 0)
+			LOG_ERRNO("arsdk_cmd_itf_periodic_add", -res);
+	}
 
 	/* Send initializing commands */
 	sendInitCmds(app, info);
@@ -1593,14 +1598,9 @@ static void disconnected(struct arsdk_device *device,
 		const struct arsdk_device_info *info,
 		void *userdata)
 {
-	int res = 0;
 	struct app *app = userdata;
 	LOGI("%s", __func__);
 
-	res = pomp_timer_clear(app->timer);
-	if (res < 0)
-		LOG_ERRNO("pomp_timer_clear", -res);
-
 	app->device = NULL;
 }
 
@@ -2458,7 +2458,6 @@ int main(int argc, char *argv[])
 
 	/* Create loop */
 	s_app.loop = pomp_loop_new();
-	s_app.timer = pomp_timer_new(s_app.loop, &timer_cb, &s_app);
 
 	/* Create device manager */
 	memset(&ctrl_device_cbs, 0, sizeof(ctrl_device_cbs));
@@ -2494,10 +2493,6 @@ int main(int argc, char *argv[])
 	if (res < 0)
 		LOG_ERRNO("arsdk_ctrl_destroy", -res);
 
-	res = pomp_timer_destroy(s_app.timer);
-	if (res < 0)
-		LOG_ERRNO("pomp_timer_destroy", -res);
-
 	res = pomp_loop_destroy(s_app.loop);
 	if (res < 0)
 		LOG_ERRNO("pomp_loop_destroy", -res);
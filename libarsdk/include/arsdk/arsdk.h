@@ -140,6 +140,23 @@ struct arsdk_peer_info;
  *             Encoded as 'varuint'.
  *     payload: Payload data of length of 'p_len'.
  *
+ * Acknowledgement Payload:
+ *     [ 2   ][ 1     ][ 2    ]
+ *     [ seq ][ flags ][ sack ]
+ *
+ *     seq : Sequence number of the acknowledged packet.
+ *           Unsigned integer encoded on 2 bytes.
+ *     flags : Optional, bit field of capabilities.
+ *             0x01: packets with acknowledgement are processed in order,
+ *                   the peer can send several of them without waiting
+ *                   for their acknowledgements. 'seq' then acknowledges
+ *                   all the packets up to it.
+ *             0x02: acknowledgements are handled as cumulative, the peer
+ *                   can acknowledge several packets at once.
+ *     sack : Optional, bit field of the packets following 'seq' also
+ *            received, bit 'i' for the packet 'seq + 1 + i'.
+ *            Unsigned integer encoded on 2 bytes.
+ *
  * Command Interface:
  *     Uses cmd_itf3.
  */
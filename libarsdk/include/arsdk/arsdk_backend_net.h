@@ -34,6 +34,10 @@ struct arsdk_backend_net;
 #define ARSDK_BACKEND_NET_PROTO_MIN ARSDK_PROTOCOL_VERSION_1
 /** maximum protocol version implemented */
 #define ARSDK_BACKEND_NET_PROTO_MAX ARSDK_PROTOCOL_VERSION_3
+/** minimum command pack size supported */
+#define ARSDK_BACKEND_NET_PACK_SIZE_MIN 512
+/** maximum command pack size supported */
+#define ARSDK_BACKEND_NET_PACK_SIZE_MAX 60000
 
 /** */
 struct arsdk_backend_net_cfg {
@@ -63,6 +67,19 @@ struct arsdk_backend_net_cfg {
 	 * '0' is considered as 'ARSDK_BACKEND_NET_PROTO_MAX'.
 	 */
 	uint32_t          proto_v_max;
+	/**
+	 * Maximum size of the command packs supported.
+	 * The smallest of the sizes of the peer and of the backend is used.
+	 * Must be '0' or in range ['ARSDK_BACKEND_NET_PACK_SIZE_MIN';
+	 * 'ARSDK_BACKEND_NET_PACK_SIZE_MAX'].
+	 * '0' keeps the default size of the protocol version.
+	 */
+	uint32_t          pack_max_size;
+	/**
+	 * Set to 1 to bound the pack size negotiated by the path MTU towards
+	 * the peer, if known by the system.
+	 */
+	int               pmtu_probe;
 };
 
 /**
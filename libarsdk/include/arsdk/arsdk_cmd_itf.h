@@ -76,6 +76,12 @@ struct arsdk_cmd {
 	struct pomp_buffer  *buf;       /**< Data buffer */
 	void                *userdata;  /**< User data */
 	enum arsdk_cmd_buffer_type buffer_type; /**< Buffer Type */
+	/**
+	 * Time to live in millisecond in the transmission queue, the command
+	 * is dropped if it is not packed in time; '0' for the default time to
+	 * live of the queue, see arsdk_cmd_itf_set_queue_ttl().
+	 */
+	uint32_t            ttl_ms;
 };
 
 /**
@@ -106,6 +112,8 @@ enum arsdk_cmd_itf_pack_recv_status {
 	ARSDK_CMD_ITF_PACK_RECV_STATUS_PROCESSED,
 	/** Ignored */
 	ARSDK_CMD_ITF_PACK_RECV_STATUS_IGNORED,
+	/** Held until the previous packs are received. */
+	ARSDK_CMD_ITF_PACK_RECV_STATUS_HELD,
 };
 
 /**
@@ -122,6 +130,8 @@ enum arsdk_cmd_itf_cmd_send_status {
 	ARSDK_CMD_ITF_CMD_SEND_STATUS_TIMEOUT,
 	/** Not sent. */
 	ARSDK_CMD_ITF_CMD_SEND_STATUS_CANCELED,
+	/** Not sent, its time to live expired before it was packed. */
+	ARSDK_CMD_ITF_CMD_SEND_STATUS_EXPIRED,
 };
 
 /**
@@ -262,6 +272,93 @@ struct arsdk_cmd_itf_cbs {
 			int32_t rx_quality,
 			int32_t rx_useful,
 			void *userdata);
+
+	/**
+	 * Function called along with 'link_quality' to inform about the
+	 * round trip time of the acknowledged data.
+	 * @param itf : interface object.
+	 * @param srtt_ms : smoothed round trip time in millisecond;
+	 *                  -1 if not calculable.
+	 * @param rttvar_ms : round trip time variation in millisecond;
+	 *                    -1 if not calculable.
+	 * @param rto_ms : retransmission timeout in millisecond.
+	 * @param userdata : user data.
+	 */
+	void (*link_quality_rtt)(struct arsdk_cmd_itf *itf,
+			int32_t srtt_ms,
+			int32_t rttvar_ms,
+			int32_t rto_ms,
+			void *userdata);
+
+	/**
+	 * Function called when a queue which refused a command, because it
+	 * reached its high watermark, has drained down to its low
+	 * watermark. Commands can be sent again.
+	 * @param itf : interface object.
+	 * @param type : buffer type given to set the watermarks of the queue.
+	 * @param userdata : user data.
+	 */
+	void (*queue_drained)(struct arsdk_cmd_itf *itf,
+			enum arsdk_cmd_buffer_type type,
+			void *userdata);
+};
+
+/** Number of buckets of a command interface histogram */
+#define ARSDK_CMD_ITF_HISTO_BUCKET_COUNT 16
+
+/**
+ * Histogram of durations with logarithmic buckets.
+ * The bucket 0 counts the durations shorter than 1 millisecond, the bucket
+ * 'i' the durations in [2^(i-1);2^i[ milliseconds and the last bucket all
+ * the longer durations.
+ */
+struct arsdk_cmd_itf_histo {
+	/** Count of durations of each bucket */
+	uint32_t buckets[ARSDK_CMD_ITF_HISTO_BUCKET_COUNT];
+};
+
+/** Statistics of a transmission queue, counted since its creation */
+struct arsdk_cmd_itf_queue_stats {
+	/** Queue identifier */
+	uint8_t id;
+	/** Buffer type of the commands of the queue */
+	enum arsdk_cmd_buffer_type type;
+	/** Number of commands queued */
+	uint64_t queued;
+	/** Number of commands completely packed */
+	uint64_t packed;
+	/** Number of packs sent for the first time */
+	uint64_t sent;
+	/** Number of packs sent again */
+	uint64_t retried;
+	/** Number of commands acknowledged */
+	uint64_t acked;
+	/** Number of commands dropped before being sent or acknowledged */
+	uint64_t dropped;
+	/** Number of commands replaced by a newer instance */
+	uint64_t coalesced;
+	/** Number of commands whose time to live expired before being packed */
+	uint64_t expired;
+	/** Number of commands pending in the queue */
+	uint32_t depth;
+	/** Size of the last pack sent; in bytes */
+	uint32_t pack_size;
+	/**
+	 * Congestion window shared by the acknowledged queues; in bytes,
+	 * '0' without congestion control
+	 */
+	uint32_t cc_window;
+	/** Bytes sent by the acknowledged queues not yet acknowledged */
+	uint32_t cc_inflight;
+	/**
+	 * Rate allowed by the congestion window, one window per round trip;
+	 * in bytes per second, '0' without congestion control
+	 */
+	uint32_t cc_rate;
+	/** Durations between the queuing and the acknowledgement of commands */
+	struct arsdk_cmd_itf_histo ack_latency;
+	/** Round trip times of the acknowledged packs sent only once */
+	struct arsdk_cmd_itf_histo ack_rtt;
 };
 
 /**
@@ -311,12 +408,297 @@ ARSDK_API void *arsdk_cmd_itf_get_osdata(struct arsdk_cmd_itf *itf);
  * given at creation will be used.
  * @param userdata : user data for send_status callback.
  * @return 0 in case of success, negative errno value in case of error.
+ * -EAGAIN if the queue of the command reached its high watermark, see
+ * arsdk_cmd_itf_set_queue_watermarks().
  */
 ARSDK_API int arsdk_cmd_itf_send(struct arsdk_cmd_itf *itf,
 		const struct arsdk_cmd *cmd,
 		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
 		void *userdata);
 
+/**
+ * Reserve the space of a command in the pack to send, to encode it directly
+ * without intermediate buffer.
+ * @param itf : interface object.
+ * @param desc : description of command.
+ * @param len : size of the encoded command.
+ * @param data : pointer to the 'len' bytes to fill with the encoded command.
+ * @return 0 in case of success, -EAGAIN if the command has to be encoded
+ * and sent with arsdk_cmd_itf_send(), negative errno value in case of error.
+ *
+ * @remarks this function is mainly used by the generated code, a success
+ * must be followed by arsdk_cmd_itf_send_enc_end() once the command is
+ * encoded.
+ */
+ARSDK_API int arsdk_cmd_itf_send_enc_begin(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd_desc *desc,
+		size_t len,
+		uint8_t **data);
+
+/**
+ * Send the command encoded after arsdk_cmd_itf_send_enc_begin().
+ * @param itf : interface object.
+ * @param send_status : function to call with send status. If NULL, the one
+ * given at creation will be used.
+ * @param userdata : user data for send_status callback.
+ * @return 0 in case of success, negative errno value in case of error.
+ *
+ * @remarks when the pack is sent immediately, the command is logged and its
+ * packed status notified before returning.
+ */
+ARSDK_API int arsdk_cmd_itf_send_enc_end(struct arsdk_cmd_itf *itf,
+		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
+		void *userdata);
+
+/**
+ * Send several commands at once.
+ * The commands are queued in order then the queues are checked only once,
+ * the packs are thus filled with as many commands as they can hold.
+ * @param itf : interface object.
+ * @param cmds : array of commands.
+ * @param count : number of commands of 'cmds'.
+ * @param send_status : function to call with send status. If NULL, the one
+ * given at creation will be used.
+ * @param userdata : user data for send_status callback.
+ * @return 0 in case of success, negative errno value in case of error.
+ * On error, the commands preceding the failing one remain queued and are
+ * sent, the following ones are not queued.
+ */
+ARSDK_API int arsdk_cmd_itf_send_batch(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd *cmds,
+		size_t count,
+		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
+		void *userdata);
+
+/**
+ * Start a batch of commands.
+ * Until the end of the batch, the commands sent are only queued; they are
+ * packed and sent at once by arsdk_cmd_itf_batch_end(). Batches can be
+ * nested, the queues are then checked at the end of the outermost one.
+ * @param itf : interface object.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_cmd_itf_batch_begin(struct arsdk_cmd_itf *itf);
+
+/**
+ * End a batch of commands started with arsdk_cmd_itf_batch_begin().
+ * @param itf : interface object.
+ * @return 0 in case of success, negative errno value in case of error.
+ * -EALREADY if no batch is in progress.
+ */
+ARSDK_API int arsdk_cmd_itf_batch_end(struct arsdk_cmd_itf *itf);
+
+/**
+ * Set the watermarks of the queue of a buffer type.
+ * Once the queue holds 'high' pending commands, sending a new one fails with
+ * -EAGAIN until the queue drains down to 'low' pending commands, which is
+ * notified by the 'queue_drained' callback.
+ * @param itf : interface object.
+ * @param type : buffer type of the queue.
+ * @param high : maximum number of pending commands; '0' for an unbounded
+ * queue, the default.
+ * @param low : number of pending commands notifying the queue drained,
+ * lower than 'high'.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_cmd_itf_set_queue_watermarks(struct arsdk_cmd_itf *itf,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t high,
+		uint32_t low);
+
+/**
+ * Enable or disable the coalescing of a non-acknowledged command.
+ * Only the newest pending instance of a coalesced command is kept: a new
+ * instance replaces the one waiting to be packed, which is notified as
+ * canceled. Useful for the periodic setpoints, to send only the freshest
+ * one once the link recovers from a stall.
+ * @param itf : interface object.
+ * @param desc : description of command.
+ * @param enable : '1' to coalesce the command, '0' otherwise.
+ * @return 0 in case of success, negative errno value in case of error.
+ * -ENOSYS if the protocol version of the interface does not support it,
+ * -EINVAL if the command is not sent in a non-acknowledged queue.
+ */
+ARSDK_API int arsdk_cmd_itf_set_cmd_coalescing(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd_desc *desc,
+		int enable);
+
+/** Maximum time to wait for more commands before sending a pack */
+#define ARSDK_CMD_ITF_PACK_DELAY_MAX_MS 10
+
+/**
+ * Set the time to wait for more commands before sending a pack not full of
+ * the non-acknowledged queue.
+ * By default, non-acknowledged commands are packed and sent as soon as
+ * possible, commands sent at close times by different modules are then
+ * sent in as many packs. A delay holds the pack until it is full or the
+ * oldest of its commands waited for 'delay_ms', trading a bounded latency
+ * for fewer packs on busy links.
+ * @param itf : interface object.
+ * @param type : buffer type of the queue.
+ * @param delay_ms : time to wait in millisecond, at most
+ * ARSDK_CMD_ITF_PACK_DELAY_MAX_MS; '0' to send as soon as possible.
+ * @return 0 in case of success, negative errno value in case of error.
+ * -ENOSYS if the protocol version of the interface does not support it,
+ * -EINVAL if the buffer type is not sent in a non-acknowledged queue.
+ */
+ARSDK_API int arsdk_cmd_itf_set_pack_delay(struct arsdk_cmd_itf *itf,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t delay_ms);
+
+/**
+ * Set the default time to live of the commands of a transmission queue.
+ * A command not packed yet once its time to live is passed is obsolete: it
+ * is dropped and notified with ARSDK_CMD_ITF_CMD_SEND_STATUS_EXPIRED
+ * instead of using the bandwidth. Commands already packed are still sent
+ * or retried until acknowledged.
+ * The time to live of a command ('ttl_ms' of 'struct arsdk_cmd') takes
+ * precedence over the default one of its queue.
+ * @param itf : interface object.
+ * @param type : buffer type of the queue.
+ * @param ttl_ms : time to live in millisecond; '0' for no limit.
+ * @return 0 in case of success, negative errno value in case of error.
+ * -ENOSYS if the protocol version of the interface does not support it,
+ * -EINVAL if no queue sends the buffer type.
+ */
+ARSDK_API int arsdk_cmd_itf_set_queue_ttl(struct arsdk_cmd_itf *itf,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t ttl_ms);
+
+/** Duration of a tick of the transmission budgets; in millisecond */
+#define ARSDK_CMD_ITF_SCHED_TICK_MS 10
+
+/** Scheduling parameters of a transmission queue */
+struct arsdk_cmd_itf_queue_sched {
+	/**
+	 * Priority level, the queues of the lower levels are served first.
+	 * By default '1' for the queue of the low priority commands and '0'
+	 * for the other ones.
+	 */
+	uint32_t priority;
+	/**
+	 * Share of the transmission budget of the interface among the queues
+	 * of the same level; at least '1', '1' by default.
+	 */
+	uint32_t weight;
+	/** Maximum bytes sent by the queue per tick; '0' for no limit */
+	uint32_t budget;
+};
+
+/**
+ * Set the scheduling parameters of a transmission queue.
+ * The queues are served by priority level. Without any budget, all that
+ * can be sent is sent at each check; with budgets, the queues of a level
+ * share the budget of the interface by deficit round robin in proportion
+ * to their weights, and a queue which used its own budget waits for the
+ * next tick. Retries are counted in the budgets.
+ * @param itf : interface object.
+ * @param type : buffer type of the queue.
+ * @param sched : scheduling parameters.
+ * @return 0 in case of success, negative errno value in case of error.
+ * -ENOSYS if the protocol version of the interface does not support it,
+ * -EINVAL if no queue sends the buffer type or the weight is null.
+ */
+ARSDK_API int arsdk_cmd_itf_set_queue_sched(struct arsdk_cmd_itf *itf,
+		enum arsdk_cmd_buffer_type type,
+		const struct arsdk_cmd_itf_queue_sched *sched);
+
+/**
+ * Set the transmission budget of the interface, shared by all its queues.
+ * Once the bytes sent in a tick reach the budget, the queues wait for the
+ * next tick; the ones of the lower priority levels are served first.
+ * @param itf : interface object.
+ * @param budget : maximum bytes sent per tick; '0' for no limit.
+ * @return 0 in case of success, negative errno value in case of error.
+ * -ENOSYS if the protocol version of the interface does not support it.
+ */
+ARSDK_API int arsdk_cmd_itf_set_tx_budget(struct arsdk_cmd_itf *itf,
+		uint32_t budget);
+
+/**
+ * Enable or disable the congestion control of the acknowledged queues.
+ * The bytes in flight of all the acknowledged queues are limited by a
+ * window, which grows by one pack per round trip while packs are
+ * acknowledged and is halved on retries. New acknowledged packs wait for
+ * room in the window, leaving the bandwidth of a degraded link to the
+ * non-acknowledged queues, which are not limited; retries of the packs in
+ * flight are not limited either. The window and its rate are reported in
+ * the statistics of the acknowledged queues.
+ * @param itf : interface object.
+ * @param enable : '1' to enable the congestion control, '0' otherwise.
+ * @return 0 in case of success, negative errno value in case of error.
+ * -ENOSYS if the protocol version of the interface does not support it.
+ */
+ARSDK_API int arsdk_cmd_itf_set_congestion_control(struct arsdk_cmd_itf *itf,
+		int enable);
+
+/**
+ * Maximum advance of a periodic command sent with other ones due before it;
+ * in millisecond.
+ */
+#define ARSDK_CMD_ITF_PERIODIC_SLACK_MS 5
+
+/**
+ * Fill callback of a periodic command.
+ * Called each period just before the command is packed, to encode it with
+ * the freshest values.
+ * @param itf : interface object.
+ * @param desc : description of the periodic command.
+ * @param cmd : initialized command to encode, cleared after sending.
+ * @param userdata : user data given to arsdk_cmd_itf_periodic_add().
+ * @return 0 to send the command, negative errno value to skip this period.
+ */
+typedef int (*arsdk_cmd_itf_periodic_fill_cb_t)(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd_desc *desc,
+		struct arsdk_cmd *cmd,
+		void *userdata);
+
+/**
+ * Send a command periodically.
+ * All the periodic commands of the interface share a single timer; the
+ * commands due within ARSDK_CMD_ITF_PERIODIC_SLACK_MS of each other are
+ * filled then sent in a batch, thus in the same pack if they are sent in
+ * the same queue. Commands are sent with the send status callback given at
+ * creation. The first command is sent one period after the call.
+ * @param itf : interface object.
+ * @param desc : description of command.
+ * @param period_ms : period in millisecond.
+ * @param fill : function to call to encode the command.
+ * @param userdata : user data for fill callback.
+ * @return 0 in case of success, negative errno value in case of error.
+ * -EEXIST if the command is already sent periodically.
+ */
+ARSDK_API int arsdk_cmd_itf_periodic_add(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd_desc *desc,
+		uint32_t period_ms,
+		arsdk_cmd_itf_periodic_fill_cb_t fill,
+		void *userdata);
+
+/**
+ * Stop sending a command periodically.
+ * Can be called from the fill callback.
+ * @param itf : interface object.
+ * @param desc : description of command.
+ * @return 0 in case of success, negative errno value in case of error.
+ * -ENOENT if the command is not sent periodically.
+ */
+ARSDK_API int arsdk_cmd_itf_periodic_remove(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd_desc *desc);
+
+/**
+ * Get the statistics of the transmission queues of the interface.
+ * Counters are maintained without allocation, reading them is cheap enough
+ * to be done periodically.
+ * @param itf : interface object.
+ * @param stats : array to fill with the statistics of each queue.
+ * @param count : capacity of 'stats' as input, number of queues of the
+ * interface as output; only the queues fitting in 'stats' are filled.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_cmd_itf_get_stats(struct arsdk_cmd_itf *itf,
+		struct arsdk_cmd_itf_queue_stats *stats,
+		uint32_t *count);
+
 /**
  * Encode a command.
  * @param cmd : command structure to fill.
@@ -344,6 +726,68 @@ ARSDK_API int arsdk_cmd_enc_argv(struct arsdk_cmd *cmd,
 		const struct arsdk_cmd_desc *desc, size_t argc,
 		const struct arsdk_value *argv);
 
+/**
+ * Encode a command in a caller provided buffer.
+ * The buffer is reset and its capacity increased if needed, it can be
+ * recycled once the command has been released (and is no more shared).
+ * @param cmd : command structure to fill, takes a new reference on buf.
+ * @param buf : buffer to use, must not be shared.
+ * @param desc : description of command.
+ * @param ... : arguments of commands.
+ * @return 0 in case of success, negative errno value in case of error.
+ * -EPERM is returned if the buffer is still shared.
+ */
+ARSDK_API int arsdk_cmd_enc_with_buf(struct arsdk_cmd *cmd,
+		struct pomp_buffer *buf,
+		const struct arsdk_cmd_desc *desc, ...);
+
+/**
+ * Encode a command in a caller provided buffer.
+ * @param cmd : command structure to fill, takes a new reference on buf.
+ * @param buf : buffer to use, must not be shared.
+ * @param desc : description of command.
+ * @param argc : size of the argv array (must be equal to desc->arg_desc_count)
+ * @param argv : arguments array (must contains exactly
+ *               desc->arg_desc_count items with same types).
+ * @return 0 in case of success, negative errno value in case of error.
+ * -EPERM is returned if the buffer is still shared.
+ */
+ARSDK_API int arsdk_cmd_enc_argv_with_buf(struct arsdk_cmd *cmd,
+		struct pomp_buffer *buf,
+		const struct arsdk_cmd_desc *desc, size_t argc,
+		const struct arsdk_value *argv);
+
+/**
+ * Encode a command (ids and arguments) in a caller provided memory area.
+ * @param data : memory to write to, can be NULL if capacity is 0.
+ * @param capacity : size of the memory area.
+ * @param len : encoded size of the command, also set when the memory
+ *              area is too small.
+ * @param desc : description of command.
+ * @param ... : arguments of commands.
+ * @return 0 in case of success, negative errno value in case of error.
+ * -ENOBUFS is returned if the command does not fit in the memory area.
+ */
+ARSDK_API int arsdk_cmd_enc_into(void *data, size_t capacity, size_t *len,
+		const struct arsdk_cmd_desc *desc, ...);
+
+/**
+ * Encode a command (ids and arguments) in a caller provided memory area.
+ * @param data : memory to write to, can be NULL if capacity is 0.
+ * @param capacity : size of the memory area.
+ * @param len : encoded size of the command, also set when the memory
+ *              area is too small.
+ * @param desc : description of command.
+ * @param argc : size of the argv array (must be equal to desc->arg_desc_count)
+ * @param argv : arguments array (must contains exactly
+ *               desc->arg_desc_count items with same types).
+ * @return 0 in case of success, negative errno value in case of error.
+ * -ENOBUFS is returned if the command does not fit in the memory area.
+ */
+ARSDK_API int arsdk_cmd_enc_argv_into(void *data, size_t capacity,
+		size_t *len, const struct arsdk_cmd_desc *desc, size_t argc,
+		const struct arsdk_value *argv);
+
 /**
  * Decode a command.
  * @param cmd : command structure to decode.
@@ -391,6 +835,73 @@ ARSDK_API int arsdk_cmd_fmt(const struct arsdk_cmd *cmd, char *buf, size_t len);
 ARSDK_API int arsdk_cmd_get_values(const struct arsdk_cmd *cmd,
 		struct arsdk_value *values, size_t max_count, size_t *count);
 
+/** Maximum number of arguments of a command accessed by a view */
+#define ARSDK_CMD_VIEW_MAX_ARGS 32
+
+/**
+ * View on the arguments of an encoded command, giving access to any of them
+ * without decoding the others.
+ * Must be zero-initialized before its first use. When it is initialized
+ * again with the same description, offsets not depending on the data
+ * (no string nor binary arguments) are kept.
+ */
+struct arsdk_cmd_view {
+	/** Description of the command, NULL if not initialized */
+	const struct arsdk_cmd_desc *desc;
+	/** Encoded command data, owned by the command buffer */
+	const void *cdata;
+	/** Encoded command length */
+	size_t len;
+	/** 1 if offsets do not depend on the data */
+	int fixed;
+	/** Offset of each argument, followed by the end offset */
+	uint32_t off[ARSDK_CMD_VIEW_MAX_ARGS + 1];
+};
+
+/**
+ * Initialize a view on the arguments of a command.
+ * @param view : view to initialize.
+ * @param cmd : command to view, its buffer must be kept while the view is
+ * used.
+ * @param desc : description of the command.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_cmd_view_init(struct arsdk_cmd_view *view,
+		const struct arsdk_cmd *cmd,
+		const struct arsdk_cmd_desc *desc);
+
+/**
+ * Get an argument of a command from its view.
+ * @param view : initialized view.
+ * @param idx : index of the argument in the description.
+ * @param val : value to fill, strings and binaries point in the command
+ * buffer.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_cmd_view_get(const struct arsdk_cmd_view *view,
+		uint32_t idx, struct arsdk_value *val);
+
+/** Number of commands gathered at once by a batch decoding */
+#define ARSDK_CMD_DEC_BATCH_CHUNK 64
+
+/**
+ * Decode many commands of the same type, each argument into its own column.
+ * Column 'i' is an array of 'count' elements of the type of argument 'i':
+ * int8_t to double for numbers, int32_t for enums, 'const char *' for strings
+ * and 'struct arsdk_binary' for binaries.
+ * @param cmds : array of commands to decode, strings and binaries point in
+ * their buffers.
+ * @param count : number of commands.
+ * @param desc : description common to all the commands.
+ * @param columns : array of one column per argument of the description,
+ * a NULL column skips its argument.
+ * @return 0 in case of success, negative errno value in case of error.
+ *
+ * @remarks in case of error, columns may be partially filled.
+ */
+ARSDK_API int arsdk_cmd_dec_batch(const struct arsdk_cmd *cmds, size_t count,
+		const struct arsdk_cmd_desc *desc, void * const *columns);
+
 /**
  * return a human string representation of an argument type.
  * @param val : the argument type.
@@ -72,6 +72,7 @@ struct arsdk_arg_desc {
 	const char                    *name;
 	enum arsdk_arg_type           type;
 
+	/** Sorted by value, values equal to their index are found directly. */
 	const struct arsdk_enum_desc  *enum_desc_table;
 	uint32_t                      enum_desc_count;
 };
@@ -89,4 +90,18 @@ struct arsdk_cmd_desc {
 	uint32_t                       arg_desc_count;
 };
 
+/** Direct-indexed descriptors of the commands of a class. */
+struct arsdk_cmd_desc_cls_index {
+	/** Descriptors indexed by command id, NULL for unknown ids. */
+	const struct arsdk_cmd_desc * const  *cmd_table;
+	uint32_t                             cmd_count;
+};
+
+/** Direct-indexed classes of a project (or feature). */
+struct arsdk_cmd_desc_prj_index {
+	/** Classes indexed by class id. */
+	const struct arsdk_cmd_desc_cls_index  *cls_table;
+	uint32_t                               cls_count;
+};
+
 #endif /* _ARSDK_DESC_H_ */
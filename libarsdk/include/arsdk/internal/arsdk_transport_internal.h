@@ -129,6 +129,16 @@ struct arsdk_transport_ops {
 	 * @remarks: Default implementation returns 'ARSDK_PROTOCOL_VERSION_1'.
 	 */
 	uint32_t (*get_proto_v)(struct arsdk_transport *base);
+
+	/**
+	 * Retrives maximum size of the command packs.
+	 *
+	 * @param base : Transport base.
+	 *
+	 * @remarks: Default implementation returns '0', the command interface
+	 * then uses the default size of the protocol version.
+	 */
+	uint32_t (*get_pack_max_size)(struct arsdk_transport *base);
 };
 
 ARSDK_API int arsdk_transport_new(
@@ -183,6 +193,9 @@ ARSDK_API void arsdk_transport_log_cmd(
 
 ARSDK_API uint32_t arsdk_transport_get_proto_v(struct arsdk_transport *self);
 
+ARSDK_API uint32_t arsdk_transport_get_pack_max_size(
+		struct arsdk_transport *self);
+
 /**
  */
 static inline void arsdk_transport_payload_init(
@@ -237,6 +237,130 @@ static int decoder_read_binary(struct decoder *dec,
 	return res;
 }
 
+/**
+ */
+static int decoder_read_header(struct decoder *dec,
+		const struct arsdk_cmd_desc *desc)
+{
+	int res = 0;
+	uint8_t project_id = 0, class_id = 0;
+	uint16_t cmd_id = 0;
+
+	/* Read project/class/cmd ids */
+	res = decoder_read_u8(dec, &project_id);
+	if (res < 0)
+		return res;
+
+	res = decoder_read_u8(dec, &class_id);
+	if (res < 0)
+		return res;
+
+	res = decoder_read_u16(dec, &cmd_id);
+	if (res < 0)
+		return res;
+
+	/* Check validity */
+	if (project_id != desc->prj_id) {
+		ARSDK_LOGW("decoder: project id mismatch: %d(%d)",
+				project_id, desc->prj_id);
+		return -EINVAL;
+	}
+	if (class_id != desc->cls_id) {
+		ARSDK_LOGW("decoder: class id mismatch: %d(%d)",
+				class_id, desc->cls_id);
+		return -EINVAL;
+	}
+	if (cmd_id != desc->cmd_id) {
+		ARSDK_LOGW("decoder: command id mismatch: %d(%d)",
+				cmd_id, desc->cmd_id);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ */
+static int decoder_read_value(struct decoder *dec, enum arsdk_arg_type type,
+		struct arsdk_value *val)
+{
+	int res = 0;
+
+	switch (type) {
+	case ARSDK_ARG_TYPE_I8:
+		val->type = ARSDK_ARG_TYPE_I8;
+		res = decoder_read_i8(dec, &val->data.i8);
+		break;
+
+	case ARSDK_ARG_TYPE_U8:
+		val->type = ARSDK_ARG_TYPE_U8;
+		res = decoder_read_u8(dec, &val->data.u8);
+		break;
+
+	case ARSDK_ARG_TYPE_I16:
+		val->type = ARSDK_ARG_TYPE_I16;
+		res = decoder_read_i16(dec, &val->data.i16);
+		break;
+
+	case ARSDK_ARG_TYPE_U16:
+		val->type = ARSDK_ARG_TYPE_U16;
+		res = decoder_read_u16(dec, &val->data.u16);
+		break;
+
+	case ARSDK_ARG_TYPE_I32:
+		val->type = ARSDK_ARG_TYPE_I32;
+		res = decoder_read_i32(dec, &val->data.i32);
+		break;
+
+	case ARSDK_ARG_TYPE_U32:
+		val->type = ARSDK_ARG_TYPE_U32;
+		res = decoder_read_u32(dec, &val->data.u32);
+		break;
+
+	case ARSDK_ARG_TYPE_I64:
+		val->type = ARSDK_ARG_TYPE_I64;
+		res = decoder_read_i64(dec, &val->data.i64);
+		break;
+
+	case ARSDK_ARG_TYPE_U64:
+		val->type = ARSDK_ARG_TYPE_U64;
+		res = decoder_read_u64(dec, &val->data.u64);
+		break;
+
+	case ARSDK_ARG_TYPE_FLOAT:
+		val->type = ARSDK_ARG_TYPE_FLOAT;
+		res = decoder_read_f32(dec, &val->data.f32);
+		break;
+
+	case ARSDK_ARG_TYPE_DOUBLE:
+		val->type = ARSDK_ARG_TYPE_DOUBLE;
+		res = decoder_read_f64(dec, &val->data.f64);
+		break;
+
+	case ARSDK_ARG_TYPE_STRING:
+		val->type = ARSDK_ARG_TYPE_STRING;
+		res = decoder_read_cstr(dec, &val->data.cstr);
+		break;
+
+	case ARSDK_ARG_TYPE_ENUM:
+		/* enum shall be extracted as i32 */
+		val->type = ARSDK_ARG_TYPE_ENUM;
+		res = decoder_read_i32(dec, &val->data.i32);
+		break;
+
+	case ARSDK_ARG_TYPE_BINARY:
+		val->type = ARSDK_ARG_TYPE_BINARY;
+		res = decoder_read_binary(dec, &val->data.binary);
+		break;
+
+	default:
+		res = -EINVAL;
+		break;
+	}
+
+	return res;
+}
+
 /**
  */
 #if defined(__GNUC__) && defined(__MINGW32__) && !defined(__clang__)
@@ -252,16 +376,109 @@ static void fmt_append(char *buf, size_t len, size_t *off, const char *fmt, ...)
 	res = vsnprintf(buf + *off, len - *off, fmt, args);
 	if (res >= 0 && (size_t)res < len - *off)
 		(*off) += (size_t)res;
+	else if (res >= 0)
+		*off = len - 1;
 	va_end(args);
 }
 
+/**
+ * Appends a string of known length without going through printf.
+ * The output is truncated if it does not fit, further appends are then
+ * ignored.
+ */
+static void fmt_append_strn(char *buf, size_t len, size_t *off,
+		const char *str, size_t n)
+{
+	if (n > len - *off - 1)
+		n = len - *off - 1;
+	memcpy(buf + *off, str, n);
+	*off += n;
+	buf[*off] = '\0';
+}
+
+/**
+ */
+static void fmt_append_str(char *buf, size_t len, size_t *off,
+		const char *str)
+{
+	fmt_append_strn(buf, len, off, str, strlen(str));
+}
+
+/**
+ */
+static void fmt_append_u64(char *buf, size_t len, size_t *off, uint64_t val)
+{
+	char tmp[20];
+	size_t n = sizeof(tmp);
+
+	/* Write digits from the end */
+	do {
+		tmp[--n] = (char)('0' + val % 10);
+		val /= 10;
+	} while (val != 0);
+
+	fmt_append_strn(buf, len, off, tmp + n, sizeof(tmp) - n);
+}
+
+/**
+ */
+static void fmt_append_i64(char *buf, size_t len, size_t *off, int64_t val)
+{
+	if (val >= 0) {
+		fmt_append_u64(buf, len, off, (uint64_t)val);
+		return;
+	}
+
+	/* Negate without overflowing on INT64_MIN */
+	fmt_append_strn(buf, len, off, "-", 1);
+	fmt_append_u64(buf, len, off, (uint64_t)(-(val + 1)) + 1);
+}
+
+/**
+ */
+static void fmt_append_hex(char *buf, size_t len, size_t *off,
+		const uint8_t *data, size_t n)
+{
+	static const char digits[] = "0123456789abcdef";
+	char tmp[2];
+	size_t i = 0;
+
+	for (i = 0; i < n && *off + 1 < len; i++) {
+		tmp[0] = digits[data[i] >> 4];
+		tmp[1] = digits[data[i] & 0xf];
+		fmt_append_strn(buf, len, off, tmp, sizeof(tmp));
+	}
+}
+
+/**
+ */
+static void fmt_append_unknown(char *buf, size_t len, size_t *off,
+		int64_t val)
+{
+	fmt_append_strn(buf, len, off, "UNKNOWN(", 8);
+	fmt_append_i64(buf, len, off, val);
+	fmt_append_strn(buf, len, off, ")", 1);
+}
+
 static const char *get_enum_str(const struct arsdk_arg_desc *arg_desc,
 		int32_t val)
 {
-	uint32_t i = 0;
-	for (i = 0; i < arg_desc->enum_desc_count; i++) {
-		if (arg_desc->enum_desc_table[i].value == val)
-			return arg_desc->enum_desc_table[i].name;
+	const struct arsdk_enum_desc *table = arg_desc->enum_desc_table;
+	uint32_t lo = 0, hi = arg_desc->enum_desc_count, mid = 0;
+
+	/* Values are most of the time contiguous from 0 */
+	if (val >= 0 && (uint32_t)val < hi && table[val].value == val)
+		return table[val].name;
+
+	/* Otherwise search in the table sorted by value */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (table[mid].value == val)
+			return table[mid].name;
+		else if (table[mid].value < val)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
 	return NULL;
 }
@@ -279,17 +496,17 @@ static void fmt_append_bitfield(char *buf, size_t len, size_t *off,
 		if (!(val & (1ULL << i)))
 			continue;
 		if (!first)
-			fmt_append(buf, len, off, "|");
+			fmt_append_strn(buf, len, off, "|", 1);
 		first = 0;
 		enum_str = get_enum_str(arg_desc, i);
 		if (enum_str)
-			fmt_append(buf, len, off, "%s", enum_str);
+			fmt_append_str(buf, len, off, enum_str);
 		else
-			fmt_append(buf, len, off, "UNKNOWN(%zd)", i);
+			fmt_append_unknown(buf, len, off, (int64_t)i);
 	}
 
 	if (first)
-		fmt_append(buf, len, off, "0");
+		fmt_append_strn(buf, len, off, "0", 1);
 }
 
 /**
@@ -301,8 +518,6 @@ int arsdk_cmd_dec(const struct arsdk_cmd *cmd,
 	struct decoder dec;
 	va_list args;
 	uint32_t i = 0;
-	uint8_t project_id = 0, class_id = 0;
-	uint16_t cmd_id = 0;
 	const struct arsdk_arg_desc *arg_desc = NULL;
 	struct arsdk_value val;
 
@@ -315,39 +530,11 @@ int arsdk_cmd_dec(const struct arsdk_cmd *cmd,
 
 	va_start(args, desc);
 
-	/* Read project/class/cmd ids */
-	res = decoder_read_u8(&dec, &project_id);
+	/* Read and check project/class/cmd ids */
+	res = decoder_read_header(&dec, desc);
 	if (res < 0)
 		goto out;
 
-	res = decoder_read_u8(&dec, &class_id);
-	if (res < 0)
-		goto out;
-
-	res = decoder_read_u16(&dec, &cmd_id);
-	if (res < 0)
-		goto out;
-
-	/* Check validity */
-	if (project_id != desc->prj_id) {
-		res = -EINVAL;
-		ARSDK_LOGW("decoder: project id mismatch: %d(%d)",
-				project_id, desc->prj_id);
-		goto out;
-	}
-	if (class_id != desc->cls_id) {
-		res = -EINVAL;
-		ARSDK_LOGW("decoder: class id mismatch: %d(%d)",
-				class_id, desc->cls_id);
-		goto out;
-	}
-	if (cmd_id != desc->cmd_id) {
-		res = -EINVAL;
-		ARSDK_LOGW("decoder: command id mismatch: %d(%d)",
-				cmd_id, desc->cmd_id);
-		goto out;
-	}
-
 	/* Arguments */
 	for (i = 0; i < desc->arg_desc_count; i++) {
 		arg_desc = &desc->arg_desc_table[i];
@@ -505,41 +692,19 @@ out:
  */
 const struct arsdk_cmd_desc *arsdk_cmd_find_desc(const struct arsdk_cmd *cmd)
 {
-	const struct arsdk_cmd_desc * const * const * const *project_table =
-			g_arsdk_cmd_desc_table;
-	const struct arsdk_cmd_desc * const * const *class_table = NULL;
-	const struct arsdk_cmd_desc * const *cmd_table = NULL;
-	const struct arsdk_cmd_desc *cmd_desc = NULL;
-	int project_found = 0, class_found = 0;
-
-	while (*project_table != NULL) {
-		class_table = *project_table;
-		while (*class_table != NULL) {
-			cmd_table = *class_table;
-			while (*cmd_table != NULL) {
-				cmd_desc = *cmd_table;
-				if (cmd_desc->prj_id != cmd->prj_id)
-					goto next_product;
-				project_found = 1;
-				if (cmd_desc->cls_id != cmd->cls_id)
-					goto next_class;
-				class_found = 1;
-				if (cmd_desc->cmd_id == cmd->cmd_id)
-					return cmd_desc;
-				cmd_table++;
-			}
-next_class:
-			if (class_found)
-				return NULL;
-			class_table++;
-		}
-next_product:
-		if (project_found)
-			return NULL;
-		project_table++;
-	}
+	const struct arsdk_cmd_desc_prj_index *prj_index = NULL;
+	const struct arsdk_cmd_desc_cls_index *cls_index = NULL;
 
-	return NULL;
+	/* Direct lookup in the generated project/class/command index */
+	prj_index = &g_arsdk_cmd_desc_index[cmd->prj_id];
+	if (cmd->cls_id >= prj_index->cls_count)
+		return NULL;
+
+	cls_index = &prj_index->cls_table[cmd->cls_id];
+	if (cmd->cmd_id >= cls_index->cmd_count)
+		return NULL;
+
+	return cls_index->cmd_table[cmd->cmd_id];
 }
 
 int arsdk_cmd_get_values(const struct arsdk_cmd *cmd,
@@ -579,79 +744,7 @@ int arsdk_cmd_get_values(const struct arsdk_cmd *cmd,
 	for (i = 0; i < cmd_desc->arg_desc_count; i++) {
 		arg_desc = &cmd_desc->arg_desc_table[i];
 
-		switch (arg_desc->type) {
-		case ARSDK_ARG_TYPE_I8:
-			values[i].type = ARSDK_ARG_TYPE_I8;
-			res = decoder_read_i8(&dec, &values[i].data.i8);
-			break;
-
-		case ARSDK_ARG_TYPE_U8:
-			values[i].type = ARSDK_ARG_TYPE_U8;
-			res = decoder_read_u8(&dec, &values[i].data.u8);
-			break;
-
-		case ARSDK_ARG_TYPE_I16:
-			values[i].type = ARSDK_ARG_TYPE_I16;
-			res = decoder_read_i16(&dec, &values[i].data.i16);
-			break;
-
-		case ARSDK_ARG_TYPE_U16:
-			values[i].type = ARSDK_ARG_TYPE_U16;
-			res = decoder_read_u16(&dec, &values[i].data.u16);
-			break;
-
-		case ARSDK_ARG_TYPE_I32:
-			values[i].type = ARSDK_ARG_TYPE_I32;
-			res = decoder_read_i32(&dec, &values[i].data.i32);
-			break;
-
-		case ARSDK_ARG_TYPE_U32:
-			values[i].type = ARSDK_ARG_TYPE_U32;
-			res = decoder_read_u32(&dec, &values[i].data.u32);
-			break;
-
-		case ARSDK_ARG_TYPE_I64:
-			values[i].type = ARSDK_ARG_TYPE_I64;
-			res = decoder_read_i64(&dec, &values[i].data.i64);
-			break;
-
-		case ARSDK_ARG_TYPE_U64:
-			values[i].type = ARSDK_ARG_TYPE_U64;
-			res = decoder_read_u64(&dec, &values[i].data.u64);
-			break;
-
-		case ARSDK_ARG_TYPE_FLOAT:
-			values[i].type = ARSDK_ARG_TYPE_FLOAT;
-			res = decoder_read_f32(&dec, &values[i].data.f32);
-			break;
-
-		case ARSDK_ARG_TYPE_DOUBLE:
-			values[i].type = ARSDK_ARG_TYPE_DOUBLE;
-			res = decoder_read_f64(&dec, &values[i].data.f64);
-			break;
-
-		case ARSDK_ARG_TYPE_STRING:
-			values[i].type = ARSDK_ARG_TYPE_STRING;
-			res = decoder_read_cstr(&dec, &values[i].data.cstr);
-			break;
-
-		case ARSDK_ARG_TYPE_ENUM:
-			/* enum shall be extracted as i32 */
-			values[i].type = ARSDK_ARG_TYPE_ENUM;
-			res = decoder_read_i32(&dec, &values[i].data.i32);
-			break;
-
-		case ARSDK_ARG_TYPE_BINARY:
-			values[i].type = ARSDK_ARG_TYPE_BINARY;
-			res = decoder_read_binary(&dec,
-					&values[i].data.binary);
-			break;
-
-		default:
-			res = -EINVAL;
-			break;
-		}
-
+		res = decoder_read_value(&dec, arg_desc->type, &values[i]);
 		if (res < 0)
 			goto out;
 	}
@@ -694,12 +787,14 @@ int arsdk_cmd_fmt(const struct arsdk_cmd *cmd, char *buf, size_t len)
 	dec.off += 4;
 
 	/* Command name */
-	fmt_append(buf, len, &off, "%s", cmd_desc->name);
+	fmt_append_str(buf, len, &off, cmd_desc->name);
 
 	/* Arguments */
 	for (i = 0; i < cmd_desc->arg_desc_count; i++) {
 		arg_desc = &cmd_desc->arg_desc_table[i];
-		fmt_append(buf, len, &off, " | %s=", arg_desc->name);
+		fmt_append_strn(buf, len, &off, " | ", 3);
+		fmt_append_str(buf, len, &off, arg_desc->name);
+		fmt_append_strn(buf, len, &off, "=", 1);
 		switch (arg_desc->type) {
 		case ARSDK_ARG_TYPE_I8:
 			val.type = ARSDK_ARG_TYPE_I8;
@@ -713,7 +808,7 @@ int arsdk_cmd_fmt(const struct arsdk_cmd *cmd, char *buf, size_t len)
 						    arg_desc,
 						    (uint64_t)val.data.i8);
 			else
-				fmt_append(buf, len, &off, "%d", val.data.i8);
+				fmt_append_i64(buf, len, &off, val.data.i8);
 			break;
 
 		case ARSDK_ARG_TYPE_U8:
@@ -728,7 +823,7 @@ int arsdk_cmd_fmt(const struct arsdk_cmd *cmd, char *buf, size_t len)
 						    arg_desc,
 						    (uint64_t)val.data.u8);
 			else
-				fmt_append(buf, len, &off, "%u", val.data.u8);
+				fmt_append_u64(buf, len, &off, val.data.u8);
 			break;
 
 		case ARSDK_ARG_TYPE_I16:
@@ -743,7 +838,7 @@ int arsdk_cmd_fmt(const struct arsdk_cmd *cmd, char *buf, size_t len)
 						    arg_desc,
 						    (uint64_t)val.data.i16);
 			else
-				fmt_append(buf, len, &off, "%d", val.data.i16);
+				fmt_append_i64(buf, len, &off, val.data.i16);
 			break;
 
 		case ARSDK_ARG_TYPE_U16:
@@ -758,7 +853,7 @@ int arsdk_cmd_fmt(const struct arsdk_cmd *cmd, char *buf, size_t len)
 						    arg_desc,
 						    (uint64_t)val.data.u16);
 			else
-				fmt_append(buf, len, &off, "%u", val.data.u16);
+				fmt_append_u64(buf, len, &off, val.data.u16);
 			break;
 
 		case ARSDK_ARG_TYPE_I32:
@@ -773,7 +868,7 @@ int arsdk_cmd_fmt(const struct arsdk_cmd *cmd, char *buf, size_t len)
 						    arg_desc,
 						    (uint64_t)val.data.i32);
 			else
-				fmt_append(buf, len, &off, "%d", val.data.i32);
+				fmt_append_i64(buf, len, &off, val.data.i32);
 			break;
 
 		case ARSDK_ARG_TYPE_U32:
@@ -788,7 +883,7 @@ int arsdk_cmd_fmt(const struct arsdk_cmd *cmd, char *buf, size_t len)
 						    arg_desc,
 						    (uint64_t)val.data.u32);
 			else
-				fmt_append(buf, len, &off, "%u", val.data.u32);
+				fmt_append_u64(buf, len, &off, val.data.u32);
 			break;
 
 		case ARSDK_ARG_TYPE_I64:
@@ -803,8 +898,7 @@ int arsdk_cmd_fmt(const struct arsdk_cmd *cmd, char *buf, size_t len)
 						    arg_desc,
 						    (uint64_t)val.data.i64);
 			else
-				fmt_append(buf, len, &off,
-					   "%" PRIi64, val.data.i64);
+				fmt_append_i64(buf, len, &off, val.data.i64);
 			break;
 
 		case ARSDK_ARG_TYPE_U64:
@@ -819,8 +913,7 @@ int arsdk_cmd_fmt(const struct arsdk_cmd *cmd, char *buf, size_t len)
 						    arg_desc,
 						    val.data.u64);
 			else
-				fmt_append(buf, len, &off,
-					   "%" PRIu64, val.data.u64);
+				fmt_append_u64(buf, len, &off, val.data.u64);
 			break;
 
 		case ARSDK_ARG_TYPE_FLOAT:
@@ -844,7 +937,9 @@ int arsdk_cmd_fmt(const struct arsdk_cmd *cmd, char *buf, size_t len)
 			res = decoder_read_cstr(&dec, &val.data.cstr);
 			if (res < 0)
 				goto out;
-			fmt_append(buf, len, &off, "'%s'", val.data.cstr);
+			fmt_append_strn(buf, len, &off, "'", 1);
+			fmt_append_str(buf, len, &off, val.data.cstr);
+			fmt_append_strn(buf, len, &off, "'", 1);
 			break;
 
 		case ARSDK_ARG_TYPE_ENUM:
@@ -854,12 +949,10 @@ int arsdk_cmd_fmt(const struct arsdk_cmd *cmd, char *buf, size_t len)
 			if (res < 0)
 				goto out;
 			enum_str = get_enum_str(arg_desc, val.data.i32);
-			if (enum_str != NULL) {
-				fmt_append(buf, len, &off, "%s", enum_str);
-			} else {
-				fmt_append(buf, len, &off,
-						"UNKNOWN(%d)", val.data.i32);
-			}
+			if (enum_str != NULL)
+				fmt_append_str(buf, len, &off, enum_str);
+			else
+				fmt_append_unknown(buf, len, &off, val.data.i32);
 			break;
 
 		case ARSDK_ARG_TYPE_BINARY:
@@ -867,11 +960,8 @@ int arsdk_cmd_fmt(const struct arsdk_cmd *cmd, char *buf, size_t len)
 			res = decoder_read_binary(&dec, &val.data.binary);
 			if (res < 0)
 				goto out;
-			for (i = 0; i < val.data.binary.len; i++) {
-				fmt_append(buf, len, &off, "%02x",
-					((const uint8_t *)
-					(val.data.binary.cdata))[i]);
-			}
+			fmt_append_hex(buf, len, &off, val.data.binary.cdata,
+					val.data.binary.len);
 			break;
 
 		default:
@@ -886,3 +976,298 @@ out:
 	decoder_clear(&dec);
 	return res;
 }
+
+/**
+ * Gets the encoded size of an argument type.
+ *
+ * @return size in bytes, 0 if the size depends on the data.
+ */
+static size_t get_arg_fixed_size(enum arsdk_arg_type type)
+{
+	switch (type) {
+	case ARSDK_ARG_TYPE_I8:
+	case ARSDK_ARG_TYPE_U8:
+		return sizeof(uint8_t);
+	case ARSDK_ARG_TYPE_I16:
+	case ARSDK_ARG_TYPE_U16:
+		return sizeof(uint16_t);
+	case ARSDK_ARG_TYPE_I32:
+	case ARSDK_ARG_TYPE_U32:
+	case ARSDK_ARG_TYPE_ENUM:
+		return sizeof(uint32_t);
+	case ARSDK_ARG_TYPE_I64:
+	case ARSDK_ARG_TYPE_U64:
+		return sizeof(uint64_t);
+	case ARSDK_ARG_TYPE_FLOAT:
+		return sizeof(float);
+	case ARSDK_ARG_TYPE_DOUBLE:
+		return sizeof(double);
+	default:
+		return 0;
+	}
+}
+
+/**
+ */
+int arsdk_cmd_view_init(struct arsdk_cmd_view *view,
+		const struct arsdk_cmd *cmd,
+		const struct arsdk_cmd_desc *desc)
+{
+	int res = 0;
+	struct decoder dec;
+	const struct arsdk_arg_desc *arg_desc = NULL;
+	const struct arsdk_cmd_desc *cached_desc = NULL;
+	struct arsdk_value val;
+	const void *p = NULL;
+	size_t size = 0;
+	uint32_t i = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(view != NULL, -EINVAL);
+
+	/* The view is only usable once initialized successfully, it must not
+	 * keep viewing the previous command on error */
+	cached_desc = view->desc;
+	view->desc = NULL;
+	view->cdata = NULL;
+	view->len = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(cmd != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cmd->buf != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(
+			desc->arg_desc_count <= ARSDK_CMD_VIEW_MAX_ARGS,
+			-E2BIG);
+
+	/* Initialize decoder */
+	decoder_init(&dec, cmd->buf);
+
+	/* Read and check project/class/cmd ids */
+	res = decoder_read_header(&dec, desc);
+	if (res < 0)
+		goto out;
+
+	/* Offsets computed for the same description are still valid if they
+	 * do not depend on the data */
+	if (cached_desc == desc && view->fixed) {
+		if (view->off[desc->arg_desc_count] > dec.len) {
+			res = -EINVAL;
+			goto out;
+		}
+		goto done;
+	}
+
+	/* Compute offsets, skipping arguments without reading them when
+	 * possible */
+	view->fixed = 1;
+	for (i = 0; i < desc->arg_desc_count; i++) {
+		arg_desc = &desc->arg_desc_table[i];
+		view->off[i] = (uint32_t)dec.off;
+
+		size = get_arg_fixed_size(arg_desc->type);
+		if (size != 0) {
+			res = decoder_cread(&dec, &p, size);
+		} else {
+			view->fixed = 0;
+			res = decoder_read_value(&dec, arg_desc->type, &val);
+		}
+		if (res < 0)
+			goto out;
+	}
+	view->off[desc->arg_desc_count] = (uint32_t)dec.off;
+
+done:
+	view->desc = desc;
+	view->cdata = dec.cdata;
+	view->len = dec.len;
+
+out:
+	decoder_clear(&dec);
+	return res;
+}
+
+/**
+ */
+int arsdk_cmd_view_get(const struct arsdk_cmd_view *view, uint32_t idx,
+		struct arsdk_value *val)
+{
+	struct decoder dec;
+
+	ARSDK_RETURN_ERR_IF_FAILED(view != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(view->desc != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(val != NULL, -EINVAL);
+
+	if (idx >= view->desc->arg_desc_count)
+		return -ENOENT;
+
+	/* Decode only the requested argument */
+	memset(&dec, 0, sizeof(dec));
+	dec.cdata = view->cdata;
+	dec.len = view->len;
+	dec.off = view->off[idx];
+	return decoder_read_value(&dec, view->desc->arg_desc_table[idx].type,
+			val);
+}
+
+/**
+ * Gets the size of an element of the column of an argument type for a
+ * batch decoding.
+ */
+static size_t get_arg_column_size(enum arsdk_arg_type type)
+{
+	switch (type) {
+	case ARSDK_ARG_TYPE_STRING:
+		return sizeof(const char *);
+	case ARSDK_ARG_TYPE_BINARY:
+		return sizeof(struct arsdk_binary);
+	default:
+		return get_arg_fixed_size(type);
+	}
+}
+
+/**
+ * Fills a column with an argument of fixed size of the commands of a chunk,
+ * converting it from little endian.
+ */
+static void fill_column(uint8_t *column, const uint8_t * const *chunk,
+		size_t n, uint32_t off, size_t size)
+{
+	size_t j = 0;
+	uint16_t d16 = 0;
+	uint32_t d32 = 0;
+	uint64_t d64 = 0;
+
+	switch (size) {
+	case sizeof(uint16_t):
+		for (j = 0; j < n; j++) {
+			memcpy(&d16, chunk[j] + off, size);
+			d16 = ARSDK_LE16TOH(d16);
+			memcpy(column + j * size, &d16, size);
+		}
+		break;
+	case sizeof(uint32_t):
+		for (j = 0; j < n; j++) {
+			memcpy(&d32, chunk[j] + off, size);
+			d32 = ARSDK_LE32TOH(d32);
+			memcpy(column + j * size, &d32, size);
+		}
+		break;
+	case sizeof(uint64_t):
+		for (j = 0; j < n; j++) {
+			memcpy(&d64, chunk[j] + off, size);
+			d64 = ARSDK_LE64TOH(d64);
+			memcpy(column + j * size, &d64, size);
+		}
+		break;
+	default:
+		for (j = 0; j < n; j++)
+			memcpy(column + j * size, chunk[j] + off, size);
+		break;
+	}
+}
+
+/**
+ * Decodes a batch of commands whose arguments are all of fixed size.
+ * Commands are processed by chunks: the data of a chunk is first checked and
+ * gathered, then each column is filled in a tight loop.
+ */
+static int cmd_dec_batch_fixed(const struct arsdk_cmd *cmds, size_t count,
+		const struct arsdk_cmd_desc *desc, void * const *columns)
+{
+	int res = 0;
+	struct decoder dec;
+	const uint8_t *chunk[ARSDK_CMD_DEC_BATCH_CHUNK];
+	uint32_t off[ARSDK_CMD_VIEW_MAX_ARGS + 1];
+	size_t base = 0, n = 0, j = 0, size = 0;
+	uint32_t i = 0;
+	uint8_t *column = NULL;
+
+	/* Offsets are the same for all commands */
+	off[0] = 4;
+	for (i = 0; i < desc->arg_desc_count; i++) {
+		off[i + 1] = off[i] + (uint32_t)get_arg_fixed_size(
+				desc->arg_desc_table[i].type);
+	}
+
+	for (base = 0; base < count; base += n) {
+		n = count - base;
+		if (n > ARSDK_CMD_DEC_BATCH_CHUNK)
+			n = ARSDK_CMD_DEC_BATCH_CHUNK;
+
+		/* Check and gather the data of the chunk */
+		for (j = 0; j < n; j++) {
+			if (cmds[base + j].buf == NULL)
+				return -EINVAL;
+			decoder_init(&dec, cmds[base + j].buf);
+			res = decoder_read_header(&dec, desc);
+			if (res == 0 && dec.len < off[desc->arg_desc_count])
+				res = -EINVAL;
+			chunk[j] = dec.cdata;
+			decoder_clear(&dec);
+			if (res < 0)
+				return res;
+		}
+
+		/* Fill the columns */
+		for (i = 0; i < desc->arg_desc_count; i++) {
+			if (columns[i] == NULL)
+				continue;
+			size = off[i + 1] - off[i];
+			column = (uint8_t *)columns[i] + base * size;
+			fill_column(column, chunk, n, off[i], size);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_dec_batch(const struct arsdk_cmd *cmds, size_t count,
+		const struct arsdk_cmd_desc *desc, void * const *columns)
+{
+	int res = 0;
+	struct decoder dec;
+	struct arsdk_value val;
+	size_t k = 0, size = 0;
+	uint32_t i = 0;
+	int fixed = 1;
+
+	ARSDK_RETURN_ERR_IF_FAILED(cmds != NULL || count == 0, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(columns != NULL ||
+			desc->arg_desc_count == 0, -EINVAL);
+
+	for (i = 0; i < desc->arg_desc_count; i++) {
+		if (get_arg_column_size(desc->arg_desc_table[i].type) == 0)
+			return -EINVAL;
+		if (get_arg_fixed_size(desc->arg_desc_table[i].type) == 0)
+			fixed = 0;
+	}
+
+	if (fixed && desc->arg_desc_count <= ARSDK_CMD_VIEW_MAX_ARGS)
+		return cmd_dec_batch_fixed(cmds, count, desc, columns);
+
+	/* Offsets depend on the data, decode commands one by one */
+	for (k = 0; k < count; k++) {
+		if (cmds[k].buf == NULL)
+			return -EINVAL;
+		decoder_init(&dec, cmds[k].buf);
+		res = decoder_read_header(&dec, desc);
+		for (i = 0; i < desc->arg_desc_count && res == 0; i++) {
+			res = decoder_read_value(&dec,
+					desc->arg_desc_table[i].type, &val);
+			if (res < 0 || columns[i] == NULL)
+				continue;
+
+			/* The value is at the start of the data union */
+			size = get_arg_column_size(val.type);
+			memcpy((uint8_t *)columns[i] + k * size, &val.data,
+					size);
+		}
+		decoder_clear(&dec);
+		if (res < 0)
+			return res;
+	}
+
+	return 0;
+}
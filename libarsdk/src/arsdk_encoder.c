@@ -34,7 +34,13 @@
 #define BUFFER_ALIGN_ALLOC_SIZE(_x) \
 	(((_x) + BUFFER_ALLOC_STEP - 1) & (~(BUFFER_ALLOC_STEP - 1)))
 
-/** */
+/**
+ * Encoder state.
+ * Three modes are possible:
+ * - buf != NULL: write in a pomp buffer, growing it if needed.
+ * - buf == NULL and data != NULL: write in a caller provided memory area.
+ * - buf == NULL and data == NULL: only compute the encoded size.
+ */
 struct encoder {
 	struct pomp_buffer  *buf;
 	void                *data;
@@ -45,15 +51,55 @@ struct encoder {
 
 /**
  */
-static int encoder_init(struct encoder *enc)
+static int encoder_init_with_buf(struct encoder *enc, struct pomp_buffer *buf,
+		size_t capacity)
 {
+	int res = 0;
+
+	memset(enc, 0, sizeof(*enc));
+
+	/* Reset buffer and make sure it can hold the whole command, this
+	 * fails if the buffer is shared. No reference is taken: the buffer
+	 * can not be modified while shared */
+	res = pomp_buffer_set_len(buf, 0);
+	if (res < 0)
+		return res;
+
+	res = pomp_buffer_get_data(buf, &enc->data, &enc->len,
+			&enc->capacity);
+	if (res < 0)
+		return res;
+
+	if (capacity > enc->capacity) {
+		res = pomp_buffer_set_capacity(buf, capacity);
+		if (res < 0)
+			return res;
+
+		res = pomp_buffer_get_data(buf, &enc->data, &enc->len,
+				&enc->capacity);
+		if (res < 0)
+			return res;
+	}
+
+	enc->buf = buf;
+	return 0;
+}
+
+/**
+ */
+static int encoder_init(struct encoder *enc, size_t capacity)
+{
+	int res = 0;
+
+	memset(enc, 0, sizeof(*enc));
+
 	/* Allocate buffer */
-	enc->buf = pomp_buffer_new(BUFFER_ALLOC_STEP);
+	enc->buf = pomp_buffer_new(capacity);
 	if (enc->buf == NULL)
 		return -ENOMEM;
 
 	/* Get data from buffer */
-	int res = pomp_buffer_get_data(enc->buf, &enc->data, &enc->len,
+	res = pomp_buffer_get_data(enc->buf, &enc->data, &enc->len,
 			&enc->capacity);
 	if (res < 0)
 		return res;
@@ -62,6 +108,16 @@ static int encoder_init(struct encoder *enc)
 	return 0;
 }
 
+/**
+ */
+static void encoder_init_with_data(struct encoder *enc, void *data,
+		size_t capacity)
+{
+	memset(enc, 0, sizeof(*enc));
+	enc->data = data;
+	enc->capacity = capacity;
+}
+
 /**
  */
 static void encoder_clear(struct encoder *enc)
@@ -81,6 +137,10 @@ static int encoder_ensure_capacity(struct encoder *enc, size_t capacity)
 	if (capacity <= enc->capacity)
 		return 0;
 
+	/* Caller provided memory can not grow */
+	if (enc->buf == NULL)
+		return -ENOBUFS;
+
 	/* Resize buffer after aligning requested capacity */
 	capacity = BUFFER_ALIGN_ALLOC_SIZE(capacity);
 	res = pomp_buffer_set_capacity(enc->buf, capacity);
@@ -98,13 +158,20 @@ static int encoder_write(struct encoder *enc, const void *p, size_t n)
 {
 	int res = 0;
 
+	/* Only compute size */
+	if (enc->buf == NULL && enc->data == NULL) {
+		enc->off += n;
+		return 0;
+	}
+
 	/* Make sure there is enough room in data buffer */
 	res = encoder_ensure_capacity(enc, enc->off + n);
 	if (res < 0)
 		return res;
 
 	/* Copy data */
-	memcpy((uint8_t *)enc->data + enc->off, p, n);
+	if (n != 0)
+		memcpy((uint8_t *)enc->data + enc->off, p, n);
 	enc->off += n;
 	return 0;
 }
@@ -228,45 +295,32 @@ static int encoder_write_binary(struct encoder *enc,
 
 /**
  */
-static int cmd_encv_internal(struct arsdk_cmd *cmd,
+static int encoder_write_cmd(struct encoder *enc,
 			     const struct arsdk_cmd_desc *desc, size_t argc,
 			     const struct arsdk_value *argv, va_list args)
 {
 	int res = 0;
-	struct encoder enc;
 	uint32_t i = 0;
 	const struct arsdk_arg_desc *arg_desc = NULL;
 	struct arsdk_value val;
 	memset(&val, 0, sizeof(val));
 
-	ARSDK_RETURN_ERR_IF_FAILED(cmd != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
 
 	if (argv != NULL)
 		ARSDK_RETURN_ERR_IF_FAILED(argc == desc->arg_desc_count,
 					   -EINVAL);
 
-	arsdk_cmd_init(cmd);
-
-	/* Initialize encoder */
-	res = encoder_init(&enc);
-	if (res < 0)
-		return res;
-
 	/* Write project/class/cmd ids */
-	res = encoder_write_u8(&enc, desc->prj_id);
+	res = encoder_write_u8(enc, desc->prj_id);
 	if (res < 0)
-		goto out;
-	res = encoder_write_u8(&enc, desc->cls_id);
+		return res;
+	res = encoder_write_u8(enc, desc->cls_id);
 	if (res < 0)
-		goto out;
-	res = encoder_write_u16(&enc, desc->cmd_id);
+		return res;
+	res = encoder_write_u16(enc, desc->cmd_id);
 	if (res < 0)
-		goto out;
-	cmd->prj_id = desc->prj_id;
-	cmd->cls_id = desc->cls_id;
-	cmd->cmd_id = desc->cmd_id;
-	cmd->id = ARSDK_CMD_FULL_ID(cmd->prj_id, cmd->cls_id, cmd->cmd_id);
+		return res;
 
 	/* Arguments */
 	for (i = 0; i < desc->arg_desc_count; i++) {
@@ -277,10 +331,8 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 			val = argv[i];
 
 			/* compare desc and given type */
-			if (arg_desc->type != argv[i].type) {
-				res = -EINVAL;
-				goto out;
-			}
+			if (arg_desc->type != argv[i].type)
+				return -EINVAL;
 		}
 
 		switch (arg_desc->type) {
@@ -289,9 +341,9 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 				val.type = ARSDK_ARG_TYPE_I8;
 				val.data.i8 = (int8_t)va_arg(args, int);
 			}
-			res = encoder_write_i8(&enc, val.data.i8);
+			res = encoder_write_i8(enc, val.data.i8);
 			if (res < 0)
-				goto out;
+				return res;
 			break;
 
 		case ARSDK_ARG_TYPE_U8:
@@ -300,9 +352,9 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 				val.data.u8 = (uint8_t)va_arg(args,
 							      unsigned int);
 			}
-			res = encoder_write_u8(&enc, val.data.u8);
+			res = encoder_write_u8(enc, val.data.u8);
 			if (res < 0)
-				goto out;
+				return res;
 			break;
 
 		case ARSDK_ARG_TYPE_I16:
@@ -310,9 +362,9 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 				val.type = ARSDK_ARG_TYPE_I16;
 				val.data.i16 = (int16_t)va_arg(args, int);
 			}
-			res = encoder_write_i16(&enc, val.data.i16);
+			res = encoder_write_i16(enc, val.data.i16);
 			if (res < 0)
-				goto out;
+				return res;
 			break;
 
 		case ARSDK_ARG_TYPE_U16:
@@ -321,9 +373,9 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 				val.data.u16 = (uint16_t)va_arg(args,
 								unsigned int);
 			}
-			res = encoder_write_u16(&enc, val.data.u16);
+			res = encoder_write_u16(enc, val.data.u16);
 			if (res < 0)
-				goto out;
+				return res;
 			break;
 
 		case ARSDK_ARG_TYPE_I32:
@@ -331,9 +383,9 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 				val.type = ARSDK_ARG_TYPE_I32;
 				val.data.i32 = va_arg(args, int);
 			}
-			res = encoder_write_i32(&enc, val.data.i32);
+			res = encoder_write_i32(enc, val.data.i32);
 			if (res < 0)
-				goto out;
+				return res;
 			break;
 
 		case ARSDK_ARG_TYPE_U32:
@@ -341,9 +393,9 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 				val.type = ARSDK_ARG_TYPE_U32;
 				val.data.u32 = va_arg(args, unsigned int);
 			}
-			res = encoder_write_u32(&enc, val.data.u32);
+			res = encoder_write_u32(enc, val.data.u32);
 			if (res < 0)
-				goto out;
+				return res;
 			break;
 
 		case ARSDK_ARG_TYPE_I64:
@@ -351,9 +403,9 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 				val.type = ARSDK_ARG_TYPE_I64;
 				val.data.i64 = va_arg(args, int64_t);
 			}
-			res = encoder_write_i64(&enc, val.data.i64);
+			res = encoder_write_i64(enc, val.data.i64);
 			if (res < 0)
-				goto out;
+				return res;
 			break;
 
 		case ARSDK_ARG_TYPE_U64:
@@ -361,9 +413,9 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 				val.type = ARSDK_ARG_TYPE_U64;
 				val.data.u64 = va_arg(args, uint64_t);
 			}
-			res = encoder_write_u64(&enc, val.data.u64);
+			res = encoder_write_u64(enc, val.data.u64);
 			if (res < 0)
-				goto out;
+				return res;
 			break;
 
 		case ARSDK_ARG_TYPE_FLOAT:
@@ -372,9 +424,9 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 				/* float shall be extracted as double */
 				val.data.f32 = (float)va_arg(args, double);
 			}
-			res = encoder_write_f32(&enc, val.data.f32);
+			res = encoder_write_f32(enc, val.data.f32);
 			if (res < 0)
-				goto out;
+				return res;
 			break;
 
 		case ARSDK_ARG_TYPE_DOUBLE:
@@ -382,9 +434,9 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 				val.type = ARSDK_ARG_TYPE_DOUBLE;
 				val.data.f64 = va_arg(args, double);
 			}
-			res = encoder_write_f64(&enc, val.data.f64);
+			res = encoder_write_f64(enc, val.data.f64);
 			if (res < 0)
-				goto out;
+				return res;
 			break;
 
 		case ARSDK_ARG_TYPE_STRING:
@@ -394,9 +446,9 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 			}
 			if (val.data.cstr == NULL)
 				val.data.cstr = "";
-			res = encoder_write_str(&enc, val.data.cstr);
+			res = encoder_write_str(enc, val.data.cstr);
 			if (res < 0)
-				goto out;
+				return res;
 			break;
 
 		case ARSDK_ARG_TYPE_ENUM:
@@ -405,9 +457,9 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 				/* enum shall be extracted as i32 */
 				val.data.i32 = va_arg(args, int);
 			}
-			res = encoder_write_i32(&enc, val.data.i32);
+			res = encoder_write_i32(enc, val.data.i32);
 			if (res < 0)
-				goto out;
+				return res;
 			break;
 
 		case ARSDK_ARG_TYPE_BINARY:
@@ -417,43 +469,136 @@ static int cmd_encv_internal(struct arsdk_cmd *cmd,
 						const struct arsdk_binary *);
 			}
 
-			res = encoder_write_binary(&enc, &val.data.binary);
+			res = encoder_write_binary(enc, &val.data.binary);
 			if (res < 0)
-				goto out;
+				return res;
 			break;
 
 		default:
-			res = -EINVAL;
 			ARSDK_LOGW("encoder: unknown argument type %d",
 					arg_desc->type);
-			goto out;
+			return -EINVAL;
 		}
 	}
 
+	return 0;
+}
+
+/**
+ */
+static int cmd_encv_internal(struct arsdk_cmd *cmd,
+			     const struct arsdk_cmd_desc *desc,
+			     struct pomp_buffer *buf, size_t argc,
+			     const struct arsdk_value *argv, va_list args)
+{
+	int res = 0;
+	struct encoder enc;
+	va_list args_copy;
+
+	ARSDK_RETURN_ERR_IF_FAILED(cmd != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
+
+	arsdk_cmd_init(cmd);
+
+	/* Compute the exact size first to allocate only once */
+	encoder_init_with_data(&enc, NULL, 0);
+	va_copy(args_copy, args);
+	res = encoder_write_cmd(&enc, desc, argc, argv, args_copy);
+	va_end(args_copy);
+	if (res < 0)
+		return res;
+
+	/* Initialize encoder */
+	if (buf != NULL)
+		res = encoder_init_with_buf(&enc, buf, enc.off);
+	else
+		res = encoder_init(&enc, enc.off);
+	if (res < 0)
+		goto out;
+
+	res = encoder_write_cmd(&enc, desc, argc, argv, args);
+	if (res < 0)
+		goto out;
+
 	/* Set final length of buffer */
 	res = pomp_buffer_set_len(enc.buf, enc.off);
 
 out:
 	/* In case of success, save a new ref for caller */
 	if (res == 0) {
+		cmd->prj_id = desc->prj_id;
+		cmd->cls_id = desc->cls_id;
+		cmd->cmd_id = desc->cmd_id;
+		cmd->id = ARSDK_CMD_FULL_ID(cmd->prj_id, cmd->cls_id,
+				cmd->cmd_id);
 		cmd->buf = enc.buf;
 		pomp_buffer_ref(cmd->buf);
 	}
 
-	/* Release our internal ref */
+	/* Release our internal ref, a provided buffer was not ours */
+	if (buf != NULL)
+		enc.buf = NULL;
 	encoder_clear(&enc);
 	return res;
 }
 
+/**
+ */
+static int cmd_encv_into(void *data, size_t capacity, size_t *len,
+			 const struct arsdk_cmd_desc *desc, size_t argc,
+			 const struct arsdk_value *argv, va_list args)
+{
+	int res = 0;
+	struct encoder enc;
+	va_list args_copy;
+
+	ARSDK_RETURN_ERR_IF_FAILED(len != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(data != NULL || capacity == 0, -EINVAL);
+
+	/* Write directly, the size is only computed if it does not fit */
+	va_copy(args_copy, args);
+	encoder_init_with_data(&enc, data, capacity);
+	res = encoder_write_cmd(&enc, desc, argc, argv, args);
+	if (res == 0 && data == NULL) {
+		/* Nothing written, only the size was computed */
+		res = -ENOBUFS;
+	} else if (res == -ENOBUFS) {
+		encoder_init_with_data(&enc, NULL, 0);
+		res = encoder_write_cmd(&enc, desc, argc, argv, args_copy);
+		if (res == 0)
+			res = -ENOBUFS;
+	}
+	va_end(args_copy);
+
+	*len = enc.off;
+	return res;
+}
+
 /* function needed because arsdk_cmd_enc_argv cannot pass NULL as va_list. */
 static int cmd_enc_internal(struct arsdk_cmd *cmd,
-			    const struct arsdk_cmd_desc *desc, size_t argc,
+			    const struct arsdk_cmd_desc *desc,
+			    struct pomp_buffer *buf, size_t argc,
 			    const struct arsdk_value *argv, ...)
 {
 	int res = 0;
 	va_list args;
 	va_start(args, argv);
-	res = cmd_encv_internal(cmd, desc, argc, argv, args);
+	res = cmd_encv_internal(cmd, desc, buf, argc, argv, args);
+	va_end(args);
+	return res;
+}
+
+/* function needed because arsdk_cmd_enc_argv_into cannot pass NULL as
+ * va_list. */
+static int cmd_enc_into(void *data, size_t capacity, size_t *len,
+			const struct arsdk_cmd_desc *desc, size_t argc,
+			const struct arsdk_value *argv, ...)
+{
+	int res = 0;
+	va_list args;
+	va_start(args, argv);
+	res = cmd_encv_into(data, capacity, len, desc, argc, argv, args);
 	va_end(args);
 	return res;
 }
@@ -462,7 +607,7 @@ int arsdk_cmd_enc_argv(struct arsdk_cmd *cmd,
 		       const struct arsdk_cmd_desc *desc, size_t argc,
 		       const struct arsdk_value *argv)
 {
-	return cmd_enc_internal(cmd, desc, argc, argv);
+	return cmd_enc_internal(cmd, desc, NULL, argc, argv);
 }
 
 int arsdk_cmd_enc(struct arsdk_cmd *cmd, const struct arsdk_cmd_desc *desc, ...)
@@ -470,7 +615,48 @@ int arsdk_cmd_enc(struct arsdk_cmd *cmd, const struct arsdk_cmd_desc *desc, ...)
 	int res = 0;
 	va_list args;
 	va_start(args, desc);
-	res = cmd_encv_internal(cmd, desc, 0, NULL, args);
+	res = cmd_encv_internal(cmd, desc, NULL, 0, NULL, args);
+	va_end(args);
+	return res;
+}
+
+int arsdk_cmd_enc_with_buf(struct arsdk_cmd *cmd, struct pomp_buffer *buf,
+		const struct arsdk_cmd_desc *desc, ...)
+{
+	int res = 0;
+	va_list args;
+
+	ARSDK_RETURN_ERR_IF_FAILED(buf != NULL, -EINVAL);
+
+	va_start(args, desc);
+	res = cmd_encv_internal(cmd, desc, buf, 0, NULL, args);
 	va_end(args);
 	return res;
 }
+
+int arsdk_cmd_enc_argv_with_buf(struct arsdk_cmd *cmd,
+		struct pomp_buffer *buf, const struct arsdk_cmd_desc *desc,
+		size_t argc, const struct arsdk_value *argv)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(buf != NULL, -EINVAL);
+
+	return cmd_enc_internal(cmd, desc, buf, argc, argv);
+}
+
+int arsdk_cmd_enc_into(void *data, size_t capacity, size_t *len,
+		const struct arsdk_cmd_desc *desc, ...)
+{
+	int res = 0;
+	va_list args;
+	va_start(args, desc);
+	res = cmd_encv_into(data, capacity, len, desc, 0, NULL, args);
+	va_end(args);
+	return res;
+}
+
+int arsdk_cmd_enc_argv_into(void *data, size_t capacity, size_t *len,
+		const struct arsdk_cmd_desc *desc, size_t argc,
+		const struct arsdk_value *argv)
+{
+	return cmd_enc_into(data, capacity, len, desc, argc, argv);
+}
@@ -144,6 +144,8 @@ struct arsdk_cmd_itf {
 		struct arsdk_cmd_itf2      *v2;
 		struct arsdk_cmd_itf3      *v3;
 	} core;
+	/** periodic commands */
+	struct arsdk_cmd_itf_periodic      periodic;
 };
 
 /** peer */
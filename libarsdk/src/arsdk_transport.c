@@ -451,3 +451,13 @@ uint32_t arsdk_transport_get_proto_v(struct arsdk_transport *self)
 	else
 		return 1;
 }
+
+uint32_t arsdk_transport_get_pack_max_size(struct arsdk_transport *self)
+{
+	ARSDK_RETURN_VAL_IF_FAILED(self != NULL, -EINVAL, 0);
+
+	if (self->ops->get_pack_max_size != NULL)
+		return (*self->ops->get_pack_max_size)(self);
+	else
+		return 0;
+}
@@ -47,6 +47,8 @@ const char *arsdk_cmd_itf_cmd_send_status_str(
 		return "TIMEOUT";
 	case ARSDK_CMD_ITF_CMD_SEND_STATUS_CANCELED:
 		return "CANCELED";
+	case ARSDK_CMD_ITF_CMD_SEND_STATUS_EXPIRED:
+		return "EXPIRED";
 	default:
 		return "UNKNOWN";
 	}
@@ -83,11 +85,962 @@ const char *arsdk_cmd_itf_pack_recv_status_str(
 		return "PROCESSED";
 	case ARSDK_CMD_ITF_PACK_RECV_STATUS_IGNORED:
 		return "IGNORED";
+	case ARSDK_CMD_ITF_PACK_RECV_STATUS_HELD:
+		return "HELD";
 	default:
 		return "UNKNOWN";
 	}
 }
 
+/**
+ */
+static void rtt_clamp_rto(struct arsdk_cmd_itf_rtt *rtt)
+{
+	if (rtt->rto_ms < ARSDK_CMD_ITF_RTO_MIN_MS)
+		rtt->rto_ms = ARSDK_CMD_ITF_RTO_MIN_MS;
+	else if (rtt->rto_ms > ARSDK_CMD_ITF_RTO_MAX_MS)
+		rtt->rto_ms = ARSDK_CMD_ITF_RTO_MAX_MS;
+}
+
+/**
+ */
+static void rtt_update_rto(struct arsdk_cmd_itf_rtt *rtt)
+{
+	uint64_t var_us = 0;
+
+	/* RTO <- SRTT + max (G, K*RTTVAR), with a clock granularity G of
+	 * one millisecond */
+	var_us = 4 * rtt->rttvar_us;
+	if (var_us < 1000)
+		var_us = 1000;
+	rtt->rto_ms = (int)((rtt->srtt_us + var_us + 999) / 1000);
+	rtt_clamp_rto(rtt);
+}
+
+/**
+ */
+void arsdk_cmd_itf_rtt_init(struct arsdk_cmd_itf_rtt *rtt, int rto_ms)
+{
+	memset(rtt, 0, sizeof(*rtt));
+	rtt->rto_ms = rto_ms;
+	rtt_clamp_rto(rtt);
+}
+
+/**
+ */
+void arsdk_cmd_itf_rtt_sample(struct arsdk_cmd_itf_rtt *rtt,
+		const struct timespec *sent_ts,
+		const struct timespec *ack_ts)
+{
+	uint64_t sent_us = 0, ack_us = 0, r_us = 0, err_us = 0;
+
+	time_timespec_to_us(sent_ts, &sent_us);
+	time_timespec_to_us(ack_ts, &ack_us);
+	if (ack_us < sent_us)
+		return;
+	r_us = ack_us - sent_us;
+
+	if (rtt->srtt_us == 0) {
+		/* First measurement */
+		rtt->srtt_us = r_us > 0 ? r_us : 1;
+		rtt->rttvar_us = r_us / 2;
+	} else {
+		/* RTTVAR <- 3/4 * RTTVAR + 1/4 * |SRTT - R'|
+		 * SRTT <- 7/8 * SRTT + 1/8 * R' */
+		err_us = rtt->srtt_us > r_us ? rtt->srtt_us - r_us :
+					       r_us - rtt->srtt_us;
+		rtt->rttvar_us = (3 * rtt->rttvar_us + err_us) / 4;
+		rtt->srtt_us = (7 * rtt->srtt_us + r_us) / 8;
+		if (rtt->srtt_us == 0)
+			rtt->srtt_us = 1;
+	}
+
+	rtt_update_rto(rtt);
+}
+
+/**
+ */
+void arsdk_cmd_itf_rtt_ack(struct arsdk_cmd_itf_rtt *rtt)
+{
+	if (rtt->srtt_us != 0)
+		rtt_update_rto(rtt);
+}
+
+/**
+ */
+void arsdk_cmd_itf_rtt_backoff(struct arsdk_cmd_itf_rtt *rtt)
+{
+	rtt->rto_ms *= 2;
+	rtt_clamp_rto(rtt);
+}
+
+/**
+ */
+void arsdk_cmd_itf_cc_enable(struct arsdk_cmd_itf_cc *cc, int enable,
+		size_t pack_size)
+{
+	cc->enabled = enable;
+	cc->pack_size = pack_size > 0 ? pack_size : 1;
+	cc->window = ARSDK_CMD_ITF_CC_INIT_PACKS * cc->pack_size;
+	memset(&cc->decrease_ts, 0, sizeof(cc->decrease_ts));
+}
+
+/**
+ */
+int arsdk_cmd_itf_cc_can_send(const struct arsdk_cmd_itf_cc *cc, size_t len)
+{
+	return !cc->enabled || cc->inflight == 0 ||
+	       cc->inflight + len <= cc->window;
+}
+
+/**
+ */
+void arsdk_cmd_itf_cc_sent(struct arsdk_cmd_itf_cc *cc, size_t len)
+{
+	cc->inflight += len;
+}
+
+/**
+ */
+void arsdk_cmd_itf_cc_acked(struct arsdk_cmd_itf_cc *cc, size_t len)
+{
+	size_t increase = 0;
+
+	cc->inflight = cc->inflight > len ? cc->inflight - len : 0;
+	if (!cc->enabled || len == 0)
+		return;
+
+	/* Additive increase of one pack per window acknowledged */
+	increase = cc->pack_size * len / cc->window;
+	cc->window += increase > 0 ? increase : 1;
+	if (cc->window > ARSDK_CMD_ITF_CC_MAX_PACKS * cc->pack_size)
+		cc->window = ARSDK_CMD_ITF_CC_MAX_PACKS * cc->pack_size;
+}
+
+/**
+ */
+void arsdk_cmd_itf_cc_loss(struct arsdk_cmd_itf_cc *cc,
+		const struct arsdk_cmd_itf_rtt *rtt,
+		const struct timespec *tsnow)
+{
+	uint64_t diff_us = 0;
+
+	if (!cc->enabled)
+		return;
+
+	if ((cc->decrease_ts.tv_sec != 0 || cc->decrease_ts.tv_nsec != 0) &&
+	    time_timespec_diff_in_range(&cc->decrease_ts, tsnow,
+			(uint64_t)rtt->rto_ms * 1000, &diff_us))
+		return;
+
+	/* Multiplicative decrease */
+	cc->decrease_ts = *tsnow;
+	cc->window /= 2;
+	if (cc->window < ARSDK_CMD_ITF_CC_MIN_PACKS * cc->pack_size)
+		cc->window = ARSDK_CMD_ITF_CC_MIN_PACKS * cc->pack_size;
+}
+
+/**
+ */
+void arsdk_cmd_itf_cc_stop(struct arsdk_cmd_itf_cc *cc)
+{
+	cc->inflight = 0;
+}
+
+/**
+ */
+void arsdk_cmd_itf_cc_stats(const struct arsdk_cmd_itf_cc *cc,
+		const struct arsdk_cmd_itf_rtt *rtt,
+		struct arsdk_cmd_itf_queue_stats *stats)
+{
+	uint64_t rtt_us = 0, rate = 0;
+
+	stats->cc_inflight = (uint32_t)cc->inflight;
+	if (!cc->enabled)
+		return;
+
+	/* One window per round trip, the retransmission timeout until the
+	   first sample */
+	rtt_us = rtt->srtt_us != 0 ? rtt->srtt_us :
+				     (uint64_t)rtt->rto_ms * 1000;
+	rate = (uint64_t)cc->window * 1000000 / rtt_us;
+	stats->cc_window = (uint32_t)cc->window;
+	stats->cc_rate = rate > UINT32_MAX ? UINT32_MAX : (uint32_t)rate;
+}
+
+/**
+ */
+static uint32_t coalesce_hash(const struct arsdk_cmd_itf_coalesce *coalesce,
+		uint32_t id)
+{
+	/* Fibonacci hashing, spreads the consecutive identifiers */
+	return (id * UINT32_C(2654435761)) & (coalesce->capacity - 1);
+}
+
+/**
+ */
+static int coalesce_grow(struct arsdk_cmd_itf_coalesce *coalesce)
+{
+	struct arsdk_cmd_itf_coalesce_slot *slots = NULL;
+	struct arsdk_cmd_itf_coalesce_slot *old_slots = coalesce->slots;
+	uint32_t old_capacity = coalesce->capacity;
+	uint32_t capacity = old_capacity == 0 ? 8 : old_capacity * 2;
+	uint32_t i = 0, h = 0;
+
+	slots = calloc(capacity, sizeof(*slots));
+	if (slots == NULL)
+		return -ENOMEM;
+
+	coalesce->slots = slots;
+	coalesce->capacity = capacity;
+
+	/* Rehash the used slots */
+	for (i = 0; i < old_capacity; i++) {
+		if (!old_slots[i].used)
+			continue;
+		h = coalesce_hash(coalesce, old_slots[i].id);
+		while (slots[h].used)
+			h = (h + 1) & (capacity - 1);
+		slots[h] = old_slots[i];
+	}
+
+	free(old_slots);
+	return 0;
+}
+
+/**
+ */
+struct arsdk_cmd_itf_coalesce_slot *arsdk_cmd_itf_coalesce_find(
+		const struct arsdk_cmd_itf_coalesce *coalesce, uint32_t id)
+{
+	uint32_t h = 0;
+
+	if (coalesce->count == 0)
+		return NULL;
+
+	h = coalesce_hash(coalesce, id);
+	while (coalesce->slots[h].used) {
+		if (coalesce->slots[h].id == id)
+			return &coalesce->slots[h];
+		h = (h + 1) & (coalesce->capacity - 1);
+	}
+
+	return NULL;
+}
+
+/**
+ */
+int arsdk_cmd_itf_coalesce_set(struct arsdk_cmd_itf_coalesce *coalesce,
+		uint32_t id, int enable)
+{
+	int res = 0;
+	struct arsdk_cmd_itf_coalesce_slot *slot = NULL;
+	uint32_t i = 0, j = 0, h = 0, mask = 0;
+
+	slot = arsdk_cmd_itf_coalesce_find(coalesce, id);
+	if (enable) {
+		if (slot != NULL)
+			return 0;
+
+		/* Keep the table at most half full */
+		if (2 * (coalesce->count + 1) > coalesce->capacity) {
+			res = coalesce_grow(coalesce);
+			if (res < 0)
+				return res;
+		}
+
+		h = coalesce_hash(coalesce, id);
+		while (coalesce->slots[h].used)
+			h = (h + 1) & (coalesce->capacity - 1);
+		coalesce->slots[h].id = id;
+		coalesce->slots[h].pos = 0;
+		coalesce->slots[h].used = 1;
+		coalesce->count++;
+		return 0;
+	}
+
+	if (slot == NULL)
+		return 0;
+
+	/* Remove the slot, moving back the following ones of its cluster
+	 * which would not be found anymore */
+	mask = coalesce->capacity - 1;
+	i = (uint32_t)(slot - coalesce->slots);
+	memset(&coalesce->slots[i], 0, sizeof(coalesce->slots[i]));
+	j = i;
+	while (1) {
+		j = (j + 1) & mask;
+		if (!coalesce->slots[j].used)
+			break;
+		h = coalesce_hash(coalesce, coalesce->slots[j].id);
+		/* Keep the slot if its home is cyclically in ]i;j] */
+		if (((j - h) & mask) < ((j - i) & mask))
+			continue;
+		coalesce->slots[i] = coalesce->slots[j];
+		memset(&coalesce->slots[j], 0, sizeof(coalesce->slots[j]));
+		i = j;
+	}
+	coalesce->count--;
+	return 0;
+}
+
+/**
+ */
+void arsdk_cmd_itf_coalesce_clear(struct arsdk_cmd_itf_coalesce *coalesce)
+{
+	free(coalesce->slots);
+	memset(coalesce, 0, sizeof(*coalesce));
+}
+
+/**
+ */
+int arsdk_cmd_itf_queue_bound_set(struct arsdk_cmd_itf_queue_bound *bound,
+		enum arsdk_cmd_buffer_type type, uint32_t high, uint32_t low)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(high == 0 || low < high, -EINVAL);
+
+	bound->high = high;
+	bound->low = high == 0 ? 0 : low;
+	bound->type = type;
+	if (high == 0)
+		bound->blocked = 0;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf_queue_bound_check(struct arsdk_cmd_itf_queue_bound *bound,
+		uint32_t count)
+{
+	if (bound->high == 0 || count < bound->high)
+		return 0;
+
+	bound->blocked = 1;
+	return -EAGAIN;
+}
+
+/**
+ */
+int arsdk_cmd_itf_queue_bound_drained(struct arsdk_cmd_itf_queue_bound *bound,
+		uint32_t count)
+{
+	if (!bound->blocked || count > bound->low)
+		return 0;
+
+	bound->blocked = 0;
+	return 1;
+}
+
+/**
+ */
+uint32_t arsdk_cmd_itf_queue_bound_grow(
+		const struct arsdk_cmd_itf_queue_bound *bound, uint32_t depth)
+{
+	uint32_t newdepth = depth == 0 ? ARSDK_CMD_ITF_QUEUE_MIN_DEPTH :
+					 depth * 2;
+
+	/* A queue keeps a free entry, there are at most 'high' pending
+	 * commands */
+	if (bound->high != 0 && newdepth > bound->high + 1)
+		newdepth = bound->high + 1;
+	return newdepth;
+}
+
+/**
+ */
+int arsdk_cmd_itf_queue_match_type(const struct arsdk_cmd_queue_info *info,
+		enum arsdk_cmd_buffer_type buffer_type)
+{
+	switch (buffer_type) {
+	case ARSDK_CMD_BUFFER_TYPE_NON_ACK:
+		return info->type == ARSDK_TRANSPORT_DATA_TYPE_NOACK;
+
+	case ARSDK_CMD_BUFFER_TYPE_ACK:
+	case ARSDK_CMD_BUFFER_TYPE_HIGH_PRIO:
+		return info->type == ARSDK_TRANSPORT_DATA_TYPE_WITHACK &&
+		       info->id != ARSDK_TRANSPORT_ID_D2C_CMD_LOWPRIO;
+
+	case ARSDK_CMD_BUFFER_TYPE_LOW_PRIO:
+		return info->type == ARSDK_TRANSPORT_DATA_TYPE_WITHACK &&
+		       info->id == ARSDK_TRANSPORT_ID_D2C_CMD_LOWPRIO;
+
+	default:
+		return 0;
+	}
+}
+
+/**
+ */
+int arsdk_cmd_itf_pack_delay_wait(int delay_ms,
+		const struct timespec *queued_ts,
+		const struct timespec *tsnow,
+		int *next_timeout_ms)
+{
+	uint64_t diff_us = 0;
+	int remaining_ms = 0;
+
+	if (delay_ms <= 0 || !time_timespec_diff_in_range(queued_ts, tsnow,
+			(uint64_t)delay_ms * 1000, &diff_us))
+		return 0;
+
+	/* Never wait less than a millisecond, a null timeout would
+	   deactivate the timer */
+	remaining_ms = delay_ms - (int)(diff_us / 1000);
+	if (remaining_ms <= 0)
+		return 0;
+
+	if (*next_timeout_ms < 0 || remaining_ms < *next_timeout_ms)
+		*next_timeout_ms = remaining_ms;
+	return 1;
+}
+
+/**
+ */
+int arsdk_cmd_itf_cmd_buf_set(struct pomp_buffer **buf,
+		const void *data, size_t len)
+{
+	int res = 0;
+
+	if (*buf != NULL && pomp_buffer_is_shared(*buf)) {
+		pomp_buffer_unref(*buf);
+		*buf = NULL;
+	}
+
+	if (*buf == NULL) {
+		*buf = pomp_buffer_new(len);
+		if (*buf == NULL)
+			return -ENOMEM;
+	} else {
+		res = pomp_buffer_set_len(*buf, 0);
+		if (res < 0)
+			return res;
+	}
+
+	return pomp_buffer_append_data(*buf, data, len);
+}
+
+/**
+ */
+int arsdk_cmd_itf_cmd_expired(uint32_t ttl_ms,
+		const struct timespec *queued_ts,
+		const struct timespec *tsnow)
+{
+	uint64_t diff_us = 0;
+
+	if (ttl_ms == 0)
+		return 0;
+
+	return !time_timespec_diff_in_range(queued_ts, tsnow,
+			(uint64_t)ttl_ms * 1000, &diff_us);
+}
+
+/**
+ */
+void arsdk_cmd_itf_timer_update(struct pomp_timer *timer,
+		uint64_t *expire_us,
+		const struct timespec *tsnow,
+		int next_timeout_ms,
+		int all)
+{
+	int res = 0;
+	uint64_t now_us = 0, next_us = 0;
+
+	if (next_timeout_ms <= 0) {
+		if (!all)
+			return;
+
+		*expire_us = 0;
+		res = pomp_timer_clear(timer);
+		if (res < 0)
+			ARSDK_LOG_ERRNO("pomp_timer_clear", -res);
+		return;
+	}
+
+	time_timespec_to_us(tsnow, &now_us);
+	next_us = now_us + (uint64_t)next_timeout_ms * 1000;
+
+	/* Keep the timer armed for an earlier check */
+	if (!all && *expire_us != 0 && *expire_us <= next_us)
+		return;
+
+	*expire_us = next_us;
+	res = pomp_timer_set(timer, (uint32_t)next_timeout_ms);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("pomp_timer_set", -res);
+}
+
+/**
+ */
+int arsdk_cmd_itf_sched_init(struct arsdk_cmd_itf_sched *sched,
+		uint32_t count, size_t quantum)
+{
+	memset(sched, 0, sizeof(*sched));
+
+	sched->order = calloc(count, sizeof(*sched->order));
+	if (sched->order == NULL)
+		return -ENOMEM;
+
+	sched->count = count;
+	sched->quantum = quantum;
+	return 0;
+}
+
+/**
+ */
+void arsdk_cmd_itf_sched_clear(struct arsdk_cmd_itf_sched *sched)
+{
+	free(sched->order);
+	memset(sched, 0, sizeof(*sched));
+}
+
+/**
+ * Orders the first 'count' queues by priority level, keeping their order of
+ * creation within a level.
+ */
+static void sched_sort(struct arsdk_cmd_itf_sched *sched, uint32_t count)
+{
+	uint32_t i = 0, j = 0;
+	struct arsdk_cmd_itf_sched_queue *sq = NULL;
+
+	for (i = 1; i < count; i++) {
+		sq = sched->order[i];
+		for (j = i; j > 0 && sched->order[j - 1]->params.priority >
+				sq->params.priority; j--)
+			sched->order[j] = sched->order[j - 1];
+		sched->order[j] = sq;
+	}
+}
+
+/**
+ * Updates whether the queues are scheduled, they can send without limit
+ * otherwise; the budgets restart from the next check.
+ */
+static void sched_update_limited(struct arsdk_cmd_itf_sched *sched)
+{
+	uint32_t i = 0;
+
+	sched->limited = sched->budget != 0;
+	for (i = 0; i < sched->count; i++)
+		sched->limited |= sched->order[i]->params.budget != 0;
+
+	sched->tick_sent = 0;
+	for (i = 0; i < sched->count; i++) {
+		sched->order[i]->allowance = INT64_MAX;
+		sched->order[i]->deficit = 0;
+		sched->order[i]->tick_sent = 0;
+	}
+}
+
+/**
+ */
+void arsdk_cmd_itf_sched_add(struct arsdk_cmd_itf_sched *sched,
+		uint32_t idx,
+		struct arsdk_cmd_itf_sched_queue *sq,
+		const struct arsdk_cmd_queue_info *info,
+		void *queue)
+{
+	memset(sq, 0, sizeof(*sq));
+	sq->params.priority = arsdk_cmd_itf_queue_match_type(info,
+			ARSDK_CMD_BUFFER_TYPE_LOW_PRIO) ? 1 : 0;
+	sq->params.weight = 1;
+	sq->queue = queue;
+	sq->allowance = INT64_MAX;
+
+	/* Queues are added in their order of creation */
+	sched->order[idx] = sq;
+	sched_sort(sched, idx + 1);
+}
+
+/**
+ */
+int arsdk_cmd_itf_sched_set_queue(struct arsdk_cmd_itf_sched *sched,
+		struct arsdk_cmd_itf_sched_queue *sq,
+		const struct arsdk_cmd_itf_queue_sched *params)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(params->weight > 0, -EINVAL);
+
+	sq->params = *params;
+	sched_sort(sched, sched->count);
+	sched_update_limited(sched);
+	return 0;
+}
+
+/**
+ */
+void arsdk_cmd_itf_sched_set_budget(struct arsdk_cmd_itf_sched *sched,
+		uint32_t budget)
+{
+	sched->budget = budget;
+	sched_update_limited(sched);
+}
+
+/**
+ * Computes the bytes sent over a budget in a tick.
+ */
+static int64_t sched_excess(int64_t sent, uint32_t budget)
+{
+	return budget != 0 && sent > (int64_t)budget ?
+			sent - (int64_t)budget : 0;
+}
+
+/**
+ * Starts a new tick if the current one is over.
+ *
+ * @return the time remaining in the current tick; in millisecond.
+ */
+static int sched_tick(struct arsdk_cmd_itf_sched *sched,
+		const struct timespec *tsnow)
+{
+	uint64_t diff_us = 0;
+	int remaining_ms = 0;
+	uint32_t i = 0;
+	struct arsdk_cmd_itf_sched_queue *sq = NULL;
+
+	if (time_timespec_diff_in_range(&sched->tick_ts, tsnow,
+			(uint64_t)ARSDK_CMD_ITF_SCHED_TICK_MS * 1000,
+			&diff_us)) {
+		remaining_ms = ARSDK_CMD_ITF_SCHED_TICK_MS -
+				(int)(diff_us / 1000);
+		if (remaining_ms > 0)
+			return remaining_ms;
+	}
+
+	/* The last pack of a tick may exceed the budgets, the excess is paid
+	   back in the new tick */
+	sched->tick_ts = *tsnow;
+	sched->tick_sent = sched_excess(sched->tick_sent, sched->budget);
+	for (i = 0; i < sched->count; i++) {
+		sq = sched->order[i];
+		sq->tick_sent = sched_excess(sq->tick_sent, sq->params.budget);
+	}
+	return ARSDK_CMD_ITF_SCHED_TICK_MS;
+}
+
+/**
+ * Computes the bytes a queue can send in its next check.
+ */
+static void sched_allow(struct arsdk_cmd_itf_sched *sched,
+		struct arsdk_cmd_itf_sched_queue *sq)
+{
+	int64_t allowance = INT64_MAX;
+
+	/* Share the budget of the interface by deficit round robin; the
+	   deficit of a pack exceeding its turn is paid back in the next one */
+	if (sched->budget != 0) {
+		if (sq->deficit > 0)
+			sq->deficit = 0;
+		sq->deficit += (int64_t)sched->quantum * sq->params.weight;
+		allowance = sq->deficit;
+
+		if (allowance > (int64_t)sched->budget - sched->tick_sent)
+			allowance = (int64_t)sched->budget - sched->tick_sent;
+	}
+
+	if (sq->params.budget != 0 &&
+	    allowance > (int64_t)sq->params.budget - sq->tick_sent)
+		allowance = (int64_t)sq->params.budget - sq->tick_sent;
+
+	sq->allowance = allowance;
+	sq->blocked = 0;
+}
+
+/**
+ * Checks whether a queue used its budget or the one of the interface in the
+ * current tick.
+ */
+static int sched_budget_used(struct arsdk_cmd_itf_sched *sched,
+		struct arsdk_cmd_itf_sched_queue *sq)
+{
+	return (sched->budget != 0 && sched->tick_sent >= sched->budget) ||
+	       (sq->params.budget != 0 && sq->tick_sent >= sq->params.budget);
+}
+
+/**
+ */
+void arsdk_cmd_itf_sched_run(struct arsdk_cmd_itf_sched *sched,
+		const struct timespec *tsnow,
+		int *next_timeout_ms,
+		arsdk_cmd_itf_sched_check_t check,
+		void *userdata)
+{
+	uint32_t first = 0, end = 0, i = 0;
+	int remaining_ms = 0;
+	int sending = 0, waiting = 0;
+	int64_t allowance = 0;
+	struct arsdk_cmd_itf_sched_queue *sq = NULL;
+
+	if (!sched->limited) {
+		for (i = 0; i < sched->count; i++)
+			(*check)(sched->order[i]->queue, tsnow,
+					next_timeout_ms, userdata);
+		return;
+	}
+
+	remaining_ms = sched_tick(sched, tsnow);
+
+	for (first = 0; first < sched->count; first = end) {
+		/* Queues of the same level */
+		end = first + 1;
+		while (end < sched->count &&
+		       sched->order[end]->params.priority ==
+				sched->order[first]->params.priority)
+			end++;
+
+		/* Rounds while the queues of the level send */
+		do {
+			sending = 0;
+			for (i = first; i < end; i++) {
+				sq = sched->order[i];
+				sched_allow(sched, sq);
+				allowance = sq->allowance;
+
+				(*check)(sq->queue, tsnow, next_timeout_ms,
+						userdata);
+
+				sending |= sq->allowance < allowance;
+				if (!sq->blocked)
+					sq->deficit = 0;
+				else if (sched_budget_used(sched, sq))
+					waiting = 1;
+			}
+		} while (sending && (sched->budget == 0 ||
+				     sched->tick_sent < sched->budget));
+	}
+
+	/* Check again the queues waiting for a budget at the next tick */
+	if (waiting && (*next_timeout_ms < 0 ||
+			remaining_ms < *next_timeout_ms))
+		*next_timeout_ms = remaining_ms;
+}
+
+/**
+ */
+int arsdk_cmd_itf_sched_can_send(struct arsdk_cmd_itf_sched_queue *sq)
+{
+	if (sq->allowance > 0)
+		return 1;
+
+	sq->blocked = 1;
+	return 0;
+}
+
+/**
+ */
+void arsdk_cmd_itf_sched_sent(struct arsdk_cmd_itf_sched *sched,
+		struct arsdk_cmd_itf_sched_queue *sq,
+		size_t len)
+{
+	if (!sched->limited)
+		return;
+
+	sq->allowance -= (int64_t)len;
+	sq->deficit -= (int64_t)len;
+	sq->tick_sent += (int64_t)len;
+	sched->tick_sent += (int64_t)len;
+}
+
+/**
+ */
+void arsdk_cmd_itf_histo_add(struct arsdk_cmd_itf_histo *histo,
+		const struct timespec *start,
+		const struct timespec *end)
+{
+	uint64_t start_us = 0, end_us = 0, ms = 0;
+	uint32_t i = 0;
+
+	time_timespec_to_us(start, &start_us);
+	time_timespec_to_us(end, &end_us);
+	ms = end_us > start_us ? (end_us - start_us) / 1000 : 0;
+
+	/* Bucket 'i' counts the durations in [2^(i-1);2^i[ ms */
+	while (ms != 0 && i < ARSDK_CMD_ITF_HISTO_BUCKET_COUNT - 1) {
+		ms >>= 1;
+		i++;
+	}
+	histo->buckets[i]++;
+}
+
+/**
+ */
+void arsdk_cmd_itf_queue_stats_init(struct arsdk_cmd_itf_queue_stats *stats,
+		const struct arsdk_cmd_queue_info *info)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->id = info->id;
+	switch (info->type) {
+	case ARSDK_TRANSPORT_DATA_TYPE_NOACK:
+		stats->type = ARSDK_CMD_BUFFER_TYPE_NON_ACK;
+		break;
+	case ARSDK_TRANSPORT_DATA_TYPE_WITHACK:
+		stats->type = info->id == ARSDK_TRANSPORT_ID_D2C_CMD_LOWPRIO ?
+				ARSDK_CMD_BUFFER_TYPE_LOW_PRIO :
+				ARSDK_CMD_BUFFER_TYPE_ACK;
+		break;
+	default:
+		stats->type = ARSDK_CMD_BUFFER_TYPE_INVALID;
+		break;
+	}
+}
+
+/**
+ * Finds a command sent periodically by an interface.
+ */
+static struct arsdk_cmd_itf_periodic_cmd *periodic_find(
+		struct arsdk_cmd_itf_periodic *periodic, uint32_t id)
+{
+	uint32_t i = 0;
+
+	for (i = 0; i < periodic->count; i++) {
+		if (periodic->cmds[i].desc != NULL &&
+		    periodic->cmds[i].id == id)
+			return &periodic->cmds[i];
+	}
+
+	return NULL;
+}
+
+/**
+ * Releases the periodic commands removed, keeping the order of the other
+ * ones.
+ */
+static void periodic_compact(struct arsdk_cmd_itf_periodic *periodic)
+{
+	uint32_t i = 0, count = 0;
+
+	for (i = 0; i < periodic->count; i++) {
+		if (periodic->cmds[i].desc == NULL)
+			continue;
+		if (count != i)
+			periodic->cmds[count] = periodic->cmds[i];
+		count++;
+	}
+	periodic->count = count;
+}
+
+/**
+ * Arms the timer of the periodic commands for the next one due, clears it
+ * if there is none.
+ */
+static void periodic_update_timer(struct arsdk_cmd_itf_periodic *periodic,
+		uint64_t now_us)
+{
+	int res = 0;
+	uint32_t i = 0;
+	uint64_t due_us = UINT64_MAX;
+	uint64_t delay_ms = 0;
+
+	for (i = 0; i < periodic->count; i++) {
+		if (periodic->cmds[i].desc != NULL &&
+		    periodic->cmds[i].due_us < due_us)
+			due_us = periodic->cmds[i].due_us;
+	}
+
+	if (due_us == UINT64_MAX) {
+		res = pomp_timer_clear(periodic->timer);
+		if (res < 0)
+			ARSDK_LOG_ERRNO("pomp_timer_clear", -res);
+		return;
+	}
+
+	/* Never wait less than a millisecond, a null timeout would
+	   deactivate the timer */
+	if (due_us > now_us)
+		delay_ms = (due_us - now_us + 999) / 1000;
+	if (delay_ms == 0)
+		delay_ms = 1;
+
+	res = pomp_timer_set(periodic->timer, (uint32_t)delay_ms);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("pomp_timer_set", -res);
+}
+
+/**
+ * Fills and sends a periodic command.
+ */
+static void periodic_send(struct arsdk_cmd_itf *self,
+		const struct arsdk_cmd_itf_periodic_cmd *pcmd)
+{
+	int res = 0;
+	struct arsdk_cmd cmd;
+	/* The fill function may add or remove periodic commands */
+	const struct arsdk_cmd_desc *desc = pcmd->desc;
+	arsdk_cmd_itf_periodic_fill_cb_t fill = pcmd->fill;
+	void *userdata = pcmd->userdata;
+
+	arsdk_cmd_init(&cmd);
+	res = (*fill)(self, desc, &cmd, userdata);
+	if (res < 0)
+		goto out;
+
+	res = arsdk_cmd_itf_send(self, &cmd, NULL, NULL);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("arsdk_cmd_itf_send", -res);
+
+out:
+	arsdk_cmd_clear(&cmd);
+}
+
+/**
+ */
+static void periodic_timer_cb(struct pomp_timer *timer, void *userdata)
+{
+	struct arsdk_cmd_itf *self = userdata;
+	struct arsdk_cmd_itf_periodic *periodic = &self->periodic;
+	struct arsdk_cmd_itf_periodic_cmd *pcmd = NULL;
+	struct timespec tsnow;
+	uint64_t now_us = 0, limit_us = 0;
+	uint32_t i = 0;
+
+	if (time_get_monotonic(&tsnow) < 0) {
+		ARSDK_LOG_ERRNO("time_get_monotonic", errno);
+		return;
+	}
+	time_timespec_to_us(&tsnow, &now_us);
+	limit_us = now_us + ARSDK_CMD_ITF_PERIODIC_SLACK_MS * 1000;
+
+	/* Send the commands due in the same batch, they are packed together
+	   once all filled */
+	periodic->running = 1;
+	arsdk_cmd_itf_batch_begin(self);
+	for (i = 0; i < periodic->count; i++) {
+		pcmd = &periodic->cmds[i];
+		if (pcmd->desc == NULL || pcmd->due_us > limit_us)
+			continue;
+
+		/* Keep the phase of the command unless late by a period */
+		pcmd->due_us += (uint64_t)pcmd->period_ms * 1000;
+		if (pcmd->due_us <= now_us)
+			pcmd->due_us = now_us + (uint64_t)pcmd->period_ms * 1000;
+
+		periodic_send(self, pcmd);
+	}
+	arsdk_cmd_itf_batch_end(self);
+	periodic->running = 0;
+
+	periodic_compact(periodic);
+	periodic_update_timer(periodic, now_us);
+}
+
+/**
+ * Stops sending all the periodic commands.
+ */
+static void periodic_clear(struct arsdk_cmd_itf_periodic *periodic)
+{
+	int res = 0;
+	uint32_t i = 0;
+
+	for (i = 0; i < periodic->count; i++)
+		periodic->cmds[i].desc = NULL;
+	if (!periodic->running)
+		periodic->count = 0;
+
+	if (periodic->timer != NULL) {
+		res = pomp_timer_clear(periodic->timer);
+		if (res < 0)
+			ARSDK_LOG_ERRNO("pomp_timer_clear", -res);
+	}
+}
+
 static void itf1_dispose(struct arsdk_cmd_itf1 *itf1, void *userdata)
 {
 	struct arsdk_cmd_itf *self = userdata;
@@ -167,6 +1120,14 @@ int arsdk_cmd_itf_new(struct arsdk_transport *transport,
 	self->internal_cbs = *internal_cbs;
 	self->proto_v = arsdk_transport_get_proto_v(transport);
 
+	self->periodic.timer = pomp_timer_new(
+			arsdk_transport_get_loop(transport),
+			&periodic_timer_cb, self);
+	if (self->periodic.timer == NULL) {
+		res = -ENOMEM;
+		goto error;
+	}
+
 	if (self->proto_v > 2) {
 		itf3_cbs.userdata = self;
 		res = arsdk_cmd_itf3_new(transport, &itf3_cbs, cbs, self,
@@ -206,6 +1167,11 @@ int arsdk_cmd_itf_destroy(struct arsdk_cmd_itf *self)
 	else
 		arsdk_cmd_itf1_destroy(self->core.v1);
 
+	if (self->periodic.timer != NULL) {
+		periodic_clear(&self->periodic);
+		pomp_timer_destroy(self->periodic.timer);
+	}
+	free(self->periodic.cmds);
 
 	free(self);
 	return 0;
@@ -235,6 +1201,8 @@ int arsdk_cmd_itf_stop(struct arsdk_cmd_itf *self)
 
 	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
 
+	periodic_clear(&self->periodic);
+
 	if (self->proto_v > 2)
 		res = arsdk_cmd_itf3_stop(self->core.v3);
 	else if (self->proto_v == 2)
@@ -270,6 +1238,386 @@ int arsdk_cmd_itf_send(struct arsdk_cmd_itf *self,
 	return res;
 }
 
+/**
+ */
+int arsdk_cmd_itf_send_enc_begin(struct arsdk_cmd_itf *self,
+		const struct arsdk_cmd_desc *desc,
+		size_t len,
+		uint8_t **data)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	if (self->proto_v > 2) {
+		return arsdk_cmd_itf3_send_enc_begin(self->core.v3, desc,
+				len, data);
+	} else if (self->proto_v == 2) {
+		return arsdk_cmd_itf2_send_enc_begin(self->core.v2, desc,
+				len, data);
+	}
+
+	/* Always sent from a command buffer */
+	return -EAGAIN;
+}
+
+/**
+ */
+int arsdk_cmd_itf_send_enc_end(struct arsdk_cmd_itf *self,
+		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
+		void *userdata)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	if (self->proto_v > 2) {
+		return arsdk_cmd_itf3_send_enc_end(self->core.v3, send_status,
+				userdata);
+	} else if (self->proto_v == 2) {
+		return arsdk_cmd_itf2_send_enc_end(self->core.v2, send_status,
+				userdata);
+	}
+
+	return -EPERM;
+}
+
+/**
+ */
+int arsdk_cmd_itf_batch_begin(struct arsdk_cmd_itf *self)
+{
+	int res;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	if (self->proto_v > 2)
+		res = arsdk_cmd_itf3_batch_begin(self->core.v3);
+	else if (self->proto_v == 2)
+		res = arsdk_cmd_itf2_batch_begin(self->core.v2);
+	else
+		res = arsdk_cmd_itf1_batch_begin(self->core.v1);
+
+	return res;
+}
+
+/**
+ */
+int arsdk_cmd_itf_batch_end(struct arsdk_cmd_itf *self)
+{
+	int res;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	if (self->proto_v > 2)
+		res = arsdk_cmd_itf3_batch_end(self->core.v3);
+	else if (self->proto_v == 2)
+		res = arsdk_cmd_itf2_batch_end(self->core.v2);
+	else
+		res = arsdk_cmd_itf1_batch_end(self->core.v1);
+
+	return res;
+}
+
+/**
+ */
+int arsdk_cmd_itf_send_batch(struct arsdk_cmd_itf *self,
+		const struct arsdk_cmd *cmds,
+		size_t count,
+		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
+		void *userdata)
+{
+	int res = 0;
+	size_t i = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cmds != NULL || count == 0, -EINVAL);
+
+	res = arsdk_cmd_itf_batch_begin(self);
+	if (res < 0)
+		return res;
+
+	for (i = 0; i < count; i++) {
+		res = arsdk_cmd_itf_send(self, &cmds[i], send_status,
+				userdata);
+		if (res < 0)
+			break;
+	}
+
+	/* Send what was queued, even on error */
+	arsdk_cmd_itf_batch_end(self);
+	return res;
+}
+
+/**
+ */
+int arsdk_cmd_itf_set_cmd_coalescing(struct arsdk_cmd_itf *self,
+		const struct arsdk_cmd_desc *desc,
+		int enable)
+{
+	int res;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
+
+	if (self->proto_v > 2) {
+		res = arsdk_cmd_itf3_set_cmd_coalescing(self->core.v3, desc,
+				enable);
+	} else if (self->proto_v == 2) {
+		res = arsdk_cmd_itf2_set_cmd_coalescing(self->core.v2, desc,
+				enable);
+	} else {
+		/* The version 1 overwrites the commands of the queues
+		 * configured for it */
+		res = -ENOSYS;
+	}
+
+	return res;
+}
+
+/**
+ */
+int arsdk_cmd_itf_set_pack_delay(struct arsdk_cmd_itf *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t delay_ms)
+{
+	int res;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	if (self->proto_v > 2) {
+		res = arsdk_cmd_itf3_set_pack_delay(self->core.v3, type,
+				delay_ms);
+	} else if (self->proto_v == 2) {
+		res = arsdk_cmd_itf2_set_pack_delay(self->core.v2, type,
+				delay_ms);
+	} else {
+		/* The version 1 sends a command per packet */
+		res = -ENOSYS;
+	}
+
+	return res;
+}
+
+/**
+ */
+int arsdk_cmd_itf_set_queue_ttl(struct arsdk_cmd_itf *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t ttl_ms)
+{
+	int res;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	if (self->proto_v > 2) {
+		res = arsdk_cmd_itf3_set_queue_ttl(self->core.v3, type,
+				ttl_ms);
+	} else if (self->proto_v == 2) {
+		res = arsdk_cmd_itf2_set_queue_ttl(self->core.v2, type,
+				ttl_ms);
+	} else {
+		/* The version 1 keeps retrying its commands */
+		res = -ENOSYS;
+	}
+
+	return res;
+}
+
+/**
+ */
+int arsdk_cmd_itf_set_queue_sched(struct arsdk_cmd_itf *self,
+		enum arsdk_cmd_buffer_type type,
+		const struct arsdk_cmd_itf_queue_sched *sched)
+{
+	int res;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(sched != NULL, -EINVAL);
+
+	if (self->proto_v > 2) {
+		res = arsdk_cmd_itf3_set_queue_sched(self->core.v3, type,
+				sched);
+	} else if (self->proto_v == 2) {
+		res = arsdk_cmd_itf2_set_queue_sched(self->core.v2, type,
+				sched);
+	} else {
+		/* The version 1 sends its queues at their own rates */
+		res = -ENOSYS;
+	}
+
+	return res;
+}
+
+/**
+ */
+int arsdk_cmd_itf_set_tx_budget(struct arsdk_cmd_itf *self,
+		uint32_t budget)
+{
+	int res;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	if (self->proto_v > 2)
+		res = arsdk_cmd_itf3_set_tx_budget(self->core.v3, budget);
+	else if (self->proto_v == 2)
+		res = arsdk_cmd_itf2_set_tx_budget(self->core.v2, budget);
+	else
+		res = -ENOSYS;
+
+	return res;
+}
+
+/**
+ */
+int arsdk_cmd_itf_set_congestion_control(struct arsdk_cmd_itf *self,
+		int enable)
+{
+	int res;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	if (self->proto_v > 2) {
+		res = arsdk_cmd_itf3_set_congestion_control(self->core.v3,
+				enable);
+	} else if (self->proto_v == 2) {
+		res = arsdk_cmd_itf2_set_congestion_control(self->core.v2,
+				enable);
+	} else {
+		res = -ENOSYS;
+	}
+
+	return res;
+}
+
+/**
+ */
+int arsdk_cmd_itf_periodic_add(struct arsdk_cmd_itf *self,
+		const struct arsdk_cmd_desc *desc,
+		uint32_t period_ms,
+		arsdk_cmd_itf_periodic_fill_cb_t fill,
+		void *userdata)
+{
+	struct arsdk_cmd_itf_periodic *periodic = NULL;
+	struct arsdk_cmd_itf_periodic_cmd *pcmd = NULL;
+	struct arsdk_cmd_itf_periodic_cmd *cmds = NULL;
+	uint32_t id = 0, capacity = 0;
+	struct timespec tsnow;
+	uint64_t now_us = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(period_ms > 0, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(fill != NULL, -EINVAL);
+
+	periodic = &self->periodic;
+	id = ARSDK_CMD_FULL_ID(desc->prj_id, desc->cls_id, desc->cmd_id);
+	if (periodic_find(periodic, id) != NULL)
+		return -EEXIST;
+
+	if (time_get_monotonic(&tsnow) < 0)
+		return -errno;
+	time_timespec_to_us(&tsnow, &now_us);
+
+	/* Grow the array of commands if needed */
+	if (periodic->count == periodic->capacity) {
+		capacity = periodic->capacity == 0 ? 4 :
+				periodic->capacity * 2;
+		cmds = realloc(periodic->cmds, capacity * sizeof(*cmds));
+		if (cmds == NULL)
+			return -ENOMEM;
+		periodic->cmds = cmds;
+		periodic->capacity = capacity;
+	}
+
+	pcmd = &periodic->cmds[periodic->count++];
+	pcmd->id = id;
+	pcmd->desc = desc;
+	pcmd->period_ms = period_ms;
+	pcmd->due_us = now_us + (uint64_t)period_ms * 1000;
+	pcmd->fill = fill;
+	pcmd->userdata = userdata;
+
+	/* The timer is armed at the end of the commands filling */
+	if (!periodic->running)
+		periodic_update_timer(periodic, now_us);
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf_periodic_remove(struct arsdk_cmd_itf *self,
+		const struct arsdk_cmd_desc *desc)
+{
+	struct arsdk_cmd_itf_periodic *periodic = NULL;
+	struct arsdk_cmd_itf_periodic_cmd *pcmd = NULL;
+	struct timespec tsnow;
+	uint64_t now_us = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
+
+	periodic = &self->periodic;
+	pcmd = periodic_find(periodic,
+			ARSDK_CMD_FULL_ID(desc->prj_id, desc->cls_id,
+			desc->cmd_id));
+	if (pcmd == NULL)
+		return -ENOENT;
+
+	/* Released at the end of the commands filling */
+	pcmd->desc = NULL;
+	if (periodic->running)
+		return 0;
+
+	periodic_compact(periodic);
+	if (time_get_monotonic(&tsnow) < 0)
+		return -errno;
+	time_timespec_to_us(&tsnow, &now_us);
+	periodic_update_timer(periodic, now_us);
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf_set_queue_watermarks(struct arsdk_cmd_itf *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t high,
+		uint32_t low)
+{
+	int res;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	if (self->proto_v > 2) {
+		res = arsdk_cmd_itf3_set_queue_watermarks(self->core.v3, type,
+				high, low);
+	} else if (self->proto_v == 2) {
+		res = arsdk_cmd_itf2_set_queue_watermarks(self->core.v2, type,
+				high, low);
+	} else {
+		res = arsdk_cmd_itf1_set_queue_watermarks(self->core.v1, type,
+				high, low);
+	}
+
+	return res;
+}
+
+/**
+ */
+int arsdk_cmd_itf_get_stats(struct arsdk_cmd_itf *self,
+		struct arsdk_cmd_itf_queue_stats *stats,
+		uint32_t *count)
+{
+	int res;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(count != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(stats != NULL || *count == 0, -EINVAL);
+
+	if (self->proto_v > 2)
+		res = arsdk_cmd_itf3_get_stats(self->core.v3, stats, count);
+	else if (self->proto_v == 2)
+		res = arsdk_cmd_itf2_get_stats(self->core.v2, stats, count);
+	else
+		res = arsdk_cmd_itf1_get_stats(self->core.v1, stats, count);
+
+	return res;
+}
+
 /**
  */
 int arsdk_cmd_itf_recv_data(struct arsdk_cmd_itf *self,
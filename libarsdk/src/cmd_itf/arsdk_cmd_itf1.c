@@ -42,6 +42,7 @@ struct entry {
 	int                                     retry_count;
 	int32_t                                 max_retry_count;
 	struct timespec                         sent_ts;
+	struct timespec                         queued_ts;
 };
 
 /** */
@@ -54,6 +55,8 @@ struct queue {
 	uint32_t                     tail;
 	struct timespec              last_sent_ts;
 	uint8_t                      seq;
+	struct arsdk_cmd_itf_queue_bound bound;
+	struct arsdk_cmd_itf_queue_stats stats;
 };
 
 /** */
@@ -67,8 +70,10 @@ struct arsdk_cmd_itf1 {
 	struct pomp_timer                  *timer;
 	struct queue                       **tx_queues;
 	uint32_t                           tx_count;
+	uint32_t                           batch;
 	uint8_t                            ackoff;
 	uint8_t                            next_ack_seq;
+	struct arsdk_cmd_itf_rtt           rtt;
 	uint8_t                            recv_seq[UINT8_MAX+1];
 	struct {
 		struct pomp_timer          *timer;
@@ -150,6 +155,7 @@ static int queue_new(const struct arsdk_cmd_queue_info *info,
 
 	/* Initialize structure */
 	memcpy(&queue->info, info, sizeof(*info));
+	arsdk_cmd_itf_queue_stats_init(&queue->stats, info);
 
 	/* Sequence number will wrap to 0 before sending first packet */
 	queue->seq = UINT8_MAX;
@@ -172,6 +178,7 @@ static void queue_stop(struct queue *queue, struct arsdk_cmd_itf1 *self)
 		entry_notify(entry, self,
 				ARSDK_CMD_ITF_CMD_SEND_STATUS_CANCELED, 1);
 		entry_clear(entry);
+		queue->stats.dropped++;
 
 		/* Continue in circular buffer */
 		pos++;
@@ -179,6 +186,7 @@ static void queue_stop(struct queue *queue, struct arsdk_cmd_itf1 *self)
 			pos = 0;
 	}
 	queue->head = queue->tail = queue->count = 0;
+	queue->bound.blocked = 0;
 }
 
 /**
@@ -224,6 +232,9 @@ replace:
 	entry_clear(entry);
 	entry_init(entry, cmd, send_status, userdata,
 		   queue->info.default_max_retry_count);
+	time_get_monotonic(&entry->queued_ts);
+	queue->stats.queued++;
+	queue->stats.coalesced++;
 	return 0;
 }
 
@@ -235,6 +246,7 @@ static int queue_add(struct queue *queue,
 		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
 		void *userdata)
 {
+	int res = 0;
 	uint32_t newdepth = 0;
 	struct entry *newentries = NULL;
 	struct entry *entry = NULL;
@@ -247,11 +259,17 @@ static int queue_add(struct queue *queue,
 		return 0;
 	}
 
-	/* Grow entries if needed (before it becomes full)
+	/* Refuse the command if the queue is full */
+	res = arsdk_cmd_itf_queue_bound_check(&queue->bound, queue->count);
+	if (res < 0)
+		return res;
+
+	/* Grow entries if needed (before it becomes full), doubling its depth
 	 * As we are using a circular queue, it is easier to alloc a new array
 	 * and copy existing entries at start of it */
 	if (queue->count + 1 >= queue->depth) {
-		newdepth = queue->depth + 16;
+		newdepth = arsdk_cmd_itf_queue_bound_grow(&queue->bound,
+				queue->depth);
 		newentries = calloc(newdepth, sizeof(struct entry));
 		if (newentries == NULL)
 			return -ENOMEM;
@@ -284,10 +302,12 @@ static int queue_add(struct queue *queue,
 	entry = &queue->entries[queue->tail];
 	entry_init(entry, cmd, send_status, userdata,
 		   queue->info.default_max_retry_count);
+	time_get_monotonic(&entry->queued_ts);
 	queue->tail++;
 	if (queue->tail >= queue->depth)
 		queue->tail = 0;
 	queue->count++;
+	queue->stats.queued++;
 
 	return 0;
 }
@@ -306,27 +326,11 @@ static void queue_pop(struct queue *queue)
 
 /**
  */
-static struct queue *find_tx_queue(struct arsdk_cmd_itf1 *self,
-		const struct arsdk_cmd *cmd)
+static struct queue *find_tx_queue_by_type(struct arsdk_cmd_itf1 *self,
+		enum arsdk_cmd_buffer_type buffer_type)
 {
 	uint32_t i = 0;
-	const struct arsdk_cmd_desc *cmd_desc = NULL;
 	struct queue *queue = NULL;
-	enum arsdk_cmd_buffer_type buffer_type = ARSDK_CMD_BUFFER_TYPE_INVALID;
-
-	/* Take buffer type from cmd if valid */
-	if (cmd->buffer_type != ARSDK_CMD_BUFFER_TYPE_INVALID) {
-		buffer_type = cmd->buffer_type;
-	} else {
-		/* Else, get it from command description */
-		cmd_desc = arsdk_cmd_find_desc(cmd);
-		if (cmd_desc == NULL) {
-			ARSDK_LOGW("Unable to find cmd description: %u,%u,%u",
-					cmd->prj_id, cmd->cls_id, cmd->cmd_id);
-			return NULL;
-		}
-		buffer_type = cmd_desc->buffer_type;
-	}
 
 	/* Search suitable queue */
 	for (i = 0; i < self->tx_count; i++) {
@@ -363,6 +367,36 @@ static struct queue *find_tx_queue(struct arsdk_cmd_itf1 *self,
 		}
 	}
 
+	return NULL;
+}
+
+/**
+ */
+static struct queue *find_tx_queue(struct arsdk_cmd_itf1 *self,
+		const struct arsdk_cmd *cmd)
+{
+	const struct arsdk_cmd_desc *cmd_desc = NULL;
+	struct queue *queue = NULL;
+	enum arsdk_cmd_buffer_type buffer_type = ARSDK_CMD_BUFFER_TYPE_INVALID;
+
+	/* Take buffer type from cmd if valid */
+	if (cmd->buffer_type != ARSDK_CMD_BUFFER_TYPE_INVALID) {
+		buffer_type = cmd->buffer_type;
+	} else {
+		/* Else, get it from command description */
+		cmd_desc = arsdk_cmd_find_desc(cmd);
+		if (cmd_desc == NULL) {
+			ARSDK_LOGW("Unable to find cmd description: %u,%u,%u",
+					cmd->prj_id, cmd->cls_id, cmd->cmd_id);
+			return NULL;
+		}
+		buffer_type = cmd_desc->buffer_type;
+	}
+
+	queue = find_tx_queue_by_type(self, buffer_type);
+	if (queue != NULL)
+		return queue;
+
 	/* No suitable queue found */
 	ARSDK_LOGW("Unable to find suitable queue for cmd: %u,%u,%u",
 			cmd->prj_id, cmd->cls_id, cmd->cmd_id);
@@ -401,11 +435,11 @@ again:
 		if (time_timespec_diff_in_range(
 				&entry->sent_ts,
 				tsnow,
-				(uint64_t)queue->info.ack_timeout_ms * 1000,
+				(uint64_t)self->rtt.rto_ms * 1000,
 				&diff_us)) {
 			/* Still need to wait for ack */
 			diff_ms = (int)(diff_us / 1000);
-			remaining_ms = queue->info.ack_timeout_ms - diff_ms;
+			remaining_ms = self->rtt.rto_ms - diff_ms;
 
 			/* If the remaining time is less than a milisecond,
 			   retry now. We should NEVER set next_timeout_ms
@@ -428,14 +462,17 @@ again:
 				ARSDK_CMD_ITF_CMD_SEND_STATUS_TIMEOUT,
 				1);
 			queue_pop(queue);
+			queue->stats.dropped++;
 			goto again;
 		}
 
-		/* Retry sending command */
+		/* Retry sending command, waiting longer for its
+		   acknowledgement */
 		entry->waiting_ack = 0;
 		entry->retry_count++;
 		memset(&entry->sent_ts, 0, sizeof(entry->sent_ts));
 		self->lnqlt.retry_count++;
+		arsdk_cmd_itf_rtt_backoff(&self->rtt);
 	}
 
 	/* If delay between tx is not passed, compute next time of check */
@@ -473,6 +510,14 @@ again:
 	if (res < 0)
 		return;
 
+	if (entry->retry_count == 0) {
+		queue->stats.packed++;
+		queue->stats.sent++;
+	} else {
+		queue->stats.retried++;
+	}
+	queue->stats.pack_size = (uint32_t)len;
+
 	entry_notify(entry, self, ARSDK_CMD_ITF_CMD_SEND_STATUS_PACKED,
 			queue->info.type != ARSDK_TRANSPORT_DATA_TYPE_WITHACK);
 	queue->last_sent_ts = *tsnow;
@@ -481,11 +526,9 @@ again:
 		entry->waiting_ack = 1;
 		entry->sent_ts = *tsnow;
 		/* update ack timeout */
-		if (queue->info.ack_timeout_ms > 0) {
-			diff_ms = queue->info.ack_timeout_ms;
-			if (*next_timeout_ms < 0 || diff_ms < *next_timeout_ms)
-				*next_timeout_ms = diff_ms;
-		}
+		diff_ms = self->rtt.rto_ms;
+		if (*next_timeout_ms < 0 || diff_ms < *next_timeout_ms)
+			*next_timeout_ms = diff_ms;
 	} else {
 		queue_pop(queue);
 		goto again;
@@ -523,6 +566,17 @@ static void check_tx_queues(struct arsdk_cmd_itf1 *self)
 		if (res < 0)
 			ARSDK_LOG_ERRNO("pomp_timer_clear", -res);
 	}
+
+	/* Notify the queues drained */
+	for (i = 0; i < self->tx_count; i++) {
+		queue = self->tx_queues[i];
+		if (!arsdk_cmd_itf_queue_bound_drained(&queue->bound,
+				queue->count) ||
+		    self->itf_cbs.queue_drained == NULL)
+			continue;
+		(*self->itf_cbs.queue_drained)(self->itf, queue->bound.type,
+				self->itf_cbs.userdata);
+	}
 }
 
 /**
@@ -536,6 +590,7 @@ static void recv_ack(struct arsdk_cmd_itf1 *self,
 	struct queue *queue = NULL;
 	struct entry *entry = NULL;
 	char cmdbuf[512] = "";
+	struct timespec tsnow;
 
 	if (payload->cdata == NULL) {
 		ARSDK_LOGW("ACK: missing seq");
@@ -571,6 +626,21 @@ static void recv_ack(struct arsdk_cmd_itf1 *self,
 			return;
 		}
 
+		/* Sample the round trip time if the command was sent only
+		   once */
+		time_get_monotonic(&tsnow);
+		if (entry->retry_count == 0) {
+			arsdk_cmd_itf_rtt_sample(&self->rtt, &entry->sent_ts,
+					&tsnow);
+			arsdk_cmd_itf_histo_add(&queue->stats.ack_rtt,
+					&entry->sent_ts, &tsnow);
+		} else {
+			arsdk_cmd_itf_rtt_ack(&self->rtt);
+		}
+
+		arsdk_cmd_itf_histo_add(&queue->stats.ack_latency,
+				&entry->queued_ts, &tsnow);
+		queue->stats.acked++;
 		self->lnqlt.ack_count++;
 		entry_notify(entry, self,
 				ARSDK_CMD_ITF_CMD_SEND_STATUS_ACK_RECEIVED, 1);
@@ -636,6 +706,17 @@ static void link_quality_timer_cb(struct pomp_timer *timer, void *userdata)
 		(*self->itf_cbs.link_quality)(self->itf, tx_quality, rx_quality,
 				rx_useful, self->itf_cbs.userdata);
 
+	/* Round trip time callback */
+	if (self->itf_cbs.link_quality_rtt) {
+		(*self->itf_cbs.link_quality_rtt)(self->itf,
+				self->rtt.srtt_us != 0 ?
+					(int32_t)(self->rtt.srtt_us / 1000) : -1,
+				self->rtt.srtt_us != 0 ?
+					(int32_t)(self->rtt.rttvar_us / 1000) :
+					-1,
+				self->rtt.rto_ms, self->itf_cbs.userdata);
+	}
+
 	/* Link quality reset */
 	self->lnqlt.ack_count = 0;
 	self->lnqlt.retry_count = 0;
@@ -652,6 +733,42 @@ static void timer_cb(struct pomp_timer *timer, void *userdata)
 	check_tx_queues(self);
 }
 
+/**
+ */
+int arsdk_cmd_itf1_get_stats(struct arsdk_cmd_itf1 *self,
+		struct arsdk_cmd_itf_queue_stats *stats,
+		uint32_t *count)
+{
+	uint32_t i = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	for (i = 0; i < self->tx_count && i < *count; i++) {
+		stats[i] = self->tx_queues[i]->stats;
+		stats[i].depth = self->tx_queues[i]->count;
+	}
+	*count = self->tx_count;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf1_set_queue_watermarks(struct arsdk_cmd_itf1 *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t high,
+		uint32_t low)
+{
+	struct queue *queue = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	queue = find_tx_queue_by_type(self, type);
+	if (queue == NULL)
+		return -EINVAL;
+
+	return arsdk_cmd_itf_queue_bound_set(&queue->bound, type, high, low);
+}
+
 /**
  */
 int arsdk_cmd_itf1_stop(struct arsdk_cmd_itf1 *self)
@@ -706,8 +823,33 @@ int arsdk_cmd_itf1_send(struct arsdk_cmd_itf1 *self,
 	if (res < 0)
 		return res;
 
-	/* Check if something can be sent now */
-	check_tx_queues(self);
+	/* Check if something can be sent now, unless more commands are
+	 * coming in the current batch */
+	if (self->batch == 0)
+		check_tx_queues(self);
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf1_batch_begin(struct arsdk_cmd_itf1 *self)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	self->batch++;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf1_batch_end(struct arsdk_cmd_itf1 *self)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(self->batch > 0, -EALREADY);
+
+	self->batch--;
+	if (self->batch == 0 && self->transport != NULL)
+		check_tx_queues(self);
 	return 0;
 }
 
@@ -842,6 +984,7 @@ int arsdk_cmd_itf1_new(struct arsdk_transport *transport,
 {
 	int res = 0;
 	uint32_t i = 0;
+	int rto_ms = 0;
 	struct arsdk_cmd_itf1 *self = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_obj != NULL, -EINVAL);
@@ -902,7 +1045,13 @@ int arsdk_cmd_itf1_new(struct arsdk_transport *transport,
 		res = queue_new(&tx_info_table[i], &self->tx_queues[i]);
 		if (res < 0)
 			goto error;
+
+		/* Retry after the longest timeout until the round trip time
+		   is measured */
+		if (tx_info_table[i].ack_timeout_ms > rto_ms)
+			rto_ms = tx_info_table[i].ack_timeout_ms;
 	}
+	arsdk_cmd_itf_rtt_init(&self->rtt, rto_ms);
 
 	*ret_obj = self;
 	return 0;
@@ -98,6 +98,57 @@ int arsdk_cmd_itf1_send(struct arsdk_cmd_itf1 *self,
 		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
 		void *userdata);
 
+/**
+ * Sets the watermarks of the queue of a buffer type.
+ *
+ * @param self : interface object.
+ * @param type : buffer type of the queue.
+ * @param high : maximum number of pending commands; '0' for unbounded.
+ * @param low : number of pending commands notifying the queue drained.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf1_set_queue_watermarks(struct arsdk_cmd_itf1 *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t high,
+		uint32_t low);
+
+/**
+ * Gets the statistics of the transmission queues.
+ *
+ * @param self : interface object.
+ * @param stats : array to fill with the statistics of each queue.
+ * @param count : capacity of 'stats' as input, number of queues as output.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf1_get_stats(struct arsdk_cmd_itf1 *self,
+		struct arsdk_cmd_itf_queue_stats *stats,
+		uint32_t *count);
+
+/**
+ * Starts a batch of commands.
+ *
+ * The commands sent until the end of the batch are only queued, the queues
+ * are checked once at its end. Batches can be nested.
+ *
+ * @param self : interface object.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf1_batch_begin(struct arsdk_cmd_itf1 *self);
+
+/**
+ * Ends a batch of commands.
+ *
+ * The queues are checked if it is the outermost batch.
+ *
+ * @param self : interface object.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf1_batch_end(struct arsdk_cmd_itf1 *self);
+
 /**
  * Stops the interface.
  *
@@ -31,7 +31,7 @@
 
 /** Link quality analysis frequency */
 #define LINK_QUALITY_TIME_MS 5000
-/** Command pack maximum size */
+/** Command pack maximum size, unless negotiated with the peer */
 #define ARSDK_PACK_MAX_SIZE 1400
 
 /**
@@ -108,6 +108,10 @@ struct entry {
 	arsdk_cmd_itf_cmd_send_status_cb_t  send_status;
 	/** User data given in callbacks */
 	void                                *userdata;
+	/** Queuing time. */
+	struct timespec                     queued_ts;
+	/** Time to live; in millisecond, '0' for no limit. */
+	uint32_t                            ttl_ms;
 };
 
 /** Sending Queue */
@@ -124,8 +128,27 @@ struct queue {
 	uint32_t                     head;
 	/** Index where write a new entry. */
 	uint32_t                     tail;
+	/** Number of entries popped since the queue creation. */
+	uint32_t                     popped;
+	/** Number of pending entries with a time to live. */
+	uint32_t                     expiring;
+	/** Commands coalesced, only used by non-acknowledged queues. */
+	struct arsdk_cmd_itf_coalesce coalesce;
+	/** Bounds of the queue. */
+	struct arsdk_cmd_itf_queue_bound bound;
+	/** Scheduling state of the queue. */
+	struct arsdk_cmd_itf_sched_queue sched;
+	/** Statistics of the queue. */
+	struct arsdk_cmd_itf_queue_stats stats;
 	/** Last sequence number used to send. */
 	uint16_t                     seq;
+	/** Maximum size of a command pack. */
+	size_t                       pack_max_size;
+	/**
+	 * Queuing time of the oldest command not yet packed of a
+	 * non-acknowledged queue; start of the delay of its pack.
+	 */
+	struct timespec              first_queued_ts;
 	/** Command pack. */
 	struct {
 		/** Data buffer. */
@@ -167,10 +190,27 @@ struct arsdk_cmd_itf2 {
 	struct pomp_loop                   *loop;
 	/** Retry timer. */
 	struct pomp_timer                  *timer;
+	/** Expiration time of the retry timer; in microsecond, 0 if unset. */
+	uint64_t                           timer_expire_us;
 	/** Commands queues to send. */
 	struct queue                       **tx_queues;
 	/** Size of 'tx_queues'. */
 	uint32_t                           tx_count;
+	/** Map of the queues sending each command buffer type. */
+	struct queue                       *type_queues[
+						ARSDK_CMD_BUFFER_TYPE_COUNT];
+	/** Map of the queues for each transmission queue identifier. */
+	struct queue                       *id_queues[UINT8_MAX+1];
+	/**
+	 * Nesting level of the batches in progress; the queues are checked
+	 * only when the last one ends.
+	 */
+	uint32_t                           batch;
+	/**
+	 * Queue whose pack receives the command encoded directly, between
+	 * arsdk_cmd_itf2_send_enc_begin() and arsdk_cmd_itf2_send_enc_end().
+	 */
+	struct queue                       *enc_queue;
 	/**
 	 * Index offset between a transmission queue and
 	 * its reception acknowledge.
@@ -178,12 +218,24 @@ struct arsdk_cmd_itf2 {
 	uint8_t                            ackoff;
 	/** Sequence number to used to send the next acknowledgement. */
 	uint16_t                           next_ack_seq;
+	/** Round trip time estimation of the acknowledged packs. */
+	struct arsdk_cmd_itf_rtt           rtt;
+	/** Scheduler of the tx queues. */
+	struct arsdk_cmd_itf_sched         sched;
+	/** Congestion control of the acknowledged tx queues. */
+	struct arsdk_cmd_itf_cc            cc;
 	/**
 	 * Map of last sequence numbers received for each reception
 	 * queue identifier.
 	 */
 	uint16_t                           recv_seq[UINT8_MAX+1];
 
+	/**
+	 * Buffer reused to notify the commands received or encoded directly
+	 * in a pack.
+	 */
+	struct pomp_buffer                 *cmd_buf;
+
 	/** Link quality part. */
 	struct {
 		/** Link quality check timer. */
@@ -250,6 +302,7 @@ static void entry_notify(struct entry *entry, struct arsdk_cmd_itf2 *self,
 /**
  */
 static int queue_new(const struct arsdk_cmd_queue_info *info,
+		size_t pack_max_size,
 		struct queue **ret_queue)
 {
 	struct queue *queue = NULL;
@@ -263,6 +316,8 @@ static int queue_new(const struct arsdk_cmd_queue_info *info,
 
 	/* Initialize structure */
 	memcpy(&queue->info, info, sizeof(*info));
+	arsdk_cmd_itf_queue_stats_init(&queue->stats, info);
+	queue->pack_max_size = pack_max_size;
 
 	/* Force infinite retry, as soon as possible without overwriting. */
 	queue->info.max_tx_rate_ms = 0;
@@ -273,7 +328,7 @@ static int queue_new(const struct arsdk_cmd_queue_info *info,
 	queue->seq = UINT16_MAX;
 	queue->last_pack.seq = UINT16_MAX;
 
-	queue->pack.buf = pomp_buffer_new(ARSDK_PACK_MAX_SIZE);
+	queue->pack.buf = pomp_buffer_new(pack_max_size);
 	if (queue->pack.buf == NULL) {
 		res = -ENOMEM;
 		goto error;
@@ -300,13 +355,17 @@ static void queue_stop(struct queue *queue, struct arsdk_cmd_itf2 *itf)
 		entry_notify(entry, itf, ARSDK_CMD_ITF_CMD_SEND_STATUS_CANCELED,
 				1);
 		entry_clear(entry);
+		queue->stats.dropped++;
 
 		/* Continue in circular buffer */
 		pos++;
 		if (pos >= queue->depth)
 			pos = 0;
 	}
+	queue->popped += queue->count;
 	queue->head = queue->tail = queue->count = 0;
+	queue->expiring = 0;
+	queue->bound.blocked = 0;
 }
 
 /**
@@ -316,11 +375,70 @@ static int queue_destroy(struct queue *queue, struct arsdk_cmd_itf2 *itf)
 	if (queue->count != 0)
 		return -EBUSY;
 	pomp_buffer_unref(queue->pack.buf);
+	arsdk_cmd_itf_coalesce_clear(&queue->coalesce);
 	free(queue->entries);
 	free(queue);
 	return 0;
 }
 
+/**
+ * Sets the time to live of a new entry of a queue, from its command or the
+ * default one of the queue.
+ */
+static void queue_entry_set_ttl(struct queue *queue, struct entry *entry,
+		const struct arsdk_cmd *cmd)
+{
+	entry->ttl_ms = cmd->ttl_ms != 0 ? cmd->ttl_ms : queue->info.ttl_ms;
+	if (entry->ttl_ms != 0)
+		queue->expiring++;
+}
+
+/**
+ * Replaces the pending instance of a coalesced command by a newer one.
+ *
+ * @param queue : queue of the command.
+ * @param itf : command interface.
+ * @param slot : slot of the coalesced command.
+ * @param cmd : newer instance of the command.
+ * @param send_status : function to call with the send status.
+ * @param userdata : user data for 'send_status'.
+ *
+ * @return 0 in case of success, -ENOENT if no instance of the command can
+ * be replaced.
+ */
+static int queue_replace(struct queue *queue,
+		struct arsdk_cmd_itf2 *itf,
+		const struct arsdk_cmd_itf_coalesce_slot *slot,
+		const struct arsdk_cmd *cmd,
+		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
+		void *userdata)
+{
+	uint32_t idx = slot->pos - queue->popped;
+	struct entry *entry = NULL;
+	struct entry old;
+
+	/* The instance must still be pending and not packed yet */
+	if (idx >= queue->count || idx < queue->pack.cmd_count)
+		return -ENOENT;
+	entry = &queue->entries[(queue->head + idx) % queue->depth];
+	if (entry->cmd.id != cmd->id)
+		return -ENOENT;
+
+	/* Replace it before notifying it canceled, the callback can send
+	 * again */
+	old = *entry;
+	entry_init(entry, cmd, send_status, userdata);
+	time_get_monotonic(&entry->queued_ts);
+	if (old.ttl_ms != 0)
+		queue->expiring--;
+	queue_entry_set_ttl(queue, entry, cmd);
+	queue->stats.queued++;
+	queue->stats.coalesced++;
+	entry_notify(&old, itf, ARSDK_CMD_ITF_CMD_SEND_STATUS_CANCELED, 1);
+	entry_clear(&old);
+	return 0;
+}
+
 /**
  */
 static int queue_add(struct queue *queue,
@@ -329,16 +447,30 @@ static int queue_add(struct queue *queue,
 		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
 		void *userdata)
 {
+	int res = 0;
 	uint32_t newdepth = 0;
 	struct entry *newentries = NULL;
 	struct entry *entry = NULL;
 	uint32_t cnt1 = 0, cnt2 = 0;
+	struct arsdk_cmd_itf_coalesce_slot *slot = NULL;
+
+	/* Only keep the newest instance of a coalesced command */
+	slot = arsdk_cmd_itf_coalesce_find(&queue->coalesce, cmd->id);
+	if (slot != NULL && queue_replace(queue, itf, slot, cmd,
+			send_status, userdata) == 0)
+		return 0;
+
+	/* Refuse the command if the queue is full */
+	res = arsdk_cmd_itf_queue_bound_check(&queue->bound, queue->count);
+	if (res < 0)
+		return res;
 
-	/* Grow entries if needed (before it becomes full)
+	/* Grow entries if needed (before it becomes full), doubling its depth
 	 * As we are using a circular queue, it is easier to alloc a new array
 	 * and copy existing entries at start of it */
 	if (queue->count + 1 >= queue->depth) {
-		newdepth = queue->depth + 16;
+		newdepth = arsdk_cmd_itf_queue_bound_grow(&queue->bound,
+				queue->depth);
 		newentries = calloc(newdepth, sizeof(struct entry));
 		if (newentries == NULL)
 			return -ENOMEM;
@@ -370,11 +502,19 @@ static int queue_add(struct queue *queue,
 	/* Add in queue */
 	entry = &queue->entries[queue->tail];
 	entry_init(entry, cmd, send_status, userdata);
+	time_get_monotonic(&entry->queued_ts);
+	queue_entry_set_ttl(queue, entry, cmd);
+	if (queue->count == 0)
+		queue->first_queued_ts = entry->queued_ts;
 	queue->tail++;
 	if (queue->tail >= queue->depth)
 		queue->tail = 0;
 	queue->count++;
 
+	if (slot != NULL)
+		slot->pos = queue->popped + queue->count - 1;
+
+	queue->stats.queued++;
 	return 0;
 }
 
@@ -383,11 +523,86 @@ static int queue_add(struct queue *queue,
 static void queue_pop(struct queue *queue)
 {
 	struct entry *entry = &queue->entries[queue->head];
+	if (entry->ttl_ms != 0)
+		queue->expiring--;
 	entry_clear(entry);
 	queue->head++;
 	if (queue->head >= queue->depth)
 		queue->head = 0;
 	queue->count--;
+	queue->popped++;
+}
+
+/**
+ * Removes a pending entry of a queue, moving the following ones back.
+ * The entry is not cleared, it must be copied before.
+ *
+ * @param queue : queue of the entry.
+ * @param idx : index of the entry from the head of the queue.
+ */
+static void queue_remove(struct queue *queue, uint32_t idx)
+{
+	uint32_t i = 0;
+	struct entry *entry = NULL;
+	struct arsdk_cmd_itf_coalesce_slot *slot = NULL;
+
+	/* Forget the removed instance of a coalesced command */
+	entry = &queue->entries[(queue->head + idx) % queue->depth];
+	if (entry->ttl_ms != 0)
+		queue->expiring--;
+	slot = arsdk_cmd_itf_coalesce_find(&queue->coalesce, entry->cmd.id);
+	if (slot != NULL && slot->pos == queue->popped + idx)
+		slot->pos = queue->popped - 1;
+
+	for (i = idx; i + 1 < queue->count; i++) {
+		entry = &queue->entries[(queue->head + i) % queue->depth];
+		*entry = queue->entries[(queue->head + i + 1) % queue->depth];
+
+		/* Follow the moved instance of a coalesced command */
+		slot = arsdk_cmd_itf_coalesce_find(&queue->coalesce,
+				entry->cmd.id);
+		if (slot != NULL && slot->pos == queue->popped + i + 1)
+			slot->pos--;
+	}
+
+	queue->tail = queue->tail == 0 ? queue->depth - 1 : queue->tail - 1;
+	memset(&queue->entries[queue->tail], 0, sizeof(struct entry));
+	queue->count--;
+}
+
+/**
+ * Drops the pending commands of a queue whose time to live is passed,
+ * the ones of the pack in flight are kept.
+ *
+ * @param self : command interface.
+ * @param queue : queue to check.
+ * @param tsnow : current time.
+ */
+static void queue_drop_expired(struct arsdk_cmd_itf2 *self,
+		struct queue *queue, const struct timespec *tsnow)
+{
+	/* Nothing of the queue is packed when a new pack is built */
+	uint32_t i = queue->pack.cmd_count;
+	struct entry *entry = NULL;
+	struct entry old;
+
+	while (queue->expiring != 0 && i < queue->count) {
+		entry = &queue->entries[(queue->head + i) % queue->depth];
+		if (!arsdk_cmd_itf_cmd_expired(entry->ttl_ms,
+				&entry->queued_ts, tsnow)) {
+			i++;
+			continue;
+		}
+
+		/* Remove it before notifying it expired, the callback can
+		 * send again */
+		old = *entry;
+		queue_remove(queue, i);
+		queue->stats.expired++;
+		entry_notify(&old, self, ARSDK_CMD_ITF_CMD_SEND_STATUS_EXPIRED,
+				1);
+		entry_clear(&old);
+	}
 }
 
 /**
@@ -407,7 +622,7 @@ static void queue_pack_cmds(struct queue *queue)
 		pomp_buffer_get_cdata(entry->cmd.buf, &cmd_data, &cmd_len,
 				NULL);
 		pack_len += cmd_len + sizeof(uint16_t);
-		if (pack_len > ARSDK_PACK_MAX_SIZE) {
+		if (pack_len > queue->pack_max_size) {
 			/* command too large to fit in the pack */
 			break;
 		}
@@ -421,12 +636,56 @@ static void queue_pack_cmds(struct queue *queue)
 	}
 }
 
+/**
+ * Builds the maps of the queues by command buffer type and by identifier;
+ * the first suitable queue is used.
+ */
+static void build_tx_queue_maps(struct arsdk_cmd_itf2 *itf)
+{
+	uint32_t i = 0;
+	int type = 0;
+	struct queue *queue = NULL;
+
+	for (i = 0; i < itf->tx_count; i++) {
+		queue = itf->tx_queues[i];
+		for (type = ARSDK_CMD_BUFFER_TYPE_NON_ACK;
+		     type < ARSDK_CMD_BUFFER_TYPE_COUNT; type++) {
+			if (itf->type_queues[type] == NULL &&
+			    arsdk_cmd_itf_queue_match_type(&queue->info, type))
+				itf->type_queues[type] = queue;
+		}
+		if (itf->id_queues[queue->info.id] == NULL)
+			itf->id_queues[queue->info.id] = queue;
+	}
+}
+
+/**
+ */
+static struct queue *find_tx_queue_by_type(struct arsdk_cmd_itf2 *itf,
+		enum arsdk_cmd_buffer_type buffer_type)
+{
+	if (buffer_type <= ARSDK_CMD_BUFFER_TYPE_INVALID ||
+	    buffer_type >= ARSDK_CMD_BUFFER_TYPE_COUNT) {
+		ARSDK_LOGW("Unknown buffer type: %d", buffer_type);
+		return NULL;
+	}
+
+	return itf->type_queues[buffer_type];
+}
+
+/**
+ */
+static struct queue *find_tx_queue_by_id(struct arsdk_cmd_itf2 *itf,
+		uint16_t id)
+{
+	return id <= UINT8_MAX ? itf->id_queues[id] : NULL;
+}
+
 /**
  */
 static struct queue *find_tx_queue(struct arsdk_cmd_itf2 *itf,
 		const struct arsdk_cmd *cmd)
 {
-	uint32_t i = 0;
 	const struct arsdk_cmd_desc *cmd_desc = NULL;
 	struct queue *queue = NULL;
 	enum arsdk_cmd_buffer_type buffer_type = ARSDK_CMD_BUFFER_TYPE_INVALID;
@@ -445,35 +704,9 @@ static struct queue *find_tx_queue(struct arsdk_cmd_itf2 *itf,
 		buffer_type = cmd_desc->buffer_type;
 	}
 
-	/* Search suitable queue */
-	for (i = 0; i < itf->tx_count; i++) {
-		queue = itf->tx_queues[i];
-		enum arsdk_transport_data_type qtype = queue->info.type;
-		uint8_t qid = queue->info.id;
-		switch (buffer_type) {
-		case ARSDK_CMD_BUFFER_TYPE_NON_ACK:
-			if (qtype == ARSDK_TRANSPORT_DATA_TYPE_NOACK)
-				return queue;
-			break;
-
-		case ARSDK_CMD_BUFFER_TYPE_ACK:
-		case ARSDK_CMD_BUFFER_TYPE_HIGH_PRIO:
-			if (qtype == ARSDK_TRANSPORT_DATA_TYPE_WITHACK &&
-			    qid != ARSDK_TRANSPORT_ID_D2C_CMD_LOWPRIO)
-				return queue;
-			break;
-
-		case ARSDK_CMD_BUFFER_TYPE_LOW_PRIO:
-			if (qtype == ARSDK_TRANSPORT_DATA_TYPE_WITHACK &&
-			    qid == ARSDK_TRANSPORT_ID_D2C_CMD_LOWPRIO)
-				return queue;
-			break;
-
-		default:
-			ARSDK_LOGW("Unknown buffer type: %d", buffer_type);
-			break;
-		}
-	}
+	queue = find_tx_queue_by_type(itf, buffer_type);
+	if (queue != NULL)
+		return queue;
 
 	/* No suitable queue found */
 	ARSDK_LOGW("Unable to find suitable queue for cmd: %u,%u,%u",
@@ -481,6 +714,68 @@ static struct queue *find_tx_queue(struct arsdk_cmd_itf2 *itf,
 	return NULL;
 }
 
+/**
+ * Sends the current pack of a queue.
+ *
+ * @param self : command interface.
+ * @param queue : queue whose pack is to send.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+static int queue_send_pack(struct arsdk_cmd_itf2 *self, struct queue *queue)
+{
+	int res = 0;
+	struct arsdk_transport_header header;
+	struct arsdk_transport_payload payload;
+	size_t len = 0;
+
+	/* Construct header and payload */
+	memset(&header, 0, sizeof(header));
+	header.type = queue->info.type;
+	header.id = queue->info.id;
+	header.seq = queue->seq;
+
+	arsdk_transport_payload_init_with_buf(&payload, queue->pack.buf);
+
+	/* Send it */
+	res = arsdk_transport_send_data(self->transport, &header, &payload,
+			NULL, 0);
+	arsdk_transport_payload_clear(&payload);
+	if (res < 0)
+		return res;
+
+	if (queue->pack.sent_count == 0)
+		queue->stats.sent++;
+	else
+		queue->stats.retried++;
+	pomp_buffer_get_cdata(queue->pack.buf, NULL, &len, NULL);
+	queue->stats.pack_size = (uint32_t)len;
+	arsdk_cmd_itf_sched_sent(&self->sched, &queue->sched, len);
+	return 0;
+}
+
+/**
+ * Checks whether the pending commands of a non-acknowledged queue fill a
+ * pack; it is then sent without waiting for more commands.
+ */
+static int queue_fills_pack(struct queue *queue)
+{
+	uint32_t i = 0;
+	struct entry *entry = NULL;
+	size_t pack_len = 0;
+	size_t cmd_len = 0;
+
+	for (i = 0; i < queue->count; i++) {
+		entry = &queue->entries[(queue->head + i) % queue->depth];
+		pomp_buffer_get_cdata(entry->cmd.buf, NULL, &cmd_len, NULL);
+		pack_len += cmd_len + sizeof(uint16_t);
+		if (pack_len >= queue->pack_max_size)
+			return 1;
+	}
+
+	return 0;
+}
+
 /**
  */
 static void check_tx_queue(struct arsdk_cmd_itf2 *self,
@@ -493,13 +788,15 @@ static void check_tx_queue(struct arsdk_cmd_itf2 *self,
 	int diff_ms = 0;
 	int remaining_ms = 0;
 	struct entry *entry = NULL;
-	struct arsdk_transport_header header;
-	struct arsdk_transport_payload payload;
-	size_t len = 0;
+	struct entry old;
 	uint32_t i = 0;
+	size_t len = 0;
 
 again:
 
+	/* Drop the obsolete commands waiting behind the pack in flight */
+	queue_drop_expired(self, queue, tsnow);
+
 	/* Nothing to do if queue is empty */
 	if (queue->count == 0)
 		return;
@@ -509,11 +806,11 @@ again:
 		if (time_timespec_diff_in_range(
 				&queue->pack.sent_ts,
 				tsnow,
-				(uint64_t)queue->info.ack_timeout_ms * 1000,
+				(uint64_t)self->rtt.rto_ms * 1000,
 				&diff_us)) {
 			/* Still need to wait for ack */
 			diff_ms = (int)(diff_us / 1000);
-			remaining_ms = queue->info.ack_timeout_ms - diff_ms;
+			remaining_ms = self->rtt.rto_ms - diff_ms;
 
 			/* If the remaining time is less than a milisecond,
 			   retry now. We should NEVER set next_timeout_ms
@@ -527,34 +824,65 @@ again:
 			}
 		}
 
-		/* Retry sending command */
+		/* Retry sending command, waiting longer for its
+		   acknowledgement */
 		queue->pack.waiting_ack = 0;
 		memset(&queue->pack.sent_ts, 0, sizeof(queue->pack.sent_ts));
 		self->lnqlt.retry_count++;
+		arsdk_cmd_itf_cc_loss(&self->cc, &self->rtt, tsnow);
+		arsdk_cmd_itf_rtt_backoff(&self->rtt);
 	}
 
+	/* Wait for more non-acknowledged commands until the delay of the
+	   pack is passed, unless they already fill it */
+	if (queue->pack.cmd_count == 0 && arsdk_cmd_itf_pack_delay_wait(
+			queue->info.pack_delay_ms,
+			&queue->first_queued_ts, tsnow,
+			next_timeout_ms) &&
+	    !queue_fills_pack(queue))
+		return;
+
+	/* Wait for the turn of the queue */
+	if (!arsdk_cmd_itf_sched_can_send(&queue->sched))
+		return;
+
+	/* Wait for room in the congestion window for a new pack; its length
+	   is only known once packed, room is needed for a full one */
+	pomp_buffer_get_cdata(queue->pack.buf, NULL, &len, NULL);
+	if (queue->info.type == ARSDK_TRANSPORT_DATA_TYPE_WITHACK &&
+	    queue->pack.sent_count == 0 &&
+	    !arsdk_cmd_itf_cc_can_send(&self->cc,
+			queue->pack.cmd_count == 0 ?
+			queue->pack_max_size : len))
+		return;
+
 	/* If it is not a retry, increment the sequence number and
 	   pack new commands to send. */
 	if (queue->pack.cmd_count == 0) {
-		queue->seq++;
 		queue_pack_cmds(queue);
-	}
 
-	/* Determine pack buffer length */
-	pomp_buffer_get_cdata(queue->pack.buf, NULL, &len, NULL);
-
-	/* Construct header and payload */
-	memset(&header, 0, sizeof(header));
-	header.type = queue->info.type;
-	header.id = queue->info.id;
-	header.seq = queue->seq;
+		/* Drop a command too large to be sent, the pack size can be
+		   reduced by the negotiation or the path MTU */
+		if (queue->pack.cmd_count == 0) {
+			ARSDK_LOGW("Command too large for queue %" PRIu8,
+					queue->info.id);
+			old = queue->entries[queue->head];
+			queue_remove(queue, 0);
+			queue->stats.dropped++;
+			entry_notify(&old, self,
+					ARSDK_CMD_ITF_CMD_SEND_STATUS_CANCELED,
+					1);
+			entry_clear(&old);
+			goto again;
+		}
 
-	arsdk_transport_payload_init_with_buf(&payload, queue->pack.buf);
+		queue->seq++;
+		queue->stats.packed += queue->pack.cmd_count;
+	}
 
 	/* Send it */
-	res = arsdk_transport_send_data(self->transport, &header, &payload,
-			NULL, 0);
-	arsdk_transport_payload_clear(&payload);
+	pomp_buffer_get_cdata(queue->pack.buf, NULL, &len, NULL);
+	res = queue_send_pack(self, queue);
 	if (res < 0)
 		return;
 
@@ -565,16 +893,16 @@ again:
 				ARSDK_TRANSPORT_DATA_TYPE_WITHACK);
 	}
 	if (queue->info.type == ARSDK_TRANSPORT_DATA_TYPE_WITHACK) {
-		queue->pack.seq = header.seq;
+		if (queue->pack.sent_count == 0)
+			arsdk_cmd_itf_cc_sent(&self->cc, len);
+		queue->pack.seq = queue->seq;
 		queue->pack.waiting_ack = 1;
 		queue->pack.sent_ts = *tsnow;
 		queue->pack.sent_count++;
 		/* update ack timeout */
-		if (queue->info.ack_timeout_ms > 0) {
-			diff_ms = queue->info.ack_timeout_ms;
-			if (*next_timeout_ms < 0 || diff_ms < *next_timeout_ms)
-				*next_timeout_ms = diff_ms;
-		}
+		diff_ms = self->rtt.rto_ms;
+		if (*next_timeout_ms < 0 || diff_ms < *next_timeout_ms)
+			*next_timeout_ms = diff_ms;
 	} else {
 		/* pop all commands send in the pack */
 		for (i = 0; i < queue->pack.cmd_count; i++)
@@ -588,13 +916,38 @@ again:
 	}
 }
 
+/**
+ * Notifies a queue drained below its low watermark.
+ */
+static void notify_tx_queue_drained(struct arsdk_cmd_itf2 *self,
+		struct queue *queue)
+{
+	if (!arsdk_cmd_itf_queue_bound_drained(&queue->bound, queue->count) ||
+	    self->itf_cbs.queue_drained == NULL)
+		return;
+
+	(*self->itf_cbs.queue_drained)(self->itf, queue->bound.type,
+			self->itf_cbs.userdata);
+}
+
+/**
+ * Checks a queue for the scheduler.
+ */
+static void sched_check_tx_queue(void *queue,
+		const struct timespec *tsnow,
+		int *next_timeout_ms,
+		void *userdata)
+{
+	struct arsdk_cmd_itf2 *self = userdata;
+
+	check_tx_queue(self, tsnow, queue, next_timeout_ms);
+}
+
 /**
  */
 static void check_tx_queues(struct arsdk_cmd_itf2 *self)
 {
-	int res = 0;
 	uint32_t i = 0;
-	struct queue *queue = NULL;
 	struct timespec tsnow;
 	int next_timeout_ms = -1;
 
@@ -603,22 +956,48 @@ static void check_tx_queues(struct arsdk_cmd_itf2 *self)
 		return;
 	}
 
-	/* Check all queues */
-	for (i = 0; i < self->tx_count; i++) {
-		queue = self->tx_queues[i];
-		check_tx_queue(self, &tsnow, queue, &next_timeout_ms);
-	}
+	/* Check all queues, by priority level */
+	arsdk_cmd_itf_sched_run(&self->sched, &tsnow, &next_timeout_ms,
+			&sched_check_tx_queue, self);
 
 	/* Update next timeout */
-	if (next_timeout_ms > 0) {
-		res = pomp_timer_set(self->timer, (uint32_t) next_timeout_ms);
-		if (res < 0)
-			ARSDK_LOG_ERRNO("pomp_timer_set", -res);
-	} else {
-		res = pomp_timer_clear(self->timer);
-		if (res < 0)
-			ARSDK_LOG_ERRNO("pomp_timer_clear", -res);
+	arsdk_cmd_itf_timer_update(self->timer, &self->timer_expire_us,
+			&tsnow, next_timeout_ms, 1);
+
+	/* Notify the queues drained */
+	for (i = 0; i < self->tx_count; i++)
+		notify_tx_queue_drained(self, self->tx_queues[i]);
+}
+
+/**
+ * Checks only the queue which changed, the other ones keep their next
+ * time of check.
+ */
+static void check_one_tx_queue(struct arsdk_cmd_itf2 *self,
+		struct queue *queue)
+{
+	struct timespec tsnow;
+	int next_timeout_ms = -1;
+
+	/* Let the scheduler share the budgets between the queues, and the
+	   queues use the room left in the congestion window */
+	if (self->sched.limited || self->cc.enabled) {
+		check_tx_queues(self);
+		return;
 	}
+
+	if (time_get_monotonic(&tsnow) < 0) {
+		ARSDK_LOG_ERRNO("time_get_monotonic", errno);
+		return;
+	}
+
+	check_tx_queue(self, &tsnow, queue, &next_timeout_ms);
+
+	/* Bring the next timeout forward if needed */
+	arsdk_cmd_itf_timer_update(self->timer, &self->timer_expire_us,
+			&tsnow, next_timeout_ms, 0);
+
+	notify_tx_queue_drained(self, queue);
 }
 
 /**
@@ -628,10 +1007,11 @@ static void recv_ack(struct arsdk_cmd_itf2 *self,
 		const struct arsdk_transport_payload *payload)
 {
 	uint16_t seq = 0, id = 0;
-	uint32_t queue_i = 0;
 	struct queue *queue = NULL;
 	struct entry *entry = NULL;
 	uint32_t entry_i = 0;
+	struct timespec tsnow;
+	size_t len = 0;
 
 	if (payload->cdata == NULL) {
 		ARSDK_LOGW("ACK: missing seq");
@@ -644,69 +1024,85 @@ static void recv_ack(struct arsdk_cmd_itf2 *self,
 	memcpy(&seq, payload->cdata, sizeof(seq));
 	id = header->id - self->ackoff;
 
-	for (queue_i = 0; queue_i < self->tx_count; queue_i++) {
-		queue = self->tx_queues[queue_i];
-		if (queue->info.id != id)
-			continue;
+	queue = find_tx_queue_by_id(self, id);
+	if (queue == NULL) {
+		ARSDK_LOGW("ACK: unknown id %u", id);
+		return;
+	}
 
-		if (seq == queue->last_pack.seq) {
-			/* Acknowledgement of a last pack retry. */
-			queue->last_pack.ack_count++;
-			ARSDK_LOGD("ACK: id(%u) seq(%u) ack(%u/%u)",
+	if (seq == queue->last_pack.seq) {
+		/* Acknowledgement of a last pack retry. */
+		queue->last_pack.ack_count++;
+		ARSDK_LOGD("ACK: id(%u) seq(%u) ack(%u/%u)",
+				id, seq,
+				queue->last_pack.ack_count,
+				queue->last_pack.sent_count);
+
+		if (queue->last_pack.ack_count >
+				queue->last_pack.sent_count) {
+			ARSDK_LOGE("ACK: id(%u) seq(%u) "
+				   "More ack(%u) than sendings(%u)",
 					id, seq,
 					queue->last_pack.ack_count,
 					queue->last_pack.sent_count);
-
-			if (queue->last_pack.ack_count >
-					queue->last_pack.sent_count) {
-				ARSDK_LOGE("ACK: id(%u) seq(%u) "
-					   "More ack(%u) than sendings(%u)",
-						id, seq,
-						queue->last_pack.ack_count,
-						queue->last_pack.sent_count);
-			}
-
-			return;
-		} else if (seq != queue->seq) {
-			ARSDK_LOGE("ACK: Bad seq for id %u (%d/%d)",
-					id, seq, queue->seq);
-			return;
-		}
-
-		if (!queue->pack.waiting_ack) {
-			ARSDK_LOGE("ACK: no ack waited for id %u", id);
-			return;
 		}
 
-		if (queue->count == 0) {
-			ARSDK_LOGE("ACK: no pending pack for id %u", id);
-			return;
-		}
+		return;
+	} else if (seq != queue->seq) {
+		ARSDK_LOGE("ACK: Bad seq for id %u (%d/%d)",
+				id, seq, queue->seq);
+		return;
+	}
 
-		self->lnqlt.ack_count++;
-		/* notify and pop each command of the pack */
-		for (entry_i = 0; entry_i < queue->pack.cmd_count; entry_i++) {
-			entry = &queue->entries[queue->head];
-			entry_notify(entry, self,
-				     ARSDK_CMD_ITF_CMD_SEND_STATUS_ACK_RECEIVED,
-				     1);
-			queue_pop(queue);
-		}
+	if (!queue->pack.waiting_ack) {
+		ARSDK_LOGE("ACK: no ack waited for id %u", id);
+		return;
+	}
 
-		/* Update last pack acknowledged. */
-		queue->last_pack.seq = queue->seq;
-		queue->last_pack.sent_count = queue->pack.sent_count;
-		queue->last_pack.ack_count = 1;
+	if (queue->count == 0) {
+		ARSDK_LOGE("ACK: no pending pack for id %u", id);
+		return;
+	}
 
-		/* reset pack */
-		pomp_buffer_set_len(queue->pack.buf, 0);
-		queue->pack.cmd_count = 0;
-		queue->pack.sent_count = 0;
+	/* Sample the round trip time if the pack was sent only once */
+	time_get_monotonic(&tsnow);
+	if (queue->pack.sent_count == 1) {
+		arsdk_cmd_itf_rtt_sample(&self->rtt,
+				&queue->pack.sent_ts, &tsnow);
+		arsdk_cmd_itf_histo_add(&queue->stats.ack_rtt,
+				&queue->pack.sent_ts, &tsnow);
+	} else {
+		arsdk_cmd_itf_rtt_ack(&self->rtt);
+	}
 
-		return;
+	self->lnqlt.ack_count++;
+	/* notify and pop each command of the pack */
+	for (entry_i = 0; entry_i < queue->pack.cmd_count; entry_i++) {
+		entry = &queue->entries[queue->head];
+		arsdk_cmd_itf_histo_add(&queue->stats.ack_latency,
+				&entry->queued_ts, &tsnow);
+		queue->stats.acked++;
+		entry_notify(entry, self,
+			     ARSDK_CMD_ITF_CMD_SEND_STATUS_ACK_RECEIVED,
+			     1);
+		queue_pop(queue);
 	}
 
-	ARSDK_LOGW("ACK: unknown id %u", id);
+	/* Update last pack acknowledged. */
+	queue->last_pack.seq = queue->seq;
+	queue->last_pack.sent_count = queue->pack.sent_count;
+	queue->last_pack.ack_count = 1;
+
+	/* Remove the pack from the flight */
+	pomp_buffer_get_cdata(queue->pack.buf, NULL, &len, NULL);
+	arsdk_cmd_itf_cc_acked(&self->cc, len);
+
+	/* reset pack */
+	pomp_buffer_set_len(queue->pack.buf, 0);
+	queue->pack.cmd_count = 0;
+	queue->pack.waiting_ack = 0;
+	memset(&queue->pack.sent_ts, 0, sizeof(queue->pack.sent_ts));
+	queue->pack.sent_count = 0;
 }
 
 /**
@@ -764,6 +1160,17 @@ static void link_quality_timer_cb(struct pomp_timer *timer, void *userdata)
 		(*self->itf_cbs.link_quality)(self->itf, tx_quality, rx_quality,
 				rx_useful, self->cbs.userdata);
 
+	/* Round trip time callback */
+	if (self->itf_cbs.link_quality_rtt) {
+		(*self->itf_cbs.link_quality_rtt)(self->itf,
+				self->rtt.srtt_us != 0 ?
+					(int32_t)(self->rtt.srtt_us / 1000) : -1,
+				self->rtt.srtt_us != 0 ?
+					(int32_t)(self->rtt.rttvar_us / 1000) :
+					-1,
+				self->rtt.rto_ms, self->itf_cbs.userdata);
+	}
+
 	/* Link quality reset */
 	self->lnqlt.ack_count = 0;
 	self->lnqlt.retry_count = 0;
@@ -795,6 +1202,7 @@ int arsdk_cmd_itf2_stop(struct arsdk_cmd_itf2 *self)
 				queue_stop(self->tx_queues[i], self);
 		}
 	}
+	arsdk_cmd_itf_cc_stop(&self->cc);
 
 	self->transport = NULL;
 	return 0;
@@ -833,11 +1241,369 @@ int arsdk_cmd_itf2_send(struct arsdk_cmd_itf2 *self,
 	if (res < 0)
 		return res;
 
-	/* Check if something can be sent now */
+	/* Check if something can be sent now, unless more commands are
+	 * coming in the current batch */
+	if (self->batch == 0)
+		check_one_tx_queue(self, queue);
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf2_batch_begin(struct arsdk_cmd_itf2 *self)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	self->batch++;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf2_batch_end(struct arsdk_cmd_itf2 *self)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(self->batch > 0, -EALREADY);
+
+	self->batch--;
+	if (self->batch == 0 && self->transport != NULL)
+		check_tx_queues(self);
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf2_get_stats(struct arsdk_cmd_itf2 *self,
+		struct arsdk_cmd_itf_queue_stats *stats,
+		uint32_t *count)
+{
+	uint32_t i = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	for (i = 0; i < self->tx_count && i < *count; i++) {
+		stats[i] = self->tx_queues[i]->stats;
+		stats[i].depth = self->tx_queues[i]->count;
+		if (self->tx_queues[i]->info.type ==
+				ARSDK_TRANSPORT_DATA_TYPE_WITHACK)
+			arsdk_cmd_itf_cc_stats(&self->cc, &self->rtt,
+					&stats[i]);
+	}
+	*count = self->tx_count;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf2_set_queue_watermarks(struct arsdk_cmd_itf2 *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t high,
+		uint32_t low)
+{
+	struct queue *queue = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	queue = find_tx_queue_by_type(self, type);
+	if (queue == NULL)
+		return -EINVAL;
+
+	return arsdk_cmd_itf_queue_bound_set(&queue->bound, type, high, low);
+}
+
+/**
+ */
+int arsdk_cmd_itf2_set_cmd_coalescing(struct arsdk_cmd_itf2 *self,
+		const struct arsdk_cmd_desc *desc,
+		int enable)
+{
+	struct queue *queue = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
+
+	/* Only the non-acknowledged commands can be coalesced */
+	queue = find_tx_queue_by_type(self, desc->buffer_type);
+	if (queue == NULL ||
+	    queue->info.type != ARSDK_TRANSPORT_DATA_TYPE_NOACK)
+		return -EINVAL;
+
+	return arsdk_cmd_itf_coalesce_set(&queue->coalesce,
+			ARSDK_CMD_FULL_ID(desc->prj_id, desc->cls_id,
+					desc->cmd_id),
+			enable);
+}
+
+/**
+ */
+int arsdk_cmd_itf2_set_pack_delay(struct arsdk_cmd_itf2 *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t delay_ms)
+{
+	struct queue *queue = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(delay_ms <= ARSDK_CMD_ITF_PACK_DELAY_MAX_MS,
+			-EINVAL);
+
+	/* Only the non-acknowledged packs can be delayed */
+	queue = find_tx_queue_by_type(self, type);
+	if (queue == NULL ||
+	    queue->info.type != ARSDK_TRANSPORT_DATA_TYPE_NOACK)
+		return -EINVAL;
+
+	queue->info.pack_delay_ms = (int)delay_ms;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf2_set_queue_ttl(struct arsdk_cmd_itf2 *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t ttl_ms)
+{
+	struct queue *queue = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	queue = find_tx_queue_by_type(self, type);
+	if (queue == NULL)
+		return -EINVAL;
+
+	queue->info.ttl_ms = ttl_ms;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf2_set_queue_sched(struct arsdk_cmd_itf2 *self,
+		enum arsdk_cmd_buffer_type type,
+		const struct arsdk_cmd_itf_queue_sched *sched)
+{
+	struct queue *queue = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(sched != NULL, -EINVAL);
+
+	queue = find_tx_queue_by_type(self, type);
+	if (queue == NULL)
+		return -EINVAL;
+
+	return arsdk_cmd_itf_sched_set_queue(&self->sched, &queue->sched,
+			sched);
+}
+
+/**
+ */
+int arsdk_cmd_itf2_set_tx_budget(struct arsdk_cmd_itf2 *self,
+		uint32_t budget)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	arsdk_cmd_itf_sched_set_budget(&self->sched, budget);
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf2_set_congestion_control(struct arsdk_cmd_itf2 *self,
+		int enable)
+{
+	uint32_t i = 0;
+	size_t pack_size = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	for (i = 0; i < self->tx_count; i++) {
+		if (self->tx_queues[i]->info.type ==
+				ARSDK_TRANSPORT_DATA_TYPE_WITHACK &&
+		    self->tx_queues[i]->pack_max_size > pack_size)
+			pack_size = self->tx_queues[i]->pack_max_size;
+	}
+
+	arsdk_cmd_itf_cc_enable(&self->cc, enable, pack_size);
 	check_tx_queues(self);
 	return 0;
 }
 
+/**
+ * Checks whether a command can be encoded directly in the pack of a queue
+ * and sent immediately.
+ *
+ * Nothing must be pending in the queue to keep the sending order.
+ */
+static int can_send_direct(struct arsdk_cmd_itf2 *self, struct queue *queue)
+{
+	if (queue->info.type != ARSDK_TRANSPORT_DATA_TYPE_NOACK ||
+	    queue->count != 0 || queue->pack.cmd_count != 0 ||
+	    queue->info.pack_delay_ms > 0 || self->sched.limited)
+		return 0;
+
+	/* Let the batch fill the pack */
+	return self->batch == 0;
+}
+
+/**
+ * Resets the pack sent with a command encoded directly in it, and notifies
+ * this command.
+ *
+ * The command only exists in the pack, it is copied in the reused command
+ * buffer when it is observed. The pack is reset before the notification,
+ * the callbacks can send other commands.
+ *
+ * @param self : command interface.
+ * @param queue : queue of the pack.
+ * @param cdata : command data in the pack.
+ * @param len : command length.
+ * @param send_status : function to call with send status.
+ * @param userdata : user data for send_status callback.
+ */
+static void enc_cmd_sent(struct arsdk_cmd_itf2 *self, struct queue *queue,
+		const void *cdata, size_t len,
+		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
+		void *userdata)
+{
+	int res = 0;
+	struct arsdk_cmd cmd;
+
+	if (send_status == NULL && self->itf_cbs.cmd_log == NULL) {
+		pomp_buffer_set_len(queue->pack.buf, 0);
+		queue->pack.cmd_count = 0;
+		return;
+	}
+
+	res = arsdk_cmd_itf_cmd_buf_set(&self->cmd_buf, cdata, len);
+	pomp_buffer_set_len(queue->pack.buf, 0);
+	queue->pack.cmd_count = 0;
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("arsdk_cmd_itf_cmd_buf_set", -res);
+		return;
+	}
+
+	arsdk_cmd_init_with_buf(&cmd, self->cmd_buf);
+	res = arsdk_cmd_dec_header(&cmd);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("arsdk_cmd_dec_header", -res);
+		arsdk_cmd_clear(&cmd);
+		return;
+	}
+
+	cmd_log(self, &cmd, ARSDK_CMD_DIR_TX);
+
+	/* A non-acknowledged command is done once packed */
+	if (send_status != NULL) {
+		(*send_status)(self->itf, &cmd, ARSDK_CMD_BUFFER_TYPE_INVALID,
+				ARSDK_CMD_ITF_CMD_SEND_STATUS_PACKED, 0, 1,
+				userdata);
+	}
+	arsdk_cmd_clear(&cmd);
+}
+
+/**
+ */
+int arsdk_cmd_itf2_send_enc_begin(struct arsdk_cmd_itf2 *self,
+		const struct arsdk_cmd_desc *desc,
+		size_t len,
+		uint8_t **data)
+{
+	int res = 0;
+	struct queue *queue = NULL;
+	uint8_t *pack_data = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(data != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(self->enc_queue == NULL, -EBUSY);
+
+	if (self->transport == NULL)
+		return -EPIPE;
+
+	queue = find_tx_queue_by_type(self, desc->buffer_type);
+	if (queue == NULL || !can_send_direct(self, queue))
+		return -EAGAIN;
+
+	/* The command too large is dropped by the queue */
+	if (len + sizeof(uint16_t) > queue->pack_max_size)
+		return -EAGAIN;
+
+	/* Fails if the pack is still referenced by the transport */
+	res = pomp_buffer_ensure_capacity(queue->pack.buf,
+			len + sizeof(uint16_t));
+	if (res == 0)
+		res = pomp_buffer_set_len(queue->pack.buf,
+				len + sizeof(uint16_t));
+	if (res == 0)
+		res = pomp_buffer_get_data(queue->pack.buf,
+				(void **)&pack_data, NULL, NULL);
+	if (res < 0) {
+		pomp_buffer_set_len(queue->pack.buf, 0);
+		return res == -EPERM ? -EAGAIN : res;
+	}
+
+	pack_data[0] = (uint8_t)(len & 0xff);
+	pack_data[1] = (uint8_t)((len >> 8) & 0xff);
+	queue->pack.cmd_count = 1;
+	self->enc_queue = queue;
+	*data = pack_data + sizeof(uint16_t);
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf2_send_enc_end(struct arsdk_cmd_itf2 *self,
+		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
+		void *userdata)
+{
+	int res = 0;
+	struct queue *queue = NULL;
+	struct pomp_buffer *buf = NULL;
+	struct arsdk_cmd cmd;
+	const uint8_t *cdata = NULL;
+	size_t len = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(self->enc_queue != NULL, -EPERM);
+
+	queue = self->enc_queue;
+	self->enc_queue = NULL;
+
+	/* Use default callback if none given */
+	if (send_status == NULL) {
+		send_status = self->itf_cbs.cmd_send_status;
+		userdata = self->itf_cbs.userdata;
+	}
+
+	pomp_buffer_get_cdata(queue->pack.buf, (const void **)&cdata, &len,
+			NULL);
+
+	queue->seq++;
+	res = queue_send_pack(self, queue);
+	if (res == 0) {
+		queue->stats.queued++;
+		queue->stats.packed++;
+		enc_cmd_sent(self, queue, cdata + sizeof(uint16_t),
+				len - sizeof(uint16_t), send_status, userdata);
+		return 0;
+	}
+
+	/* Queue the command to retry later like any other */
+	queue->seq--;
+	buf = pomp_buffer_new_with_data(cdata + sizeof(uint16_t),
+			len - sizeof(uint16_t));
+	pomp_buffer_set_len(queue->pack.buf, 0);
+	queue->pack.cmd_count = 0;
+	if (buf == NULL)
+		return -ENOMEM;
+
+	arsdk_cmd_init_with_buf(&cmd, buf);
+	pomp_buffer_unref(buf);
+	res = arsdk_cmd_dec_header(&cmd);
+	if (res == 0)
+		res = arsdk_cmd_itf2_send(self, &cmd, send_status, userdata);
+	arsdk_cmd_clear(&cmd);
+	return res;
+}
+
 static int should_process_data(struct arsdk_cmd_itf2 *self, uint8_t id,
 		uint16_t seq)
 {
@@ -890,7 +1656,6 @@ static int unpack_cmds(struct arsdk_cmd_itf2 *self,
 	uint16_t cmd_size;
 	const uint8_t *data = frame_data;
 	const uint8_t *data_end = data + frame_data_len;
-	struct pomp_buffer *buf = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(data != NULL, -EINVAL);
@@ -903,12 +1668,13 @@ static int unpack_cmds(struct arsdk_cmd_itf2 *self,
 		if (data + cmd_size > data_end)
 			return -EPROTO;
 
-		buf = pomp_buffer_new_with_data(data, cmd_size);
-		if (buf == NULL)
-			return -ENOMEM;
+		res = arsdk_cmd_itf_cmd_buf_set(&self->cmd_buf, data,
+				cmd_size);
+		if (res < 0)
+			return res;
 
 		data += cmd_size;
-		arsdk_cmd_init_with_buf(&cmd, buf);
+		arsdk_cmd_init_with_buf(&cmd, self->cmd_buf);
 
 		/* Set arsdk_cmd buffer type from transport data type */
 		switch (data_type) {
@@ -943,8 +1709,6 @@ static int unpack_cmds(struct arsdk_cmd_itf2 *self,
 
 		/* Cleanup */
 		arsdk_cmd_clear(&cmd);
-		pomp_buffer_unref(buf);
-		buf = NULL;
 	}
 
 	return res;
@@ -958,6 +1722,8 @@ int arsdk_cmd_itf2_recv_data(struct arsdk_cmd_itf2 *self,
 		const struct arsdk_transport_payload *payload)
 {
 	int res = 0;
+	int rto_ms = 0;
+	struct queue *queue = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(header != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(payload != NULL, -EINVAL);
@@ -969,10 +1735,19 @@ int arsdk_cmd_itf2_recv_data(struct arsdk_cmd_itf2 *self,
 	/* Update of the reception link quality */
 	lnqlt_rx_update(self, header);
 
-	/* Handle ACK frame and re-check tx queues */
+	/* Handle ACK frame and re-check its tx queue */
 	if (header->type == ARSDK_TRANSPORT_DATA_TYPE_ACK) {
+		rto_ms = self->rtt.rto_ms;
 		recv_ack(self, header, payload);
-		check_tx_queues(self);
+		queue = find_tx_queue_by_id(self,
+				(uint16_t)(header->id - self->ackoff));
+
+		/* A shorter retransmission timeout brings the retries of all
+		   the queues forward */
+		if (self->rtt.rto_ms < rto_ms)
+			check_tx_queues(self);
+		else if (queue != NULL)
+			check_one_tx_queue(self, queue);
 		/* Update last sequence number received */
 		self->recv_seq[header->id] = header->seq;
 		return 0;
@@ -1016,7 +1791,9 @@ int arsdk_cmd_itf2_new(struct arsdk_transport *transport,
 {
 	int res = 0;
 	uint32_t i = 0;
+	int rto_ms = 0;
 	struct arsdk_cmd_itf2 *self = NULL;
+	size_t pack_max_size = 0;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_obj != NULL, -EINVAL);
 	*ret_obj = NULL;
@@ -1065,6 +1842,11 @@ int arsdk_cmd_itf2_new(struct arsdk_transport *transport,
 	if (res < 0)
 		goto error;
 
+	/* Use the pack size negotiated with the peer, if any */
+	pack_max_size = arsdk_transport_get_pack_max_size(transport);
+	if (pack_max_size == 0)
+		pack_max_size = ARSDK_PACK_MAX_SIZE;
+
 	/* Create tx queues */
 	self->tx_queues = calloc(tx_count, sizeof(struct queue *));
 	if (self->tx_queues == NULL) {
@@ -1072,11 +1854,25 @@ int arsdk_cmd_itf2_new(struct arsdk_transport *transport,
 		goto error;
 	}
 	self->tx_count = tx_count;
+	res = arsdk_cmd_itf_sched_init(&self->sched, tx_count, pack_max_size);
+	if (res < 0)
+		goto error;
 	for (i = 0; i < tx_count; i++) {
-		res = queue_new(&tx_info_table[i], &self->tx_queues[i]);
+		res = queue_new(&tx_info_table[i], pack_max_size,
+				&self->tx_queues[i]);
 		if (res < 0)
 			goto error;
+		arsdk_cmd_itf_sched_add(&self->sched, i,
+				&self->tx_queues[i]->sched,
+				&self->tx_queues[i]->info, self->tx_queues[i]);
+
+		/* Retry after the longest timeout until the round trip time
+		   is measured */
+		if (tx_info_table[i].ack_timeout_ms > rto_ms)
+			rto_ms = tx_info_table[i].ack_timeout_ms;
 	}
+	arsdk_cmd_itf_rtt_init(&self->rtt, rto_ms);
+	build_tx_queue_maps(self);
 
 	*ret_obj = self;
 	return 0;
@@ -1114,6 +1910,9 @@ int arsdk_cmd_itf2_destroy(struct arsdk_cmd_itf2 *itf)
 		}
 		free(itf->tx_queues);
 	}
+	arsdk_cmd_itf_sched_clear(&itf->sched);
+	if (itf->cmd_buf != NULL)
+		pomp_buffer_unref(itf->cmd_buf);
 
 	/* Free timer */
 	if (itf->timer != NULL)
@@ -98,6 +98,168 @@ int arsdk_cmd_itf2_send(struct arsdk_cmd_itf2 *self,
 		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
 		void *userdata);
 
+/**
+ * Reserves the space of a non-acknowledged command in the pack to send.
+ *
+ * @param self : interface object.
+ * @param desc : description of the command.
+ * @param len : size of the encoded command.
+ * @param data : pointer to the 'len' bytes to fill with the command.
+ *
+ * @return 0 in case of success, -EAGAIN if the command cannot be encoded
+ * directly in the pack, negative errno value in case of error.
+ */
+int arsdk_cmd_itf2_send_enc_begin(struct arsdk_cmd_itf2 *self,
+		const struct arsdk_cmd_desc *desc,
+		size_t len,
+		uint8_t **data);
+
+/**
+ * Sends the pack filled after arsdk_cmd_itf2_send_enc_begin().
+ *
+ * The command is notified as packed once the pack is sent, or queued if
+ * the pack cannot be sent immediately.
+ *
+ * @param self : interface object.
+ * @param send_status : function to call with send status. If NULL, the one
+ * given at creation will be used.
+ * @param userdata : user data for send_status callback.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf2_send_enc_end(struct arsdk_cmd_itf2 *self,
+		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
+		void *userdata);
+
+/**
+ * Enables or disables the coalescing of a non-acknowledged command.
+ *
+ * Only the newest pending instance of a coalesced command is kept in its
+ * queue.
+ *
+ * @param self : interface object.
+ * @param desc : description of the command.
+ * @param enable : '1' to coalesce the command, '0' otherwise.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf2_set_cmd_coalescing(struct arsdk_cmd_itf2 *self,
+		const struct arsdk_cmd_desc *desc,
+		int enable);
+
+/**
+ * Sets the time to wait for more commands before sending a non-acknowledged
+ * pack not full.
+ *
+ * @param self : interface object.
+ * @param type : buffer type of the queue.
+ * @param delay_ms : time to wait in millisecond; '0' to send soon as possible.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf2_set_pack_delay(struct arsdk_cmd_itf2 *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t delay_ms);
+
+/**
+ * Sets the default time to live of the commands of a queue.
+ *
+ * @param self : interface object.
+ * @param type : buffer type of the queue.
+ * @param ttl_ms : time to live in millisecond; '0' for no limit.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf2_set_queue_ttl(struct arsdk_cmd_itf2 *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t ttl_ms);
+
+/**
+ * Sets the scheduling parameters of the queue of a buffer type.
+ *
+ * @param self : interface object.
+ * @param type : buffer type of the queue.
+ * @param sched : scheduling parameters.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf2_set_queue_sched(struct arsdk_cmd_itf2 *self,
+		enum arsdk_cmd_buffer_type type,
+		const struct arsdk_cmd_itf_queue_sched *sched);
+
+/**
+ * Sets the transmission budget shared by all the queues.
+ *
+ * @param self : interface object.
+ * @param budget : maximum bytes sent per tick; '0' for no limit.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf2_set_tx_budget(struct arsdk_cmd_itf2 *self,
+		uint32_t budget);
+
+/**
+ * Enables or disables the congestion control of the acknowledged queues.
+ *
+ * @param self : interface object.
+ * @param enable : '1' to enable the congestion control, '0' otherwise.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf2_set_congestion_control(struct arsdk_cmd_itf2 *self,
+		int enable);
+
+/**
+ * Sets the watermarks of the queue of a buffer type.
+ *
+ * @param self : interface object.
+ * @param type : buffer type of the queue.
+ * @param high : maximum number of pending commands; '0' for unbounded.
+ * @param low : number of pending commands notifying the queue drained.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf2_set_queue_watermarks(struct arsdk_cmd_itf2 *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t high,
+		uint32_t low);
+
+/**
+ * Gets the statistics of the transmission queues.
+ *
+ * @param self : interface object.
+ * @param stats : array to fill with the statistics of each queue.
+ * @param count : capacity of 'stats' as input, number of queues as output.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf2_get_stats(struct arsdk_cmd_itf2 *self,
+		struct arsdk_cmd_itf_queue_stats *stats,
+		uint32_t *count);
+
+/**
+ * Starts a batch of commands.
+ *
+ * The commands sent until the end of the batch are only queued, the queues
+ * are checked once at its end. Batches can be nested.
+ *
+ * @param self : interface object.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf2_batch_begin(struct arsdk_cmd_itf2 *self);
+
+/**
+ * Ends a batch of commands.
+ *
+ * The queues are checked if it is the outermost batch.
+ *
+ * @param self : interface object.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf2_batch_end(struct arsdk_cmd_itf2 *self);
+
 /**
  * Stops the interface.
  *
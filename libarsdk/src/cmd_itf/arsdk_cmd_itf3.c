@@ -31,8 +31,18 @@
 
 /** Link quality analysis frequency */
 #define LINK_QUALITY_TIME_MS 5000
-/** Command pack maximum size */
+/** Command pack maximum size, unless negotiated with the peer */
 #define ARSDK_PACK_MAX_SIZE 1000
+/** Maximum number of commands indexed by one pass of the pack scanner */
+#define ARSDK_CMD_ITF3_SCAN_MAX 64
+/** Maximum number of packs of a queue waiting for their acknowledgement */
+#define ARSDK_CMD_ITF3_TX_WINDOW 8
+/**
+ * Maximum distance from the last pack processed of the packs with
+ * acknowledgement received out of order and kept until the missing ones are
+ * received; the peer sends at most a window of packs.
+ */
+#define ARSDK_CMD_ITF3_RX_REORDER_MAX ARSDK_CMD_ITF3_TX_WINDOW
 
 /**
  * Formats a variable name to be used in a macro.
@@ -71,47 +81,13 @@
 #define queue_for_each_entry(queue, entry)\
 		queue_for_each_entry__(queue, entry, __COUNTER__)
 
-/**
- * Iterates over the packed entries of the given queue.
- *
- * Should not be used directly, see queue_for_each_packed_entry.
- *
- * @param queue :       The queue to run through.
- * @param entry :       Itaration entry.
- * @param sent:         '1' to filter entries not completely sent.
- * @param cnt :         Counter value used to generate local variables names.
- */
-#define queue_for_each_packed_entry__(queue, entry, sent, cnt) \
-	uint32_t MNAME(i, cnt) = queue->head; \
-	uint32_t MNAME(i_max, cnt) = queue->depth - 1; \
-	uint32_t MNAME(i_end, cnt) = (queue->head + queue->pack.cmd_count) % \
-			queue->depth; \
-	if (sent && queue->pack.remaining_len > 0) \
-		MNAME(i_end, cnt) = MNAME(i_end, cnt) > 0 ?\
-			MNAME(i_end, cnt) - 1 : MNAME(i_max, cnt); \
-	entry = &queue->entries[MNAME(i, cnt)]; \
-	for (; MNAME(i, cnt) != MNAME(i_end, cnt); \
-	     MNAME(i, cnt) = MNAME(i, cnt) < MNAME(i_max, cnt) ?\
-			MNAME(i, cnt) + 1 : 0, \
-	     entry = &queue->entries[MNAME(i, cnt)])
-
-/**
- * Iterates over the packed entries of the given queue.
- *
- * @param queue :       The queue to run through.
- * @param entry :       Itaration entry.
- */
-#define queue_for_each_packed_entry(queue, entry)\
-		queue_for_each_packed_entry__(queue, entry, 0, __COUNTER__)
-
-/**
- * Iterates over entries completely sent by the pack of the given queue.
- *
- * @param queue :       The queue to run through.
- * @param entry :       Itaration entry.
- */
-#define queue_for_each_packed_entry_sent(queue, entry)\
-		queue_for_each_packed_entry__(queue, entry, 1, __COUNTER__)
+/** Position of a command in a received payload */
+struct cmd_slice {
+	/** Offset of the command data, after its size */
+	uint32_t                                off;
+	/** Length of the command data */
+	uint32_t                                len;
+};
 
 /** Queue entry */
 struct entry {
@@ -121,6 +97,32 @@ struct entry {
 	arsdk_cmd_itf_cmd_send_status_cb_t      cmd_send_status;
 	/** User data given in callbacks */
 	void                                    *userdata;
+	/** Queuing time. */
+	struct timespec                         queued_ts;
+	/** Time to live; in millisecond, '0' for no limit. */
+	uint32_t                                ttl_ms;
+};
+
+/** Command pack */
+struct pack {
+	/** Data buffer. */
+	struct pomp_buffer      *buf;
+	/** Number of command in the pack. */
+	uint32_t                cmd_count;
+	/** Remaining data length. */
+	size_t                  remaining_len;
+	/** Sending sequence number. */
+	uint16_t                seq;
+	/** '1' if is waiting acknowledgement ; otherwise '0'. */
+	int                     waiting_ack;
+	/** '1' if acknowledged before an older pack of the window. */
+	int                     acked;
+	/** Last sending time. */
+	struct timespec         sent_ts;
+	/** Sending count. */
+	uint32_t                sent_count;
+	/** Length counted in flight by the congestion control. */
+	size_t                  flight_len;
 };
 
 /** Sending Queue */
@@ -137,27 +139,42 @@ struct queue {
 	uint32_t                     head;
 	/** Index where write a new entry. */
 	uint32_t                     tail;
+	/** Number of entries popped since the queue creation. */
+	uint32_t                     popped;
+	/** Number of pending entries with a time to live. */
+	uint32_t                     expiring;
+	/** Commands coalesced, only used by non-acknowledged queues. */
+	struct arsdk_cmd_itf_coalesce coalesce;
+	/** Bounds of the queue. */
+	struct arsdk_cmd_itf_queue_bound bound;
+	/** Scheduling state of the queue. */
+	struct arsdk_cmd_itf_sched_queue sched;
+	/** Statistics of the queue. */
+	struct arsdk_cmd_itf_queue_stats stats;
 	/** Last sequence number used to send. */
 	uint16_t                     seq;
+	/** Maximum size of a command pack. */
+	size_t                       pack_max_size;
 	/** Last sending time. */
 	struct timespec              last_sent_ts;
-	/** Command pack. */
-	struct {
-		/** Data buffer. */
-		struct pomp_buffer      *buf;
-		/** Number of command in the pack. */
-		uint32_t                cmd_count;
-		/** Remaining data length. */
-		size_t                  remaining_len;
-		/** Sending sequence number. */
-		uint16_t                seq;
-		/** '1' if is waiting acknowledgement ; otherwise '0'. */
-		int                     waiting_ack;
-		/** Last sending time. */
-		struct timespec         sent_ts;
-		/** Sending count. */
-		uint32_t                sent_count;
-	} pack;
+	/**
+	 * Queuing time of the oldest command not yet packed of a
+	 * non-acknowledged queue; start of the delay of its pack.
+	 */
+	struct timespec              first_queued_ts;
+	/**
+	 * Command packs, circular buffer of the packs waiting for their
+	 * acknowledgement. Non-acknowledged queues only use the first one.
+	 */
+	struct pack                  packs[ARSDK_CMD_ITF3_TX_WINDOW];
+	/** Index of the oldest pack. */
+	uint32_t                     pack_head;
+	/** Number of packs waiting for their acknowledgement. */
+	uint32_t                     pack_count;
+	/** Number of entries completely packed. */
+	uint32_t                     packed;
+	/** Remaining data length of the entry following the packed ones. */
+	size_t                       packed_remaining_len;
 	/** Last pack acknowledged. */
 	struct {
 		/** Sending sequence number. */
@@ -166,11 +183,21 @@ struct queue {
 		uint32_t                sent_count;
 		/** Count of acknowledgement received. */
 		uint32_t                ack_count;
-		/** Remaining data length. */
-		size_t                  remaining_len;
 	} last_pack;
 };
 
+/** Packs with acknowledgement received out of order for a queue */
+struct rx_reorder {
+	/**
+	 * Packs kept by distance from the last pack processed, the slot 'i'
+	 * for the distance 'i + 1'; NULL if not received.
+	 * The slot 0 is the next pack expected, it is processed at once.
+	 */
+	struct pomp_buffer      *packs[ARSDK_CMD_ITF3_RX_REORDER_MAX];
+	/** Number of packs kept. */
+	uint32_t                count;
+};
+
 /** Command interface version 3 */
 struct arsdk_cmd_itf3 {
 	/** Command interface V3 callbacks. */
@@ -186,10 +213,27 @@ struct arsdk_cmd_itf3 {
 	struct pomp_loop                   *loop;
 	/** Retry timer. */
 	struct pomp_timer                  *timer;
+	/** Expiration time of the retry timer; in microsecond, 0 if unset. */
+	uint64_t                           timer_expire_us;
 	/** Commands queues to send. */
 	struct queue                       **tx_queues;
 	/** Size of 'tx_queues'. */
 	uint32_t                           tx_count;
+	/** Map of the queues sending each command buffer type. */
+	struct queue                       *type_queues[
+						ARSDK_CMD_BUFFER_TYPE_COUNT];
+	/** Map of the queues for each transmission queue identifier. */
+	struct queue                       *id_queues[UINT8_MAX+1];
+	/**
+	 * Nesting level of the batches in progress; the queues are checked
+	 * only when the last one ends.
+	 */
+	uint32_t                           batch;
+	/**
+	 * Queue whose pack receives the command encoded directly, between
+	 * arsdk_cmd_itf3_send_enc_begin() and arsdk_cmd_itf3_send_enc_end().
+	 */
+	struct queue                       *enc_queue;
 	/**
 	 * Index offset between a transmission queue and
 	 * its reception acknowledge.
@@ -197,17 +241,63 @@ struct arsdk_cmd_itf3 {
 	uint8_t                            ackoff;
 	/** Sequence number to used to send the next acknowledgement. */
 	uint16_t                           next_ack_seq;
+	/**
+	 * Number of packs of a queue that can wait for their acknowledgement,
+	 * more than one if the peer processes packs in order.
+	 */
+	uint32_t                           tx_window;
+	/** Round trip time estimation of the acknowledged packs. */
+	struct arsdk_cmd_itf_rtt           rtt;
+	/** Scheduler of the tx queues. */
+	struct arsdk_cmd_itf_sched         sched;
+	/** Congestion control of the acknowledged tx queues. */
+	struct arsdk_cmd_itf_cc            cc;
 	/**
 	 * Map of last sequence numbers received for each reception
 	 * queue identifier.
 	 */
 	uint16_t                           recv_seq[UINT8_MAX+1];
+	/**
+	 * Map of flags telling whether a pack with acknowledgement was
+	 * received for each reception queue identifier.
+	 */
+	uint8_t                            withack_received[UINT8_MAX+1];
+
+	/** Delayed acknowledgements part. */
+	struct {
+		/**
+		 * '1' if the peer handles acknowledgements as cumulative,
+		 * several packs are then acknowledged at once.
+		 */
+		int                        cumulative;
+		/** Delayed acknowledgements timer. */
+		struct pomp_timer          *timer;
+		/**
+		 * Map of numbers of packs received but not yet acknowledged
+		 * for each reception queue identifier.
+		 */
+		uint8_t                    pending[UINT8_MAX+1];
+		/** Number of identifiers with packs not yet acknowledged. */
+		uint32_t                   pending_count;
+	} ack;
 
 	/**
 	 * Map of partial command received for each reception queue identifier.
 	 */
 	struct pomp_buffer *partial_cmd_buf[UINT8_MAX+1];
 
+	/**
+	 * Map of packs with acknowledgement received out of order for each
+	 * reception queue identifier; allocated on the first one.
+	 */
+	struct rx_reorder                  *rx_reorder[UINT8_MAX+1];
+
+	/**
+	 * Buffer reused to notify the commands received or encoded directly
+	 * in a pack.
+	 */
+	struct pomp_buffer                 *cmd_buf;
+
 	/** Link quality part. */
 	struct {
 		/** Link quality check timer. */
@@ -330,11 +420,14 @@ static void pack_recv_notify(struct arsdk_cmd_itf3 *self,
 /**
  */
 static int queue_new(const struct arsdk_cmd_queue_info *info,
+		size_t pack_max_size,
 		struct queue **ret_queue)
 {
 	struct queue *queue = NULL;
 	*ret_queue = NULL;
 	int res;
+	uint32_t i = 0;
+	uint32_t pack_count = 0;
 
 	/* Allocate structure */
 	queue = calloc(1, sizeof(*queue));
@@ -343,6 +436,8 @@ static int queue_new(const struct arsdk_cmd_queue_info *info,
 
 	/* Initialize structure */
 	memcpy(&queue->info, info, sizeof(*info));
+	arsdk_cmd_itf_queue_stats_init(&queue->stats, info);
+	queue->pack_max_size = pack_max_size;
 
 	/* Force infinite retry, without overwriting. */
 	queue->info.overwrite = 0;
@@ -352,35 +447,92 @@ static int queue_new(const struct arsdk_cmd_queue_info *info,
 	queue->seq = UINT16_MAX;
 	queue->last_pack.seq = UINT16_MAX;
 
-	queue->pack.buf = pomp_buffer_new(ARSDK_PACK_MAX_SIZE);
-	if (queue->pack.buf == NULL) {
-		res = -ENOMEM;
-		goto error;
+	/* Only acknowledged queues have several packs in flight */
+	pack_count = queue->info.type == ARSDK_TRANSPORT_DATA_TYPE_WITHACK ?
+			ARSDK_CMD_ITF3_TX_WINDOW : 1;
+	for (i = 0; i < pack_count; i++) {
+		queue->packs[i].buf = pomp_buffer_new(pack_max_size);
+		if (queue->packs[i].buf == NULL) {
+			res = -ENOMEM;
+			goto error;
+		}
 	}
 
 	*ret_queue = queue;
 	return 0;
 error:
+	for (i = 0; i < pack_count; i++) {
+		if (queue->packs[i].buf != NULL)
+			pomp_buffer_unref(queue->packs[i].buf);
+	}
 	free(queue);
 	return res;
 }
 
+/**
+ * Gets a pack of a queue.
+ *
+ * @param queue : queue of the pack.
+ * @param idx : index of the pack from the oldest one.
+ *
+ * @return the pack.
+ */
+static struct pack *queue_get_pack(struct queue *queue, uint32_t idx)
+{
+	return &queue->packs[(queue->pack_head + idx) %
+			ARSDK_CMD_ITF3_TX_WINDOW];
+}
+
+/**
+ */
+static void pack_reset(struct pack *pack)
+{
+	pomp_buffer_set_len(pack->buf, 0);
+	pack->cmd_count = 0;
+	pack->remaining_len = 0;
+	pack->waiting_ack = 0;
+	pack->acked = 0;
+	memset(&pack->sent_ts, 0, sizeof(pack->sent_ts));
+	pack->sent_count = 0;
+	pack->flight_len = 0;
+}
+
+/**
+ * Marks a pack acknowledged, removing it from the flight.
+ */
+static void pack_acked(struct arsdk_cmd_itf3 *self, struct pack *pack)
+{
+	arsdk_cmd_itf_cc_acked(&self->cc, pack->flight_len);
+	pack->flight_len = 0;
+	pack->acked = 1;
+	pack->waiting_ack = 0;
+}
+
 /**
  */
 static void queue_stop(struct queue *queue, struct arsdk_cmd_itf3 *itf)
 {
 	uint32_t i = 0, pos = 0;
 	struct entry *entry = NULL;
+	struct pack *pack = NULL;
+
+	/* Notify packs canceled */
+	for (i = 0; i < ARSDK_CMD_ITF3_TX_WINDOW; i++) {
+		pack = queue_get_pack(queue, i);
+		if (pack->buf == NULL || pack->cmd_count == 0)
+			continue;
 
-	/* Notify pack canceled */
-	if (queue->pack.cmd_count != 0) {
 		size_t len;
-		pomp_buffer_get_cdata(queue->pack.buf, NULL, &len, NULL);
+		pomp_buffer_get_cdata(pack->buf, NULL, &len, NULL);
 
-		pack_send_notify(itf, queue->pack.seq, queue->info.type,
+		pack_send_notify(itf, pack->seq, queue->info.type,
 				queue->info.id, len,
 				ARSDK_CMD_ITF_PACK_SEND_STATUS_CANCELED, 0);
+		pack_reset(pack);
 	}
+	queue->pack_head = queue->pack_count = 0;
+	queue->packed = 0;
+	queue->packed_remaining_len = 0;
 
 	/* Cancel all entries of queue */
 	pos = queue->head;
@@ -389,27 +541,96 @@ static void queue_stop(struct queue *queue, struct arsdk_cmd_itf3 *itf)
 		entry_send_notify(entry, itf, queue->info.type, queue->info.id,
 				ARSDK_CMD_ITF_CMD_SEND_STATUS_CANCELED, 0, 1);
 		entry_clear(entry);
+		queue->stats.dropped++;
 
 		/* Continue in circular buffer */
 		pos++;
 		if (pos >= queue->depth)
 			pos = 0;
 	}
+	queue->popped += queue->count;
 	queue->head = queue->tail = queue->count = 0;
+	queue->expiring = 0;
+	queue->bound.blocked = 0;
 }
 
 /**
  */
 static int queue_destroy(struct queue *queue, struct arsdk_cmd_itf3 *itf)
 {
+	uint32_t i = 0;
+
 	if (queue->count != 0)
 		return -EBUSY;
-	pomp_buffer_unref(queue->pack.buf);
+	for (i = 0; i < ARSDK_CMD_ITF3_TX_WINDOW; i++) {
+		if (queue->packs[i].buf != NULL)
+			pomp_buffer_unref(queue->packs[i].buf);
+	}
+	arsdk_cmd_itf_coalesce_clear(&queue->coalesce);
 	free(queue->entries);
 	free(queue);
 	return 0;
 }
 
+/**
+ * Sets the time to live of a new entry of a queue, from its command or the
+ * default one of the queue.
+ */
+static void queue_entry_set_ttl(struct queue *queue, struct entry *entry,
+		const struct arsdk_cmd *cmd)
+{
+	entry->ttl_ms = cmd->ttl_ms != 0 ? cmd->ttl_ms : queue->info.ttl_ms;
+	if (entry->ttl_ms != 0)
+		queue->expiring++;
+}
+
+/**
+ * Replaces the pending instance of a coalesced command by a newer one.
+ *
+ * @param queue : queue of the command.
+ * @param itf : command interface.
+ * @param slot : slot of the coalesced command.
+ * @param cmd : newer instance of the command.
+ * @param cmd_send_status : function to call with the send status.
+ * @param userdata : user data for 'cmd_send_status'.
+ *
+ * @return 0 in case of success, -ENOENT if no instance of the command can
+ * be replaced.
+ */
+static int queue_replace(struct queue *queue,
+		struct arsdk_cmd_itf3 *itf,
+		const struct arsdk_cmd_itf_coalesce_slot *slot,
+		const struct arsdk_cmd *cmd,
+		arsdk_cmd_itf_cmd_send_status_cb_t cmd_send_status,
+		void *userdata)
+{
+	uint32_t idx = slot->pos - queue->popped;
+	struct entry *entry = NULL;
+	struct entry old;
+
+	/* The instance must still be pending and not packed yet */
+	if (idx >= queue->count || idx < queue->packed)
+		return -ENOENT;
+	entry = &queue->entries[(queue->head + idx) % queue->depth];
+	if (entry->cmd.id != cmd->id)
+		return -ENOENT;
+
+	/* Replace it before notifying it canceled, the callback can send
+	 * again */
+	old = *entry;
+	entry_init(entry, cmd, cmd_send_status, userdata);
+	time_get_monotonic(&entry->queued_ts);
+	if (old.ttl_ms != 0)
+		queue->expiring--;
+	queue_entry_set_ttl(queue, entry, cmd);
+	queue->stats.queued++;
+	queue->stats.coalesced++;
+	entry_send_notify(&old, itf, queue->info.type, queue->info.id,
+			ARSDK_CMD_ITF_CMD_SEND_STATUS_CANCELED, 0, 1);
+	entry_clear(&old);
+	return 0;
+}
+
 /**
  */
 static int queue_add(struct queue *queue,
@@ -418,16 +639,30 @@ static int queue_add(struct queue *queue,
 		arsdk_cmd_itf_cmd_send_status_cb_t cmd_send_status,
 		void *userdata)
 {
+	int res = 0;
 	uint32_t newdepth = 0;
 	struct entry *newentries = NULL;
 	struct entry *entry = NULL;
 	uint32_t cnt1 = 0, cnt2 = 0;
+	struct arsdk_cmd_itf_coalesce_slot *slot = NULL;
+
+	/* Only keep the newest instance of a coalesced command */
+	slot = arsdk_cmd_itf_coalesce_find(&queue->coalesce, cmd->id);
+	if (slot != NULL && queue_replace(queue, itf, slot, cmd,
+			cmd_send_status, userdata) == 0)
+		return 0;
 
-	/* Grow entries if needed (before it becomes full)
+	/* Refuse the command if the queue is full */
+	res = arsdk_cmd_itf_queue_bound_check(&queue->bound, queue->count);
+	if (res < 0)
+		return res;
+
+	/* Grow entries if needed (before it becomes full), doubling its depth
 	 * As we are using a circular queue, it is easier to alloc a new array
 	 * and copy existing entries at start of it */
 	if (queue->count + 1 >= queue->depth) {
-		newdepth = queue->depth + 16;
+		newdepth = arsdk_cmd_itf_queue_bound_grow(&queue->bound,
+				queue->depth);
 		newentries = calloc(newdepth, sizeof(struct entry));
 		if (newentries == NULL)
 			return -ENOMEM;
@@ -459,11 +694,19 @@ static int queue_add(struct queue *queue,
 	/* Add in queue */
 	entry = &queue->entries[queue->tail];
 	entry_init(entry, cmd, cmd_send_status, userdata);
+	time_get_monotonic(&entry->queued_ts);
+	queue_entry_set_ttl(queue, entry, cmd);
+	if (queue->count == 0)
+		queue->first_queued_ts = entry->queued_ts;
 	queue->tail++;
 	if (queue->tail >= queue->depth)
 		queue->tail = 0;
 	queue->count++;
 
+	if (slot != NULL)
+		slot->pos = queue->popped + queue->count - 1;
+
+	queue->stats.queued++;
 	return 0;
 }
 
@@ -472,37 +715,118 @@ static int queue_add(struct queue *queue,
 static void queue_pop(struct queue *queue)
 {
 	struct entry *entry = &queue->entries[queue->head];
+	if (entry->ttl_ms != 0)
+		queue->expiring--;
 	entry_clear(entry);
 	queue->head++;
 	if (queue->head >= queue->depth)
 		queue->head = 0;
 	queue->count--;
+	queue->popped++;
+}
+
+/**
+ * Removes a pending entry of a queue, moving the following ones back.
+ * The entry is not cleared, it must be copied before.
+ *
+ * @param queue : queue of the entry.
+ * @param idx : index of the entry from the head of the queue.
+ */
+static void queue_remove(struct queue *queue, uint32_t idx)
+{
+	uint32_t i = 0;
+	struct entry *entry = NULL;
+	struct arsdk_cmd_itf_coalesce_slot *slot = NULL;
+
+	/* Forget the removed instance of a coalesced command */
+	entry = &queue->entries[(queue->head + idx) % queue->depth];
+	if (entry->ttl_ms != 0)
+		queue->expiring--;
+	slot = arsdk_cmd_itf_coalesce_find(&queue->coalesce, entry->cmd.id);
+	if (slot != NULL && slot->pos == queue->popped + idx)
+		slot->pos = queue->popped - 1;
+
+	for (i = idx; i + 1 < queue->count; i++) {
+		entry = &queue->entries[(queue->head + i) % queue->depth];
+		*entry = queue->entries[(queue->head + i + 1) % queue->depth];
+
+		/* Follow the moved instance of a coalesced command */
+		slot = arsdk_cmd_itf_coalesce_find(&queue->coalesce,
+				entry->cmd.id);
+		if (slot != NULL && slot->pos == queue->popped + i + 1)
+			slot->pos--;
+	}
+
+	queue->tail = queue->tail == 0 ? queue->depth - 1 : queue->tail - 1;
+	memset(&queue->entries[queue->tail], 0, sizeof(struct entry));
+	queue->count--;
+}
+
+/**
+ * Drops the pending commands of a queue whose time to live is passed,
+ * the ones of the packs in flight are kept.
+ *
+ * @param self : command interface.
+ * @param queue : queue to check.
+ * @param tsnow : current time.
+ */
+static void queue_drop_expired(struct arsdk_cmd_itf3 *self,
+		struct queue *queue, const struct timespec *tsnow)
+{
+	/* Skip the entries packed and the one partially packed */
+	uint32_t i = queue->packed +
+			(queue->packed_remaining_len != 0 ? 1 : 0);
+	struct entry *entry = NULL;
+	struct entry old;
+
+	while (queue->expiring != 0 && i < queue->count) {
+		entry = &queue->entries[(queue->head + i) % queue->depth];
+		if (!arsdk_cmd_itf_cmd_expired(entry->ttl_ms,
+				&entry->queued_ts, tsnow)) {
+			i++;
+			continue;
+		}
+
+		/* Remove it before notifying it expired, the callback can
+		 * send again */
+		old = *entry;
+		queue_remove(queue, i);
+		queue->stats.expired++;
+		entry_send_notify(&old, self, queue->info.type, queue->info.id,
+				ARSDK_CMD_ITF_CMD_SEND_STATUS_EXPIRED, 0, 1);
+		entry_clear(&old);
+	}
 }
 
 /**
  * Packs as much as possible the pending commands in only one payload.
+ * Packing starts after the entries already packed in the previous packs.
  *
  * @param self : command interface.
  * @param queue : queue of commands to send.
+ * @param pack : empty pack to fill.
  */
-static void queue_pack_cmds(struct arsdk_cmd_itf3 *self, struct queue *queue)
+static void queue_pack_cmds(struct arsdk_cmd_itf3 *self, struct queue *queue,
+		struct pack *pack)
 {
 	struct entry *entry = NULL;
 	size_t pack_len = 0;
+	uint32_t i = queue->packed;
 
-	queue_for_each_entry(queue, entry) {
+	while (i < queue->count) {
 		const uint8_t *cmd_data;
 		size_t cmd_len;
 		int done;
 
+		entry = &queue->entries[(queue->head + i) % queue->depth];
 		pomp_buffer_get_cdata(entry->cmd.buf, (const void **)&cmd_data,
 				&cmd_len, NULL);
 
-		if (queue->pack.cmd_count == 0 &&
-		    queue->last_pack.remaining_len != 0) {
+		if (pack->cmd_count == 0 &&
+		    queue->packed_remaining_len != 0) {
 			/* It is the following of a command partially sent. */
-			cmd_data += cmd_len - queue->last_pack.remaining_len;
-			cmd_len = queue->last_pack.remaining_len;
+			cmd_data += cmd_len - queue->packed_remaining_len;
+			cmd_len = queue->packed_remaining_len;
 		} else {
 			/* It is a new command. */
 
@@ -514,18 +838,22 @@ static void queue_pack_cmds(struct arsdk_cmd_itf3 *self, struct queue *queue)
 
 			pack_len += data_size;
 			/* Leave the loop if there is not enough space to write
-			   the command size. */
-			if (pack_len > ARSDK_PACK_MAX_SIZE)
+			   the command size, or the whole command if it can not
+			   be sent partially. */
+			if (pack_len > queue->pack_max_size)
+				break;
+			if (pack_len + cmd_len > queue->pack_max_size &&
+			    queue->info.type !=
+					ARSDK_TRANSPORT_DATA_TYPE_WITHACK)
 				break;
 
 			/* Append command size */
-			pomp_buffer_append_data(queue->pack.buf,
-						data, data_size);
+			pomp_buffer_append_data(pack->buf, data, data_size);
 		}
 
 		/* Command data: */
 		pack_len += cmd_len;
-		if (pack_len > ARSDK_PACK_MAX_SIZE) {
+		if (pack_len > queue->pack_max_size) {
 			/* Command too large to fit in the pack */
 			if (queue->info.type !=
 					ARSDK_TRANSPORT_DATA_TYPE_WITHACK) {
@@ -534,18 +862,17 @@ static void queue_pack_cmds(struct arsdk_cmd_itf3 *self, struct queue *queue)
 				break;
 			}
 
-			queue->pack.remaining_len =
-					pack_len - ARSDK_PACK_MAX_SIZE;
-			cmd_len -= queue->pack.remaining_len;
+			pack->remaining_len = pack_len - queue->pack_max_size;
+			cmd_len -= pack->remaining_len;
 		}
 
 		/* Append command payload */
-		pomp_buffer_append_data(queue->pack.buf, cmd_data, cmd_len);
-		queue->pack.cmd_count++;
+		pomp_buffer_append_data(pack->buf, cmd_data, cmd_len);
+		pack->cmd_count++;
 
 		/* Notify packed command */
 		enum arsdk_cmd_itf_cmd_send_status status =
-				queue->pack.remaining_len > 0 ?
+				pack->remaining_len > 0 ?
 				ARSDK_CMD_ITF_CMD_SEND_STATUS_PARTIALLY_PACKED :
 				ARSDK_CMD_ITF_CMD_SEND_STATUS_PACKED;
 		done = (queue->info.type == ARSDK_TRANSPORT_DATA_TYPE_NOACK &&
@@ -555,21 +882,113 @@ static void queue_pack_cmds(struct arsdk_cmd_itf3 *self, struct queue *queue)
 				  queue->info.type,
 				  queue->info.id,
 				  status,
-				  queue->seq,
+				  pack->seq,
 				  done);
 
 		/* Leave the loop if there is remaining data. */
-		if (queue->pack.remaining_len > 0)
+		queue->packed_remaining_len = pack->remaining_len;
+		if (pack->remaining_len > 0)
 			break;
+
+		queue->packed++;
+		queue->stats.packed++;
+		i++;
+	}
+}
+
+/**
+ * Releases the oldest pack of a queue once acknowledged, notifying and
+ * popping the commands it completes.
+ *
+ * @param self : command interface.
+ * @param queue : queue of the pack.
+ * @param tsnow : reception time of the acknowledgement.
+ */
+static void queue_release_pack(struct arsdk_cmd_itf3 *self,
+		struct queue *queue, const struct timespec *tsnow)
+{
+	struct pack *pack = queue_get_pack(queue, 0);
+	struct entry *entry = NULL;
+	uint32_t i = 0;
+
+	/* notify and pop each command completely send of the pack */
+	uint32_t cmd_count = pack->remaining_len == 0 ?
+					pack->cmd_count :
+					pack->cmd_count - 1;
+	for (i = 0; i < cmd_count; i++) {
+		entry = &queue->entries[queue->head];
+		arsdk_cmd_itf_histo_add(&queue->stats.ack_latency,
+				&entry->queued_ts, tsnow);
+		queue->stats.acked++;
+		entry_send_notify(entry, self, queue->info.type,
+			queue->info.id,
+			ARSDK_CMD_ITF_CMD_SEND_STATUS_ACK_RECEIVED,
+			pack->seq, 1);
+		queue_pop(queue);
+	}
+	queue->packed -= cmd_count;
+
+	/* Update last pack acknowledged. */
+	queue->last_pack.seq = pack->seq;
+	queue->last_pack.sent_count = pack->sent_count;
+	queue->last_pack.ack_count = 1;
+
+	/* Reset pack */
+	pack_reset(pack);
+	queue->pack_head = (queue->pack_head + 1) % ARSDK_CMD_ITF3_TX_WINDOW;
+	queue->pack_count--;
+}
+
+/**
+ * Builds the maps of the queues by command buffer type and by identifier;
+ * the first suitable queue is used.
+ */
+static void build_tx_queue_maps(struct arsdk_cmd_itf3 *itf)
+{
+	uint32_t i = 0;
+	int type = 0;
+	struct queue *queue = NULL;
+
+	for (i = 0; i < itf->tx_count; i++) {
+		queue = itf->tx_queues[i];
+		for (type = ARSDK_CMD_BUFFER_TYPE_NON_ACK;
+		     type < ARSDK_CMD_BUFFER_TYPE_COUNT; type++) {
+			if (itf->type_queues[type] == NULL &&
+			    arsdk_cmd_itf_queue_match_type(&queue->info, type))
+				itf->type_queues[type] = queue;
+		}
+		if (itf->id_queues[queue->info.id] == NULL)
+			itf->id_queues[queue->info.id] = queue;
 	}
 }
 
+/**
+ */
+static struct queue *find_tx_queue_by_type(struct arsdk_cmd_itf3 *itf,
+		enum arsdk_cmd_buffer_type buffer_type)
+{
+	if (buffer_type <= ARSDK_CMD_BUFFER_TYPE_INVALID ||
+	    buffer_type >= ARSDK_CMD_BUFFER_TYPE_COUNT) {
+		ARSDK_LOGW("Unknown buffer type: %d", buffer_type);
+		return NULL;
+	}
+
+	return itf->type_queues[buffer_type];
+}
+
+/**
+ */
+static struct queue *find_tx_queue_by_id(struct arsdk_cmd_itf3 *itf,
+		uint16_t id)
+{
+	return id <= UINT8_MAX ? itf->id_queues[id] : NULL;
+}
+
 /**
  */
 static struct queue *find_tx_queue(struct arsdk_cmd_itf3 *itf,
 		const struct arsdk_cmd *cmd)
 {
-	uint32_t i = 0;
 	const struct arsdk_cmd_desc *cmd_desc = NULL;
 	struct queue *queue = NULL;
 	enum arsdk_cmd_buffer_type buffer_type = ARSDK_CMD_BUFFER_TYPE_INVALID;
@@ -588,35 +1007,9 @@ static struct queue *find_tx_queue(struct arsdk_cmd_itf3 *itf,
 		buffer_type = cmd_desc->buffer_type;
 	}
 
-	/* Search suitable queue */
-	for (i = 0; i < itf->tx_count; i++) {
-		queue = itf->tx_queues[i];
-		enum arsdk_transport_data_type qtype = queue->info.type;
-		uint8_t qid = queue->info.id;
-		switch (buffer_type) {
-		case ARSDK_CMD_BUFFER_TYPE_NON_ACK:
-			if (qtype == ARSDK_TRANSPORT_DATA_TYPE_NOACK)
-				return queue;
-			break;
-
-		case ARSDK_CMD_BUFFER_TYPE_ACK:
-		case ARSDK_CMD_BUFFER_TYPE_HIGH_PRIO:
-			if (qtype == ARSDK_TRANSPORT_DATA_TYPE_WITHACK &&
-			    qid != ARSDK_TRANSPORT_ID_D2C_CMD_LOWPRIO)
-				return queue;
-			break;
-
-		case ARSDK_CMD_BUFFER_TYPE_LOW_PRIO:
-			if (qtype == ARSDK_TRANSPORT_DATA_TYPE_WITHACK &&
-			    qid == ARSDK_TRANSPORT_ID_D2C_CMD_LOWPRIO)
-				return queue;
-			break;
-
-		default:
-			ARSDK_LOGW("Unknown buffer type: %d", buffer_type);
-			break;
-		}
-	}
+	queue = find_tx_queue_by_type(itf, buffer_type);
+	if (queue != NULL)
+		return queue;
 
 	/* No suitable queue found */
 	ARSDK_LOGW("Unable to find suitable queue for cmd: %u,%u,%u",
@@ -625,95 +1018,33 @@ static struct queue *find_tx_queue(struct arsdk_cmd_itf3 *itf,
 }
 
 /**
+ * Sends a pack of a queue.
+ *
+ * @param self : command interface.
+ * @param queue : queue whose pack is to send.
+ * @param pack : pack to send.
+ * @param tsnow : current time.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
  */
-static void check_tx_queue(struct arsdk_cmd_itf3 *self,
-		const struct timespec *tsnow,
-		struct queue *queue,
-		int *next_timeout_ms)
+static int queue_send_pack(struct arsdk_cmd_itf3 *self, struct queue *queue,
+		struct pack *pack, const struct timespec *tsnow)
 {
 	int res = 0;
-	uint64_t diff_us = 0;
-	int diff_ms = 0;
-	int remaining_ms = 0;
 	struct arsdk_transport_header header;
 	struct arsdk_transport_payload payload;
 	size_t len = 0;
-	uint32_t i = 0;
-
-again:
-
-	/* Nothing to do if queue is empty */
-	if (queue->count == 0)
-		return;
-
-	/* If waiting for an ack, compute next time of check */
-	if (queue->pack.waiting_ack) {
-		if (time_timespec_diff_in_range(
-				&queue->pack.sent_ts,
-				tsnow,
-				(uint64_t)queue->info.ack_timeout_ms * 1000,
-				&diff_us)) {
-			/* Still need to wait for ack */
-			diff_ms = (int)(diff_us / 1000);
-			remaining_ms = queue->info.ack_timeout_ms - diff_ms;
-
-			/* If the remaining time is less than a milisecond,
-			   retry now. We should NEVER set next_timeout_ms
-			   to zero here, as it would deactivate the pomp_timer
-			*/
-			if (remaining_ms > 0) {
-				if (*next_timeout_ms < 0 ||
-				    remaining_ms < *next_timeout_ms)
-					*next_timeout_ms = remaining_ms;
-				return;
-			}
-		}
-
-		/* Retry sending command */
-		queue->pack.waiting_ack = 0;
-		memset(&queue->pack.sent_ts, 0, sizeof(queue->pack.sent_ts));
-		self->lnqlt.retry_count++;
-	}
-
-	/* If delay between tx is not passed, compute next time of check */
-	if (queue->info.max_tx_rate_ms > 0 && time_timespec_diff_in_range(
-			&queue->last_sent_ts,
-			tsnow,
-			(uint64_t)queue->info.max_tx_rate_ms * 1000,
-			&diff_us)) {
-		/* Still need to wait before sending */
-		diff_ms = (int)(diff_us / 1000);
-		remaining_ms = queue->info.max_tx_rate_ms - diff_ms;
-
-		/* If the remaining time is less than a milisecond,
-		   send the pack now. We should NEVER set next_timeout_ms
-		   to zero here, as it would deactivate the pomp_timer
-		*/
-		if (remaining_ms > 0) {
-			if (*next_timeout_ms < 0 ||
-			    remaining_ms < *next_timeout_ms)
-				*next_timeout_ms = remaining_ms;
-			return;
-		}
-	}
-
-	/* If it is not a retry, increment the sequence number and
-	   pack new commands to send. */
-	if (queue->pack.cmd_count == 0) {
-		queue->seq++;
-		queue_pack_cmds(self, queue);
-	}
 
 	/* Determine pack buffer length */
-	pomp_buffer_get_cdata(queue->pack.buf, NULL, &len, NULL);
+	pomp_buffer_get_cdata(pack->buf, NULL, &len, NULL);
 
 	/* Construct header and payload */
 	memset(&header, 0, sizeof(header));
 	header.type = queue->info.type;
 	header.id = queue->info.id;
-	header.seq = queue->seq;
+	header.seq = pack->seq;
 
-	arsdk_transport_payload_init_with_buf(&payload, queue->pack.buf);
+	arsdk_transport_payload_init_with_buf(&payload, pack->buf);
 
 	/* Send it */
 	res = arsdk_transport_send_data(self->transport, &header, &payload,
@@ -721,53 +1052,335 @@ again:
 	arsdk_transport_payload_clear(&payload);
 	if (res < 0) {
 		ARSDK_LOGI("arsdk_transport_send_data err: %d seq%" PRIu16
-			   "queue: %" PRIu8, -res, queue->seq, queue->info.id);
-		return;
+			   "queue: %" PRIu8, -res, pack->seq, queue->info.id);
+		return res;
 	}
 
 	/* Notify pack sent */
 	pack_send_notify(self, header.seq, queue->info.type, queue->info.id,
 			len, ARSDK_CMD_ITF_PACK_SEND_STATUS_SENT,
-			queue->pack.sent_count + 1);
-	if (queue->pack.sent_count == 100) {
+			pack->sent_count + 1);
+	if (pack->sent_count == 100) {
 		ARSDK_LOG_EVT("ARSDK",
-			      "event='too_many_retries';max_pack_size=%d;current_pack_size=%zu",
-			      ARSDK_PACK_MAX_SIZE, len);
+			      "event='too_many_retries';max_pack_size=%zu;current_pack_size=%zu",
+			      queue->pack_max_size, len);
 	}
+	if (pack->sent_count == 0)
+		queue->stats.sent++;
+	else
+		queue->stats.retried++;
+	queue->stats.pack_size = (uint32_t)len;
 	queue->last_sent_ts = *tsnow;
+	arsdk_cmd_itf_sched_sent(&self->sched, &queue->sched, len);
+	return 0;
+}
 
-	if (queue->info.type == ARSDK_TRANSPORT_DATA_TYPE_WITHACK) {
-		queue->pack.seq = header.seq;
-		queue->pack.waiting_ack = 1;
-		queue->pack.sent_ts = *tsnow;
-		queue->pack.sent_count++;
+/**
+ */
+static void set_next_timeout(int *next_timeout_ms, int timeout_ms)
+{
+	if (*next_timeout_ms < 0 || timeout_ms < *next_timeout_ms)
+		*next_timeout_ms = timeout_ms;
+}
 
-		/* update ack timeout */
-		if (queue->info.ack_timeout_ms > 0) {
-			diff_ms = queue->info.ack_timeout_ms;
-			if (*next_timeout_ms < 0 || diff_ms < *next_timeout_ms)
-				*next_timeout_ms = diff_ms;
-		}
-	} else {
-		/* pop all commands send in the pack */
-		for (i = 0; i < queue->pack.cmd_count; i++)
-			queue_pop(queue);
+/**
+ * Checks whether the delay between two sendings of a queue is passed,
+ * computes the next time of check otherwise.
+ */
+static int queue_tx_rate_passed(struct queue *queue,
+		const struct timespec *tsnow,
+		int *next_timeout_ms)
+{
+	uint64_t diff_us = 0;
+	int remaining_ms = 0;
 
-		/* reset pack */
-		pomp_buffer_set_len(queue->pack.buf, 0);
-		queue->pack.cmd_count = 0;
+	if (queue->info.max_tx_rate_ms <= 0 || !time_timespec_diff_in_range(
+			&queue->last_sent_ts,
+			tsnow,
+			(uint64_t)queue->info.max_tx_rate_ms * 1000,
+			&diff_us))
+		return 1;
 
-		goto again;
-	}
+	/* Still need to wait before sending */
+	remaining_ms = queue->info.max_tx_rate_ms - (int)(diff_us / 1000);
+
+	/* If the remaining time is less than a milisecond,
+	   send the pack now. We should NEVER set next_timeout_ms
+	   to zero here, as it would deactivate the pomp_timer
+	*/
+	if (remaining_ms <= 0)
+		return 1;
+
+	set_next_timeout(next_timeout_ms, remaining_ms);
+	return 0;
 }
 
 /**
+ * Checks whether the pending commands of a non-acknowledged queue fill a
+ * pack; it is then sent without waiting for more commands.
  */
-static void check_tx_queues(struct arsdk_cmd_itf3 *self)
+static int queue_fills_pack(struct queue *queue)
+{
+	uint32_t i = 0;
+	struct entry *entry = NULL;
+	size_t pack_len = 0;
+	size_t cmd_len = 0;
+	uint8_t data[5];
+	size_t data_size = 0;
+
+	for (i = 0; i < queue->count; i++) {
+		entry = &queue->entries[(queue->head + i) % queue->depth];
+		pomp_buffer_get_cdata(entry->cmd.buf, NULL, &cmd_len, NULL);
+		futils_varint_write_u32(data, sizeof(data), cmd_len,
+				&data_size);
+		pack_len += data_size + cmd_len;
+		if (pack_len >= queue->pack_max_size)
+			return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Checks a non-acknowledged queue, its commands are sent as soon as possible,
+ * or once the delay of the pack is passed, and popped.
+ */
+static void check_tx_queue_noack(struct arsdk_cmd_itf3 *self,
+		const struct timespec *tsnow,
+		struct queue *queue,
+		int *next_timeout_ms)
+{
+	int res = 0;
+	uint32_t i = 0;
+	struct pack *pack = &queue->packs[0];
+
+	while (queue->count != 0) {
+		/* If delay between tx is not passed, wait */
+		if (!queue_tx_rate_passed(queue, tsnow, next_timeout_ms))
+			return;
+
+		/* Wait for the turn of the queue */
+		if (!arsdk_cmd_itf_sched_can_send(&queue->sched))
+			return;
+
+		/* Drop the obsolete commands before packing new ones */
+		if (pack->cmd_count == 0) {
+			queue_drop_expired(self, queue, tsnow);
+			if (queue->count == 0)
+				return;
+		}
+
+		/* Wait for more commands until the delay of the pack is
+		   passed, unless they already fill it */
+		if (pack->cmd_count == 0 && arsdk_cmd_itf_pack_delay_wait(
+				queue->info.pack_delay_ms,
+				&queue->first_queued_ts, tsnow,
+				next_timeout_ms) &&
+		    !queue_fills_pack(queue))
+			return;
+
+		/* If it is not a retry, increment the sequence number and
+		   pack new commands to send. */
+		if (pack->cmd_count == 0) {
+			queue->seq++;
+			pack->seq = queue->seq;
+			queue_pack_cmds(self, queue, pack);
+		}
+
+		/* Drop a command too large to be sent */
+		if (pack->cmd_count == 0) {
+			ARSDK_LOGW("Command too large for queue %" PRIu8,
+					queue->info.id);
+			entry_send_notify(&queue->entries[queue->head], self,
+					queue->info.type, queue->info.id,
+					ARSDK_CMD_ITF_CMD_SEND_STATUS_CANCELED,
+					0, 1);
+			queue_pop(queue);
+			queue->stats.dropped++;
+			queue->seq--;
+			continue;
+		}
+
+		/* Send it */
+		res = queue_send_pack(self, queue, pack, tsnow);
+		if (res < 0)
+			return;
+
+		/* pop all commands send in the pack */
+		for (i = 0; i < pack->cmd_count; i++)
+			queue_pop(queue);
+		queue->packed = 0;
+
+		/* reset pack */
+		pack_reset(pack);
+	}
+}
+
+/**
+ * Checks an acknowledged queue. New packs are sent while the number of packs
+ * waiting for their acknowledgement is less than the window; each of them is
+ * sent again if its acknowledgement is not received in time.
+ */
+static void check_tx_queue_withack(struct arsdk_cmd_itf3 *self,
+		const struct timespec *tsnow,
+		struct queue *queue,
+		int *next_timeout_ms)
+{
+	int res = 0;
+	uint64_t diff_us = 0;
+	int remaining_ms = 0;
+	uint32_t i = 0;
+	size_t len = 0;
+	struct pack *pack = NULL;
+
+	/* Drop the obsolete commands waiting behind the packs in flight */
+	queue_drop_expired(self, queue, tsnow);
+
+	/* Nothing to do if queue is empty */
+	if (queue->count == 0)
+		return;
+
+	for (i = 0;; i++) {
+		if (i < queue->pack_count) {
+			pack = queue_get_pack(queue, i);
+			if (pack->acked)
+				continue;
+		} else if (i < self->tx_window) {
+			/* Pack new commands only when they can be sent; a
+			   pack is frozen until its acknowledgement */
+			if (queue->packed >= queue->count)
+				return;
+			if (!queue_tx_rate_passed(queue, tsnow, next_timeout_ms))
+				return;
+			if (!arsdk_cmd_itf_sched_can_send(&queue->sched))
+				return;
+
+			/* The length of the pack is only known once packed,
+			   wait for room for a full one */
+			if (!arsdk_cmd_itf_cc_can_send(&self->cc,
+					queue->pack_max_size))
+				return;
+
+			pack = queue_get_pack(queue, queue->pack_count);
+			queue->seq++;
+			pack->seq = queue->seq;
+			queue_pack_cmds(self, queue, pack);
+			queue->pack_count++;
+		} else {
+			/* Window full */
+			return;
+		}
+
+		/* If waiting for an ack, compute next time of check */
+		if (pack->waiting_ack) {
+			if (time_timespec_diff_in_range(
+					&pack->sent_ts,
+					tsnow,
+					(uint64_t)self->rtt.rto_ms * 1000,
+					&diff_us)) {
+				/* Still need to wait for ack */
+				remaining_ms = self->rtt.rto_ms -
+						(int)(diff_us / 1000);
+
+				/* If the remaining time is less than a
+				   milisecond, retry now. We should NEVER set
+				   next_timeout_ms to zero here, as it would
+				   deactivate the pomp_timer
+				*/
+				if (remaining_ms > 0) {
+					set_next_timeout(next_timeout_ms,
+							remaining_ms);
+					continue;
+				}
+			}
+
+			/* Retry sending command, waiting longer for the
+			   oldest pack acknowledgement */
+			pack->waiting_ack = 0;
+			memset(&pack->sent_ts, 0, sizeof(pack->sent_ts));
+			self->lnqlt.retry_count++;
+			arsdk_cmd_itf_cc_loss(&self->cc, &self->rtt, tsnow);
+			if (i == 0)
+				arsdk_cmd_itf_rtt_backoff(&self->rtt);
+		}
+
+		/* If delay between tx is not passed, wait */
+		if (!queue_tx_rate_passed(queue, tsnow, next_timeout_ms))
+			return;
+
+		/* Wait for the turn of the queue */
+		if (!arsdk_cmd_itf_sched_can_send(&queue->sched))
+			return;
+
+		/* Wait for room in the congestion window for a new pack */
+		pomp_buffer_get_cdata(pack->buf, NULL, &len, NULL);
+		if (pack->sent_count == 0 &&
+		    !arsdk_cmd_itf_cc_can_send(&self->cc, len))
+			return;
+
+		/* Send it */
+		res = queue_send_pack(self, queue, pack, tsnow);
+		if (res < 0)
+			return;
+
+		if (pack->sent_count == 0) {
+			pack->flight_len = len;
+			arsdk_cmd_itf_cc_sent(&self->cc, len);
+		}
+		pack->waiting_ack = 1;
+		pack->sent_ts = *tsnow;
+		pack->sent_count++;
+
+		/* update ack timeout */
+		set_next_timeout(next_timeout_ms, self->rtt.rto_ms);
+	}
+}
+
+/**
+ */
+static void check_tx_queue(struct arsdk_cmd_itf3 *self,
+		const struct timespec *tsnow,
+		struct queue *queue,
+		int *next_timeout_ms)
+{
+	if (queue->info.type == ARSDK_TRANSPORT_DATA_TYPE_WITHACK)
+		check_tx_queue_withack(self, tsnow, queue, next_timeout_ms);
+	else
+		check_tx_queue_noack(self, tsnow, queue, next_timeout_ms);
+}
+
+/**
+ * Notifies a queue drained below its low watermark.
+ */
+static void notify_tx_queue_drained(struct arsdk_cmd_itf3 *self,
+		struct queue *queue)
+{
+	if (!arsdk_cmd_itf_queue_bound_drained(&queue->bound, queue->count) ||
+	    self->itf_cbs.queue_drained == NULL)
+		return;
+
+	(*self->itf_cbs.queue_drained)(self->itf, queue->bound.type,
+			self->itf_cbs.userdata);
+}
+
+/**
+ * Checks a queue for the scheduler.
+ */
+static void sched_check_tx_queue(void *queue,
+		const struct timespec *tsnow,
+		int *next_timeout_ms,
+		void *userdata)
+{
+	struct arsdk_cmd_itf3 *self = userdata;
+
+	check_tx_queue(self, tsnow, queue, next_timeout_ms);
+}
+
+/**
+ */
+static void check_tx_queues(struct arsdk_cmd_itf3 *self)
 {
-	int res = 0;
 	uint32_t i = 0;
-	struct queue *queue = NULL;
 	struct timespec tsnow;
 	int next_timeout_ms = -1;
 
@@ -776,22 +1389,151 @@ static void check_tx_queues(struct arsdk_cmd_itf3 *self)
 		return;
 	}
 
-	/* Check all queues */
-	for (i = 0; i < self->tx_count; i++) {
-		queue = self->tx_queues[i];
-		check_tx_queue(self, &tsnow, queue, &next_timeout_ms);
-	}
+	/* Check all queues, by priority level */
+	arsdk_cmd_itf_sched_run(&self->sched, &tsnow, &next_timeout_ms,
+			&sched_check_tx_queue, self);
 
 	/* Update next timeout */
-	if (next_timeout_ms > 0) {
-		res = pomp_timer_set(self->timer, (uint32_t) next_timeout_ms);
-		if (res < 0)
-			ARSDK_LOG_ERRNO("pomp_timer_set", -res);
-	} else {
-		res = pomp_timer_clear(self->timer);
-		if (res < 0)
-			ARSDK_LOG_ERRNO("pomp_timer_clear", -res);
+	arsdk_cmd_itf_timer_update(self->timer, &self->timer_expire_us,
+			&tsnow, next_timeout_ms, 1);
+
+	/* Notify the queues drained */
+	for (i = 0; i < self->tx_count; i++)
+		notify_tx_queue_drained(self, self->tx_queues[i]);
+}
+
+/**
+ * Checks only the queue which changed, the other ones keep their next
+ * time of check.
+ */
+static void check_one_tx_queue(struct arsdk_cmd_itf3 *self,
+		struct queue *queue)
+{
+	struct timespec tsnow;
+	int next_timeout_ms = -1;
+
+	/* Let the scheduler share the budgets between the queues, and the
+	   queues use the room left in the congestion window */
+	if (self->sched.limited || self->cc.enabled) {
+		check_tx_queues(self);
+		return;
+	}
+
+	if (time_get_monotonic(&tsnow) < 0) {
+		ARSDK_LOG_ERRNO("time_get_monotonic", errno);
+		return;
+	}
+
+	check_tx_queue(self, &tsnow, queue, &next_timeout_ms);
+
+	/* Bring the next timeout forward if needed */
+	arsdk_cmd_itf_timer_update(self->timer, &self->timer_expire_us,
+			&tsnow, next_timeout_ms, 0);
+
+	notify_tx_queue_drained(self, queue);
+}
+
+/**
+ * Finds a sent pack of a queue from its sequence number.
+ */
+static struct pack *queue_find_pack(struct queue *queue, uint16_t seq)
+{
+	uint32_t i = 0;
+	struct pack *pack = NULL;
+
+	for (i = 0; i < queue->pack_count; i++) {
+		pack = queue_get_pack(queue, i);
+		if (pack->sent_count > 0 && pack->seq == seq)
+			return pack;
+	}
+
+	return NULL;
+}
+
+/**
+ * Handles an acknowledgement from a peer processing the packs in order; it
+ * acknowledges all the packs up to its sequence number and the packs
+ * selected by its bitmap.
+ *
+ * @param self : command interface.
+ * @param queue : queue of the acknowledged packs.
+ * @param seq : sequence number of the last pack processed by the peer.
+ * @param sack : bitmap of the packs following 'seq' received by the peer.
+ * @param len : acknowledgement payload length.
+ * @param tsnow : reception time of the acknowledgement.
+ */
+static void recv_ack_cumulative(struct arsdk_cmd_itf3 *self,
+		struct queue *queue, uint16_t seq, uint16_t sack, size_t len,
+		const struct timespec *tsnow)
+{
+	uint32_t i = 0;
+	uint32_t ack_count = 0;
+	uint16_t diff = 0;
+	struct pack *pack = NULL;
+
+	for (i = 0; i < queue->pack_count; i++) {
+		pack = queue_get_pack(queue, i);
+		if (pack->sent_count == 0)
+			break;
+
+		/* Acknowledged by the sequence number or by the bitmap */
+		diff = pack->seq - seq;
+		if (diff != 0 && diff <= UINT16_MAX / 2 &&
+		    (diff > 16 || !(sack & (1 << (diff - 1)))))
+			continue;
+		if (pack->acked)
+			continue;
+
+		/* Sample the round trip time of the pack acknowledged by its
+		   sequence number if sent only once */
+		if (diff == 0 && pack->sent_count == 1) {
+			arsdk_cmd_itf_rtt_sample(&self->rtt, &pack->sent_ts,
+					tsnow);
+			arsdk_cmd_itf_histo_add(&queue->stats.ack_rtt,
+					&pack->sent_ts, tsnow);
+		} else {
+			arsdk_cmd_itf_rtt_ack(&self->rtt);
+		}
+
+		self->lnqlt.ack_count++;
+		ack_count++;
+
+		/* Notify pack ack received */
+		pack_send_notify(self, pack->seq, queue->info.type,
+			queue->info.id, len,
+			ARSDK_CMD_ITF_PACK_SEND_STATUS_ACK_RECEIVED, 1);
+
+		pack_acked(self, pack);
 	}
+
+	if (ack_count == 0) {
+		ARSDK_LOGD("ACK: id(%u) seq(%u) already acknowledged",
+				queue->info.id, seq);
+
+		/* Notify pack ack received */
+		pack_send_notify(self, seq, queue->info.type, queue->info.id,
+			len, ARSDK_CMD_ITF_PACK_SEND_STATUS_ACK_RECEIVED, 0);
+
+		/* The acknowledgement of the pack preceding the oldest one
+		   again means the peer received a following pack but not
+		   this one, send it again without waiting for its timeout,
+		   only once. */
+		pack = queue_get_pack(queue, 0);
+		if (queue->pack_count > 0 && pack->waiting_ack &&
+		    pack->sent_count == 1 &&
+		    seq == (uint16_t)(pack->seq - 1)) {
+			pack->waiting_ack = 0;
+			memset(&pack->sent_ts, 0, sizeof(pack->sent_ts));
+			self->lnqlt.retry_count++;
+			arsdk_cmd_itf_cc_loss(&self->cc, &self->rtt, tsnow);
+		}
+		return;
+	}
+
+	/* Release the acknowledged packs from the oldest one, commands
+	   are notified in order */
+	while (queue->pack_count > 0 && queue_get_pack(queue, 0)->acked)
+		queue_release_pack(self, queue, tsnow);
 }
 
 /**
@@ -800,11 +1542,11 @@ static void recv_ack(struct arsdk_cmd_itf3 *self,
 		const struct arsdk_transport_header *header,
 		const struct arsdk_transport_payload *payload)
 {
-	uint16_t seq = 0, id = 0;
-	uint32_t queue_i = 0;
+	uint16_t seq = 0, id = 0, sack = 0;
+	uint8_t flags = 0;
 	struct queue *queue = NULL;
-	struct entry *entry = NULL;
-	uint32_t entry_i = 0;
+	struct pack *pack = NULL;
+	struct timespec tsnow;
 
 	if (payload->cdata == NULL) {
 		ARSDK_LOGW("ACK: missing seq");
@@ -815,95 +1557,149 @@ static void recv_ack(struct arsdk_cmd_itf3 *self,
 		return;
 	}
 	memcpy(&seq, payload->cdata, sizeof(seq));
+	if (payload->len > sizeof(seq))
+		flags = ((const uint8_t *)payload->cdata)[sizeof(seq)];
+	if (payload->len >= sizeof(seq) + 1 + sizeof(sack)) {
+		memcpy(&sack, (const uint8_t *)payload->cdata + sizeof(seq) + 1,
+				sizeof(sack));
+	}
 	id = header->id - self->ackoff;
 
-	for (queue_i = 0; queue_i < self->tx_count; queue_i++) {
-		queue = self->tx_queues[queue_i];
-		if (queue->info.id != id)
-			continue;
+	if (time_get_monotonic(&tsnow) < 0) {
+		ARSDK_LOG_ERRNO("time_get_monotonic", errno);
+		return;
+	}
 
-		if (seq == queue->last_pack.seq) {
-			/* Acknowledgement of a last pack retry. */
-			queue->last_pack.ack_count++;
-			ARSDK_LOGD("ACK: id(%u) seq(%u) ack(%u/%u)",
+	/* Send several packs at once if the peer processes them in order */
+	if ((flags & ARSDK_CMD_ITF3_ACK_FLAG_IN_ORDER) &&
+	    self->tx_window != ARSDK_CMD_ITF3_TX_WINDOW) {
+		ARSDK_LOGI("ACK: packs processed in order by the peer, "
+			   "tx window: %d", ARSDK_CMD_ITF3_TX_WINDOW);
+		self->tx_window = ARSDK_CMD_ITF3_TX_WINDOW;
+	}
+
+	/* Acknowledge several packs at once if the peer handles it */
+	if ((flags & ARSDK_CMD_ITF3_ACK_FLAG_CUMULATIVE) &&
+	    !self->ack.cumulative) {
+		ARSDK_LOGI("ACK: cumulative acknowledgements handled "
+			   "by the peer");
+		self->ack.cumulative = 1;
+	}
+
+	queue = find_tx_queue_by_id(self, id);
+	if (queue == NULL) {
+		ARSDK_LOGW("ACK: unknown id %u", id);
+		return;
+	}
+
+	/* The peer processing the packs in order, its
+	   acknowledgements are cumulative */
+	if (self->tx_window > 1) {
+		recv_ack_cumulative(self, queue, seq, sack,
+				payload->len, &tsnow);
+		return;
+	}
+
+	pack = queue_find_pack(queue, seq);
+	if (pack == NULL && seq == queue->last_pack.seq) {
+		/* Acknowledgement of a last pack retry. */
+		queue->last_pack.ack_count++;
+		ARSDK_LOGD("ACK: id(%u) seq(%u) ack(%u/%u)",
+				id, seq,
+				queue->last_pack.ack_count,
+				queue->last_pack.sent_count);
+
+		/* Notify pack ack received */
+		pack_send_notify(self, seq, queue->info.type,
+			queue->info.id, payload->len,
+			ARSDK_CMD_ITF_PACK_SEND_STATUS_ACK_RECEIVED,
+			queue->last_pack.ack_count);
+
+		if (queue->last_pack.ack_count >
+				queue->last_pack.sent_count) {
+			ARSDK_LOGE("ACK: id(%u) seq(%u) "
+				   "More ack(%u) than sendings(%u)",
 					id, seq,
 					queue->last_pack.ack_count,
 					queue->last_pack.sent_count);
+		}
 
-			/* Notify pack ack received */
-			pack_send_notify(self, seq, queue->info.type,
-				queue->info.id, payload->len,
-				ARSDK_CMD_ITF_PACK_SEND_STATUS_ACK_RECEIVED,
-				queue->last_pack.ack_count);
-
-			if (queue->last_pack.ack_count >
-					queue->last_pack.sent_count) {
-				ARSDK_LOGE("ACK: id(%u) seq(%u) "
-					   "More ack(%u) than sendings(%u)",
-						id, seq,
-						queue->last_pack.ack_count,
-						queue->last_pack.sent_count);
-			}
-
-			return;
-		} else if (seq != queue->seq) {
+		return;
+	} else if (pack == NULL) {
+		/* Acknowledgement of an older pack retry is expected
+		   with several packs in flight. */
+		if ((uint16_t)(queue->last_pack.seq - seq) <
+				ARSDK_CMD_ITF3_TX_WINDOW) {
+			ARSDK_LOGD("ACK: id(%u) seq(%u) already "
+				   "acknowledged", id, seq);
+		} else {
 			ARSDK_LOGE("ACK: Bad seq for id %u (%d/%d)",
 					id, seq, queue->seq);
-
-			/* Notify pack ack received */
-			pack_send_notify(self, seq, queue->info.type,
-				queue->info.id, payload->len,
-				ARSDK_CMD_ITF_PACK_SEND_STATUS_ACK_RECEIVED,
-				0);
-			return;
 		}
 
-		if (!queue->pack.waiting_ack) {
-			ARSDK_LOGE("ACK: no ack waited for id %u", id);
-			return;
-		}
+		/* Notify pack ack received */
+		pack_send_notify(self, seq, queue->info.type,
+			queue->info.id, payload->len,
+			ARSDK_CMD_ITF_PACK_SEND_STATUS_ACK_RECEIVED,
+			0);
+		return;
+	}
 
-		if (queue->count == 0) {
-			ARSDK_LOGE("ACK: no pending pack for id %u", id);
-			return;
-		}
+	if (pack->acked) {
+		ARSDK_LOGD("ACK: id(%u) seq(%u) already acknowledged",
+				id, seq);
+		return;
+	}
 
-		self->lnqlt.ack_count++;
+	/* Sample the round trip time if the pack was sent only once */
+	if (pack->sent_count == 1) {
+		arsdk_cmd_itf_rtt_sample(&self->rtt, &pack->sent_ts,
+				&tsnow);
+		arsdk_cmd_itf_histo_add(&queue->stats.ack_rtt,
+				&pack->sent_ts, &tsnow);
+	} else {
+		arsdk_cmd_itf_rtt_ack(&self->rtt);
+	}
 
-		/* Notify pack ack received */
-		pack_send_notify(self, seq, queue->info.type, queue->info.id,
-			payload->len,
-			ARSDK_CMD_ITF_PACK_SEND_STATUS_ACK_RECEIVED, 1);
+	self->lnqlt.ack_count++;
 
-		/* notify and pop each command completely send of the pack */
-		uint32_t cmd_count = queue->pack.remaining_len == 0 ?
-						queue->pack.cmd_count :
-						queue->pack.cmd_count - 1;
-		for (entry_i = 0; entry_i < cmd_count; entry_i++) {
-			entry = &queue->entries[queue->head];
-			entry_send_notify(entry, self, queue->info.type,
-				queue->info.id,
-				ARSDK_CMD_ITF_CMD_SEND_STATUS_ACK_RECEIVED,
-				seq, 1);
-			queue_pop(queue);
-		}
+	/* Notify pack ack received */
+	pack_send_notify(self, seq, queue->info.type, queue->info.id,
+		payload->len,
+		ARSDK_CMD_ITF_PACK_SEND_STATUS_ACK_RECEIVED, 1);
 
-		/* Update last pack acknowledged. */
-		queue->last_pack.seq = queue->seq;
-		queue->last_pack.sent_count = queue->pack.sent_count;
-		queue->last_pack.ack_count = 1;
-		queue->last_pack.remaining_len = queue->pack.remaining_len;
+	/* Release the acknowledged packs from the oldest one, commands
+	   are notified in order */
+	pack_acked(self, pack);
+	while (queue->pack_count > 0 && queue_get_pack(queue, 0)->acked)
+		queue_release_pack(self, queue, &tsnow);
+}
 
-		/* Reset pack */
-		pomp_buffer_set_len(queue->pack.buf, 0);
-		queue->pack.cmd_count = 0;
-		queue->pack.sent_count = 0;
-		queue->pack.remaining_len = 0;
+/**
+ * Computes the bitmap of the packs following an acknowledged one kept out of
+ * order, bit 'i' for the pack 'seq + 1 + i'.
+ */
+static uint16_t rx_reorder_sack(struct arsdk_cmd_itf3 *self, uint8_t id,
+		uint16_t seq)
+{
+	struct rx_reorder *reorder = self->rx_reorder[id];
+	uint16_t sack = 0;
+	uint16_t diff = 0;
+	uint32_t i = 0;
 
-		return;
+	if (reorder == NULL || reorder->count == 0)
+		return 0;
+
+	for (i = 0; i < ARSDK_CMD_ITF3_RX_REORDER_MAX; i++) {
+		if (reorder->packs[i] == NULL)
+			continue;
+
+		diff = (uint16_t)(self->recv_seq[id] + 1 + i - seq);
+		if (diff >= 1 && diff <= 16)
+			sack |= (uint16_t)(1 << (diff - 1));
 	}
 
-	ARSDK_LOGW("ACK: unknown id %u", id);
+	return sack;
 }
 
 /**
@@ -913,13 +1709,29 @@ static int send_ack(struct arsdk_cmd_itf3 *self, uint8_t id, uint16_t seq)
 	int res = 0;
 	struct arsdk_transport_header header;
 	struct arsdk_transport_payload payload;
+	uint16_t sack = 0;
+	size_t len = sizeof(seq) + 1;
+	uint8_t data[sizeof(seq) + 1 + sizeof(sack)];
+
+	/* Construct data with given frame's seq as data, followed by flags
+	 * ignored by peers not knowing them */
+	memcpy(data, &seq, sizeof(seq));
+	data[sizeof(seq)] = ARSDK_CMD_ITF3_ACK_FLAG_IN_ORDER |
+			    ARSDK_CMD_ITF3_ACK_FLAG_CUMULATIVE;
+
+	/* Tell the packs kept out of order, the peer does not need to send
+	 * them again */
+	sack = rx_reorder_sack(self, id, seq);
+	if (sack != 0) {
+		memcpy(data + len, &sack, sizeof(sack));
+		len += sizeof(sack);
+	}
 
-	/* Construct data with given frame's seq as data */
 	memset(&header, 0, sizeof(header));
 	header.type = ARSDK_TRANSPORT_DATA_TYPE_ACK;
 	header.id = id + self->ackoff;
 	header.seq = self->next_ack_seq++;
-	arsdk_transport_payload_init_with_data(&payload, &seq, sizeof(seq));
+	arsdk_transport_payload_init_with_data(&payload, data, len);
 
 	/* Send it */
 	res = arsdk_transport_send_data(self->transport, &header, &payload,
@@ -929,10 +1741,88 @@ static int send_ack(struct arsdk_cmd_itf3 *self, uint8_t id, uint16_t seq)
 	/* Notify pack acknowledge sent, force type to data with ack since
 	 * we will never send an acknowledge for non-ack data */
 	pack_recv_notify(self, seq, ARSDK_TRANSPORT_DATA_TYPE_WITHACK, id,
-			sizeof(seq), ARSDK_CMD_ITF_PACK_RECV_STATUS_ACK_SENT);
+			len, ARSDK_CMD_ITF_PACK_RECV_STATUS_ACK_SENT);
 	return res;
 }
 
+/**
+ * Clears the packs not yet acknowledged of a reception queue.
+ *
+ * @param self : command interface.
+ * @param id : queue identifier.
+ */
+static void ack_pending_clear(struct arsdk_cmd_itf3 *self, uint8_t id)
+{
+	if (self->ack.pending[id] == 0)
+		return;
+
+	self->ack.pending[id] = 0;
+	self->ack.pending_count--;
+}
+
+/**
+ * Acknowledges a received pack with acknowledgement. If the peer handles
+ * cumulative acknowledgements, the packs received in order are acknowledged
+ * several at once, after a short delay.
+ *
+ * @param self : command interface.
+ * @param id : queue identifier.
+ * @param seq : sequence number of the pack.
+ * @param process : result of 'check_withack_seq' for the pack.
+ */
+static void ack_pack(struct arsdk_cmd_itf3 *self, uint8_t id, uint16_t seq,
+		int process)
+{
+	int res = 0;
+
+	if (!self->ack.cumulative) {
+		/* Acknowledge each pack received in order or duplicated, an
+		 * out of order pack tells the peer which pack is missing */
+		send_ack(self, id, process >= 0 ? seq : self->recv_seq[id]);
+		return;
+	}
+
+	/* Delay the acknowledgement of a pack received in order */
+	if (self->ack.pending[id]++ == 0)
+		self->ack.pending_count++;
+	if (process > 0 &&
+	    self->ack.pending[id] < ARSDK_CMD_ITF3_ACK_MAX_PENDING) {
+		/* Start the delay if no other acknowledgement is pending */
+		if (self->ack.pending_count > 1)
+			return;
+		res = pomp_timer_set(self->ack.timer,
+				ARSDK_CMD_ITF3_ACK_DELAY_MS);
+		if (res < 0)
+			ARSDK_LOG_ERRNO("pomp_timer_set", -res);
+		return;
+	}
+
+	/* Acknowledge now the last pack processed, a duplicated or
+	 * out of order pack tells the peer which pack is missing */
+	ack_pending_clear(self, id);
+	send_ack(self, id, self->recv_seq[id]);
+}
+
+/**
+ */
+static void ack_timer_cb(struct pomp_timer *timer, void *userdata)
+{
+	struct arsdk_cmd_itf3 *self = userdata;
+	uint32_t i = 0;
+
+	if (self->transport == NULL)
+		return;
+
+	/* Acknowledge the delayed packs */
+	for (i = 0; i <= UINT8_MAX && self->ack.pending_count != 0; i++) {
+		if (self->ack.pending[i] == 0)
+			continue;
+
+		ack_pending_clear(self, (uint8_t)i);
+		send_ack(self, (uint8_t)i, self->recv_seq[i]);
+	}
+}
+
 /**
  */
 static void link_quality_timer_cb(struct pomp_timer *timer, void *userdata)
@@ -966,6 +1856,17 @@ static void link_quality_timer_cb(struct pomp_timer *timer, void *userdata)
 		(*self->itf_cbs.link_quality)(self->itf, tx_quality, rx_quality,
 				rx_useful, self->cbs.userdata);
 
+	/* Round trip time callback */
+	if (self->itf_cbs.link_quality_rtt) {
+		(*self->itf_cbs.link_quality_rtt)(self->itf,
+				self->rtt.srtt_us != 0 ?
+					(int32_t)(self->rtt.srtt_us / 1000) : -1,
+				self->rtt.srtt_us != 0 ?
+					(int32_t)(self->rtt.rttvar_us / 1000) :
+					-1,
+				self->rtt.rto_ms, self->itf_cbs.userdata);
+	}
+
 	/* Link quality reset */
 	self->lnqlt.ack_count = 0;
 	self->lnqlt.retry_count = 0;
@@ -997,6 +1898,13 @@ int arsdk_cmd_itf3_stop(struct arsdk_cmd_itf3 *self)
 				queue_stop(self->tx_queues[i], self);
 		}
 	}
+	arsdk_cmd_itf_cc_stop(&self->cc);
+
+	/* Drop the delayed acknowledgements */
+	if (self->ack.timer != NULL)
+		pomp_timer_clear(self->ack.timer);
+	memset(self->ack.pending, 0, sizeof(self->ack.pending));
+	self->ack.pending_count = 0;
 
 	self->transport = NULL;
 	return 0;
@@ -1017,7 +1925,373 @@ int arsdk_cmd_itf3_send(struct arsdk_cmd_itf3 *self,
 	if (self->transport == NULL)
 		return -EPIPE;
 
-	cmd_log(self, cmd, ARSDK_CMD_DIR_TX);
+	cmd_log(self, cmd, ARSDK_CMD_DIR_TX);
+
+	/* Use default callback if none given */
+	if (send_status == NULL) {
+		send_status = self->itf_cbs.cmd_send_status;
+		userdata = self->itf_cbs.userdata;
+	}
+
+	/* Determine queue where to put command */
+	queue = find_tx_queue(self, cmd);
+	if (queue == NULL)
+		return -EINVAL;
+
+	/* Add in tx queue */
+	res = queue_add(queue, self, cmd, send_status, userdata);
+	if (res < 0)
+		return res;
+
+	/* Check if something can be sent now, unless more commands are
+	 * coming in the current batch */
+	if (self->batch == 0)
+		check_one_tx_queue(self, queue);
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf3_batch_begin(struct arsdk_cmd_itf3 *self)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	self->batch++;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf3_batch_end(struct arsdk_cmd_itf3 *self)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(self->batch > 0, -EALREADY);
+
+	self->batch--;
+	if (self->batch == 0 && self->transport != NULL)
+		check_tx_queues(self);
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf3_get_stats(struct arsdk_cmd_itf3 *self,
+		struct arsdk_cmd_itf_queue_stats *stats,
+		uint32_t *count)
+{
+	uint32_t i = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	for (i = 0; i < self->tx_count && i < *count; i++) {
+		stats[i] = self->tx_queues[i]->stats;
+		stats[i].depth = self->tx_queues[i]->count;
+		if (self->tx_queues[i]->info.type ==
+				ARSDK_TRANSPORT_DATA_TYPE_WITHACK)
+			arsdk_cmd_itf_cc_stats(&self->cc, &self->rtt,
+					&stats[i]);
+	}
+	*count = self->tx_count;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf3_set_queue_watermarks(struct arsdk_cmd_itf3 *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t high,
+		uint32_t low)
+{
+	struct queue *queue = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	queue = find_tx_queue_by_type(self, type);
+	if (queue == NULL)
+		return -EINVAL;
+
+	return arsdk_cmd_itf_queue_bound_set(&queue->bound, type, high, low);
+}
+
+/**
+ */
+int arsdk_cmd_itf3_set_cmd_coalescing(struct arsdk_cmd_itf3 *self,
+		const struct arsdk_cmd_desc *desc,
+		int enable)
+{
+	struct queue *queue = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
+
+	/* Only the non-acknowledged commands can be coalesced */
+	queue = find_tx_queue_by_type(self, desc->buffer_type);
+	if (queue == NULL ||
+	    queue->info.type != ARSDK_TRANSPORT_DATA_TYPE_NOACK)
+		return -EINVAL;
+
+	return arsdk_cmd_itf_coalesce_set(&queue->coalesce,
+			ARSDK_CMD_FULL_ID(desc->prj_id, desc->cls_id,
+					desc->cmd_id),
+			enable);
+}
+
+/**
+ */
+int arsdk_cmd_itf3_set_pack_delay(struct arsdk_cmd_itf3 *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t delay_ms)
+{
+	struct queue *queue = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(delay_ms <= ARSDK_CMD_ITF_PACK_DELAY_MAX_MS,
+			-EINVAL);
+
+	/* Only the non-acknowledged packs can be delayed */
+	queue = find_tx_queue_by_type(self, type);
+	if (queue == NULL ||
+	    queue->info.type != ARSDK_TRANSPORT_DATA_TYPE_NOACK)
+		return -EINVAL;
+
+	queue->info.pack_delay_ms = (int)delay_ms;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf3_set_queue_ttl(struct arsdk_cmd_itf3 *self,
+		enum arsdk_cmd_buffer_type type,
+		uint32_t ttl_ms)
+{
+	struct queue *queue = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	queue = find_tx_queue_by_type(self, type);
+	if (queue == NULL)
+		return -EINVAL;
+
+	queue->info.ttl_ms = ttl_ms;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf3_set_queue_sched(struct arsdk_cmd_itf3 *self,
+		enum arsdk_cmd_buffer_type type,
+		const struct arsdk_cmd_itf_queue_sched *sched)
+{
+	struct queue *queue = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(sched != NULL, -EINVAL);
+
+	queue = find_tx_queue_by_type(self, type);
+	if (queue == NULL)
+		return -EINVAL;
+
+	return arsdk_cmd_itf_sched_set_queue(&self->sched, &queue->sched,
+			sched);
+}
+
+/**
+ */
+int arsdk_cmd_itf3_set_tx_budget(struct arsdk_cmd_itf3 *self,
+		uint32_t budget)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	arsdk_cmd_itf_sched_set_budget(&self->sched, budget);
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf3_set_congestion_control(struct arsdk_cmd_itf3 *self,
+		int enable)
+{
+	uint32_t i = 0;
+	size_t pack_size = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	for (i = 0; i < self->tx_count; i++) {
+		if (self->tx_queues[i]->info.type ==
+				ARSDK_TRANSPORT_DATA_TYPE_WITHACK &&
+		    self->tx_queues[i]->pack_max_size > pack_size)
+			pack_size = self->tx_queues[i]->pack_max_size;
+	}
+
+	arsdk_cmd_itf_cc_enable(&self->cc, enable, pack_size);
+	check_tx_queues(self);
+	return 0;
+}
+
+/**
+ * Checks whether a command can be encoded directly in the pack of a queue
+ * and sent immediately.
+ *
+ * Nothing must be pending in the queue to keep the sending order.
+ */
+static int can_send_direct(struct arsdk_cmd_itf3 *self, struct queue *queue,
+		const struct timespec *tsnow)
+{
+	uint64_t diff_us = 0;
+
+	if (queue->info.type != ARSDK_TRANSPORT_DATA_TYPE_NOACK ||
+	    queue->count != 0 || queue->packs[0].cmd_count != 0 ||
+	    queue->info.pack_delay_ms > 0 || self->sched.limited)
+		return 0;
+
+	/* Let the batch fill the packs */
+	if (self->batch != 0)
+		return 0;
+
+	/* Delay between tx not passed */
+	if (queue->info.max_tx_rate_ms > 0 && time_timespec_diff_in_range(
+			&queue->last_sent_ts,
+			tsnow,
+			(uint64_t)queue->info.max_tx_rate_ms * 1000,
+			&diff_us))
+		return 0;
+
+	return 1;
+}
+
+/**
+ * Resets the pack sent with a command encoded directly in it, and notifies
+ * this command.
+ *
+ * The command only exists in the pack, it is copied in the reused command
+ * buffer when it is observed. The pack is reset before the notification,
+ * the callbacks can send other commands.
+ *
+ * @param self : command interface.
+ * @param queue : queue of the pack.
+ * @param pack : pack sent.
+ * @param cdata : command data in the pack.
+ * @param len : command length.
+ * @param send_status : function to call with send status.
+ * @param userdata : user data for send_status callback.
+ */
+static void enc_cmd_sent(struct arsdk_cmd_itf3 *self, struct queue *queue,
+		struct pack *pack, const void *cdata, size_t len,
+		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
+		void *userdata)
+{
+	int res = 0;
+	struct arsdk_cmd cmd;
+	uint16_t seq = pack->seq;
+
+	if (send_status == NULL && self->itf_cbs.cmd_log == NULL) {
+		pack_reset(pack);
+		return;
+	}
+
+	res = arsdk_cmd_itf_cmd_buf_set(&self->cmd_buf, cdata, len);
+	pack_reset(pack);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("arsdk_cmd_itf_cmd_buf_set", -res);
+		return;
+	}
+
+	arsdk_cmd_init_with_buf(&cmd, self->cmd_buf);
+	res = arsdk_cmd_dec_header(&cmd);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("arsdk_cmd_dec_header", -res);
+		arsdk_cmd_clear(&cmd);
+		return;
+	}
+
+	cmd_log(self, &cmd, ARSDK_CMD_DIR_TX);
+
+	/* A non-acknowledged command is done once packed */
+	if (send_status != NULL) {
+		(*send_status)(self->itf, &cmd,
+				data_type_to_buffer_type(queue->info.type,
+						queue->info.id),
+				ARSDK_CMD_ITF_CMD_SEND_STATUS_PACKED,
+				seq, 1, userdata);
+	}
+	arsdk_cmd_clear(&cmd);
+}
+
+/**
+ */
+int arsdk_cmd_itf3_send_enc_begin(struct arsdk_cmd_itf3 *self,
+		const struct arsdk_cmd_desc *desc,
+		size_t len,
+		uint8_t **data)
+{
+	int res = 0;
+	struct queue *queue = NULL;
+	struct pack *pack = NULL;
+	struct timespec tsnow;
+	uint8_t *pack_data = NULL;
+	size_t size_len = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(data != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(self->enc_queue == NULL, -EBUSY);
+
+	if (self->transport == NULL)
+		return -EPIPE;
+
+	queue = find_tx_queue_by_type(self, desc->buffer_type);
+	if (queue == NULL || time_get_monotonic(&tsnow) < 0 ||
+	    !can_send_direct(self, queue, &tsnow))
+		return -EAGAIN;
+
+	/* The command too large is dropped by the queue */
+	size_len = len < 0x80 ? 1 : len < 0x4000 ? 2 : 3;
+	if (size_len + len > queue->pack_max_size)
+		return -EAGAIN;
+
+	/* Fails if the pack is still referenced by the transport */
+	pack = &queue->packs[0];
+	res = pomp_buffer_ensure_capacity(pack->buf, size_len + len);
+	if (res == 0)
+		res = pomp_buffer_set_len(pack->buf, size_len + len);
+	if (res == 0)
+		res = pomp_buffer_get_data(pack->buf, (void **)&pack_data,
+				NULL, NULL);
+	if (res < 0) {
+		pack_reset(pack);
+		return res == -EPERM ? -EAGAIN : res;
+	}
+
+	futils_varint_write_u32(pack_data, size_len, len, &size_len);
+	pack->cmd_count = 1;
+	self->enc_queue = queue;
+	*data = pack_data + size_len;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf3_send_enc_end(struct arsdk_cmd_itf3 *self,
+		arsdk_cmd_itf_cmd_send_status_cb_t send_status,
+		void *userdata)
+{
+	int res = 0;
+	struct queue *queue = NULL;
+	struct pack *pack = NULL;
+	struct pomp_buffer *buf = NULL;
+	struct arsdk_cmd cmd;
+	struct timespec tsnow;
+	const void *cdata = NULL;
+	size_t len = 0;
+	uint32_t cmd_len = 0;
+	size_t size_len = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(self->enc_queue != NULL, -EPERM);
+
+	queue = self->enc_queue;
+	pack = &queue->packs[0];
+	self->enc_queue = NULL;
 
 	/* Use default callback if none given */
 	if (send_status == NULL) {
@@ -1025,19 +2299,42 @@ int arsdk_cmd_itf3_send(struct arsdk_cmd_itf3 *self,
 		userdata = self->itf_cbs.userdata;
 	}
 
-	/* Determine queue where to put command */
-	queue = find_tx_queue(self, cmd);
-	if (queue == NULL)
-		return -EINVAL;
-
-	/* Add in tx queue */
-	res = queue_add(queue, self, cmd, send_status, userdata);
-	if (res < 0)
+	pomp_buffer_get_cdata(pack->buf, &cdata, &len, NULL);
+	res = futils_varint_read_u32(cdata, len, &cmd_len, &size_len);
+	if (res < 0) {
+		pack_reset(pack);
 		return res;
+	}
 
-	/* Check if something can be sent now */
-	check_tx_queues(self);
-	return 0;
+	queue->seq++;
+	pack->seq = queue->seq;
+	res = time_get_monotonic(&tsnow);
+	if (res == 0)
+		res = queue_send_pack(self, queue, pack, &tsnow);
+	if (res == 0) {
+		queue->stats.queued++;
+		queue->stats.packed++;
+		enc_cmd_sent(self, queue, pack,
+				(const uint8_t *)cdata + size_len, cmd_len,
+				send_status, userdata);
+		return 0;
+	}
+
+	/* Queue the command to retry later like any other */
+	queue->seq--;
+	buf = pomp_buffer_new_with_data((const uint8_t *)cdata + size_len,
+			cmd_len);
+	pack_reset(pack);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	arsdk_cmd_init_with_buf(&cmd, buf);
+	pomp_buffer_unref(buf);
+	res = arsdk_cmd_dec_header(&cmd);
+	if (res == 0)
+		res = arsdk_cmd_itf3_send(self, &cmd, send_status, userdata);
+	arsdk_cmd_clear(&cmd);
+	return res;
 }
 
 static int should_process_data(struct arsdk_cmd_itf3 *self, uint8_t id,
@@ -1061,6 +2358,47 @@ static int should_process_data(struct arsdk_cmd_itf3 *self, uint8_t id,
 	}
 }
 
+/**
+ * Checks the sequence number of an acknowledged pack; such packs are
+ * processed in order since the peer may send several of them without
+ * waiting for their acknowledgements.
+ *
+ * @param self : command interface.
+ * @param id : queue identifier.
+ * @param seq : sequence number of the pack.
+ *
+ * @return 1 if the pack is the next one and has to be processed, 0 if it was
+ * already processed and has only to be acknowledged again, -1 if a previous
+ * pack is missing, in this case the pack is kept until the missing one is
+ * received or, if too far, sent again by the peer.
+ */
+static int check_withack_seq(struct arsdk_cmd_itf3 *self, uint8_t id,
+		uint16_t seq)
+{
+	uint16_t prev = self->recv_seq[id];
+	uint16_t diff = seq - prev;
+
+	/* Accept the first pack whatever its sequence number */
+	if (!self->withack_received[id]) {
+		self->withack_received[id] = 1;
+		self->recv_seq[id] = seq;
+		return 1;
+	} else if (diff == 1) {
+		self->recv_seq[id] = seq;
+		return 1;
+	} else if (diff == 0 || diff > UINT16_MAX / 2) {
+		ARSDK_LOGD("Duplicated seq num for queue: %" PRIu8
+			   " ; recv: %" PRIu16 " prev: %" PRIu16,
+				id, seq, prev);
+		return 0;
+	} else {
+		ARSDK_LOGD("Out of order seq num for queue: %" PRIu8
+			   " ; recv: %" PRIu16 " prev: %" PRIu16,
+				id, seq, prev);
+		return -1;
+	}
+}
+
 /**
  */
 static void lnqlt_rx_update(struct arsdk_cmd_itf3 *self,
@@ -1080,8 +2418,207 @@ static void lnqlt_rx_update(struct arsdk_cmd_itf3 *self,
 	}
 }
 
+/**
+ * Notifies the reception of a command.
+ *
+ * @param self : command interface.
+ * @param data_type : transport data type of the queue.
+ * @param queue_id : id of the queue.
+ * @param cmd : received command.
+ */
+static void recv_cmd(struct arsdk_cmd_itf3 *self,
+		enum arsdk_transport_data_type data_type, uint8_t queue_id,
+		struct arsdk_cmd *cmd)
+{
+	int res = 0;
+
+	/* Set arsdk_cmd buffer type from transport data type */
+	cmd->buffer_type = data_type_to_buffer_type(data_type, queue_id);
+
+	/* Try to decode header of command, Notify reception */
+	res = arsdk_cmd_dec_header(cmd);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("arsdk_cmd_dec_header", -res);
+	} else {
+		cmd_log(self, cmd, ARSDK_CMD_DIR_RX);
+		(*self->itf_cbs.recv_cmd)(self->itf, cmd,
+				self->itf_cbs.userdata);
+	}
+}
+
+/**
+ * Notifies the reception of a complete command from its data.
+ * The command buffer is reused from one command to the other unless a
+ * reference on it was kept during the notification.
+ *
+ * @param self : command interface.
+ * @param data_type : transport data type of the queue.
+ * @param queue_id : id of the queue.
+ * @param data : command data.
+ * @param len : command length.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+static int recv_cmd_data(struct arsdk_cmd_itf3 *self,
+		enum arsdk_transport_data_type data_type, uint8_t queue_id,
+		const void *data, size_t len)
+{
+	int res = 0;
+	struct arsdk_cmd cmd;
+
+	res = arsdk_cmd_itf_cmd_buf_set(&self->cmd_buf, data, len);
+	if (res < 0)
+		return res;
+
+	arsdk_cmd_init_with_buf(&cmd, self->cmd_buf);
+	recv_cmd(self, data_type, queue_id, &cmd);
+	arsdk_cmd_clear(&cmd);
+	return 0;
+}
+
+/**
+ * Scans the complete commands of a payload.
+ * Stops on a partial command or when the slices array is full.
+ *
+ * @param data : payload data to scan.
+ * @param len : payload length.
+ * @param slices : array to fill with the commands found.
+ * @param max_count : size of 'slices'.
+ * @param count : will contain the number of commands found.
+ * @param scan_len : will contain the length of the commands found,
+ * size prefixes included.
+ * @return 0 in case of success, negative errno value in case of error.
+ * 'count' and 'scan_len' are also set in case of error.
+ */
+static int scan_cmds(const uint8_t *data, size_t len,
+		struct cmd_slice *slices, size_t max_count,
+		size_t *count, size_t *scan_len)
+{
+	int res = 0;
+	size_t off = 0;
+	size_t n = 0;
+	uint32_t val;
+	size_t val_len;
+
+	while (off < len && n < max_count) {
+		/* Read command size from varuint32, usually on 1 byte */
+		if (data[off] < 0x80) {
+			val = data[off];
+			val_len = 1;
+		} else {
+			res = futils_varint_read_u32(data + off, len - off,
+					&val, &val_len);
+			if (res < 0)
+				break;
+		}
+
+		/* Partial command */
+		if (val > len - off - val_len)
+			break;
+
+		slices[n].off = (uint32_t)(off + val_len);
+		slices[n].len = val;
+		n++;
+		off += val_len + val;
+	}
+
+	*count = n;
+	*scan_len = off;
+	return res;
+}
+
+/**
+ * Saves the start of a partial command, waiting for its continuation.
+ *
+ * @param self : command interface.
+ * @param data_type : transport data type of the queue.
+ * @param queue_id : id of the queue.
+ * @param data : partial command data, with its size prefix.
+ * @param len : partial command length.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+static int save_partial_cmd(struct arsdk_cmd_itf3 *self,
+		enum arsdk_transport_data_type data_type, uint8_t queue_id,
+		const uint8_t *data, size_t len)
+{
+	int res = 0;
+	uint32_t cmd_size;
+	size_t val_len = 0;
+	struct pomp_buffer *buf = NULL;
+
+	/* Only acknowledged commands could be sent partially */
+	if (data_type != ARSDK_TRANSPORT_DATA_TYPE_WITHACK)
+		return -EPROTO;
+
+	res = futils_varint_read_u32(data, len, &cmd_size, &val_len);
+	if (res < 0)
+		return res;
+
+	buf = pomp_buffer_new(cmd_size);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	res = pomp_buffer_append_data(buf, data + val_len, len - val_len);
+	if (res < 0) {
+		pomp_buffer_unref(buf);
+		return res;
+	}
+
+	self->partial_cmd_buf[queue_id] = buf;
+	return 0;
+}
+
+/**
+ * Continues a partial command with the start of a payload.
+ *
+ * @param self : command interface.
+ * @param data_type : transport data type of the queue.
+ * @param queue_id : id of the queue.
+ * @param data : payload data.
+ * @param len : payload length.
+ * @return length of payload used in case of success,
+ * negative errno value in case of error.
+ */
+static ssize_t continue_partial_cmd(struct arsdk_cmd_itf3 *self,
+		enum arsdk_transport_data_type data_type, uint8_t queue_id,
+		const uint8_t *data, size_t len)
+{
+	int res = 0;
+	size_t cmd_size = 0;
+	size_t cmd_rcv_len = 0;
+	struct arsdk_cmd cmd;
+	struct pomp_buffer *buf = self->partial_cmd_buf[queue_id];
+
+	self->partial_cmd_buf[queue_id] = NULL;
+
+	res = pomp_buffer_get_cdata(buf, NULL, &cmd_rcv_len, &cmd_size);
+	if (res < 0)
+		goto out;
+
+	if (cmd_size - cmd_rcv_len < len)
+		len = cmd_size - cmd_rcv_len;
+
+	res = pomp_buffer_append_data(buf, data, len);
+	if (res < 0)
+		goto out;
+
+	if (cmd_rcv_len + len < cmd_size) {
+		/* Still partial, wait for the continuation */
+		self->partial_cmd_buf[queue_id] = buf;
+		return len;
+	}
+
+	arsdk_cmd_init_with_buf(&cmd, buf);
+	recv_cmd(self, data_type, queue_id, &cmd);
+	arsdk_cmd_clear(&cmd);
+
+out:
+	pomp_buffer_unref(buf);
+	return res < 0 ? res : (ssize_t)len;
+}
+
 /**
  * Unpacks each command from the playload.
+ * Commands are first indexed in one pass, then notified from the index.
  *
  * @param self : command interface.
  * @param data_type : transport data type of the queue.
@@ -1095,103 +2632,217 @@ static int unpack_cmds(struct arsdk_cmd_itf3 *self,
 		const void *payload_data, size_t payload_len)
 {
 	int res = 0;
-	struct arsdk_cmd cmd;
-	size_t cmd_size = 0;
-	size_t cmd_rcv_len = 0;
-	size_t data_len;
-	int is_partial_cmd;
+	int err = 0;
+	ssize_t used = 0;
+	struct cmd_slice slices[ARSDK_CMD_ITF3_SCAN_MAX];
+	size_t count = 0;
+	size_t scan_len = 0;
+	size_t i = 0;
 	const uint8_t *data = payload_data;
 	const uint8_t *data_end = data + payload_len;
-	struct pomp_buffer *buf = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(data != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(payload_len > 0, -EINVAL);
 
+	if (data_type == ARSDK_TRANSPORT_DATA_TYPE_WITHACK &&
+	    self->partial_cmd_buf[queue_id] != NULL) {
+		/* It is the following of a partial command. */
+		used = continue_partial_cmd(self, data_type, queue_id,
+				data, payload_len);
+		if (used < 0)
+			return (int)used;
+		data += used;
+	}
+
 	while (data < data_end) {
-		data_len = data_end - data;
-		if (data_type == ARSDK_TRANSPORT_DATA_TYPE_WITHACK &&
-		    data == payload_data &&
-		    self->partial_cmd_buf[queue_id] != NULL) {
-			/* It is the following of a partial command. */
-			buf = self->partial_cmd_buf[queue_id];
-			self->partial_cmd_buf[queue_id] = NULL;
-
-			res = pomp_buffer_get_cdata(buf, NULL, &cmd_rcv_len,
-					&cmd_size);
-			if (res < 0)
-				return res;
-		} else {
-			/* It is a new command. */
+		res = scan_cmds(data, data_end - data, slices,
+				ARSDK_CMD_ITF3_SCAN_MAX, &count, &scan_len);
+
+		for (i = 0; i < count; i++) {
+			err = recv_cmd_data(self, data_type, queue_id,
+					data + slices[i].off, slices[i].len);
+			if (err < 0)
+				ARSDK_LOG_ERRNO("recv_cmd_data", -err);
+		}
+		if (res < 0)
+			return res;
 
-			/* Read command size from varuint32 */
-			uint32_t val;
-			size_t val_len = 0;
-			res = futils_varint_read_u32(data, data_len,
-						     &val, &val_len);
-			if (res < 0)
-				return res;
-			cmd_size = val;
-			cmd_rcv_len = 0;
-			data += val_len;
-			data_len -= val_len;
+		data += scan_len;
+		if (count < ARSDK_CMD_ITF3_SCAN_MAX && data < data_end) {
+			/* It is a partial command */
+			return save_partial_cmd(self, data_type, queue_id,
+					data, data_end - data);
 		}
+	}
 
-		is_partial_cmd = (cmd_size - cmd_rcv_len > data_len);
-		if (is_partial_cmd) {
-			/* It is an partial command */
+	return 0;
+}
 
-			/* Only acknowledged commands could be sent partially */
-			if (data_type != ARSDK_TRANSPORT_DATA_TYPE_WITHACK)
-				return -EPROTO;
+/**
+ * Keeps a pack with acknowledgement received out of order until the missing
+ * packs preceding it are received.
+ *
+ * @param self : command interface.
+ * @param id : queue identifier.
+ * @param seq : sequence number of the pack.
+ * @param data : payload data of the pack.
+ * @param len : payload length.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ * -ERANGE if the pack is too far from the last pack processed.
+ */
+static int rx_reorder_hold(struct arsdk_cmd_itf3 *self, uint8_t id,
+		uint16_t seq, const void *data, size_t len)
+{
+	struct rx_reorder *reorder = self->rx_reorder[id];
+	uint16_t diff = seq - self->recv_seq[id];
 
-			data_len = data_end - data;
-		} else {
-			/* It is a complete command */
-			data_len = cmd_size - cmd_rcv_len;
-		}
+	if (diff < 2 || diff > ARSDK_CMD_ITF3_RX_REORDER_MAX)
+		return -ERANGE;
 
-		/* Create a new buffer if needed. */
-		if (buf == NULL) {
-			buf = pomp_buffer_new(cmd_size);
-			if (buf == NULL)
-				return -ENOMEM;
-		}
+	if (reorder == NULL) {
+		reorder = calloc(1, sizeof(*reorder));
+		if (reorder == NULL)
+			return -ENOMEM;
+		self->rx_reorder[id] = reorder;
+	}
 
-		res = pomp_buffer_append_data(buf, data, data_len);
-		if (res < 0) {
-			pomp_buffer_unref(buf);
-			buf = NULL;
-			return res;
-		}
+	/* Already kept */
+	if (reorder->packs[diff - 1] != NULL)
+		return 0;
 
-		if (is_partial_cmd) {
-			/* It is a partial command
-			   save the buffer and wait for the continuation. */
-			self->partial_cmd_buf[queue_id] = buf;
-			return res;
-		}
+	reorder->packs[diff - 1] = pomp_buffer_new_with_data(data, len);
+	if (reorder->packs[diff - 1] == NULL)
+		return -ENOMEM;
+	reorder->count++;
+	return 0;
+}
 
-		data += data_len;
-		arsdk_cmd_init_with_buf(&cmd, buf);
+/**
+ * Releases the packs kept for a queue.
+ */
+static void rx_reorder_clear(struct rx_reorder *reorder)
+{
+	uint32_t i = 0;
 
-		/* Set arsdk_cmd buffer type from transport data type */
-		cmd.buffer_type = data_type_to_buffer_type(data_type, queue_id);
+	for (i = 0; i < ARSDK_CMD_ITF3_RX_REORDER_MAX; i++) {
+		if (reorder->packs[i] != NULL)
+			pomp_buffer_unref(reorder->packs[i]);
+		reorder->packs[i] = NULL;
+	}
+	reorder->count = 0;
+}
 
-		/* Try to decode header of command, Notify reception */
-		res = arsdk_cmd_dec_header(&cmd);
-		if (res < 0) {
-			ARSDK_LOG_ERRNO("arsdk_cmd_dec_header", -res);
-		} else {
-			cmd_log(self, &cmd, ARSDK_CMD_DIR_RX);
-			(*self->itf_cbs.recv_cmd)(self->itf, &cmd,
-					self->itf_cbs.userdata);
-		}
+/**
+ * Moves the packs kept for a queue one slot closer to the next pack
+ * expected.
+ */
+static void rx_reorder_shift(struct rx_reorder *reorder)
+{
+	memmove(&reorder->packs[0], &reorder->packs[1],
+			(ARSDK_CMD_ITF3_RX_REORDER_MAX - 1) *
+			sizeof(reorder->packs[0]));
+	reorder->packs[ARSDK_CMD_ITF3_RX_REORDER_MAX - 1] = NULL;
+}
 
-		/* Cleanup */
-		arsdk_cmd_clear(&cmd);
+/**
+ * Processes the packs kept out of order which follow the last pack
+ * processed, once the missing ones are received.
+ *
+ * @param self : command interface.
+ * @param id : queue identifier.
+ *
+ * @return the number of packs processed.
+ */
+static uint32_t rx_reorder_release(struct arsdk_cmd_itf3 *self, uint8_t id)
+{
+	int res = 0;
+	struct rx_reorder *reorder = self->rx_reorder[id];
+	struct pomp_buffer *buf = NULL;
+	const void *data = NULL;
+	size_t len = 0;
+	uint32_t count = 0;
+
+	if (reorder == NULL || reorder->count == 0)
+		return 0;
+
+	/* The last pack processed moved forward */
+	rx_reorder_shift(reorder);
+
+	while (reorder->packs[0] != NULL) {
+		buf = reorder->packs[0];
+		rx_reorder_shift(reorder);
+		reorder->count--;
+		self->recv_seq[id]++;
+		count++;
+
+		pomp_buffer_get_cdata(buf, &data, &len, NULL);
+		pack_recv_notify(self, self->recv_seq[id],
+				ARSDK_TRANSPORT_DATA_TYPE_WITHACK, id, len,
+				ARSDK_CMD_ITF_PACK_RECV_STATUS_PROCESSED);
+		res = unpack_cmds(self, ARSDK_TRANSPORT_DATA_TYPE_WITHACK, id,
+				data, len);
+		if (res < 0)
+			ARSDK_LOG_ERRNO("unpack_cmds", -res);
 		pomp_buffer_unref(buf);
-		buf = NULL;
+	}
+
+	return count;
+}
+
+/**
+ * Receives a pack with acknowledgement. Packs are processed in order, the
+ * ones received out of order are kept until the missing ones are received.
+ *
+ * @param self : command interface.
+ * @param header : transport header of the pack.
+ * @param data : payload data.
+ * @param len : payload length.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+static int recv_withack_pack(struct arsdk_cmd_itf3 *self,
+		const struct arsdk_transport_header *header,
+		const void *data, size_t len)
+{
+	int res = 0;
+	int process = 0;
+
+	/* Keep the pack received out of order, the peer sends several packs
+	 * without waiting for their acknowledgements */
+	process = check_withack_seq(self, header->id, header->seq);
+	if (process < 0 &&
+	    rx_reorder_hold(self, header->id, header->seq, data, len) == 0) {
+		/* Acknowledge the last pack processed with the ones kept */
+		ack_pack(self, header->id, header->seq, process);
+		pack_recv_notify(self, header->seq, header->type, header->id,
+				len, ARSDK_CMD_ITF_PACK_RECV_STATUS_HELD);
+		return 0;
+	}
+
+	/* Acknowledge the duplicates, the pack too far out of order is
+	 * neither processed nor acknowledged and will be sent again */
+	if (process <= 0) {
+		ack_pack(self, header->id, header->seq, process);
+		pack_recv_notify(self, header->seq, header->type, header->id,
+				len, ARSDK_CMD_ITF_PACK_RECV_STATUS_IGNORED);
+		return 0;
+	}
+
+	/* Notify pack received */
+	pack_recv_notify(self, header->seq, header->type, header->id, len,
+			ARSDK_CMD_ITF_PACK_RECV_STATUS_PROCESSED);
+
+	/* Unpack commands from the payload */
+	res = unpack_cmds(self, header->type, header->id, data, len);
+
+	/* Process the packs it was missing and acknowledge them at once */
+	if (rx_reorder_release(self, header->id) > 0) {
+		ack_pending_clear(self, header->id);
+		send_ack(self, header->id, self->recv_seq[header->id]);
+	} else {
+		ack_pack(self, header->id, header->seq, process);
 	}
 
 	return res;
@@ -1203,6 +2854,11 @@ int arsdk_cmd_itf3_recv_data(struct arsdk_cmd_itf3 *self,
 		const struct arsdk_transport_header *header,
 		const struct arsdk_transport_payload *payload)
 {
+	int process = 0;
+	int rto_ms = 0;
+	uint32_t tx_window = 0;
+	struct queue *queue = NULL;
+
 	ARSDK_RETURN_ERR_IF_FAILED(header != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(payload != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
@@ -1213,19 +2869,26 @@ int arsdk_cmd_itf3_recv_data(struct arsdk_cmd_itf3 *self,
 	/* Update of the reception link quality */
 	lnqlt_rx_update(self, header);
 
-	/* Handle ACK frame and re-check tx queues */
+	/* Handle ACK frame and re-check its tx queue */
 	if (header->type == ARSDK_TRANSPORT_DATA_TYPE_ACK) {
+		rto_ms = self->rtt.rto_ms;
+		tx_window = self->tx_window;
 		recv_ack(self, header, payload);
-		check_tx_queues(self);
+		queue = find_tx_queue_by_id(self,
+				(uint16_t)(header->id - self->ackoff));
+
+		/* A shorter retransmission timeout brings the retries of all
+		   the queues forward, a larger window lets all of them send
+		   more packs */
+		if (self->rtt.rto_ms < rto_ms || self->tx_window != tx_window)
+			check_tx_queues(self);
+		else if (queue != NULL)
+			check_one_tx_queue(self, queue);
 		/* Update last sequence number received */
 		self->recv_seq[header->id] = header->seq;
 		return 0;
 	}
 
-	/* Send ACK if needed */
-	if (header->type == ARSDK_TRANSPORT_DATA_TYPE_WITHACK)
-		send_ack(self, header->id, header->seq);
-
 	size_t len;
 	const void *data = NULL;
 	if (payload->cdata != NULL) {
@@ -1236,8 +2899,13 @@ int arsdk_cmd_itf3_recv_data(struct arsdk_cmd_itf3 *self,
 		pomp_buffer_get_cdata(payload->buf, &data, &len, NULL);
 	}
 
+	if (header->type == ARSDK_TRANSPORT_DATA_TYPE_WITHACK)
+		return recv_withack_pack(self, header, data, len);
+
+	process = should_process_data(self, header->id, header->seq);
+
 	/* If the sequence number was already handled, stop processing here */
-	if (!should_process_data(self, header->id, header->seq)) {
+	if (!process) {
 		/* Notify pack drop */
 		pack_recv_notify(self, header->seq, header->type, header->id,
 				len, ARSDK_CMD_ITF_PACK_RECV_STATUS_IGNORED);
@@ -1265,7 +2933,9 @@ int arsdk_cmd_itf3_new(struct arsdk_transport *transport,
 {
 	int res = 0;
 	uint32_t i = 0;
+	int rto_ms = 0;
 	struct arsdk_cmd_itf3 *self = NULL;
+	size_t pack_max_size = 0;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_obj != NULL, -EINVAL);
 	*ret_obj = NULL;
@@ -1287,6 +2957,7 @@ int arsdk_cmd_itf3_new(struct arsdk_transport *transport,
 	self->itf_cbs = *itf_cbs;
 	self->itf = itf;
 	self->ackoff = ackoff;
+	self->tx_window = 1;
 
 	/* Initialize recv_seq to a non-zero values in order to accept the
 	   first data */
@@ -1299,6 +2970,13 @@ int arsdk_cmd_itf3_new(struct arsdk_transport *transport,
 		goto error;
 	}
 
+	/* Create delayed acknowledgements timer */
+	self->ack.timer = pomp_timer_new(self->loop, &ack_timer_cb, self);
+	if (self->ack.timer == NULL) {
+		res = -ENOMEM;
+		goto error;
+	}
+
 	/* Create link quality timer */
 	self->lnqlt.timer = pomp_timer_new(self->loop,
 			&link_quality_timer_cb, self);
@@ -1314,6 +2992,11 @@ int arsdk_cmd_itf3_new(struct arsdk_transport *transport,
 	if (res < 0)
 		goto error;
 
+	/* Use the pack size negotiated with the peer, if any */
+	pack_max_size = arsdk_transport_get_pack_max_size(transport);
+	if (pack_max_size == 0)
+		pack_max_size = ARSDK_PACK_MAX_SIZE;
+
 	/* Create tx queues */
 	self->tx_queues = calloc(tx_count, sizeof(struct queue *));
 	if (self->tx_queues == NULL) {
@@ -1321,11 +3004,25 @@ int arsdk_cmd_itf3_new(struct arsdk_transport *transport,
 		goto error;
 	}
 	self->tx_count = tx_count;
+	res = arsdk_cmd_itf_sched_init(&self->sched, tx_count, pack_max_size);
+	if (res < 0)
+		goto error;
 	for (i = 0; i < tx_count; i++) {
-		res = queue_new(&tx_info_table[i], &self->tx_queues[i]);
+		res = queue_new(&tx_info_table[i], pack_max_size,
+				&self->tx_queues[i]);
 		if (res < 0)
 			goto error;
+		arsdk_cmd_itf_sched_add(&self->sched, i,
+				&self->tx_queues[i]->sched,
+				&self->tx_queues[i]->info, self->tx_queues[i]);
+
+		/* Retry after the longest timeout until the round trip time
+		   is measured */
+		if (tx_info_table[i].ack_timeout_ms > rto_ms)
+			rto_ms = tx_info_table[i].ack_timeout_ms;
 	}
+	arsdk_cmd_itf_rtt_init(&self->rtt, rto_ms);
+	build_tx_queue_maps(self);
 
 	*ret_obj = self;
 	return 0;
@@ -1363,11 +3060,28 @@ int arsdk_cmd_itf3_destroy(struct arsdk_cmd_itf3 *itf)
 		}
 		free(itf->tx_queues);
 	}
+	arsdk_cmd_itf_sched_clear(&itf->sched);
+
+	/* Free reception buffers */
+	for (i = 0; i < UINT8_MAX + 1; i++) {
+		if (itf->partial_cmd_buf[i] != NULL)
+			pomp_buffer_unref(itf->partial_cmd_buf[i]);
+		if (itf->rx_reorder[i] != NULL) {
+			rx_reorder_clear(itf->rx_reorder[i]);
+			free(itf->rx_reorder[i]);
+		}
+	}
+	if (itf->cmd_buf != NULL)
+		pomp_buffer_unref(itf->cmd_buf);
 
 	/* Free timer */
 	if (itf->timer != NULL)
 		pomp_timer_destroy(itf->timer);
 
+	/* Free delayed acknowledgements timer */
+	if (itf->ack.timer != NULL)
+		pomp_timer_destroy(itf->ack.timer);
+
 	/* Stop link quality timer */
 	res = pomp_timer_clear(itf->lnqlt.timer);
 	if (res < 0)
@@ -41,13 +41,18 @@ struct arsdk_cmd_queue_info {
 	/**
 	 * Time to wait after retry to send an acknowledged command;
 	 * in millisecond.
+	 * Only used until the round trip time is measured, the longest
+	 * timeout of the queues is then replaced by the estimated
+	 * retransmission timeout.
 	 * Not used if 'type' is not 'ARSDK_TRANSPORT_DATA_TYPE_WITHACK'.
 	 */
 	int                             ack_timeout_ms;
 	/**
 	 * Different of '0' to allow to overwrite old pending commands
 	 * in the queue.
-	 * Not used since the version 2; overwriting not more allowed.
+	 * Not used since the version 2; replaced by the coalescing of the
+	 * commands enabled one by one, see
+	 * 'arsdk_cmd_itf_set_cmd_coalescing'.
 	 */
 	int                             overwrite;
 	/**
@@ -56,6 +61,573 @@ struct arsdk_cmd_queue_info {
 	 * Not used since the version 2; forced in infinite retry.
 	 */
 	int32_t                         default_max_retry_count;
+	/**
+	 * Time to wait for more commands before sending a pack not full;
+	 * in millisecond.
+	 * '0' to send soon as possible.
+	 * Only used by the non-acknowledged queues since the version 2.
+	 */
+	int                             pack_delay_ms;
+	/**
+	 * Default time to live of the commands; in millisecond.
+	 * '0' for no limit.
+	 * Not used by the version 1.
+	 */
+	uint32_t                        ttl_ms;
+};
+
+/** Count of command buffer types, including the invalid one. */
+#define ARSDK_CMD_BUFFER_TYPE_COUNT (ARSDK_CMD_BUFFER_TYPE_LOW_PRIO + 1)
+
+/**
+ * Checks whether a transmission queue sends a command buffer type.
+ *
+ * @param info : queue information.
+ * @param buffer_type : command buffer type.
+ *
+ * @return '1' if the queue sends the buffer type, '0' otherwise.
+ */
+int arsdk_cmd_itf_queue_match_type(const struct arsdk_cmd_queue_info *info,
+		enum arsdk_cmd_buffer_type buffer_type);
+
+/** Minimum retransmission timeout of acknowledged data; in millisecond. */
+#define ARSDK_CMD_ITF_RTO_MIN_MS 30
+/** Maximum retransmission timeout of acknowledged data; in millisecond. */
+#define ARSDK_CMD_ITF_RTO_MAX_MS 1000
+
+/**
+ * Round trip time estimation of acknowledged data, computing the
+ * retransmission timeout as described by the RFC 6298.
+ */
+struct arsdk_cmd_itf_rtt {
+	/** Smoothed round trip time in microsecond; '0' before any sample. */
+	uint64_t                        srtt_us;
+	/** Round trip time variation in microsecond. */
+	uint64_t                        rttvar_us;
+	/** Retransmission timeout in millisecond. */
+	int                             rto_ms;
+};
+
+/**
+ * Initializes a round trip time estimation.
+ *
+ * @param rtt : round trip time estimation.
+ * @param rto_ms : retransmission timeout to use until the first sample.
+ */
+ARSDK_API void arsdk_cmd_itf_rtt_init(struct arsdk_cmd_itf_rtt *rtt,
+		int rto_ms);
+
+/**
+ * Updates a round trip time estimation with a new sample.
+ * According to the Karn's algorithm, data sent several times must not be
+ * sampled.
+ *
+ * @param rtt : round trip time estimation.
+ * @param sent_ts : sending time of the acknowledged data.
+ * @param ack_ts : reception time of the acknowledgement.
+ */
+ARSDK_API void arsdk_cmd_itf_rtt_sample(struct arsdk_cmd_itf_rtt *rtt,
+		const struct timespec *sent_ts,
+		const struct timespec *ack_ts);
+
+/**
+ * Restores the retransmission timeout from the current estimation after the
+ * acknowledgement of data sent several times, ending its backoff.
+ *
+ * @param rtt : round trip time estimation.
+ */
+ARSDK_API void arsdk_cmd_itf_rtt_ack(struct arsdk_cmd_itf_rtt *rtt);
+
+/**
+ * Doubles the retransmission timeout after a retransmission.
+ *
+ * @param rtt : round trip time estimation.
+ */
+ARSDK_API void arsdk_cmd_itf_rtt_backoff(struct arsdk_cmd_itf_rtt *rtt);
+
+/** Initial congestion window; in packs of the largest size. */
+#define ARSDK_CMD_ITF_CC_INIT_PACKS 4
+/** Minimum congestion window; in packs of the largest size. */
+#define ARSDK_CMD_ITF_CC_MIN_PACKS 1
+/** Maximum congestion window; in packs of the largest size. */
+#define ARSDK_CMD_ITF_CC_MAX_PACKS 64
+
+/**
+ * Congestion control of the acknowledged queues of an interface, limiting
+ * the bytes in flight with an additive increase, multiplicative decrease
+ * window.
+ */
+struct arsdk_cmd_itf_cc {
+	/** '1' if the window limits the packs sent, '0' otherwise. */
+	int                             enabled;
+	/** Largest pack size of the acknowledged queues; in bytes. */
+	size_t                          pack_size;
+	/** Congestion window; in bytes. */
+	size_t                          window;
+	/**
+	 * Bytes of the packs sent and not yet acknowledged, counted even
+	 * when disabled.
+	 */
+	size_t                          inflight;
+	/** Time of the last decrease of the window. */
+	struct timespec                 decrease_ts;
+};
+
+/**
+ * Enables or disables a congestion control, restarting from its initial
+ * window.
+ *
+ * @param cc : congestion control.
+ * @param enable : '1' to limit the packs sent, '0' otherwise.
+ * @param pack_size : largest pack size of the acknowledged queues.
+ */
+void arsdk_cmd_itf_cc_enable(struct arsdk_cmd_itf_cc *cc, int enable,
+		size_t pack_size);
+
+/**
+ * Checks if a new pack can be sent. One pack is always let in flight.
+ *
+ * @param cc : congestion control.
+ * @param len : length of the pack.
+ *
+ * @return '1' if the pack can be sent, '0' if it has to wait for
+ * acknowledgements.
+ */
+int arsdk_cmd_itf_cc_can_send(const struct arsdk_cmd_itf_cc *cc, size_t len);
+
+/**
+ * Counts a pack sent for the first time in flight.
+ *
+ * @param cc : congestion control.
+ * @param len : length of the pack.
+ */
+void arsdk_cmd_itf_cc_sent(struct arsdk_cmd_itf_cc *cc, size_t len);
+
+/**
+ * Removes an acknowledged pack from the flight and increases the window by
+ * one pack per window acknowledged.
+ *
+ * @param cc : congestion control.
+ * @param len : length of the pack.
+ */
+void arsdk_cmd_itf_cc_acked(struct arsdk_cmd_itf_cc *cc, size_t len);
+
+/**
+ * Halves the window on a retry, at most once per retransmission timeout
+ * since the retries of the packs of a same window report the same
+ * congestion.
+ *
+ * @param cc : congestion control.
+ * @param rtt : round trip time estimation.
+ * @param tsnow : current time.
+ */
+void arsdk_cmd_itf_cc_loss(struct arsdk_cmd_itf_cc *cc,
+		const struct arsdk_cmd_itf_rtt *rtt,
+		const struct timespec *tsnow);
+
+/**
+ * Forgets the packs in flight, once canceled.
+ *
+ * @param cc : congestion control.
+ */
+void arsdk_cmd_itf_cc_stop(struct arsdk_cmd_itf_cc *cc);
+
+/**
+ * Fills the congestion control statistics of an acknowledged queue.
+ *
+ * @param cc : congestion control.
+ * @param rtt : round trip time estimation.
+ * @param stats : queue statistics.
+ */
+void arsdk_cmd_itf_cc_stats(const struct arsdk_cmd_itf_cc *cc,
+		const struct arsdk_cmd_itf_rtt *rtt,
+		struct arsdk_cmd_itf_queue_stats *stats);
+
+/** Coalesced command of a non-acknowledged queue. */
+struct arsdk_cmd_itf_coalesce_slot {
+	/** Full identifier of the command. */
+	uint32_t                        id;
+	/**
+	 * Position of the last instance of the command queued, counted
+	 * from the creation of the queue.
+	 */
+	uint32_t                        pos;
+	/** '1' if the slot is used ; otherwise '0'. */
+	int                             used;
+};
+
+/**
+ * Map of the commands coalesced by a non-acknowledged queue, keeping only
+ * their newest pending instance.
+ * Open addressing hash table indexed by the full command identifier.
+ */
+struct arsdk_cmd_itf_coalesce {
+	/** Slots of the table. */
+	struct arsdk_cmd_itf_coalesce_slot  *slots;
+	/** Number of slots, power of two. */
+	uint32_t                            capacity;
+	/** Number of slots used. */
+	uint32_t                            count;
+};
+
+/**
+ * Enables or disables the coalescing of a command.
+ *
+ * @param coalesce : coalesced commands map.
+ * @param id : full identifier of the command.
+ * @param enable : '1' to coalesce the command, '0' otherwise.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf_coalesce_set(struct arsdk_cmd_itf_coalesce *coalesce,
+		uint32_t id, int enable);
+
+/**
+ * Finds the slot of a coalesced command.
+ *
+ * @param coalesce : coalesced commands map.
+ * @param id : full identifier of the command.
+ *
+ * @return the slot of the command, NULL if it is not coalesced.
+ */
+struct arsdk_cmd_itf_coalesce_slot *arsdk_cmd_itf_coalesce_find(
+		const struct arsdk_cmd_itf_coalesce *coalesce, uint32_t id);
+
+/**
+ * Clears a coalesced commands map, releasing its slots.
+ *
+ * @param coalesce : coalesced commands map.
+ */
+void arsdk_cmd_itf_coalesce_clear(struct arsdk_cmd_itf_coalesce *coalesce);
+
+/** Initial depth of a transmission queue, doubled each time it is full. */
+#define ARSDK_CMD_ITF_QUEUE_MIN_DEPTH 16
+
+/** Bounds of a transmission queue. */
+struct arsdk_cmd_itf_queue_bound {
+	/**
+	 * Maximum number of pending commands, a new command is then refused;
+	 * '0' for an unbounded queue.
+	 */
+	uint32_t                        high;
+	/**
+	 * Number of pending commands under which a queue which refused
+	 * a command is notified as drained.
+	 */
+	uint32_t                        low;
+	/** Buffer type given to set the bounds. */
+	enum arsdk_cmd_buffer_type      type;
+	/** '1' if a command was refused since the last drain. */
+	int                             blocked;
+};
+
+/**
+ * Sets the bounds of a transmission queue.
+ *
+ * @param bound : queue bounds.
+ * @param type : buffer type of the queue.
+ * @param high : maximum number of pending commands; '0' for unbounded.
+ * @param low : number of pending commands under which the queue is drained,
+ *              lower than 'high'.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf_queue_bound_set(struct arsdk_cmd_itf_queue_bound *bound,
+		enum arsdk_cmd_buffer_type type, uint32_t high, uint32_t low);
+
+/**
+ * Checks whether a command can be added to a transmission queue.
+ *
+ * @param bound : queue bounds.
+ * @param count : number of pending commands of the queue.
+ *
+ * @return 0 if the command can be added, -EAGAIN if the queue is full.
+ */
+int arsdk_cmd_itf_queue_bound_check(struct arsdk_cmd_itf_queue_bound *bound,
+		uint32_t count);
+
+/**
+ * Checks whether a transmission queue which refused a command is drained.
+ *
+ * @param bound : queue bounds.
+ * @param count : number of pending commands of the queue.
+ *
+ * @return 1 if the queue is drained and must be notified, 0 otherwise.
+ */
+int arsdk_cmd_itf_queue_bound_drained(struct arsdk_cmd_itf_queue_bound *bound,
+		uint32_t count);
+
+/**
+ * Computes the new depth of a full transmission queue.
+ *
+ * @param bound : queue bounds.
+ * @param depth : current depth of the queue.
+ *
+ * @return the new depth of the queue.
+ */
+uint32_t arsdk_cmd_itf_queue_bound_grow(
+		const struct arsdk_cmd_itf_queue_bound *bound, uint32_t depth);
+
+/**
+ * Checks whether a pack not full must still wait for more commands.
+ *
+ * @param delay_ms : time to wait for more commands; in millisecond.
+ * @param queued_ts : queuing time of the oldest command to pack.
+ * @param tsnow : current time.
+ * @param next_timeout_ms : next time of check to update if the pack must
+ * wait; in millisecond.
+ *
+ * @return '1' if the pack must wait, '0' if it can be sent.
+ */
+int arsdk_cmd_itf_pack_delay_wait(int delay_ms,
+		const struct timespec *queued_ts,
+		const struct timespec *tsnow,
+		int *next_timeout_ms);
+
+/**
+ * Copies the data of a command in a buffer reused from one command to the
+ * other, to notify it without allocation. A new buffer is used if a
+ * reference on the previous one was kept.
+ *
+ * @param buf : reused buffer, NULL before the first command.
+ * @param data : command data.
+ * @param len : command length.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf_cmd_buf_set(struct pomp_buffer **buf,
+		const void *data, size_t len);
+
+/**
+ * Checks whether the time to live of a queued command is passed.
+ *
+ * @param ttl_ms : time to live of the command; in millisecond, '0' for no
+ * limit.
+ * @param queued_ts : queuing time of the command.
+ * @param tsnow : current time.
+ *
+ * @return '1' if the command expired, '0' otherwise.
+ */
+int arsdk_cmd_itf_cmd_expired(uint32_t ttl_ms,
+		const struct timespec *queued_ts,
+		const struct timespec *tsnow);
+
+/**
+ * Updates the retry timer shared by the transmission queues.
+ *
+ * When a single queue was checked, the timer is only brought forward; the
+ * other queues may still need it. Firing too early is harmless as all the
+ * queues are then checked.
+ *
+ * @param timer : retry timer.
+ * @param expire_us : expiration time of the timer to update; in
+ * microsecond, '0' if it is not armed.
+ * @param tsnow : current time.
+ * @param next_timeout_ms : next time of check of the queues checked; in
+ * millisecond, negative or null for none.
+ * @param all : '1' if all the queues were checked, '0' otherwise.
+ */
+ARSDK_API void arsdk_cmd_itf_timer_update(struct pomp_timer *timer,
+		uint64_t *expire_us,
+		const struct timespec *tsnow,
+		int next_timeout_ms,
+		int all);
+
+/** Scheduling state of a transmission queue. */
+struct arsdk_cmd_itf_sched_queue {
+	/** Scheduling parameters. */
+	struct arsdk_cmd_itf_queue_sched params;
+	/** Queue scheduled, given to the check callback. */
+	void                            *queue;
+	/**
+	 * Bytes the queue can still send in the current round of its level;
+	 * only used with a budget of the interface.
+	 */
+	int64_t                         deficit;
+	/** Bytes sent by the queue in the current tick. */
+	int64_t                         tick_sent;
+	/**
+	 * Bytes the queue can still send in the current check, 'INT64_MAX'
+	 * without any budget.
+	 */
+	int64_t                         allowance;
+	/** '1' if the queue stopped sending on its allowance. */
+	int                             blocked;
+};
+
+/** Scheduler of the transmission queues of an interface. */
+struct arsdk_cmd_itf_sched {
+	/** Queues ordered by priority level. */
+	struct arsdk_cmd_itf_sched_queue **order;
+	/** Size of 'order'. */
+	uint32_t                        count;
+	/** Round robin quantum of a queue of weight 1; in bytes. */
+	size_t                          quantum;
+	/** Bytes sent by all the queues per tick; '0' for no limit. */
+	uint32_t                        budget;
+	/** Bytes sent by all the queues in the current tick. */
+	int64_t                         tick_sent;
+	/** Start time of the current tick. */
+	struct timespec                 tick_ts;
+	/** '1' if a budget is set, the queues are then scheduled. */
+	int                             limited;
+};
+
+/**
+ * Checks a queue for the scheduler.
+ *
+ * @param queue : queue to check.
+ * @param tsnow : current time.
+ * @param next_timeout_ms : next time of check to update; in millisecond.
+ * @param userdata : user data.
+ */
+typedef void (*arsdk_cmd_itf_sched_check_t)(void *queue,
+		const struct timespec *tsnow,
+		int *next_timeout_ms,
+		void *userdata);
+
+/**
+ * Initializes a scheduler.
+ *
+ * @param sched : scheduler.
+ * @param count : number of queues to schedule.
+ * @param quantum : round robin quantum of a queue of weight 1; in bytes.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf_sched_init(struct arsdk_cmd_itf_sched *sched,
+		uint32_t count, size_t quantum);
+
+/**
+ * Clears a scheduler.
+ *
+ * @param sched : scheduler.
+ */
+void arsdk_cmd_itf_sched_clear(struct arsdk_cmd_itf_sched *sched);
+
+/**
+ * Adds a queue to a scheduler, with its default parameters.
+ *
+ * @param sched : scheduler.
+ * @param idx : index of the queue.
+ * @param sq : scheduling state of the queue to initialize.
+ * @param info : queue information.
+ * @param queue : queue given to the check callback.
+ */
+void arsdk_cmd_itf_sched_add(struct arsdk_cmd_itf_sched *sched,
+		uint32_t idx,
+		struct arsdk_cmd_itf_sched_queue *sq,
+		const struct arsdk_cmd_queue_info *info,
+		void *queue);
+
+/**
+ * Sets the scheduling parameters of a queue.
+ *
+ * @param sched : scheduler.
+ * @param sq : scheduling state of the queue.
+ * @param params : scheduling parameters.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf_sched_set_queue(struct arsdk_cmd_itf_sched *sched,
+		struct arsdk_cmd_itf_sched_queue *sq,
+		const struct arsdk_cmd_itf_queue_sched *params);
+
+/**
+ * Sets the budget of all the queues of a scheduler.
+ *
+ * @param sched : scheduler.
+ * @param budget : bytes sent per tick; '0' for no limit.
+ */
+void arsdk_cmd_itf_sched_set_budget(struct arsdk_cmd_itf_sched *sched,
+		uint32_t budget);
+
+/**
+ * Checks all the queues of a scheduler, by priority level.
+ *
+ * @param sched : scheduler.
+ * @param tsnow : current time.
+ * @param next_timeout_ms : next time of check to update; in millisecond.
+ * @param check : queue check callback.
+ * @param userdata : user data of the callback.
+ */
+void arsdk_cmd_itf_sched_run(struct arsdk_cmd_itf_sched *sched,
+		const struct timespec *tsnow,
+		int *next_timeout_ms,
+		arsdk_cmd_itf_sched_check_t check,
+		void *userdata);
+
+/**
+ * Checks whether a queue can send a pack in the current check.
+ *
+ * @param sq : scheduling state of the queue.
+ *
+ * @return '1' if the queue can send, '0' if it must wait for its turn.
+ */
+int arsdk_cmd_itf_sched_can_send(struct arsdk_cmd_itf_sched_queue *sq);
+
+/**
+ * Counts a pack sent by a queue in its budgets.
+ *
+ * @param sched : scheduler.
+ * @param sq : scheduling state of the queue.
+ * @param len : length of the pack; in bytes.
+ */
+void arsdk_cmd_itf_sched_sent(struct arsdk_cmd_itf_sched *sched,
+		struct arsdk_cmd_itf_sched_queue *sq,
+		size_t len);
+
+/**
+ * Adds a duration to a histogram.
+ *
+ * @param histo : histogram to update.
+ * @param start : start time of the duration.
+ * @param end : end time of the duration.
+ */
+void arsdk_cmd_itf_histo_add(struct arsdk_cmd_itf_histo *histo,
+		const struct timespec *start,
+		const struct timespec *end);
+
+/**
+ * Initializes the statistics of a transmission queue.
+ *
+ * @param stats : queue statistics.
+ * @param info : queue information.
+ */
+void arsdk_cmd_itf_queue_stats_init(struct arsdk_cmd_itf_queue_stats *stats,
+		const struct arsdk_cmd_queue_info *info);
+
+/** Command sent periodically by an interface. */
+struct arsdk_cmd_itf_periodic_cmd {
+	/** Full identifier of the command. */
+	uint32_t                            id;
+	/** Description of the command; NULL once removed. */
+	const struct arsdk_cmd_desc         *desc;
+	/** Period; in millisecond. */
+	uint32_t                            period_ms;
+	/** Next time the command is due; in microsecond. */
+	uint64_t                            due_us;
+	/** Function called to encode the command. */
+	arsdk_cmd_itf_periodic_fill_cb_t    fill;
+	/** User data given to the fill function. */
+	void                                *userdata;
+};
+
+/** Commands sent periodically by an interface, on a single timer. */
+struct arsdk_cmd_itf_periodic {
+	/** Timer armed for the next command due. */
+	struct pomp_timer                   *timer;
+	/** Periodic commands. */
+	struct arsdk_cmd_itf_periodic_cmd   *cmds;
+	/** Number of periodic commands, including the removed ones. */
+	uint32_t                            count;
+	/** Capacity of 'cmds'. */
+	uint32_t                            capacity;
+	/**
+	 * '1' while the commands due are filled; the removed commands are
+	 * then released at the end.
+	 */
+	int                                 running;
 };
 
 /** Command interface internal callbacks. */
@@ -73,6 +73,12 @@ struct arsdk_peer_conn {
 	uint32_t                               proto_v_max;
 	/** protocol version used */
 	uint32_t                               proto_v;
+	/** maximum command pack size supported, 0 for the default one */
+	uint32_t                               pack_max_size_supported;
+	/** maximum command pack size used, 0 for the default one */
+	uint32_t                               pack_max_size;
+	/** '1' to bound the pack size by the path MTU */
+	int                                    pmtu_probe;
 };
 
 /** */
@@ -93,6 +99,11 @@ struct arsdk_backend_net {
 	int                                    qos_mode_supported;
 	int                                    stream_supported;
 
+	/** maximum command pack size supported, 0 for the default one */
+	uint32_t                               pack_max_size;
+	/** '1' to bound the pack size by the path MTU */
+	int                                    pmtu_probe;
+
 	struct {
 		struct pomp_ctx                     *ctx;
 		struct arsdk_backend_listen_cbs     cbs;
@@ -114,6 +125,8 @@ struct arsdk_req {
 	uint32_t  proto_v_min;
 	/** maximum protocol version supported */
 	uint32_t  proto_v_max;
+	/** maximum command pack size supported, 0 for the default one */
+	uint32_t  pack_max_size;
 };
 
 static void arsdk_backend_net_socket_cb(struct arsdk_backend *base, int fd,
@@ -213,6 +226,32 @@ static int parse_qos_mode(json_object *object)
 	return qos_mode;
 }
 
+/**
+ */
+static uint32_t parse_pack_max_size(json_object *object)
+{
+	int pack_max_size = 0;
+	json_object *jobj = NULL;
+
+	if (!object)
+		return 0;
+
+	/* Default pack size if not present */
+	jobj = get_json_object(object, ARSDK_CONN_JSON_KEY_PACK_MAX_SIZE);
+	if (jobj != NULL)
+		pack_max_size = json_object_get_int(jobj);
+
+	/* Default pack size if invalid value */
+	if (pack_max_size != 0 &&
+	    (pack_max_size < ARSDK_BACKEND_NET_PACK_SIZE_MIN ||
+	     pack_max_size > ARSDK_BACKEND_NET_PACK_SIZE_MAX)) {
+		ARSDK_LOGW("Invalid pack max size: %d", pack_max_size);
+		pack_max_size = 0;
+	}
+
+	return (uint32_t)pack_max_size;
+}
+
 /**
  */
 static int peer_conn_req_parse(
@@ -285,6 +324,10 @@ static int peer_conn_req_parse(
 	 * by default only the protocol version 1 is considered as supported */
 	parse_proto_versions(jroot, &req->proto_v_min, &req->proto_v_max);
 
+	/* Parse supported pack size:
+	 * if not present the default one of the protocol is used */
+	req->pack_max_size = parse_pack_max_size(jroot);
+
 	/* Success */
 	json_object_put(jroot);
 	return 0;
@@ -320,6 +363,8 @@ static int peer_conn_setup_transport(struct arsdk_peer_conn *self,
 	cfg.data.rx_port = ARSDK_NET_DEFAULT_C2D_DATA_PORT;
 	cfg.stream_supported = backend_net->stream_supported;
 	cfg.proto_v = self->proto_v;
+	cfg.pack_max_size = self->pack_max_size;
+	cfg.pmtu_probe = self->pmtu_probe;
 
 	/* Create transport */
 	memset(&transport_net_cbs, 0, sizeof(transport_net_cbs));
@@ -384,6 +429,13 @@ static int peer_conn_send_json(struct arsdk_peer_conn *self,
 	json_object_object_add(jroot, ARSDK_CONN_JSON_KEY_PROTO_V,
 			json_object_new_int(self->proto_v));
 
+	/* Add pack size to use, if not the default one */
+	if (self->pack_max_size != 0) {
+		json_object_object_add(jroot,
+				ARSDK_CONN_JSON_KEY_PACK_MAX_SIZE,
+				json_object_new_int(self->pack_max_size));
+	}
+
 	/* Get updated json */
 	newjson = json_object_to_json_string(jroot);
 	if (newjson == NULL) {
@@ -450,6 +502,8 @@ static int peer_conn_new(struct arsdk_backend_net *backend,
 		uint32_t proto_v_max,
 		int qos_mode_supported,
 		int stream_supported,
+		uint32_t pack_max_size,
+		int pmtu_probe,
 		struct arsdk_peer_conn **ret_conn)
 {
 	struct arsdk_peer_conn *self = NULL;
@@ -470,6 +524,8 @@ static int peer_conn_new(struct arsdk_backend_net *backend,
 	self->proto_v_max = proto_v_max;
 	self->qos_mode_supported = qos_mode_supported;
 	self->stream_supported = stream_supported;
+	self->pack_max_size_supported = pack_max_size;
+	self->pmtu_probe = pmtu_probe;
 	*ret_conn = self;
 	return 0;
 }
@@ -515,6 +571,8 @@ static void backend_net_event_cb(struct pomp_ctx *ctx,
 				self->proto_v_min, self->proto_v_max,
 				self->qos_mode_supported,
 				self->stream_supported,
+				self->pack_max_size,
+				self->pmtu_probe,
 				&self->listen.conn) < 0) {
 			pomp_conn_disconnect(conn);
 		}
@@ -616,6 +674,16 @@ static void backend_net_raw_cb(struct pomp_ctx *ctx,
 		self->listen.conn->qos_mode = req.qos_mode;
 	}
 
+	/* choose the real pack size according to the pack sizes supported by
+	 * the peer and the backend, the default one if not supported by both */
+	if (req.pack_max_size != 0 &&
+	    self->listen.conn->pack_max_size_supported != 0) {
+		self->listen.conn->pack_max_size = MIN(req.pack_max_size,
+				self->listen.conn->pack_max_size_supported);
+	} else {
+		self->listen.conn->pack_max_size = 0;
+	}
+
 	/* Create peer */
 	self->listen.conn->d2c_data_port = req.d2c_data_port;
 	self->listen.conn->d2c_rtp_port = req.d2c_rtp_port;
@@ -921,6 +989,10 @@ int arsdk_backend_net_new(struct arsdk_mngr *mngr,
 			(cfg->proto_v_max == 0 &&
 			 cfg->proto_v_min <= ARSDK_BACKEND_NET_PROTO_MAX),
 			-EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cfg->pack_max_size == 0 ||
+			(cfg->pack_max_size >= ARSDK_BACKEND_NET_PACK_SIZE_MIN &&
+			 cfg->pack_max_size <= ARSDK_BACKEND_NET_PACK_SIZE_MAX),
+			-EINVAL);
 
 	/* Allocate structure */
 	self = calloc(1, sizeof(*self));
@@ -945,6 +1017,8 @@ int arsdk_backend_net_new(struct arsdk_mngr *mngr,
 			ARSDK_BACKEND_NET_PROTO_MIN;
 	self->proto_v_max = cfg->proto_v_max != 0 ? self->proto_v_max :
 			ARSDK_BACKEND_NET_PROTO_MAX;
+	self->pack_max_size = cfg->pack_max_size;
+	self->pmtu_probe = cfg->pmtu_probe;
 
 	/* Success */
 	*ret_obj = self;
@@ -81,6 +81,12 @@
 #define ARSDK_CONN_JSON_KEY_PROTO_V_MAX            "proto_v_max"
 /** json key used by the device to indicate the chosen protocol version. */
 #define ARSDK_CONN_JSON_KEY_PROTO_V                "proto_v"
+/**
+ * json key used by the controller to indicate the maximum size of command
+ * packs it supports, and by the device to indicate the chosen one.
+ * If absent the default size of the protocol version is used.
+ */
+#define ARSDK_CONN_JSON_KEY_PACK_MAX_SIZE          "pack_max_size"
 
 #ifdef _WIN32
 
@@ -31,6 +31,10 @@
 #define ARSDK_FRAME_V1_HEADER_SIZE      7
 #define ARSDK_FRAME_V2_HEADER_SIZE_MIN  6
 #define ARSDK_FRAME_V2_HEADER_SIZE_MAX  14
+#define ARSDK_IP_HEADER_SIZE            20
+#define ARSDK_UDP_HEADER_SIZE           8
+/** Minimum datagram size every IPv4 host must accept (RFC 791) */
+#define ARSDK_IP_MTU_MIN                576
 #define ARSDK_TRANSPORT_PING_PERIOD     2000
 #define ARSDK_TRANSPORT_TAG             "net"
 
@@ -185,6 +189,15 @@ retry_bind:
 		sock->rxbufsize /= 2;
 #endif /* !_WIN32 */
 
+		/* A datagram holds one frame of at most the negotiated pack
+		 * size, the rx buffer does not need to be larger */
+		if (self->cfg.pack_max_size != 0 &&
+		    self->cfg.pack_max_size + ARSDK_FRAME_V2_HEADER_SIZE_MAX <
+				sock->rxbufsize) {
+			sock->rxbufsize = self->cfg.pack_max_size +
+					ARSDK_FRAME_V2_HEADER_SIZE_MAX;
+		}
+
 		/* Allocate rx buffer */
 		sock->rxbuf = malloc(sock->rxbufsize);
 		if (sock->rxbuf == NULL) {
@@ -892,6 +905,85 @@ static uint32_t arsdk_transport_net_get_proto_v(struct arsdk_transport *base)
 	return self->cfg.proto_v;
 }
 
+/**
+ * Retrieves the path MTU towards the peer known by the kernel.
+ *
+ * A temporary socket is connected to the peer address, the data socket being
+ * unconnected.
+ *
+ * @param self : Net transport.
+ * @param ret_mtu : Will receive the path MTU.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+static int pmtu_probe(struct arsdk_transport_net *self, uint32_t *ret_mtu)
+{
+#ifdef IP_MTU
+	int res = 0;
+	int fd = -1;
+	int mtu = 0;
+	socklen_t optlen = sizeof(mtu);
+	struct sockaddr_in addr;
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("socket", errno);
+		return res;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = self->cfg.tx_addr;
+	addr.sin_port = htons(self->cfg.data.tx_port);
+	if (connect(fd, (const struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		res = -errno;
+		ARSDK_LOG_FD_ERRNO("connect", fd, errno);
+		goto out;
+	}
+
+	if (getsockopt(fd, IPPROTO_IP, IP_MTU, &mtu, &optlen) < 0) {
+		res = -errno;
+		ARSDK_LOG_FD_ERRNO("getsockopt.IP_MTU", fd, errno);
+		goto out;
+	}
+
+	*ret_mtu = (uint32_t)mtu;
+
+out:
+	close(fd);
+	return res;
+#else /* !IP_MTU */
+	return -ENOSYS;
+#endif /* !IP_MTU */
+}
+
+static uint32_t arsdk_transport_net_get_pack_max_size(
+		struct arsdk_transport *base)
+{
+	int res = 0;
+	uint32_t mtu = 0;
+	uint32_t overhead = ARSDK_IP_HEADER_SIZE + ARSDK_UDP_HEADER_SIZE +
+			ARSDK_FRAME_V2_HEADER_SIZE_MAX;
+	struct arsdk_transport_net *self = arsdk_transport_get_child(base);
+	ARSDK_RETURN_VAL_IF_FAILED(self != NULL, -EINVAL, 0);
+
+	if (self->cfg.pack_max_size == 0 || !self->cfg.pmtu_probe)
+		return self->cfg.pack_max_size;
+
+	/* Keep the negotiated size if the path MTU is unknown */
+	res = pmtu_probe(self, &mtu);
+	if (res < 0 || mtu < ARSDK_IP_MTU_MIN)
+		return self->cfg.pack_max_size;
+
+	if (mtu - overhead < self->cfg.pack_max_size) {
+		ARSDK_LOGI("pack max size reduced from %u to %u (path mtu %u)",
+				self->cfg.pack_max_size, mtu - overhead, mtu);
+		return mtu - overhead;
+	}
+	return self->cfg.pack_max_size;
+}
+
 /** */
 static const struct arsdk_transport_ops s_arsdk_transport_net_ops = {
 	.dispose = &arsdk_transport_net_dispose,
@@ -899,6 +991,7 @@ static const struct arsdk_transport_ops s_arsdk_transport_net_ops = {
 	.stop = &arsdk_transport_net_stop,
 	.send_data = &arsdk_transport_net_send_data,
 	.get_proto_v = &arsdk_transport_net_get_proto_v,
+	.get_pack_max_size = &arsdk_transport_net_get_pack_max_size,
 };
 
 /**
@@ -37,6 +37,10 @@ struct arsdk_transport_net_cfg {
 	in_addr_t  tx_addr;
 	int        qos_mode;
 	int        stream_supported;
+	/** maximum size of command packs, 0 for the protocol default */
+	uint32_t   pack_max_size;
+	/** bound 'pack_max_size' by the path MTU towards 'tx_addr' */
+	int        pmtu_probe;
 
 	struct {
 		uint16_t rx_port;
@@ -31,6 +31,10 @@
 #define ARSDKCTRL_BACKEND_NET_PROTO_MIN ARSDK_PROTOCOL_VERSION_1
 /** maximum protocol version implemented */
 #define ARSDKCTRL_BACKEND_NET_PROTO_MAX ARSDK_PROTOCOL_VERSION_3
+/** minimum command pack size supported */
+#define ARSDKCTRL_BACKEND_NET_PACK_SIZE_MIN 512
+/** maximum command pack size supported */
+#define ARSDKCTRL_BACKEND_NET_PACK_SIZE_MAX 60000
 
 /** */
 struct arsdkctrl_backend_net;
@@ -63,6 +67,19 @@ struct arsdkctrl_backend_net_cfg {
 	 * '0' is considered as 'ARSDKCTRL_BACKEND_NET_PROTO_MAX'.
 	 */
 	uint32_t          proto_v_max;
+	/**
+	 * Maximum size of the command packs supported.
+	 * The smallest of the sizes of the device and of the backend is used.
+	 * Must be '0' or in range ['ARSDKCTRL_BACKEND_NET_PACK_SIZE_MIN';
+	 * 'ARSDKCTRL_BACKEND_NET_PACK_SIZE_MAX'].
+	 * '0' keeps the default size of the protocol version.
+	 */
+	uint32_t          pack_max_size;
+	/**
+	 * Set to 1 to bound the pack size negotiated by the path MTU towards
+	 * the device, if known by the system.
+	 */
+	int               pmtu_probe;
 };
 
 /**
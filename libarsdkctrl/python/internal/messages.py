@@ -38,6 +38,23 @@ CTYPES_ARG_CONVERSION = {
     libarsdk.ARSDK_ARG_TYPE_BINARY: ctypes.POINTER(libarsdk.struct_arsdk_binary),
 }
 
+# Element type of the columns filled by arsdk_cmd_dec_batch
+CTYPES_COLUMN_CONVERSION = {
+    libarsdk.ARSDK_ARG_TYPE_I8: ctypes.c_int8,
+    libarsdk.ARSDK_ARG_TYPE_U8: ctypes.c_uint8,
+    libarsdk.ARSDK_ARG_TYPE_I16: ctypes.c_int16,
+    libarsdk.ARSDK_ARG_TYPE_U16: ctypes.c_uint16,
+    libarsdk.ARSDK_ARG_TYPE_I32: ctypes.c_int32,
+    libarsdk.ARSDK_ARG_TYPE_U32: ctypes.c_uint32,
+    libarsdk.ARSDK_ARG_TYPE_I64: ctypes.c_int64,
+    libarsdk.ARSDK_ARG_TYPE_U64: ctypes.c_uint64,
+    libarsdk.ARSDK_ARG_TYPE_FLOAT: ctypes.c_float,
+    libarsdk.ARSDK_ARG_TYPE_DOUBLE: ctypes.c_double,
+    libarsdk.ARSDK_ARG_TYPE_STRING: ctypes.c_char_p,
+    libarsdk.ARSDK_ARG_TYPE_ENUM: ctypes.c_int32,
+    libarsdk.ARSDK_ARG_TYPE_BINARY: libarsdk.struct_arsdk_binary,
+}
+
 
 class ArsdkCommand:
     def __init__(self, name, desc):
@@ -162,6 +179,47 @@ class ArsdkCommand:
             setattr(py_args, arg_name, arg_value)
         return py_args
 
+    def decode_batch(self, cmds):
+        """
+        Decode many commands of this type at once, returns a dict of
+        argument name to column. Numbers and enums columns are contiguous
+        ctypes arrays (usable through memoryview), strings and binaries
+        columns are lists as their data belongs to the commands buffers.
+        """
+        count = len(cmds)
+        c_cmds = (libarsdk.struct_arsdk_cmd * count)()
+        for i in range(count):
+            c_cmds[i] = ctypes.cast(
+                cmds[i], ctypes.POINTER(libarsdk.struct_arsdk_cmd)).contents
+
+        # Create one column per argument
+        arg_count = self._desc.contents.arg_desc_count
+        columns = []
+        for i in range(arg_count):
+            arg_desc = self._desc.contents.arg_desc_table[i]
+            columns.append((CTYPES_COLUMN_CONVERSION[arg_desc.type] * count)())
+        c_columns = (ctypes.c_void_p * arg_count)(
+            *[ctypes.cast(c, ctypes.c_void_p) for c in columns])
+
+        res = libarsdk.arsdk_cmd_dec_batch(c_cmds, count, self._desc,
+                                           c_columns)
+        if res < 0:
+            raise RuntimeError(f"arsdk_cmd_dec_batch: {res}")
+
+        py_columns = {}
+        for i in range(arg_count):
+            arg_desc = self._desc.contents.arg_desc_table[i]
+            arg_name = string_cast(arg_desc.name)
+            if arg_desc.type == libarsdk.ARSDK_ARG_TYPE_STRING:
+                py_columns[arg_name] = [
+                    v.decode('utf-8') for v in columns[i]]
+            elif arg_desc.type == libarsdk.ARSDK_ARG_TYPE_BINARY:
+                py_columns[arg_name] = [
+                    ctypes.string_at(v.cdata, v.len) for v in columns[i]]
+            else:
+                py_columns[arg_name] = columns[i]
+        return py_columns
+
 
 # First level of the table is 'Class'
 class ArsdkClsFactory:
@@ -68,6 +68,12 @@ struct arsdk_device_conn {
 	uint32_t                               proto_v_max;
 	/** protocol version used */
 	uint32_t                               proto_v;
+	/** maximum command pack size supported, 0 for the default one */
+	uint32_t                               pack_max_size_supported;
+	/** maximum command pack size used, 0 for the default one */
+	uint32_t                               pack_max_size;
+	/** '1' to bound the pack size by the path MTU */
+	int                                    pmtu_probe;
 };
 
 /** */
@@ -86,6 +92,10 @@ struct arsdkctrl_backend_net {
 	uint32_t                               proto_v_min;
 	/** maximum protocol version supported */
 	uint32_t                               proto_v_max;
+	/** maximum command pack size supported, 0 for the default one */
+	uint32_t                               pack_max_size;
+	/** '1' to bound the pack size by the path MTU */
+	int                                    pmtu_probe;
 };
 
 static void arsdkctrl_backend_net_socket_cb(struct arsdkctrl_backend *base,
@@ -233,6 +243,14 @@ static int device_conn_send_json(struct arsdk_device_conn *self,
 	json_object_object_add(jroot, ARSDK_CONN_JSON_KEY_PROTO_V_MAX,
 			json_object_new_int(self->proto_v_max));
 
+	/* Add supported pack size, if not the default one */
+	if (self->pack_max_size_supported != 0) {
+		json_object_object_add(jroot,
+				ARSDK_CONN_JSON_KEY_PACK_MAX_SIZE,
+				json_object_new_int(
+					self->pack_max_size_supported));
+	}
+
 	/* Get updated json */
 	newjson = json_object_to_json_string(jroot);
 	if (newjson == NULL) {
@@ -300,6 +318,32 @@ static uint32_t parse_proto_version(json_object *object)
 	return proto_v;
 }
 
+/**
+ */
+static uint32_t parse_pack_max_size(json_object *object)
+{
+	int pack_max_size = 0;
+	json_object *jobj = NULL;
+
+	if (!object)
+		return 0;
+
+	/* Default pack size if not present */
+	jobj = get_json_object(object, ARSDK_CONN_JSON_KEY_PACK_MAX_SIZE);
+	if (jobj != NULL)
+		pack_max_size = json_object_get_int(jobj);
+
+	/* Default pack size if invalid value */
+	if (pack_max_size != 0 &&
+	    (pack_max_size < ARSDKCTRL_BACKEND_NET_PACK_SIZE_MIN ||
+	     pack_max_size > ARSDKCTRL_BACKEND_NET_PACK_SIZE_MAX)) {
+		ARSDK_LOGW("Invalid pack max size: %d", pack_max_size);
+		pack_max_size = 0;
+	}
+
+	return (uint32_t)pack_max_size;
+}
+
 /**
  */
 static int device_conn_recv_json(struct arsdk_device_conn *self,
@@ -351,6 +395,10 @@ static int device_conn_recv_json(struct arsdk_device_conn *self,
 
 	self->proto_v = parse_proto_version(jroot);
 
+	/* Parse the chosen pack size:
+	 * if not present the default one of the protocol is used */
+	self->pack_max_size = parse_pack_max_size(jroot);
+
 end:
 	/* Success */
 	json_object_put(jroot);
@@ -493,6 +541,14 @@ static void device_conn_raw_cb(
 	cfg.qos_mode = self->qos_mode;
 	cfg.data.tx_port = self->c2d_data_port;
 	cfg.proto_v = self->proto_v;
+	/* the device can not choose a larger pack size than the supported one */
+	if (self->pack_max_size != 0 && self->pack_max_size_supported != 0) {
+		cfg.pack_max_size = MIN(self->pack_max_size,
+				self->pack_max_size_supported);
+	} else {
+		cfg.pack_max_size = 0;
+	}
+	cfg.pmtu_probe = self->pmtu_probe;
 	res = arsdk_transport_net_update_cfg(self->transport, &cfg);
 	if (res < 0)
 		goto error;
@@ -559,6 +615,8 @@ static int device_conn_new(
 		uint32_t proto_v_max, uint32_t proto_v_min,
 		int qos_mode_supported,
 		int stream_supported,
+		uint32_t pack_max_size,
+		int pmtu_probe,
 		struct arsdk_device_conn **ret_conn)
 {
 	int res = 0;
@@ -584,6 +642,8 @@ static int device_conn_new(
 	self->state = DEVICE_CONN_STATE_IDLE;
 	self->proto_v_min = proto_v_min;
 	self->proto_v_max = proto_v_max;
+	self->pack_max_size_supported = pack_max_size;
+	self->pmtu_probe = pmtu_probe;
 
 	/* Create pomp context, make it raw */
 	self->ctx = pomp_ctx_new_with_loop(&device_conn_event_cb, self, loop);
@@ -651,6 +711,8 @@ static int arsdkctrl_backend_net_start_device_conn(
 			self->proto_v_max, self->proto_v_min,
 			self->qos_mode_supported,
 			self->stream_supported,
+			self->pack_max_size,
+			self->pmtu_probe,
 			&conn);
 	if (res < 0)
 		goto error;
@@ -753,6 +815,12 @@ int arsdkctrl_backend_net_new(struct arsdk_ctrl *ctrl,
 			(cfg->proto_v_max == 0 &&
 			 cfg->proto_v_min <= ARSDKCTRL_BACKEND_NET_PROTO_MAX),
 			-EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cfg->pack_max_size == 0 ||
+			(cfg->pack_max_size >=
+				ARSDKCTRL_BACKEND_NET_PACK_SIZE_MIN &&
+			 cfg->pack_max_size <=
+				ARSDKCTRL_BACKEND_NET_PACK_SIZE_MAX),
+			-EINVAL);
 
 	/* Allocate structure */
 	self = calloc(1, sizeof(*self));
@@ -775,6 +843,8 @@ int arsdkctrl_backend_net_new(struct arsdk_ctrl *ctrl,
 			ARSDKCTRL_BACKEND_NET_PROTO_MIN;
 	self->proto_v_max = cfg->proto_v_max != 0 ? cfg->proto_v_max :
 			ARSDKCTRL_BACKEND_NET_PROTO_MAX;
+	self->pack_max_size = cfg->pack_max_size;
+	self->pmtu_probe = cfg->pmtu_probe;
 
 	/* Success */
 	*ret_obj = self;
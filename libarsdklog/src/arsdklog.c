@@ -425,6 +425,7 @@ int arsdk_logger_log_cmd_send_status(struct arsdk_logger *logger,
 		header.count = 1;
 		/* fallthrough */
 	case ARSDK_CMD_ITF_CMD_SEND_STATUS_CANCELED:
+	case ARSDK_CMD_ITF_CMD_SEND_STATUS_EXPIRED:
 		header.event = ARSDKLOG_EVENT_CMD_ABORTED;
 		break;
 	default:
@@ -535,6 +536,9 @@ int arsdk_logger_log_pack_recv_status(
 	};
 
 	switch (status) {
+	case ARSDK_CMD_ITF_PACK_RECV_STATUS_HELD:
+		/* Logged once processed */
+		return 0;
 	case ARSDK_CMD_ITF_PACK_RECV_STATUS_IGNORED:
 		header.count = 1;
 		/* fallthrough */
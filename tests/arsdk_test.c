@@ -151,6 +151,8 @@ int main(int argc, char *argv[])
 	/* Register tests */
 	CU_initialize_registry();
 	CU_register_suites(g_suites_cmd_itf);
+	CU_register_suites(g_suites_cmd_itf_loop);
+	CU_register_suites(g_suites_cmd_itf_rtt);
 	CU_register_suites(g_suites_enc_dec);
 	CU_register_suites(g_suites_protoc);
 
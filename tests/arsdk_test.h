@@ -51,6 +51,14 @@
  */
 extern CU_SuiteInfo g_suites_cmd_itf[];
 
+/**
+ */
+extern CU_SuiteInfo g_suites_cmd_itf_loop[];
+
+/**
+ */
+extern CU_SuiteInfo g_suites_cmd_itf_rtt[];
+
 /**
  */
 extern CU_SuiteInfo g_suites_enc_dec[];
@@ -60,6 +60,15 @@ struct test_data {
 
 	struct test_cmd_info *cmds;
 	size_t cmds_cnt;
+
+	/* Pack max sizes supported by the device and the controller,
+	   '0' for the default one */
+	uint32_t dev_pack_max_size;
+	uint32_t ctrl_pack_max_size;
+
+	/* Statistics of the device queues when all commands are received */
+	struct arsdk_cmd_itf_queue_stats stats[8];
+	uint32_t stats_cnt;
 };
 static struct test_data s_data = {
 };
@@ -148,6 +157,27 @@ struct arsdk_cmd_desc s_cmd_lowprio_desc1 = {
 	.arg_desc_count = 1,
 };
 
+struct arsdk_cmd_desc s_cmd_noack_desc1 = {
+	.name = "cmd5_noack",
+	.prj_id = 1,
+	.cls_id = 2,
+	.cmd_id = 5,
+	.list_type = ARSDK_CMD_LIST_TYPE_NONE,
+	.buffer_type = ARSDK_CMD_BUFFER_TYPE_NON_ACK,
+	.timeout_policy = ARSDK_CMD_TIMEOUT_POLICY_POP,
+
+	.arg_desc_table = (const struct arsdk_arg_desc[1]) {
+		{
+			"arg1",
+			ARSDK_ARG_TYPE_STRING,
+
+			NULL,
+			0,
+		}
+	},
+	.arg_desc_count = 1,
+};
+
 static void send_status_cb (struct arsdk_cmd_itf *itf,
 		const struct arsdk_cmd *cmd,
 		enum arsdk_cmd_buffer_type type,
@@ -282,6 +312,10 @@ static void ctrl_recv_cmd(struct arsdk_cmd_itf *itf,
 	}
 
 	if (!waiting_cmd) {
+		s_data.stats_cnt = sizeof(s_data.stats) /
+				sizeof(s_data.stats[0]);
+		arsdk_cmd_itf_get_stats(s_data.dev.cmd_itf, s_data.stats,
+				&s_data.stats_cnt);
 		arsdk_test_env_loop_stop(s_data.env);
 	} else {
 		/* Device sends next commands. */
@@ -424,6 +458,13 @@ static void test_run(enum arsdk_backend_type backend_type)
 	res = arsdk_test_env_new(backend_type, &env_cbs, &s_data.env);
 	CU_ASSERT_EQUAL_FATAL(res, 0);
 
+	if (s_data.dev_pack_max_size != 0 || s_data.ctrl_pack_max_size != 0) {
+		res = arsdk_test_env_set_pack_max_size(s_data.env,
+				s_data.dev_pack_max_size,
+				s_data.ctrl_pack_max_size);
+		CU_ASSERT_EQUAL_FATAL(res, 0);
+	}
+
 	res = arsdk_test_env_start(s_data.env);
 	CU_ASSERT_EQUAL_FATAL(res, 0);
 
@@ -585,6 +626,112 @@ static void test_cmd_itf_net_ack_lowprio_msg(void)
 	}
 }
 
+static void test_cmd_itf_net_window_ack_msg(void)
+{
+	TST_LOG("%s", __func__);
+
+	memset(&s_data, 0, sizeof(s_data));
+
+	/* Enough packs to be sent several at once */
+	struct test_cmd_info cmds[] = {
+		{
+			.desc = s_cmd_ack_desc1,
+
+			.msg_size = 900,
+			.msg_cnt = 64,
+		},
+
+		{
+			.desc = s_cmd_ack_desc2,
+
+			.msg_size = 30,
+			.msg_cnt = 64,
+		},
+	};
+
+	s_data.cmds = cmds;
+	s_data.cmds_cnt = 2;
+
+	test_run(ARSDK_BACKEND_TYPE_NET);
+
+	/* checks */
+
+	size_t i;
+	for (i = 0; i < s_data.cmds_cnt; i++) {
+		CU_ASSERT_EQUAL(s_data.cmds[i].sent_cnt, s_data.cmds[i].msg_cnt);
+		CU_ASSERT_EQUAL(s_data.cmds[i].recv_cnt, s_data.cmds[i].msg_cnt);
+	}
+
+	/* All the commands went through the acknowledged queue, the ones
+	   not yet acknowledged are still in it */
+	CU_ASSERT_FATAL(s_data.stats_cnt > 0);
+	struct arsdk_cmd_itf_queue_stats *stats = NULL;
+	for (i = 0; i < s_data.stats_cnt; i++) {
+		if (s_data.stats[i].type == ARSDK_CMD_BUFFER_TYPE_ACK)
+			stats = &s_data.stats[i];
+	}
+	CU_ASSERT_PTR_NOT_NULL_FATAL(stats);
+	CU_ASSERT_EQUAL(stats->queued,
+			s_data.cmds[0].msg_cnt + s_data.cmds[1].msg_cnt);
+	CU_ASSERT_EQUAL(stats->queued, stats->acked + stats->depth);
+	CU_ASSERT(stats->sent > 0);
+
+	uint64_t latency_cnt = 0;
+	for (i = 0; i < ARSDK_CMD_ITF_HISTO_BUCKET_COUNT; i++)
+		latency_cnt += stats->ack_latency.buckets[i];
+	CU_ASSERT_EQUAL(latency_cnt, stats->acked);
+}
+
+static void test_cmd_itf_net_pack_size_msg(void)
+{
+	TST_LOG("%s", __func__);
+
+	memset(&s_data, 0, sizeof(s_data));
+
+	/* Commands larger than the default pack size, sent in a single pack
+	   of the size negotiated */
+	struct test_cmd_info cmds[] = {
+		{
+			.desc = s_cmd_noack_desc1,
+
+			.msg_size = 1800,
+			.msg_cnt = 10,
+		},
+		{
+			.desc = s_cmd_ack_desc1,
+
+			.msg_size = 1800,
+			.msg_cnt = 10,
+		},
+	};
+
+	s_data.cmds = cmds;
+	s_data.cmds_cnt = 2;
+	/* The smallest size is negotiated, the path MTU probed on the
+	   loopback interface does not reduce it */
+	s_data.dev_pack_max_size = 4000;
+	s_data.ctrl_pack_max_size = 2000;
+
+	test_run(ARSDK_BACKEND_TYPE_NET);
+
+	/* checks */
+
+	size_t i;
+	for (i = 0; i < s_data.cmds_cnt; i++) {
+		CU_ASSERT_EQUAL(s_data.cmds[i].sent_cnt, s_data.cmds[i].msg_cnt);
+		CU_ASSERT_EQUAL(s_data.cmds[i].recv_cnt, s_data.cmds[i].msg_cnt);
+	}
+
+	CU_ASSERT_FATAL(s_data.stats_cnt > 0);
+	for (i = 0; i < s_data.stats_cnt; i++) {
+		if (s_data.stats[i].packed == 0)
+			continue;
+		CU_ASSERT_EQUAL(s_data.stats[i].dropped, 0);
+		CU_ASSERT(s_data.stats[i].pack_size > 1800);
+		CU_ASSERT(s_data.stats[i].pack_size <= 2000);
+	}
+}
+
 /* mux */
 
 static void test_cmd_itf_mux_large_ack_msg(void)
@@ -671,6 +818,9 @@ static CU_TestInfo s_cmd_itf_tests[] = {
 	{(char *)"cmd_itf_mux_multi_ack_msg", &test_cmd_itf_mux_multi_ack_msg},
 	{(char *)"cmd_itf_net_problematic_ack_msg", &test_cmd_itf_net_problematic_ack_msg},
 	{(char *)"cmd_itf_net_ack_lowprio_msg", &test_cmd_itf_net_ack_lowprio_msg},
+	{(char *)"cmd_itf_net_window_ack_msg", &test_cmd_itf_net_window_ack_msg},
+	{(char *)"cmd_itf_net_pack_size_msg",
+			&test_cmd_itf_net_pack_size_msg},
 	CU_TEST_INFO_NULL,
 };
 
@@ -0,0 +1,1796 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Command interfaces connected by a loopback transport, the test controls
+ * the delivery of each datagram: drop, reordering and inspection of the
+ * data and of the acknowledgements.
+ */
+
+#include "arsdk_test.h"
+#include <time.h>
+#include <arsdk/internal/arsdk_internal.h>
+#include "arsdk_transport_ids.h"
+#include "cmd_itf/arsdk_cmd_itf_priv.h"
+#include "cmd_itf/arsdk_cmd_itf3.h"
+
+#define LOG_TAG "arsdk_test_cmd_itf_loop"
+#include "arsdk_test_log.h"
+
+/** Maximum count of datagrams in flight */
+#define LOOP_DGRAM_MAX 1024
+/** Maximum count of commands received recorded */
+#define LOOP_RECV_MAX 1024
+
+/** Sides of the loopback */
+enum loop_side {
+	LOOP_SENDER = 0,
+	LOOP_RECEIVER,
+	LOOP_SIDE_COUNT,
+};
+
+/** Datagram sent, not yet delivered */
+struct loop_dgram {
+	enum loop_side from;
+	struct arsdk_transport_header header;
+	uint8_t *data;
+	size_t len;
+};
+
+/**
+ * Filter of the datagrams to deliver.
+ * Returns '1' to deliver the datagram, '0' to drop it.
+ */
+typedef int (*loop_filter_t)(const struct loop_dgram *dgram);
+
+struct loop_data {
+	struct pomp_loop *loop;
+	uint32_t proto_v;
+	uint32_t pack_max_size;
+	struct arsdk_transport *transports[LOOP_SIDE_COUNT];
+	struct arsdk_cmd_itf *itfs[LOOP_SIDE_COUNT];
+
+	/* Datagrams in flight */
+	struct loop_dgram dgrams[LOOP_DGRAM_MAX];
+	size_t dgram_cnt;
+	loop_filter_t filter;
+
+	/* Data datagrams sent by the sender, by transport data type */
+	size_t sent_cnt[ARSDK_TRANSPORT_DATA_TYPE_MAX];
+	/* Data datagrams sent by the sender, in order */
+	struct {
+		uint8_t id;
+		uint16_t seq;
+		size_t len;
+		uint64_t ms;
+	} sent[LOOP_DGRAM_MAX];
+	size_t sent_log_cnt;
+
+	/* Commands received by the receiver, in order */
+	struct {
+		uint16_t cmd_id;
+		uint32_t idx;
+	} recv[LOOP_RECV_MAX];
+	size_t recv_cnt;
+	/* First commands received, kept by the receiver */
+	struct arsdk_cmd kept[4];
+	size_t kept_cnt;
+	size_t keep_cnt;
+
+	/* Final statuses of the commands sent by the sender */
+	size_t status_cnt[ARSDK_CMD_ITF_CMD_SEND_STATUS_EXPIRED + 1];
+	/* Id of the last command packed */
+	uint32_t packed_id;
+	/* Commands logged as sent by the sender */
+	size_t log_tx_cnt;
+	/* Datagrams in flight when the last command was logged */
+	size_t log_tx_dgram_cnt;
+	/* Statuses of the packs received by the receiver */
+	size_t pack_recv_cnt[ARSDK_CMD_ITF_PACK_RECV_STATUS_HELD + 1];
+	/* Drains notified by the sender and buffer type of the last one */
+	size_t drained_cnt;
+	enum arsdk_cmd_buffer_type drained_type;
+};
+static struct loop_data s_loop;
+
+/** Queues of both interfaces, the ones of a device */
+static const struct arsdk_cmd_queue_info s_loop_tx_info_table[] = {
+	{
+		.type = ARSDK_TRANSPORT_DATA_TYPE_WITHACK,
+		.id = ARSDK_TRANSPORT_ID_D2C_CMD_WITHACK,
+		.ack_timeout_ms = 150,
+		.default_max_retry_count = -1,
+	},
+	{
+		.type = ARSDK_TRANSPORT_DATA_TYPE_NOACK,
+		.id = ARSDK_TRANSPORT_ID_D2C_CMD_NOACK,
+		.ack_timeout_ms = -1,
+		.default_max_retry_count = -1,
+	},
+	{
+		.type = ARSDK_TRANSPORT_DATA_TYPE_WITHACK,
+		.id = ARSDK_TRANSPORT_ID_D2C_CMD_LOWPRIO,
+		.ack_timeout_ms = 150,
+		.default_max_retry_count = -1,
+	},
+};
+
+static const struct arsdk_arg_desc s_loop_arg_desc_table[] = {
+	{
+		"idx",
+		ARSDK_ARG_TYPE_U32,
+
+		NULL,
+		0,
+	},
+	{
+		"pad",
+		ARSDK_ARG_TYPE_STRING,
+
+		NULL,
+		0,
+	},
+};
+
+static const struct arsdk_cmd_desc s_loop_ack_desc = {
+	.name = "loop_ack",
+	.prj_id = 1,
+	.cls_id = 3,
+	.cmd_id = 1,
+	.list_type = ARSDK_CMD_LIST_TYPE_NONE,
+	.buffer_type = ARSDK_CMD_BUFFER_TYPE_ACK,
+	.timeout_policy = ARSDK_CMD_TIMEOUT_POLICY_RETRY,
+	.arg_desc_table = s_loop_arg_desc_table,
+	.arg_desc_count = 2,
+};
+
+static const struct arsdk_cmd_desc s_loop_noack_desc = {
+	.name = "loop_noack",
+	.prj_id = 1,
+	.cls_id = 3,
+	.cmd_id = 2,
+	.list_type = ARSDK_CMD_LIST_TYPE_NONE,
+	.buffer_type = ARSDK_CMD_BUFFER_TYPE_NON_ACK,
+	.timeout_policy = ARSDK_CMD_TIMEOUT_POLICY_POP,
+	.arg_desc_table = s_loop_arg_desc_table,
+	.arg_desc_count = 2,
+};
+
+static const struct arsdk_cmd_desc s_loop_lowprio_desc = {
+	.name = "loop_lowprio",
+	.prj_id = 1,
+	.cls_id = 3,
+	.cmd_id = 3,
+	.list_type = ARSDK_CMD_LIST_TYPE_NONE,
+	.buffer_type = ARSDK_CMD_BUFFER_TYPE_LOW_PRIO,
+	.timeout_policy = ARSDK_CMD_TIMEOUT_POLICY_RETRY,
+	.arg_desc_table = s_loop_arg_desc_table,
+	.arg_desc_count = 2,
+};
+
+static const struct arsdk_cmd_desc *loop_find_desc(uint16_t cmd_id)
+{
+	switch (cmd_id) {
+	case 1:
+		return &s_loop_ack_desc;
+	case 2:
+		return &s_loop_noack_desc;
+	case 3:
+		return &s_loop_lowprio_desc;
+	default:
+		return NULL;
+	}
+}
+
+static uint64_t loop_now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static enum loop_side loop_transport_side(struct arsdk_transport *base)
+{
+	return base == s_loop.transports[LOOP_SENDER] ?
+			LOOP_SENDER : LOOP_RECEIVER;
+}
+
+static int loop_transport_dispose(struct arsdk_transport *base)
+{
+	return 0;
+}
+
+static int loop_transport_start(struct arsdk_transport *base)
+{
+	return 0;
+}
+
+static int loop_transport_stop(struct arsdk_transport *base)
+{
+	return 0;
+}
+
+static int loop_transport_send_data(struct arsdk_transport *base,
+		const struct arsdk_transport_header *header,
+		const struct arsdk_transport_payload *payload,
+		const void *extra_hdr,
+		size_t extra_hdrlen)
+{
+	const void *cdata = payload->cdata;
+	size_t len = payload->len;
+	if (payload->buf != NULL)
+		pomp_buffer_get_cdata(payload->buf, &cdata, &len, NULL);
+
+	CU_ASSERT_FATAL(s_loop.dgram_cnt < LOOP_DGRAM_MAX);
+	struct loop_dgram *dgram = &s_loop.dgrams[s_loop.dgram_cnt++];
+	dgram->from = loop_transport_side(base);
+	dgram->header = *header;
+	dgram->len = extra_hdrlen + len;
+	dgram->data = malloc(dgram->len + 1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dgram->data);
+	if (extra_hdrlen > 0)
+		memcpy(dgram->data, extra_hdr, extra_hdrlen);
+	if (len > 0)
+		memcpy(dgram->data + extra_hdrlen, cdata, len);
+
+	if (dgram->from == LOOP_SENDER &&
+	    header->type != ARSDK_TRANSPORT_DATA_TYPE_ACK) {
+		s_loop.sent_cnt[header->type]++;
+		if (s_loop.sent_log_cnt < LOOP_DGRAM_MAX) {
+			s_loop.sent[s_loop.sent_log_cnt].id = header->id;
+			s_loop.sent[s_loop.sent_log_cnt].seq = header->seq;
+			s_loop.sent[s_loop.sent_log_cnt].len = dgram->len;
+			s_loop.sent[s_loop.sent_log_cnt].ms = loop_now_ms();
+			s_loop.sent_log_cnt++;
+		}
+	}
+	return 0;
+}
+
+static uint32_t loop_transport_get_proto_v(struct arsdk_transport *base)
+{
+	return s_loop.proto_v;
+}
+
+static uint32_t loop_transport_get_pack_max_size(struct arsdk_transport *base)
+{
+	return s_loop.pack_max_size;
+}
+
+static const struct arsdk_transport_ops s_loop_transport_ops = {
+	.dispose = &loop_transport_dispose,
+	.start = &loop_transport_start,
+	.stop = &loop_transport_stop,
+	.send_data = &loop_transport_send_data,
+	.get_proto_v = &loop_transport_get_proto_v,
+	.get_pack_max_size = &loop_transport_get_pack_max_size,
+};
+
+static int loop_itf_dispose(struct arsdk_cmd_itf *itf, void *userdata)
+{
+	return 0;
+}
+
+static void loop_recv_cmd(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd *cmd,
+		void *userdata)
+{
+	uint32_t idx = 0;
+	const char *pad = NULL;
+
+	if (itf != s_loop.itfs[LOOP_RECEIVER])
+		return;
+
+	int res;
+	if (cmd->id == ARSDK_ID_ARDRONE3_PILOTING_PCMD) {
+		/* Generated command, indexed by its sequence number */
+		uint8_t flag;
+		int8_t roll, pitch, yaw, gaz;
+		res = arsdk_cmd_dec_Ardrone3_Piloting_PCMD(cmd, &flag, &roll,
+				&pitch, &yaw, &gaz, &idx);
+		CU_ASSERT_EQUAL_FATAL(res, 0);
+		CU_ASSERT_EQUAL(flag, 1);
+		CU_ASSERT_EQUAL(roll, -10);
+		CU_ASSERT_EQUAL(gaz, 20);
+	} else {
+		const struct arsdk_cmd_desc *desc =
+				loop_find_desc(cmd->cmd_id);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(desc);
+		res = arsdk_cmd_dec(cmd, desc, &idx, &pad);
+		CU_ASSERT_EQUAL_FATAL(res, 0);
+	}
+
+	if (s_loop.kept_cnt < s_loop.keep_cnt)
+		arsdk_cmd_copy(&s_loop.kept[s_loop.kept_cnt++], cmd);
+
+	CU_ASSERT_FATAL(s_loop.recv_cnt < LOOP_RECV_MAX);
+	s_loop.recv[s_loop.recv_cnt].cmd_id = cmd->cmd_id;
+	s_loop.recv[s_loop.recv_cnt].idx = idx;
+	s_loop.recv_cnt++;
+}
+
+static void loop_pack_recv_status(struct arsdk_cmd_itf *itf,
+		int seq,
+		enum arsdk_cmd_buffer_type type,
+		size_t len,
+		enum arsdk_cmd_itf_pack_recv_status status,
+		void *userdata)
+{
+	if (itf == s_loop.itfs[LOOP_RECEIVER])
+		s_loop.pack_recv_cnt[status]++;
+}
+
+static void loop_send_status(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd *cmd,
+		enum arsdk_cmd_buffer_type type,
+		enum arsdk_cmd_itf_cmd_send_status status,
+		uint16_t seq,
+		int done,
+		void *userdata)
+{
+	if (done)
+		s_loop.status_cnt[status]++;
+	if (status == ARSDK_CMD_ITF_CMD_SEND_STATUS_PACKED)
+		s_loop.packed_id = cmd->id;
+}
+
+static void loop_cmd_log(struct arsdk_cmd_itf *itf,
+		enum arsdk_cmd_dir dir,
+		const struct arsdk_cmd *cmd,
+		void *userdata)
+{
+	if (itf == s_loop.itfs[LOOP_SENDER] && dir == ARSDK_CMD_DIR_TX) {
+		s_loop.log_tx_cnt++;
+		s_loop.log_tx_dgram_cnt = s_loop.dgram_cnt;
+	}
+}
+
+static void loop_queue_drained(struct arsdk_cmd_itf *itf,
+		enum arsdk_cmd_buffer_type type,
+		void *userdata)
+{
+	s_loop.drained_cnt++;
+	s_loop.drained_type = type;
+}
+
+/**
+ * Creates the sender interface and, if requested, the receiver one.
+ */
+static void loop_start(uint32_t proto_v, uint32_t pack_max_size,
+		int receiver)
+{
+	static const char * const names[LOOP_SIDE_COUNT] = {
+		"sender", "receiver",
+	};
+	struct arsdk_cmd_itf_cbs cbs = {
+		.recv_cmd = &loop_recv_cmd,
+		.cmd_send_status = &loop_send_status,
+		.pack_recv_status = &loop_pack_recv_status,
+		.cmd_log = &loop_cmd_log,
+		.queue_drained = &loop_queue_drained,
+	};
+	struct arsdk_cmd_itf_internal_cbs internal_cbs = {
+		.dispose = &loop_itf_dispose,
+	};
+	int res;
+	int i;
+
+	memset(&s_loop, 0, sizeof(s_loop));
+	s_loop.proto_v = proto_v;
+	s_loop.pack_max_size = pack_max_size;
+	s_loop.loop = pomp_loop_new();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(s_loop.loop);
+
+	for (i = 0; i < (receiver ? LOOP_SIDE_COUNT : 1); i++) {
+		res = arsdk_transport_new(NULL, &s_loop_transport_ops,
+				s_loop.loop, 0, names[i],
+				&s_loop.transports[i]);
+		CU_ASSERT_EQUAL_FATAL(res, 0);
+
+		res = arsdk_cmd_itf_new(s_loop.transports[i], &cbs,
+				&internal_cbs, s_loop_tx_info_table,
+				sizeof(s_loop_tx_info_table) /
+				sizeof(s_loop_tx_info_table[0]),
+				ARSDK_TRANSPORT_ID_ACKOFF, &s_loop.itfs[i]);
+		CU_ASSERT_EQUAL_FATAL(res, 0);
+	}
+}
+
+static void loop_stop(void)
+{
+	size_t i;
+
+	for (i = 0; i < LOOP_SIDE_COUNT; i++) {
+		if (s_loop.itfs[i] != NULL) {
+			arsdk_cmd_itf_stop(s_loop.itfs[i]);
+			arsdk_cmd_itf_destroy(s_loop.itfs[i]);
+		}
+		if (s_loop.transports[i] != NULL)
+			arsdk_transport_destroy(s_loop.transports[i]);
+	}
+
+	for (i = 0; i < s_loop.dgram_cnt; i++)
+		free(s_loop.dgrams[i].data);
+	for (i = 0; i < s_loop.kept_cnt; i++)
+		arsdk_cmd_clear(&s_loop.kept[i]);
+
+	pomp_loop_destroy(s_loop.loop);
+	memset(&s_loop, 0, sizeof(s_loop));
+}
+
+/**
+ * Sends a command by the sender.
+ */
+static int loop_send(const struct arsdk_cmd_desc *desc, uint32_t idx,
+		size_t pad_len, uint32_t ttl_ms)
+{
+	struct arsdk_cmd cmd;
+	char *pad = malloc(pad_len + 1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(pad);
+	memset(pad, 'a', pad_len);
+	pad[pad_len] = '\0';
+
+	arsdk_cmd_init(&cmd);
+	int res = arsdk_cmd_enc(&cmd, desc, idx, pad);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	/* The test commands are not in the generated tables */
+	cmd.buffer_type = desc->buffer_type;
+	cmd.ttl_ms = ttl_ms;
+
+	res = arsdk_cmd_itf_send(s_loop.itfs[LOOP_SENDER], &cmd,
+			&loop_send_status, NULL);
+
+	arsdk_cmd_clear(&cmd);
+	free(pad);
+	return res;
+}
+
+/**
+ * Removes a datagram in flight, the caller must free its data.
+ */
+static struct loop_dgram loop_take(size_t i)
+{
+	struct loop_dgram dgram = s_loop.dgrams[i];
+
+	s_loop.dgram_cnt--;
+	memmove(&s_loop.dgrams[i], &s_loop.dgrams[i + 1],
+			(s_loop.dgram_cnt - i) * sizeof(dgram));
+	return dgram;
+}
+
+/**
+ * Delivers a datagram to the other side, if it exists.
+ */
+static void loop_deliver(const struct loop_dgram *dgram)
+{
+	struct arsdk_cmd_itf *itf = s_loop.itfs[dgram->from == LOOP_SENDER ?
+			LOOP_RECEIVER : LOOP_SENDER];
+	struct arsdk_transport_payload payload;
+	struct pomp_buffer *buf;
+
+	if (itf == NULL)
+		return;
+
+	buf = pomp_buffer_new_with_data(dgram->data, dgram->len);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(buf);
+	arsdk_transport_payload_init_with_buf(&payload, buf);
+	arsdk_cmd_itf_recv_data(itf, &dgram->header, &payload);
+	arsdk_transport_payload_clear(&payload);
+	pomp_buffer_unref(buf);
+}
+
+/**
+ * Delivers the datagrams in flight in order, and the ones sent in
+ * response, except the ones refused by the filter.
+ */
+static void loop_pump(void)
+{
+	struct loop_dgram dgram;
+
+	while (s_loop.dgram_cnt > 0) {
+		dgram = loop_take(0);
+		if (s_loop.filter == NULL || (*s_loop.filter)(&dgram))
+			loop_deliver(&dgram);
+		free(dgram.data);
+	}
+}
+
+/**
+ * Runs the loop, pumping the datagrams, until the count of commands
+ * received is reached or the timeout expires.
+ */
+static void loop_run(size_t recv_cnt, uint32_t timeout_ms)
+{
+	uint64_t end_ms = loop_now_ms() + timeout_ms;
+	uint64_t now_ms;
+
+	loop_pump();
+	while (s_loop.recv_cnt < recv_cnt &&
+	       (now_ms = loop_now_ms()) < end_ms) {
+		pomp_loop_wait_and_process(s_loop.loop, (int)(end_ms - now_ms));
+		loop_pump();
+	}
+}
+
+/**
+ * Runs the loop for a duration, without delivering the datagrams.
+ */
+static void loop_wait(uint32_t duration_ms)
+{
+	uint64_t end_ms = loop_now_ms() + duration_ms;
+	uint64_t now_ms;
+
+	while ((now_ms = loop_now_ms()) < end_ms)
+		pomp_loop_wait_and_process(s_loop.loop, (int)(end_ms - now_ms));
+}
+
+static void loop_get_stats(enum arsdk_cmd_buffer_type type,
+		struct arsdk_cmd_itf_queue_stats *stats)
+{
+	struct arsdk_cmd_itf_queue_stats all[8];
+	uint32_t count = sizeof(all) / sizeof(all[0]);
+	uint32_t i;
+
+	memset(stats, 0, sizeof(*stats));
+	int res = arsdk_cmd_itf_get_stats(s_loop.itfs[LOOP_SENDER], all,
+			&count);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	for (i = 0; i < count; i++) {
+		if (all[i].type == type) {
+			*stats = all[i];
+			return;
+		}
+	}
+	CU_FAIL("queue not found");
+}
+
+static void test_too_large(uint32_t proto_v)
+{
+	struct arsdk_cmd_itf_queue_stats stats;
+
+	TST_LOG("%s v%u", __func__, proto_v);
+
+	/* Pack size reduced by the negotiation or the path MTU */
+	loop_start(proto_v, 600, 1);
+
+	CU_ASSERT_EQUAL(loop_send(&s_loop_noack_desc, 0, 1000, 0), 0);
+	CU_ASSERT_EQUAL(loop_send(&s_loop_noack_desc, 1, 10, 0), 0);
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 2, 1000, 0), 0);
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 3, 10, 0), 0);
+
+	/* The version 3 splits the acknowledged commands in several packs,
+	   the other commands too large are dropped */
+	size_t expected = proto_v > 2 ? 3 : 2;
+	loop_run(expected, 1000);
+	loop_wait(50);
+	loop_pump();
+
+	CU_ASSERT_EQUAL(s_loop.recv_cnt, expected);
+	CU_ASSERT_EQUAL(s_loop.status_cnt[ARSDK_CMD_ITF_CMD_SEND_STATUS_CANCELED],
+			4 - expected);
+
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_NON_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.dropped, 1);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.dropped, proto_v > 2 ? 0 : 1);
+	CU_ASSERT_EQUAL(stats.depth, 0);
+
+	loop_stop();
+}
+
+static void test_cmd_itf_loop_too_large(void)
+{
+	test_too_large(2);
+	test_too_large(3);
+}
+
+static void test_send_gen(uint32_t proto_v)
+{
+	struct arsdk_cmd_itf_queue_stats stats;
+	int res;
+
+	TST_LOG("%s v%u", __func__, proto_v);
+
+	loop_start(proto_v, 0, 1);
+
+	/* Encoded directly in the pack and sent at once, then logged and
+	   notified with the default status callback; a queued command would
+	   be logged before being packed */
+	res = arsdk_cmd_send_Ardrone3_Piloting_PCMD(s_loop.itfs[LOOP_SENDER],
+			NULL, NULL, 1, -10, 0, 0, 20, 1);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(s_loop.dgram_cnt, 1);
+	CU_ASSERT_EQUAL(s_loop.log_tx_cnt, 1);
+	CU_ASSERT_EQUAL(s_loop.log_tx_dgram_cnt, 1);
+	CU_ASSERT_EQUAL(s_loop.status_cnt[ARSDK_CMD_ITF_CMD_SEND_STATUS_PACKED],
+			1);
+	CU_ASSERT_EQUAL(s_loop.packed_id, ARSDK_ID_ARDRONE3_PILOTING_PCMD);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_NON_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.packed, 1);
+	CU_ASSERT_EQUAL(stats.depth, 0);
+
+	/* Same with a status callback given */
+	res = arsdk_cmd_send_Ardrone3_Piloting_PCMD(s_loop.itfs[LOOP_SENDER],
+			&loop_send_status, NULL, 1, -10, 0, 0, 20, 2);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(s_loop.dgram_cnt, 2);
+	CU_ASSERT_EQUAL(s_loop.log_tx_cnt, 2);
+	CU_ASSERT_EQUAL(s_loop.log_tx_dgram_cnt, 2);
+	CU_ASSERT_EQUAL(s_loop.status_cnt[ARSDK_CMD_ITF_CMD_SEND_STATUS_PACKED],
+			2);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_NON_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.depth, 0);
+
+	loop_run(2, 1000);
+
+	CU_ASSERT_EQUAL_FATAL(s_loop.recv_cnt, 2);
+	CU_ASSERT_EQUAL(s_loop.recv[0].idx, 1);
+	CU_ASSERT_EQUAL(s_loop.recv[1].idx, 2);
+
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_NON_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.queued, 2);
+	CU_ASSERT_EQUAL(stats.packed, 2);
+
+	loop_stop();
+}
+
+static void test_cmd_itf_loop_send_gen(void)
+{
+	test_send_gen(2);
+	test_send_gen(3);
+}
+
+static void test_recv_keep(uint32_t proto_v)
+{
+	struct arsdk_cmd ref;
+	const void *cdata = NULL;
+	const void *ref_cdata = NULL;
+	size_t len = 0;
+	size_t ref_len = 0;
+	uint32_t idx = 0;
+	const char *pad = NULL;
+	size_t i;
+	int res;
+
+	TST_LOG("%s v%u", __func__, proto_v);
+
+	loop_start(proto_v, 0, 1);
+	s_loop.keep_cnt = 2;
+
+	for (i = 0; i < 6; i++)
+		CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, i, 10, 0), 0);
+	loop_run(6, 1000);
+	CU_ASSERT_EQUAL(s_loop.recv_cnt, 6);
+	CU_ASSERT_EQUAL_FATAL(s_loop.kept_cnt, 2);
+
+	/* A kept command holds exactly its data, the buffer of the
+	   following ones is not the same */
+	arsdk_cmd_init(&ref);
+	res = arsdk_cmd_enc(&ref, &s_loop_ack_desc, 0, "aaaaaaaaaa");
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	pomp_buffer_get_cdata(ref.buf, &ref_cdata, &ref_len, NULL);
+	CU_ASSERT(s_loop.kept[0].buf != s_loop.kept[1].buf);
+
+	for (i = 0; i < s_loop.kept_cnt; i++) {
+		pomp_buffer_get_cdata(s_loop.kept[i].buf, &cdata, &len, NULL);
+		CU_ASSERT_EQUAL(len, ref_len);
+		res = arsdk_cmd_dec(&s_loop.kept[i], &s_loop_ack_desc,
+				&idx, &pad);
+		CU_ASSERT_EQUAL(res, 0);
+		CU_ASSERT_EQUAL(idx, i);
+	}
+	arsdk_cmd_clear(&ref);
+
+	loop_stop();
+}
+
+static void test_cmd_itf_loop_recv_keep(void)
+{
+	test_recv_keep(2);
+	test_recv_keep(3);
+}
+
+static void test_coalesce(uint32_t proto_v)
+{
+	struct arsdk_cmd_itf_queue_stats stats;
+	struct arsdk_cmd_itf *itf;
+	uint32_t i;
+
+	TST_LOG("%s v%u", __func__, proto_v);
+
+	loop_start(proto_v, 0, 1);
+	itf = s_loop.itfs[LOOP_SENDER];
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_set_cmd_coalescing(itf,
+			&s_loop_ack_desc, 1), -EINVAL);
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_set_cmd_coalescing(itf,
+			&s_loop_noack_desc, 1), 0);
+
+	/* Only the newest pending instance is sent, the other commands are
+	   not affected */
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_batch_begin(itf), 0);
+	for (i = 0; i < 10; i++) {
+		CU_ASSERT_EQUAL(loop_send(&s_loop_noack_desc, i, 10, 0), 0);
+		CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, i, 10, 0), 0);
+	}
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_batch_end(itf), 0);
+	loop_run(11, 1000);
+
+	CU_ASSERT_EQUAL_FATAL(s_loop.recv_cnt, 11);
+	for (i = 0; i < 11; i++) {
+		if (s_loop.recv[i].cmd_id == s_loop_noack_desc.cmd_id)
+			CU_ASSERT_EQUAL(s_loop.recv[i].idx, 9);
+	}
+	CU_ASSERT_EQUAL(s_loop.status_cnt[
+			ARSDK_CMD_ITF_CMD_SEND_STATUS_CANCELED], 9);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_NON_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.coalesced, 9);
+	CU_ASSERT_EQUAL(stats.packed, 1);
+
+	/* Every instance is sent once disabled */
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_set_cmd_coalescing(itf,
+			&s_loop_noack_desc, 0), 0);
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_batch_begin(itf), 0);
+	for (i = 10; i < 13; i++)
+		CU_ASSERT_EQUAL(loop_send(&s_loop_noack_desc, i, 10, 0), 0);
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_batch_end(itf), 0);
+	loop_run(14, 1000);
+
+	CU_ASSERT_EQUAL_FATAL(s_loop.recv_cnt, 14);
+	for (i = 11; i < 14; i++)
+		CU_ASSERT_EQUAL(s_loop.recv[i].idx, i - 1);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_NON_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.coalesced, 9);
+
+	loop_stop();
+}
+
+static void test_cmd_itf_loop_coalesce(void)
+{
+	test_coalesce(2);
+	test_coalesce(3);
+}
+
+static void test_watermarks(uint32_t proto_v)
+{
+	struct arsdk_cmd_itf_queue_stats stats;
+	uint32_t i;
+
+	TST_LOG("%s v%u", __func__, proto_v);
+
+	loop_start(proto_v, 0, 1);
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_set_queue_watermarks(
+			s_loop.itfs[LOOP_SENDER], ARSDK_CMD_BUFFER_TYPE_ACK,
+			4, 1), 0);
+
+	/* Refused once the high watermark is reached */
+	for (i = 0; i < 4; i++)
+		CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, i, 10, 0), 0);
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 4, 10, 0), -EAGAIN);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.queued, 4);
+	CU_ASSERT_EQUAL(s_loop.drained_cnt, 0);
+
+	/* Other queues are not bounded */
+	for (i = 0; i < 8; i++)
+		CU_ASSERT_EQUAL(loop_send(&s_loop_lowprio_desc, i, 10, 0), 0);
+
+	/* Notified once drained down to the low watermark */
+	loop_run(12, 1000);
+	CU_ASSERT_EQUAL(s_loop.recv_cnt, 12);
+	CU_ASSERT_EQUAL(s_loop.drained_cnt, 1);
+	CU_ASSERT_EQUAL(s_loop.drained_type, ARSDK_CMD_BUFFER_TYPE_ACK);
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 4, 10, 0), 0);
+	loop_run(13, 1000);
+	CU_ASSERT_EQUAL(s_loop.recv_cnt, 13);
+
+	/* No drain notified without a refusal */
+	CU_ASSERT_EQUAL(s_loop.drained_cnt, 1);
+
+	loop_stop();
+}
+
+static void test_cmd_itf_loop_watermarks(void)
+{
+	test_watermarks(2);
+	test_watermarks(3);
+}
+
+static int loop_filter_drop_sender(const struct loop_dgram *dgram)
+{
+	return dgram->from != LOOP_SENDER;
+}
+
+static void test_cmd_itf_loop_cc_gate(void)
+{
+	struct arsdk_cmd_itf_queue_stats stats;
+	size_t i;
+
+	TST_LOG_FUNC();
+
+	loop_start(3, 0, 1);
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_set_congestion_control(
+			s_loop.itfs[LOOP_SENDER], 1), 0);
+
+	/* The first acknowledgement opens the tx window */
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 0, 10, 0), 0);
+	loop_run(1, 1000);
+	loop_pump();
+	CU_ASSERT_EQUAL_FATAL(s_loop.recv_cnt, 1);
+
+	/* Commands filling a pack each, never acknowledged: only the packs
+	   fitting in the congestion window are built, the other commands
+	   stay queued and expire */
+	s_loop.filter = &loop_filter_drop_sender;
+	for (i = 1; i <= 12; i++)
+		CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, i, 900, 300), 0);
+	loop_wait(1000);
+	loop_pump();
+
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.packed + stats.expired, 13);
+	/* The window may have grown by a pack with the first
+	   acknowledgement */
+	CU_ASSERT(stats.packed - 1 <= ARSDK_CMD_ITF_CC_INIT_PACKS + 1);
+	CU_ASSERT_EQUAL(s_loop.status_cnt[ARSDK_CMD_ITF_CMD_SEND_STATUS_EXPIRED],
+			stats.expired);
+
+	loop_stop();
+}
+
+static void test_cc_loss(uint32_t proto_v)
+{
+	struct arsdk_cmd_itf_queue_stats stats;
+	uint32_t pack_max_size = proto_v > 2 ? 1000 : 1400;
+	uint32_t window;
+	size_t i;
+
+	TST_LOG("%s v%u", __func__, proto_v);
+
+	loop_start(proto_v, 0, 1);
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_set_congestion_control(
+			s_loop.itfs[LOOP_SENDER], 1), 0);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.cc_window,
+			ARSDK_CMD_ITF_CC_INIT_PACKS * pack_max_size);
+
+	/* Grows while the packs are acknowledged */
+	for (i = 0; i < 8; i++) {
+		CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, i, 10, 0), 0);
+		loop_run(i + 1, 1000);
+		loop_pump();
+	}
+	CU_ASSERT_EQUAL_FATAL(s_loop.recv_cnt, 8);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	window = stats.cc_window;
+	CU_ASSERT(window > ARSDK_CMD_ITF_CC_INIT_PACKS * pack_max_size);
+
+	/* Halved by the first retry */
+	s_loop.filter = &loop_filter_drop_sender;
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 8, 10, 0), 0);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	while (stats.retried == 0) {
+		loop_wait(1);
+		loop_pump();
+		loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	}
+	CU_ASSERT_EQUAL(stats.cc_window, window / 2);
+
+	/* Down to its minimum while the losses last */
+	loop_wait(5000);
+	loop_pump();
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.cc_window,
+			ARSDK_CMD_ITF_CC_MIN_PACKS * pack_max_size);
+
+	/* Grows again once the link recovers */
+	s_loop.filter = NULL;
+	loop_run(9, 3000);
+	CU_ASSERT_EQUAL(s_loop.recv_cnt, 9);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT(stats.cc_window > ARSDK_CMD_ITF_CC_MIN_PACKS * pack_max_size);
+
+	loop_stop();
+}
+
+static void test_cmd_itf_loop_cc_loss(void)
+{
+	test_cc_loss(2);
+	test_cc_loss(3);
+}
+
+/**
+ * Sends the commands given to the sender, one pack each, and takes its
+ * data datagrams without delivering them.
+ */
+static void loop_send_packs(struct loop_dgram *dgrams, size_t count,
+		uint32_t first_idx)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, first_idx + i,
+				900, 0), 0);
+	}
+	loop_wait(1);
+
+	CU_ASSERT_EQUAL_FATAL(s_loop.dgram_cnt, count);
+	for (i = 0; i < count; i++) {
+		dgrams[i] = loop_take(0);
+		CU_ASSERT_EQUAL(dgrams[i].from, LOOP_SENDER);
+		CU_ASSERT_EQUAL(dgrams[i].header.type,
+				ARSDK_TRANSPORT_DATA_TYPE_WITHACK);
+	}
+}
+
+/**
+ * Takes the acknowledgement sent by the receiver, gets its sequence number
+ * and its bitmap of the packs kept out of order, '0' if none, and delivers
+ * it to the sender if requested.
+ *
+ * @return the flags of the acknowledgement.
+ */
+static uint8_t loop_take_ack(uint16_t *seq, uint16_t *sack, int deliver)
+{
+	struct loop_dgram dgram;
+	uint8_t flags;
+
+	CU_ASSERT_EQUAL_FATAL(s_loop.dgram_cnt, 1);
+	dgram = loop_take(0);
+	CU_ASSERT_EQUAL(dgram.from, LOOP_RECEIVER);
+	CU_ASSERT_EQUAL(dgram.header.type, ARSDK_TRANSPORT_DATA_TYPE_ACK);
+	CU_ASSERT_FATAL(dgram.len >= 3);
+
+	*seq = (uint16_t)(dgram.data[0] | (dgram.data[1] << 8));
+	flags = dgram.data[2];
+	*sack = dgram.len >= 5 ?
+			(uint16_t)(dgram.data[3] | (dgram.data[4] << 8)) : 0;
+	if (deliver)
+		loop_deliver(&dgram);
+	free(dgram.data);
+	return flags;
+}
+
+static void test_cmd_itf_loop_reorder(void)
+{
+	struct loop_dgram dgrams[3];
+	uint16_t seq, sack, first_seq;
+	size_t i;
+
+	TST_LOG_FUNC();
+
+	loop_start(3, 0, 1);
+
+	/* The first acknowledgement opens the tx window */
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 0, 10, 0), 0);
+	loop_run(1, 1000);
+	loop_pump();
+	CU_ASSERT_EQUAL_FATAL(s_loop.recv_cnt, 1);
+	memset(s_loop.pack_recv_cnt, 0, sizeof(s_loop.pack_recv_cnt));
+
+	/* Three packs in flight, received in reverse order */
+	loop_send_packs(dgrams, 3, 1);
+	first_seq = dgrams[0].header.seq;
+
+	loop_deliver(&dgrams[2]);
+	loop_take_ack(&seq, &sack, 0);
+	CU_ASSERT_EQUAL(seq, (uint16_t)(first_seq - 1));
+	CU_ASSERT_EQUAL(sack, 0x4);
+
+	loop_deliver(&dgrams[1]);
+	loop_take_ack(&seq, &sack, 0);
+	CU_ASSERT_EQUAL(seq, (uint16_t)(first_seq - 1));
+	CU_ASSERT_EQUAL(sack, 0x6);
+
+	/* Held until the missing pack is received */
+	CU_ASSERT_EQUAL(s_loop.recv_cnt, 1);
+	CU_ASSERT_EQUAL(
+		s_loop.pack_recv_cnt[ARSDK_CMD_ITF_PACK_RECV_STATUS_HELD], 2);
+
+	/* Processed in order, acknowledged at once */
+	loop_deliver(&dgrams[0]);
+	loop_take_ack(&seq, &sack, 0);
+	CU_ASSERT_EQUAL(seq, (uint16_t)(first_seq + 2));
+	CU_ASSERT_EQUAL(sack, 0);
+
+	CU_ASSERT_EQUAL_FATAL(s_loop.recv_cnt, 4);
+	for (i = 0; i < 4; i++)
+		CU_ASSERT_EQUAL(s_loop.recv[i].idx, i);
+
+	for (i = 0; i < 3; i++)
+		free(dgrams[i].data);
+	loop_stop();
+}
+
+static void test_cmd_itf_loop_cumulative_ack(void)
+{
+	struct arsdk_cmd_itf_queue_stats stats;
+	struct arsdk_cmd cmd;
+	struct loop_dgram dgrams[4];
+	uint16_t seq, sack, first_seq;
+	uint8_t flags;
+	uint64_t acked;
+	size_t i, sent_first;
+	int res;
+
+	TST_LOG_FUNC();
+
+	loop_start(3, 0, 1);
+
+	/* The receiver learns from the acknowledgements of the sender that
+	   it handles the cumulative ones */
+	arsdk_cmd_init(&cmd);
+	res = arsdk_cmd_enc(&cmd, &s_loop_ack_desc, 0, "");
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	cmd.buffer_type = s_loop_ack_desc.buffer_type;
+	res = arsdk_cmd_itf_send(s_loop.itfs[LOOP_RECEIVER], &cmd, NULL, NULL);
+	CU_ASSERT_EQUAL(res, 0);
+	arsdk_cmd_clear(&cmd);
+	loop_pump();
+
+	/* The first acknowledgement opens the tx window, once delayed */
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 0, 10, 0), 0);
+	loop_pump();
+	CU_ASSERT_EQUAL(s_loop.recv_cnt, 1);
+	CU_ASSERT_EQUAL(s_loop.dgram_cnt, 0);
+	loop_wait(ARSDK_CMD_ITF3_ACK_DELAY_MS);
+	flags = loop_take_ack(&seq, &sack, 1);
+	CU_ASSERT_EQUAL(flags, ARSDK_CMD_ITF3_ACK_FLAG_IN_ORDER |
+			ARSDK_CMD_ITF3_ACK_FLAG_CUMULATIVE);
+	CU_ASSERT_EQUAL(sack, 0);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.acked, 1);
+
+	/* Packs received in order acknowledged two at once */
+	loop_send_packs(dgrams, 4, 1);
+	first_seq = dgrams[0].header.seq;
+
+	loop_deliver(&dgrams[0]);
+	CU_ASSERT_EQUAL(s_loop.dgram_cnt, 0);
+	loop_deliver(&dgrams[1]);
+	loop_take_ack(&seq, &sack, 1);
+	CU_ASSERT_EQUAL(seq, (uint16_t)(first_seq + 1));
+	CU_ASSERT_EQUAL(sack, 0);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.acked, 3);
+
+	/* A single one once the delay is passed */
+	loop_deliver(&dgrams[2]);
+	CU_ASSERT_EQUAL(s_loop.dgram_cnt, 0);
+	loop_wait(ARSDK_CMD_ITF3_ACK_DELAY_MS);
+	loop_take_ack(&seq, &sack, 1);
+	CU_ASSERT_EQUAL(seq, (uint16_t)(first_seq + 2));
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.acked, 4);
+
+	/* A pack out of order is acknowledged at once by the bitmap, the
+	   sender does not send it again */
+	acked = stats.acked;
+	loop_deliver(&dgrams[3]);
+	for (i = 0; i < 4; i++)
+		free(dgrams[i].data);
+	loop_wait(ARSDK_CMD_ITF3_ACK_DELAY_MS);
+	loop_take_ack(&seq, &sack, 1);
+	CU_ASSERT_EQUAL(seq, (uint16_t)(first_seq + 3));
+
+	loop_send_packs(dgrams, 3, 5);
+	first_seq = dgrams[0].header.seq;
+	loop_deliver(&dgrams[2]);
+	loop_take_ack(&seq, &sack, 1);
+	CU_ASSERT_EQUAL(seq, (uint16_t)(first_seq - 1));
+	CU_ASSERT_EQUAL(sack, 0x4);
+	for (i = 0; i < 3; i++)
+		free(dgrams[i].data);
+
+	s_loop.filter = &loop_filter_drop_sender;
+	sent_first = s_loop.sent_log_cnt;
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	while (stats.retried < 2) {
+		loop_wait(1);
+		loop_pump();
+		loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	}
+	s_loop.filter = NULL;
+	CU_ASSERT_EQUAL(s_loop.sent_log_cnt - sent_first, 2);
+	for (i = sent_first; i < s_loop.sent_log_cnt; i++) {
+		CU_ASSERT_NOT_EQUAL(s_loop.sent[i].seq,
+				(uint16_t)(first_seq + 2));
+	}
+	CU_ASSERT_EQUAL(stats.acked, acked + 1);
+
+	/* Released in order once the missing packs are received */
+	loop_run(8, 3000);
+	loop_wait(ARSDK_CMD_ITF3_ACK_DELAY_MS);
+	loop_pump();
+	CU_ASSERT_EQUAL_FATAL(s_loop.recv_cnt, 8);
+	for (i = 0; i < 8; i++)
+		CU_ASSERT_EQUAL(s_loop.recv[i].idx, i);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.acked, 8);
+	CU_ASSERT_EQUAL(stats.depth, 0);
+
+	loop_stop();
+}
+
+/**
+ * Delivers to the sender the acknowledgement of a peer not knowing the
+ * flags, only made of the sequence number.
+ */
+static void loop_deliver_legacy_ack(uint16_t seq)
+{
+	struct loop_dgram dgram;
+	uint8_t data[2];
+
+	data[0] = (uint8_t)(seq & 0xff);
+	data[1] = (uint8_t)(seq >> 8);
+
+	memset(&dgram, 0, sizeof(dgram));
+	dgram.from = LOOP_RECEIVER;
+	dgram.header.type = ARSDK_TRANSPORT_DATA_TYPE_ACK;
+	dgram.header.id = ARSDK_TRANSPORT_ID_D2C_CMD_WITHACK +
+			ARSDK_TRANSPORT_ID_ACKOFF;
+	dgram.data = data;
+	dgram.len = sizeof(data);
+	loop_deliver(&dgram);
+}
+
+static void test_cmd_itf_loop_legacy_ack(void)
+{
+	struct arsdk_cmd_itf_queue_stats stats;
+	struct loop_dgram dgram;
+	uint16_t seq;
+	size_t i;
+
+	TST_LOG_FUNC();
+
+	/* Without receiver, the acknowledgements are made by the test */
+	loop_start(3, 0, 0);
+
+	for (i = 0; i < 3; i++)
+		CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, i, 900, 0), 0);
+
+	/* Each pack waits for the acknowledgement of the previous one */
+	for (i = 0; i < 3; i++) {
+		loop_wait(1);
+		CU_ASSERT_EQUAL_FATAL(s_loop.dgram_cnt, 1);
+		dgram = loop_take(0);
+		seq = dgram.header.seq;
+		free(dgram.data);
+
+		loop_deliver_legacy_ack(seq);
+		loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+		CU_ASSERT_EQUAL(stats.acked, i + 1);
+		CU_ASSERT_EQUAL(stats.retried, 0);
+	}
+
+	CU_ASSERT_EQUAL(s_loop.status_cnt[ARSDK_CMD_ITF_CMD_SEND_STATUS_ACK_RECEIVED],
+			3);
+	CU_ASSERT_EQUAL(stats.depth, 0);
+
+	loop_stop();
+}
+
+static void test_ttl(uint32_t proto_v, int queue_ttl)
+{
+	struct arsdk_cmd_itf_queue_stats stats;
+	uint32_t ttl_ms = queue_ttl ? 0 : 100;
+	size_t i;
+
+	TST_LOG("%s v%u queue_ttl:%d", __func__, proto_v, queue_ttl);
+
+	loop_start(proto_v, 0, 1);
+	if (queue_ttl) {
+		CU_ASSERT_EQUAL(arsdk_cmd_itf_set_queue_ttl(
+				s_loop.itfs[LOOP_SENDER],
+				ARSDK_CMD_BUFFER_TYPE_ACK, 100), 0);
+	}
+
+	/* The first pack is never acknowledged, the commands behind it wait
+	   in the queue */
+	s_loop.filter = &loop_filter_drop_sender;
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 0, 10, ttl_ms), 0);
+	loop_wait(1);
+	for (i = 1; i <= 5; i++)
+		CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, i, 10, ttl_ms), 0);
+
+	/* Without limit, or with a limit longer than the queue one */
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 6, 10,
+			queue_ttl ? 2000 : 0), 0);
+
+	loop_wait(500);
+	loop_pump();
+
+	/* The packed command is still retried */
+	CU_ASSERT_EQUAL(s_loop.status_cnt[ARSDK_CMD_ITF_CMD_SEND_STATUS_EXPIRED],
+			5);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.expired, 5);
+	CU_ASSERT_EQUAL(stats.packed, 1);
+	CU_ASSERT(stats.retried > 0);
+	CU_ASSERT_EQUAL(stats.depth, 2);
+
+	loop_stop();
+}
+
+static void test_cmd_itf_loop_ttl(void)
+{
+	test_ttl(2, 0);
+	test_ttl(3, 0);
+	test_ttl(2, 1);
+	test_ttl(3, 1);
+}
+
+static void test_sched_priority(uint32_t proto_v)
+{
+	struct arsdk_cmd_itf_queue_sched sched = {
+		.priority = 2,
+		.weight = 1,
+	};
+	size_t i;
+
+	TST_LOG("%s v%u", __func__, proto_v);
+
+	loop_start(proto_v, 0, 0);
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_set_tx_budget(s_loop.itfs[LOOP_SENDER],
+			1000), 0);
+	/* After the low priority commands */
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_set_queue_sched(s_loop.itfs[LOOP_SENDER],
+			ARSDK_CMD_BUFFER_TYPE_NON_ACK, &sched), 0);
+
+	/* Use the budget of the tick */
+	CU_ASSERT_EQUAL(loop_send(&s_loop_noack_desc, 0, 900, 0), 0);
+	CU_ASSERT_EQUAL(loop_send(&s_loop_noack_desc, 1, 900, 0), 0);
+	CU_ASSERT_EQUAL_FATAL(s_loop.sent_log_cnt, 2);
+
+	/* Wait for the next tick, then served by priority level */
+	CU_ASSERT_EQUAL(loop_send(&s_loop_noack_desc, 2, 10, 0), 0);
+	CU_ASSERT_EQUAL(loop_send(&s_loop_lowprio_desc, 3, 10, 0), 0);
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 4, 10, 0), 0);
+	CU_ASSERT_EQUAL(s_loop.sent_log_cnt, 2);
+
+	loop_wait(ARSDK_CMD_ITF_SCHED_TICK_MS);
+	CU_ASSERT_EQUAL_FATAL(s_loop.sent_log_cnt, 5);
+	CU_ASSERT_EQUAL(s_loop.sent[2].id, ARSDK_TRANSPORT_ID_D2C_CMD_WITHACK);
+	CU_ASSERT_EQUAL(s_loop.sent[3].id, ARSDK_TRANSPORT_ID_D2C_CMD_LOWPRIO);
+	CU_ASSERT_EQUAL(s_loop.sent[4].id, ARSDK_TRANSPORT_ID_D2C_CMD_NOACK);
+	for (i = 2; i < 5; i++) {
+		CU_ASSERT_EQUAL(s_loop.sent[i].ms - s_loop.sent[0].ms,
+				ARSDK_CMD_ITF_SCHED_TICK_MS);
+	}
+
+	loop_stop();
+}
+
+/**
+ * Checks the bytes sent from an entry of the log of the sender, tick by
+ * tick: only the last pack of a tick may exceed the budget, the excess is
+ * paid back in the next tick.
+ *
+ * @return the count of ticks.
+ */
+static size_t loop_check_tick_budget(size_t first, uint32_t budget,
+		uint32_t pack_max_size)
+{
+	size_t i, tick_cnt = 0;
+	uint64_t tick_ms = 0, tick_bytes = 0, total_bytes = 0;
+
+	for (i = first; i < s_loop.sent_log_cnt; i++) {
+		if (tick_cnt == 0 || s_loop.sent[i].ms != tick_ms) {
+			tick_ms = s_loop.sent[i].ms;
+			tick_bytes = 0;
+			tick_cnt++;
+		}
+		tick_bytes += s_loop.sent[i].len;
+		total_bytes += s_loop.sent[i].len;
+		CU_ASSERT(tick_bytes <= budget + pack_max_size);
+		CU_ASSERT(total_bytes <= tick_cnt * budget + pack_max_size);
+	}
+	return tick_cnt;
+}
+
+static void test_sched_budget(uint32_t proto_v)
+{
+	struct arsdk_cmd_itf_queue_sched sched = {
+		.priority = 0,
+		.weight = 1,
+		.budget = 2000,
+	};
+	uint32_t pack_max_size = proto_v > 2 ? 1000 : 1400;
+	size_t i;
+
+	TST_LOG("%s v%u", __func__, proto_v);
+
+	loop_start(proto_v, 0, 0);
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_set_queue_sched(s_loop.itfs[LOOP_SENDER],
+			ARSDK_CMD_BUFFER_TYPE_NON_ACK, &sched), 0);
+
+	/* One command per pack */
+	for (i = 0; i < 10; i++)
+		CU_ASSERT_EQUAL(loop_send(&s_loop_noack_desc, i, 900, 0), 0);
+	loop_wait(20 * ARSDK_CMD_ITF_SCHED_TICK_MS);
+
+	CU_ASSERT_EQUAL_FATAL(s_loop.sent_log_cnt, 10);
+	CU_ASSERT(loop_check_tick_budget(0, sched.budget, pack_max_size) >=
+			10 * 900 / sched.budget);
+
+	loop_stop();
+}
+
+static void test_sched_weights(void)
+{
+	struct arsdk_cmd_itf_queue_sched sched = {
+		.priority = 0,
+		.weight = 3,
+	};
+	uint32_t budget = 8000;
+	size_t i, first;
+	uint64_t last_ack_ms = 0, ack_bytes = 0, noack_bytes = 0;
+
+	TST_LOG_FUNC();
+
+	loop_start(3, 0, 1);
+
+	/* The first acknowledgement opens the tx window */
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 0, 10, 0), 0);
+	loop_run(1, 1000);
+	loop_pump();
+
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_set_tx_budget(s_loop.itfs[LOOP_SENDER],
+			budget), 0);
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_set_queue_sched(s_loop.itfs[LOOP_SENDER],
+			ARSDK_CMD_BUFFER_TYPE_NON_ACK, &sched), 0);
+
+	/* Use the budget of the tick, then fill both queues */
+	for (i = 0; i < 9; i++)
+		CU_ASSERT_EQUAL(loop_send(&s_loop_noack_desc, i, 900, 0), 0);
+	loop_pump();
+	first = s_loop.sent_log_cnt;
+	for (i = 0; i < 8; i++)
+		CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, i, 900, 0), 0);
+	for (i = 0; i < 24; i++)
+		CU_ASSERT_EQUAL(loop_send(&s_loop_noack_desc, i, 900, 0), 0);
+	CU_ASSERT_EQUAL(s_loop.sent_log_cnt, first);
+
+	while (s_loop.recv_cnt < 1 + 9 + 8 + 24 &&
+	       s_loop.sent_log_cnt - first < 64) {
+		loop_wait(ARSDK_CMD_ITF_SCHED_TICK_MS);
+		loop_pump();
+	}
+	CU_ASSERT_EQUAL_FATAL(s_loop.recv_cnt, 1 + 9 + 8 + 24);
+	loop_check_tick_budget(first, budget, 1000);
+
+	/* The budget is shared in proportion to the weights while both
+	   queues have commands to send, until the tick the acknowledged one
+	   is drained */
+	for (i = first; i < s_loop.sent_log_cnt; i++) {
+		if (s_loop.sent[i].id == ARSDK_TRANSPORT_ID_D2C_CMD_WITHACK)
+			last_ack_ms = s_loop.sent[i].ms;
+	}
+	for (i = first; i < s_loop.sent_log_cnt &&
+			s_loop.sent[i].ms < last_ack_ms; i++) {
+		if (s_loop.sent[i].id == ARSDK_TRANSPORT_ID_D2C_CMD_WITHACK)
+			ack_bytes += s_loop.sent[i].len;
+		else
+			noack_bytes += s_loop.sent[i].len;
+	}
+	CU_ASSERT(ack_bytes > 0);
+	CU_ASSERT(noack_bytes > 2 * ack_bytes);
+	CU_ASSERT(noack_bytes < 4 * ack_bytes);
+
+	loop_stop();
+}
+
+static void test_cmd_itf_loop_sched(void)
+{
+	test_sched_priority(2);
+	test_sched_priority(3);
+	test_sched_budget(2);
+	test_sched_budget(3);
+	test_sched_weights();
+}
+
+static int loop_periodic_fill(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd_desc *desc,
+		struct arsdk_cmd *cmd,
+		void *userdata)
+{
+	uint32_t *idx = userdata;
+	int res;
+
+	if (desc == &g_arsdk_cmd_desc_Ardrone3_Piloting_PCMD) {
+		return arsdk_cmd_enc_Ardrone3_Piloting_PCMD(cmd, 1, -10, 0, 0,
+				20, (*idx)++);
+	}
+
+	res = arsdk_cmd_enc(cmd, desc, (*idx)++, "");
+	/* The test commands are not in the generated tables */
+	cmd->buffer_type = desc->buffer_type;
+	return res;
+}
+
+static void test_periodic(uint32_t proto_v)
+{
+	uint32_t noack_idx = 0, pcmd_idx = 0;
+	size_t i;
+
+	TST_LOG("%s v%u", __func__, proto_v);
+
+	loop_start(proto_v, 0, 1);
+
+	/* Due together every other period of the first one */
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_periodic_add(s_loop.itfs[LOOP_SENDER],
+			&s_loop_noack_desc, 20, &loop_periodic_fill,
+			&noack_idx), 0);
+	loop_wait(ARSDK_CMD_ITF_PERIODIC_SLACK_MS - 1);
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_periodic_add(s_loop.itfs[LOOP_SENDER],
+			&g_arsdk_cmd_desc_Ardrone3_Piloting_PCMD, 40,
+			&loop_periodic_fill, &pcmd_idx), 0);
+
+	loop_wait(210);
+	CU_ASSERT_EQUAL(noack_idx, 10);
+	CU_ASSERT_EQUAL(pcmd_idx, 5);
+
+	/* Sent in the same packs */
+	CU_ASSERT_EQUAL(s_loop.sent_cnt[ARSDK_TRANSPORT_DATA_TYPE_NOACK], 10);
+	for (i = 1; i < s_loop.sent_log_cnt; i++) {
+		CU_ASSERT(s_loop.sent[i].ms - s_loop.sent[i - 1].ms >=
+				20 - ARSDK_CMD_ITF_PERIODIC_SLACK_MS);
+	}
+
+	loop_pump();
+	CU_ASSERT_EQUAL(s_loop.recv_cnt, 15);
+
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_periodic_remove(s_loop.itfs[LOOP_SENDER],
+			&s_loop_noack_desc), 0);
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_periodic_remove(s_loop.itfs[LOOP_SENDER],
+			&g_arsdk_cmd_desc_Ardrone3_Piloting_PCMD), 0);
+	loop_stop();
+}
+
+static void test_cmd_itf_loop_periodic(void)
+{
+	test_periodic(2);
+	test_periodic(3);
+}
+
+static uint32_t loop_histo_count(const struct arsdk_cmd_itf_histo *histo)
+{
+	uint32_t count = 0;
+	size_t i;
+
+	for (i = 0; i < ARSDK_CMD_ITF_HISTO_BUCKET_COUNT; i++)
+		count += histo->buckets[i];
+	return count;
+}
+
+static void test_karn(uint32_t proto_v)
+{
+	struct arsdk_cmd_itf_queue_stats stats;
+
+	TST_LOG("%s v%u", __func__, proto_v);
+
+	loop_start(proto_v, 0, 1);
+
+	/* Sampled once acknowledged */
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 0, 10, 0), 0);
+	loop_run(1, 1000);
+	loop_pump();
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT_EQUAL(loop_histo_count(&stats.ack_rtt), 1);
+
+	/* Not sampled once sent again, the acknowledgement may be the one
+	   of the first sending */
+	s_loop.filter = &loop_filter_drop_sender;
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 1, 10, 0), 0);
+	do {
+		loop_wait(1);
+		loop_pump();
+		loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	} while (stats.retried == 0);
+	s_loop.filter = NULL;
+	loop_run(2, 3000);
+	CU_ASSERT_EQUAL(s_loop.recv_cnt, 2);
+
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.acked, 2);
+	CU_ASSERT_EQUAL(loop_histo_count(&stats.ack_rtt), 1);
+
+	loop_stop();
+}
+
+static void test_cmd_itf_loop_karn(void)
+{
+	test_karn(2);
+	test_karn(3);
+}
+
+static void loop_timer_cb(struct pomp_timer *timer, void *userdata)
+{
+}
+
+static void test_cmd_itf_loop_timer_update(void)
+{
+	struct pomp_timer *timer;
+	struct timespec tsnow;
+	uint64_t now_us, expire_us = 0;
+
+	TST_LOG_FUNC();
+
+	loop_start(3, 0, 0);
+	timer = pomp_timer_new(s_loop.loop, &loop_timer_cb, NULL);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(timer);
+	clock_gettime(CLOCK_MONOTONIC, &tsnow);
+	now_us = (uint64_t)tsnow.tv_sec * 1000000 +
+			(uint64_t)tsnow.tv_nsec / 1000;
+
+	/* Set by the check of all the queues */
+	arsdk_cmd_itf_timer_update(timer, &expire_us, &tsnow, 100, 1);
+	CU_ASSERT_EQUAL(expire_us, now_us + 100000);
+
+	/* Only brought forward by the check of a single queue */
+	arsdk_cmd_itf_timer_update(timer, &expire_us, &tsnow, 200, 0);
+	CU_ASSERT_EQUAL(expire_us, now_us + 100000);
+	arsdk_cmd_itf_timer_update(timer, &expire_us, &tsnow, -1, 0);
+	CU_ASSERT_EQUAL(expire_us, now_us + 100000);
+	arsdk_cmd_itf_timer_update(timer, &expire_us, &tsnow, 50, 0);
+	CU_ASSERT_EQUAL(expire_us, now_us + 50000);
+
+	/* Delayed or cleared by the check of all the queues */
+	arsdk_cmd_itf_timer_update(timer, &expire_us, &tsnow, 200, 1);
+	CU_ASSERT_EQUAL(expire_us, now_us + 200000);
+	arsdk_cmd_itf_timer_update(timer, &expire_us, &tsnow, -1, 1);
+	CU_ASSERT_EQUAL(expire_us, 0);
+
+	/* Set by the check of a single queue once cleared */
+	arsdk_cmd_itf_timer_update(timer, &expire_us, &tsnow, 300, 0);
+	CU_ASSERT_EQUAL(expire_us, now_us + 300000);
+
+	pomp_timer_destroy(timer);
+	loop_stop();
+}
+
+static void test_retry_deadlines(uint32_t proto_v)
+{
+	struct arsdk_cmd_itf_queue_stats stats;
+	uint64_t ack_ms, lowprio_ms;
+	size_t i, ack_retry = 0, lowprio_retry = 0;
+
+	TST_LOG("%s v%u", __func__, proto_v);
+
+	/* Without receiver, the packs are never acknowledged */
+	loop_start(proto_v, 0, 0);
+
+	/* The second queue checked alone, with a later retry deadline */
+	CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, 0, 10, 0), 0);
+	loop_wait(100);
+	CU_ASSERT_EQUAL(loop_send(&s_loop_lowprio_desc, 1, 10, 0), 0);
+	loop_wait(1000);
+
+	CU_ASSERT_FATAL(s_loop.sent_log_cnt >= 4);
+	CU_ASSERT_EQUAL(s_loop.sent[0].id, ARSDK_TRANSPORT_ID_D2C_CMD_WITHACK);
+	CU_ASSERT_EQUAL(s_loop.sent[1].id, ARSDK_TRANSPORT_ID_D2C_CMD_LOWPRIO);
+	ack_ms = s_loop.sent[0].ms;
+	lowprio_ms = s_loop.sent[1].ms;
+	CU_ASSERT_EQUAL(lowprio_ms, ack_ms + 100);
+
+	for (i = 2; i < s_loop.sent_log_cnt; i++) {
+		if (s_loop.sent[i].id == ARSDK_TRANSPORT_ID_D2C_CMD_WITHACK &&
+		    ack_retry == 0)
+			ack_retry = i;
+		else if (s_loop.sent[i].id ==
+				ARSDK_TRANSPORT_ID_D2C_CMD_LOWPRIO &&
+			 lowprio_retry == 0)
+			lowprio_retry = i;
+	}
+
+	/* The first deadline is kept, the second one is not lost */
+	CU_ASSERT_EQUAL_FATAL(ack_retry, 2);
+	CU_ASSERT_EQUAL(s_loop.sent[ack_retry].ms,
+			ack_ms + s_loop_tx_info_table[0].ack_timeout_ms);
+	CU_ASSERT_FATAL(lowprio_retry != 0);
+	CU_ASSERT(s_loop.sent[lowprio_retry].ms >=
+			lowprio_ms + s_loop_tx_info_table[2].ack_timeout_ms);
+
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats);
+	CU_ASSERT(stats.retried > 0);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_LOW_PRIO, &stats);
+	CU_ASSERT(stats.retried > 0);
+
+	loop_stop();
+}
+
+static void test_cmd_itf_loop_retry_deadlines(void)
+{
+	test_retry_deadlines(2);
+	test_retry_deadlines(3);
+}
+
+/**
+ * Sends commands to the acknowledged and non-acknowledged queues, in a batch
+ * or not, then gets the statistics and the bytes sent of both queues.
+ */
+static void loop_send_burst(uint32_t proto_v, int batch,
+		struct arsdk_cmd_itf_queue_stats stats[2], size_t bytes[2])
+{
+	static const uint8_t ids[2] = {
+		ARSDK_TRANSPORT_ID_D2C_CMD_WITHACK,
+		ARSDK_TRANSPORT_ID_D2C_CMD_NOACK,
+	};
+	uint32_t i;
+	size_t j;
+
+	loop_start(proto_v, 0, 1);
+
+	if (batch)
+		CU_ASSERT_EQUAL(arsdk_cmd_itf_batch_begin(
+				s_loop.itfs[LOOP_SENDER]), 0);
+	for (i = 0; i < 16; i++) {
+		CU_ASSERT_EQUAL(loop_send(&s_loop_ack_desc, i, 20, 0), 0);
+		CU_ASSERT_EQUAL(loop_send(&s_loop_noack_desc, i, 20, 0), 0);
+	}
+	if (batch) {
+		/* Nothing sent before the end of the batch */
+		CU_ASSERT_EQUAL(s_loop.sent_log_cnt, 0);
+		CU_ASSERT_EQUAL(arsdk_cmd_itf_batch_end(
+				s_loop.itfs[LOOP_SENDER]), 0);
+	}
+	loop_run(32, 1000);
+	CU_ASSERT_EQUAL(s_loop.recv_cnt, 32);
+
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_ACK, &stats[0]);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_NON_ACK, &stats[1]);
+	for (i = 0; i < 2; i++) {
+		CU_ASSERT_EQUAL(stats[i].packed, 16);
+		CU_ASSERT_EQUAL(stats[i].retried, 0);
+		bytes[i] = 0;
+		for (j = 0; j < s_loop.sent_log_cnt; j++) {
+			if (s_loop.sent[j].id == ids[i])
+				bytes[i] += s_loop.sent[j].len;
+		}
+	}
+
+	loop_stop();
+}
+
+static void test_batch(uint32_t proto_v)
+{
+	struct arsdk_cmd_itf_queue_stats plain[2], batch[2];
+	size_t plain_bytes[2], batch_bytes[2];
+	size_t i;
+
+	TST_LOG("%s v%u", __func__, proto_v);
+
+	loop_send_burst(proto_v, 0, plain, plain_bytes);
+	loop_send_burst(proto_v, 1, batch, batch_bytes);
+
+	/* Fewer packs, each one fuller */
+	for (i = 0; i < 2; i++) {
+		CU_ASSERT_FATAL(batch[i].sent > 0);
+		CU_ASSERT(batch[i].sent < plain[i].sent);
+		CU_ASSERT_EQUAL(batch_bytes[i], plain_bytes[i]);
+		CU_ASSERT(batch_bytes[i] / batch[i].sent >
+				plain_bytes[i] / plain[i].sent);
+	}
+	/* All the non-acknowledged commands in a single pack */
+	CU_ASSERT_EQUAL(batch[1].sent, 1);
+}
+
+static void test_cmd_itf_loop_batch(void)
+{
+	test_batch(2);
+	test_batch(3);
+}
+
+static void test_pack_delay(uint32_t proto_v)
+{
+	struct arsdk_cmd_itf_queue_stats stats;
+	uint64_t start_ms;
+	uint32_t i;
+
+	TST_LOG("%s v%u", __func__, proto_v);
+
+	loop_start(proto_v, 256, 1);
+	CU_ASSERT_EQUAL(arsdk_cmd_itf_set_pack_delay(s_loop.itfs[LOOP_SENDER],
+			ARSDK_CMD_BUFFER_TYPE_NON_ACK, 5), 0);
+
+	/* Commands sent within the delay are held */
+	start_ms = loop_now_ms();
+	for (i = 0; i < 3; i++) {
+		CU_ASSERT_EQUAL(loop_send(&s_loop_noack_desc, i, 10, 0), 0);
+		loop_wait(1);
+	}
+	CU_ASSERT_EQUAL(s_loop.sent_log_cnt, 0);
+
+	/* Then leave in a single pack once the delay of the first one is
+	   passed */
+	loop_wait(2);
+	CU_ASSERT_EQUAL_FATAL(s_loop.sent_log_cnt, 1);
+	CU_ASSERT_EQUAL(s_loop.sent[0].ms - start_ms, 5);
+	loop_get_stats(ARSDK_CMD_BUFFER_TYPE_NON_ACK, &stats);
+	CU_ASSERT_EQUAL(stats.packed, 3);
+	CU_ASSERT_EQUAL(stats.sent, 1);
+	loop_run(3, 100);
+	CU_ASSERT_EQUAL_FATAL(s_loop.recv_cnt, 3);
+	for (i = 0; i < 3; i++)
+		CU_ASSERT_EQUAL(s_loop.recv[i].idx, i);
+
+	/* A full pack is not held, the remaining command waits for the
+	   delay */
+	start_ms = loop_now_ms();
+	for (i = 3; i < 6; i++)
+		CU_ASSERT_EQUAL(loop_send(&s_loop_noack_desc, i, 100, 0), 0);
+	CU_ASSERT_EQUAL_FATAL(s_loop.sent_log_cnt, 2);
+	CU_ASSERT_EQUAL(s_loop.sent[1].ms, start_ms);
+	loop_wait(5);
+	CU_ASSERT_EQUAL_FATAL(s_loop.sent_log_cnt, 3);
+	CU_ASSERT_EQUAL(s_loop.sent[2].ms - start_ms, 5);
+	loop_run(6, 100);
+	CU_ASSERT_EQUAL(s_loop.recv_cnt, 6);
+
+	loop_stop();
+}
+
+static void test_cmd_itf_loop_pack_delay(void)
+{
+	test_pack_delay(2);
+	test_pack_delay(3);
+}
+
+/* Disable some gcc warnings for test suite descriptions */
+#ifdef __GNUC__
+#  pragma GCC diagnostic ignored "-Wcast-qual"
+#endif /* __GNUC__ */
+
+/** */
+static CU_TestInfo s_cmd_itf_loop_tests[] = {
+	{(char *)"cmd_itf_loop_too_large", &test_cmd_itf_loop_too_large},
+	{(char *)"cmd_itf_loop_send_gen", &test_cmd_itf_loop_send_gen},
+	{(char *)"cmd_itf_loop_recv_keep", &test_cmd_itf_loop_recv_keep},
+	{(char *)"cmd_itf_loop_coalesce", &test_cmd_itf_loop_coalesce},
+	{(char *)"cmd_itf_loop_watermarks", &test_cmd_itf_loop_watermarks},
+	{(char *)"cmd_itf_loop_cc_gate", &test_cmd_itf_loop_cc_gate},
+	{(char *)"cmd_itf_loop_cc_loss", &test_cmd_itf_loop_cc_loss},
+	{(char *)"cmd_itf_loop_reorder", &test_cmd_itf_loop_reorder},
+	{(char *)"cmd_itf_loop_cumulative_ack",
+			&test_cmd_itf_loop_cumulative_ack},
+	{(char *)"cmd_itf_loop_legacy_ack", &test_cmd_itf_loop_legacy_ack},
+	{(char *)"cmd_itf_loop_ttl", &test_cmd_itf_loop_ttl},
+	{(char *)"cmd_itf_loop_sched", &test_cmd_itf_loop_sched},
+	{(char *)"cmd_itf_loop_periodic", &test_cmd_itf_loop_periodic},
+	{(char *)"cmd_itf_loop_karn", &test_cmd_itf_loop_karn},
+	{(char *)"cmd_itf_loop_timer_update", &test_cmd_itf_loop_timer_update},
+	{(char *)"cmd_itf_loop_retry_deadlines",
+			&test_cmd_itf_loop_retry_deadlines},
+	{(char *)"cmd_itf_loop_batch", &test_cmd_itf_loop_batch},
+	{(char *)"cmd_itf_loop_pack_delay", &test_cmd_itf_loop_pack_delay},
+	CU_TEST_INFO_NULL,
+};
+
+/** */
+/*extern*/ CU_SuiteInfo g_suites_cmd_itf_loop[] = {
+	{(char *)"cmd_itf_loop", NULL, NULL, s_cmd_itf_loop_tests},
+	CU_SUITE_INFO_NULL,
+};
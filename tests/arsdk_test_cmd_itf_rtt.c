@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdk_test.h"
+#include <time.h>
+#include <arsdk/internal/arsdk_internal.h>
+#include "cmd_itf/arsdk_cmd_itf_priv.h"
+
+#define LOG_TAG "arsdk_test_cmd_itf_rtt"
+#include "arsdk_test_log.h"
+
+/**
+ * Samples a round trip time, the acknowledgement received 'rtt_us' after
+ * the sending.
+ */
+static void rtt_sample_us(struct arsdk_cmd_itf_rtt *rtt, uint64_t rtt_us)
+{
+	struct timespec sent_ts = {
+		.tv_sec = 100,
+		.tv_nsec = 500000000,
+	};
+	struct timespec ack_ts;
+	uint64_t ack_ns = (uint64_t)sent_ts.tv_nsec + rtt_us * 1000;
+
+	ack_ts.tv_sec = sent_ts.tv_sec + (time_t)(ack_ns / 1000000000);
+	ack_ts.tv_nsec = (long)(ack_ns % 1000000000);
+	arsdk_cmd_itf_rtt_sample(rtt, &sent_ts, &ack_ts);
+}
+
+static void test_cmd_itf_rtt_init(void)
+{
+	struct arsdk_cmd_itf_rtt rtt;
+
+	TST_LOG_FUNC();
+
+	/* Timeout of the queue until the first sample, clamped */
+	arsdk_cmd_itf_rtt_init(&rtt, 150);
+	CU_ASSERT_EQUAL(rtt.rto_ms, 150);
+	CU_ASSERT_EQUAL(rtt.srtt_us, 0);
+	CU_ASSERT_EQUAL(rtt.rttvar_us, 0);
+
+	arsdk_cmd_itf_rtt_init(&rtt, 0);
+	CU_ASSERT_EQUAL(rtt.rto_ms, ARSDK_CMD_ITF_RTO_MIN_MS);
+
+	arsdk_cmd_itf_rtt_init(&rtt, 5000);
+	CU_ASSERT_EQUAL(rtt.rto_ms, ARSDK_CMD_ITF_RTO_MAX_MS);
+}
+
+static void test_cmd_itf_rtt_sample(void)
+{
+	struct arsdk_cmd_itf_rtt rtt;
+	struct timespec ts = {
+		.tv_sec = 100,
+		.tv_nsec = 0,
+	};
+	struct timespec before_ts = {
+		.tv_sec = 99,
+		.tv_nsec = 0,
+	};
+
+	TST_LOG_FUNC();
+
+	/* First sample: SRTT <- R, RTTVAR <- R/2, RTO <- SRTT + 4*RTTVAR */
+	arsdk_cmd_itf_rtt_init(&rtt, 150);
+	rtt_sample_us(&rtt, 100000);
+	CU_ASSERT_EQUAL(rtt.srtt_us, 100000);
+	CU_ASSERT_EQUAL(rtt.rttvar_us, 50000);
+	CU_ASSERT_EQUAL(rtt.rto_ms, 300);
+
+	/* Smoothed by the next samples */
+	rtt_sample_us(&rtt, 200000);
+	CU_ASSERT_EQUAL(rtt.srtt_us, 112500);
+	CU_ASSERT_EQUAL(rtt.rttvar_us, 62500);
+	CU_ASSERT_EQUAL(rtt.rto_ms, 363);
+
+	rtt_sample_us(&rtt, 112500);
+	CU_ASSERT_EQUAL(rtt.srtt_us, 112500);
+	CU_ASSERT_EQUAL(rtt.rttvar_us, 46875);
+	CU_ASSERT_EQUAL(rtt.rto_ms, 300);
+
+	/* Acknowledgement received before the sending, ignored */
+	arsdk_cmd_itf_rtt_sample(&rtt, &ts, &before_ts);
+	CU_ASSERT_EQUAL(rtt.srtt_us, 112500);
+	CU_ASSERT_EQUAL(rtt.rttvar_us, 46875);
+	CU_ASSERT_EQUAL(rtt.rto_ms, 300);
+
+	/* Clamped to the minimum on a fast link */
+	arsdk_cmd_itf_rtt_init(&rtt, 150);
+	rtt_sample_us(&rtt, 1000);
+	CU_ASSERT_EQUAL(rtt.srtt_us, 1000);
+	CU_ASSERT_EQUAL(rtt.rto_ms, ARSDK_CMD_ITF_RTO_MIN_MS);
+
+	/* Null round trip, the estimation is still started */
+	arsdk_cmd_itf_rtt_init(&rtt, 150);
+	arsdk_cmd_itf_rtt_sample(&rtt, &ts, &ts);
+	CU_ASSERT_NOT_EQUAL(rtt.srtt_us, 0);
+	CU_ASSERT_EQUAL(rtt.rto_ms, ARSDK_CMD_ITF_RTO_MIN_MS);
+
+	/* Clamped to the maximum on a slow link */
+	arsdk_cmd_itf_rtt_init(&rtt, 150);
+	rtt_sample_us(&rtt, 800000);
+	CU_ASSERT_EQUAL(rtt.rto_ms, ARSDK_CMD_ITF_RTO_MAX_MS);
+}
+
+static void test_cmd_itf_rtt_backoff(void)
+{
+	struct arsdk_cmd_itf_rtt rtt;
+
+	TST_LOG_FUNC();
+
+	/* Doubled by each retry, up to the maximum */
+	arsdk_cmd_itf_rtt_init(&rtt, 150);
+	rtt_sample_us(&rtt, 100000);
+	CU_ASSERT_EQUAL(rtt.rto_ms, 300);
+
+	arsdk_cmd_itf_rtt_backoff(&rtt);
+	CU_ASSERT_EQUAL(rtt.rto_ms, 600);
+	arsdk_cmd_itf_rtt_backoff(&rtt);
+	CU_ASSERT_EQUAL(rtt.rto_ms, ARSDK_CMD_ITF_RTO_MAX_MS);
+	arsdk_cmd_itf_rtt_backoff(&rtt);
+	CU_ASSERT_EQUAL(rtt.rto_ms, ARSDK_CMD_ITF_RTO_MAX_MS);
+
+	/* The estimation is left unchanged */
+	CU_ASSERT_EQUAL(rtt.srtt_us, 100000);
+	CU_ASSERT_EQUAL(rtt.rttvar_us, 50000);
+}
+
+static void test_cmd_itf_rtt_karn(void)
+{
+	struct arsdk_cmd_itf_rtt rtt;
+
+	TST_LOG_FUNC();
+
+	/* The acknowledgement of data sent several times is not sampled, it
+	   only ends the backoff */
+	arsdk_cmd_itf_rtt_init(&rtt, 150);
+	rtt_sample_us(&rtt, 100000);
+	arsdk_cmd_itf_rtt_backoff(&rtt);
+	arsdk_cmd_itf_rtt_backoff(&rtt);
+	CU_ASSERT_EQUAL(rtt.rto_ms, ARSDK_CMD_ITF_RTO_MAX_MS);
+
+	arsdk_cmd_itf_rtt_ack(&rtt);
+	CU_ASSERT_EQUAL(rtt.srtt_us, 100000);
+	CU_ASSERT_EQUAL(rtt.rttvar_us, 50000);
+	CU_ASSERT_EQUAL(rtt.rto_ms, 300);
+
+	/* Without any sample, the backoff goes on */
+	arsdk_cmd_itf_rtt_init(&rtt, 150);
+	arsdk_cmd_itf_rtt_backoff(&rtt);
+	arsdk_cmd_itf_rtt_ack(&rtt);
+	CU_ASSERT_EQUAL(rtt.srtt_us, 0);
+	CU_ASSERT_EQUAL(rtt.rto_ms, 300);
+}
+
+/* Disable some gcc warnings for test suite descriptions */
+#ifdef __GNUC__
+#  pragma GCC diagnostic ignored "-Wcast-qual"
+#endif /* __GNUC__ */
+
+/** */
+static CU_TestInfo s_cmd_itf_rtt_tests[] = {
+	{(char *)"cmd_itf_rtt_init", &test_cmd_itf_rtt_init},
+	{(char *)"cmd_itf_rtt_sample", &test_cmd_itf_rtt_sample},
+	{(char *)"cmd_itf_rtt_backoff", &test_cmd_itf_rtt_backoff},
+	{(char *)"cmd_itf_rtt_karn", &test_cmd_itf_rtt_karn},
+	CU_TEST_INFO_NULL,
+};
+
+/** */
+/*extern*/ CU_SuiteInfo g_suites_cmd_itf_rtt[] = {
+	{(char *)"cmd_itf_rtt", NULL, NULL, s_cmd_itf_rtt_tests},
+	CU_SUITE_INFO_NULL,
+};
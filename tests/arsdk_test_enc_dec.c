@@ -1077,6 +1077,442 @@ static void test_enc_dec_bad_buf(void)
 	arsdk_cmd_clear(&cmd);
 }
 
+/** */
+static void test_enc_dec_into(void)
+{
+	int res = 0;
+	struct arsdk_cmd cmd;
+	struct arsdk_cmd cmd_ref;
+	struct pomp_buffer *buf = NULL;
+	uint8_t data[64];
+	size_t len = 0;
+	const void *cdata = NULL;
+	size_t cdata_len = 0;
+	uint32_t u32_dec = 0;
+	const char *str_dec = NULL;
+
+	const struct arsdk_arg_desc arg_a[] = {
+		s_arg_desc_u32,
+		s_arg_desc_string,
+	};
+
+	struct arsdk_cmd_desc cmd_a = {
+		"cmd_a",
+		UINT8_MAX,
+		UINT8_MAX,
+		UINT16_MAX,
+		ARSDK_CMD_LIST_TYPE_NONE,
+		ARSDK_CMD_BUFFER_TYPE_NON_ACK,
+		ARSDK_CMD_TIMEOUT_POLICY_POP,
+		arg_a,
+		sizeof(arg_a) / sizeof(arg_a[0]),
+	};
+
+	res = arsdk_cmd_enc(&cmd_ref, &cmd_a, UINT32_MAX, "abc");
+	CU_ASSERT_EQUAL(res, 0);
+	pomp_buffer_get_cdata(cmd_ref.buf, &cdata, &cdata_len, NULL);
+	CU_ASSERT_EQUAL(cdata_len, 4 + 4 + 4);
+
+	/* size query */
+	res = arsdk_cmd_enc_into(NULL, 0, &len, &cmd_a, UINT32_MAX, "abc");
+	CU_ASSERT_EQUAL(res, -ENOBUFS);
+	CU_ASSERT_EQUAL(len, cdata_len);
+
+	/* too small */
+	len = 0;
+	res = arsdk_cmd_enc_into(data, cdata_len - 1, &len, &cmd_a,
+			UINT32_MAX, "abc");
+	CU_ASSERT_EQUAL(res, -ENOBUFS);
+	CU_ASSERT_EQUAL(len, cdata_len);
+
+	/* caller provided memory */
+	res = arsdk_cmd_enc_into(data, sizeof(data), &len, &cmd_a,
+			UINT32_MAX, "abc");
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(len, cdata_len);
+	CU_ASSERT_EQUAL(memcmp(data, cdata, len), 0);
+	arsdk_cmd_clear(&cmd_ref);
+
+	/* caller provided buffer, recycled once released */
+	buf = pomp_buffer_new(0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(buf);
+	res = arsdk_cmd_enc_with_buf(&cmd, buf, &cmd_a, UINT32_MAX, "abc");
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_PTR_EQUAL(cmd.buf, buf);
+	res = arsdk_cmd_dec(&cmd, &cmd_a, &u32_dec, &str_dec);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(u32_dec, UINT32_MAX);
+	CU_ASSERT_STRING_EQUAL(str_dec, "abc");
+
+	res = arsdk_cmd_enc_with_buf(&cmd_ref, buf, &cmd_a, 0, "");
+	CU_ASSERT_EQUAL(res, -EPERM);
+
+	arsdk_cmd_clear(&cmd);
+	res = arsdk_cmd_enc_with_buf(&cmd, buf, &cmd_a, 0, "");
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_dec(&cmd, &cmd_a, &u32_dec, &str_dec);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(u32_dec, 0);
+	CU_ASSERT_STRING_EQUAL(str_dec, "");
+
+	arsdk_cmd_clear(&cmd);
+	pomp_buffer_unref(buf);
+}
+
+/** */
+static void test_enc_dec_find_desc(void)
+{
+	const struct arsdk_cmd_desc * const * const * const *project_table =
+			g_arsdk_cmd_desc_table;
+	const struct arsdk_cmd_desc * const * const *class_table = NULL;
+	const struct arsdk_cmd_desc * const *cmd_table = NULL;
+	const struct arsdk_cmd_desc *cmd_desc = NULL;
+	struct arsdk_cmd cmd;
+
+	/* every generated descriptor must be found through the index */
+	for (; *project_table != NULL; project_table++) {
+		for (class_table = *project_table; *class_table != NULL;
+				class_table++) {
+			for (cmd_table = *class_table; *cmd_table != NULL;
+					cmd_table++) {
+				cmd_desc = *cmd_table;
+				arsdk_cmd_init(&cmd);
+				cmd.prj_id = cmd_desc->prj_id;
+				cmd.cls_id = cmd_desc->cls_id;
+				cmd.cmd_id = cmd_desc->cmd_id;
+				CU_ASSERT_PTR_EQUAL(arsdk_cmd_find_desc(&cmd),
+						cmd_desc);
+			}
+		}
+	}
+
+	/* unknown ids */
+	arsdk_cmd_init(&cmd);
+	cmd.prj_id = UINT8_MAX;
+	cmd.cls_id = UINT8_MAX;
+	cmd.cmd_id = UINT16_MAX;
+	CU_ASSERT_PTR_NULL(arsdk_cmd_find_desc(&cmd));
+}
+
+/** */
+static void check_same_buf(const struct arsdk_cmd *cmd_a,
+		const struct arsdk_cmd *cmd_b)
+{
+	const void *cdata_a = NULL, *cdata_b = NULL;
+	size_t len_a = 0, len_b = 0;
+
+	CU_ASSERT_EQUAL(cmd_a->id, cmd_b->id);
+	pomp_buffer_get_cdata(cmd_a->buf, &cdata_a, &len_a, NULL);
+	pomp_buffer_get_cdata(cmd_b->buf, &cdata_b, &len_b, NULL);
+	CU_ASSERT_EQUAL(len_a, len_b);
+	if (len_a == len_b)
+		CU_ASSERT_EQUAL(memcmp(cdata_a, cdata_b, len_a), 0);
+}
+
+/** */
+static void test_enc_dec_generated(void)
+{
+	int res = 0;
+	struct arsdk_cmd cmd_gen;
+	struct arsdk_cmd cmd_ref;
+
+	/* integers */
+	res = arsdk_cmd_enc_Ardrone3_Piloting_PCMD(&cmd_gen,
+			1, INT8_MIN, -1, 0, INT8_MAX, UINT32_MAX);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_enc(&cmd_ref, &g_arsdk_cmd_desc_Ardrone3_Piloting_PCMD,
+			1, INT8_MIN, -1, 0, INT8_MAX, UINT32_MAX);
+	CU_ASSERT_EQUAL(res, 0);
+	check_same_buf(&cmd_gen, &cmd_ref);
+	arsdk_cmd_clear(&cmd_gen);
+	arsdk_cmd_clear(&cmd_ref);
+
+	/* floats */
+	res = arsdk_cmd_enc_Ardrone3_Piloting_MoveBy(&cmd_gen,
+			FLT_MIN, FLT_MAX, -1.5f, 0.0f);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_enc(&cmd_ref,
+			&g_arsdk_cmd_desc_Ardrone3_Piloting_MoveBy,
+			FLT_MIN, FLT_MAX, -1.5f, 0.0f);
+	CU_ASSERT_EQUAL(res, 0);
+	check_same_buf(&cmd_gen, &cmd_ref);
+	arsdk_cmd_clear(&cmd_gen);
+	arsdk_cmd_clear(&cmd_ref);
+
+	/* strings, NULL is encoded as an empty string */
+	res = arsdk_cmd_enc_Common_Common_CurrentDateTime(&cmd_gen,
+			"20190101T000000+0000");
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_enc(&cmd_ref,
+			&g_arsdk_cmd_desc_Common_Common_CurrentDateTime,
+			"20190101T000000+0000");
+	CU_ASSERT_EQUAL(res, 0);
+	check_same_buf(&cmd_gen, &cmd_ref);
+	arsdk_cmd_clear(&cmd_gen);
+	arsdk_cmd_clear(&cmd_ref);
+
+	res = arsdk_cmd_enc_Common_Common_CurrentDateTime(&cmd_gen, NULL);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_enc(&cmd_ref,
+			&g_arsdk_cmd_desc_Common_Common_CurrentDateTime, NULL);
+	CU_ASSERT_EQUAL(res, 0);
+	check_same_buf(&cmd_gen, &cmd_ref);
+	arsdk_cmd_clear(&cmd_gen);
+	arsdk_cmd_clear(&cmd_ref);
+
+	res = arsdk_cmd_enc_Common_Common_CurrentDateTime(NULL, "");
+	CU_ASSERT_EQUAL(res, -EINVAL);
+}
+
+/** */
+static void test_enc_dec_generated_args(void)
+{
+	int res = 0;
+	struct arsdk_cmd cmd;
+	struct arsdk_cmd_Ardrone3_Piloting_PCMD_args pcmd;
+	struct arsdk_cmd_Ardrone3_Piloting_MoveBy_args move_by;
+	struct arsdk_cmd_Common_Common_CurrentDateTime_args date_time;
+	const char *str_enc = "20190101T000000+0000";
+
+	/* fixed size arguments */
+	res = arsdk_cmd_enc_Ardrone3_Piloting_PCMD(&cmd,
+			1, INT8_MIN, -1, 0, INT8_MAX, UINT32_MAX);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_dec_Ardrone3_Piloting_PCMD_args(&cmd, &pcmd);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(pcmd._flag, 1);
+	CU_ASSERT_EQUAL(pcmd._roll, INT8_MIN);
+	CU_ASSERT_EQUAL(pcmd._pitch, -1);
+	CU_ASSERT_EQUAL(pcmd._yaw, 0);
+	CU_ASSERT_EQUAL(pcmd._gaz, INT8_MAX);
+	CU_ASSERT_EQUAL(pcmd._timestampAndSeqNum, UINT32_MAX);
+
+	/* wrong command */
+	res = arsdk_cmd_dec_Ardrone3_Piloting_MoveBy_args(&cmd, &move_by);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+	arsdk_cmd_clear(&cmd);
+
+	res = arsdk_cmd_enc_Ardrone3_Piloting_MoveBy(&cmd,
+			FLT_MIN, FLT_MAX, -1.5f, 0.0f);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_dec_Ardrone3_Piloting_MoveBy_args(&cmd, &move_by);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(move_by._dX, FLT_MIN);
+	CU_ASSERT_EQUAL(move_by._dY, FLT_MAX);
+	CU_ASSERT_EQUAL(move_by._dZ, -1.5f);
+	CU_ASSERT_EQUAL(move_by._dPsi, 0.0f);
+
+	/* truncated buffer */
+	res = pomp_buffer_set_len(cmd.buf, 4 + 3 * sizeof(float));
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_dec_Ardrone3_Piloting_MoveBy_args(&cmd, &move_by);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+	arsdk_cmd_clear(&cmd);
+
+	/* strings are views in the command buffer */
+	res = arsdk_cmd_enc_Common_Common_CurrentDateTime(&cmd, str_enc);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_dec_Common_Common_CurrentDateTime_args(&cmd,
+			&date_time);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_STRING_EQUAL(date_time._datetime, str_enc);
+
+	/* missing null byte */
+	res = pomp_buffer_set_len(cmd.buf, 4 + strlen(str_enc));
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_dec_Common_Common_CurrentDateTime_args(&cmd,
+			&date_time);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+	arsdk_cmd_clear(&cmd);
+}
+
+static void test_enc_dec_fmt(void)
+{
+	int res = 0;
+	struct arsdk_cmd cmd;
+	char buf[256];
+
+	/* integers */
+	res = arsdk_cmd_enc_Ardrone3_Piloting_PCMD(&cmd,
+			1, INT8_MIN, -1, 0, INT8_MAX, UINT32_MAX);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_fmt(&cmd, buf, sizeof(buf));
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_STRING_EQUAL(buf, "Ardrone3.Piloting.PCMD"
+			" | Flag=1 | Roll=-128 | Pitch=-1 | Yaw=0 | Gaz=127"
+			" | TimestampAndSeqNum=4294967295");
+
+	/* truncated output */
+	res = arsdk_cmd_fmt(&cmd, buf, 30);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_STRING_EQUAL(buf, "Ardrone3.Piloting.PCMD | Flag");
+	arsdk_cmd_clear(&cmd);
+
+	/* strings */
+	res = arsdk_cmd_enc_Common_Common_CurrentDateTime(&cmd, "T000000");
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_fmt(&cmd, buf, sizeof(buf));
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_STRING_EQUAL(buf,
+			"Common.Common.CurrentDateTime | Datetime='T000000'");
+	arsdk_cmd_clear(&cmd);
+
+	/* known and unknown enum values */
+	res = arsdk_cmd_enc_Ardrone3_PilotingState_FlyingStateChanged(&cmd,
+		ARSDK_ARDRONE3_PILOTINGSTATE_FLYINGSTATECHANGED_STATE_HOVERING);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_fmt(&cmd, buf, sizeof(buf));
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_STRING_EQUAL(buf,
+		"Ardrone3.PilotingState.FlyingStateChanged | State=HOVERING");
+	arsdk_cmd_clear(&cmd);
+
+	res = arsdk_cmd_enc_Ardrone3_PilotingState_FlyingStateChanged(&cmd,
+			-42);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_fmt(&cmd, buf, sizeof(buf));
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_STRING_EQUAL(buf,
+		"Ardrone3.PilotingState.FlyingStateChanged | State=UNKNOWN(-42)");
+	arsdk_cmd_clear(&cmd);
+}
+
+static void test_enc_dec_view(void)
+{
+	int res = 0;
+	struct arsdk_cmd cmd;
+	struct arsdk_cmd_view view;
+	struct arsdk_value val;
+
+	memset(&view, 0, sizeof(view));
+
+	/* fixed size arguments */
+	res = arsdk_cmd_enc_Ardrone3_Piloting_PCMD(&cmd,
+			1, INT8_MIN, -1, 0, INT8_MAX, UINT32_MAX);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_view_init(&view, &cmd,
+			&g_arsdk_cmd_desc_Ardrone3_Piloting_PCMD);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(view.fixed, 1);
+	res = arsdk_cmd_view_get(&view, 5, &val);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(val.type, ARSDK_ARG_TYPE_U32);
+	CU_ASSERT_EQUAL(val.data.u32, UINT32_MAX);
+	res = arsdk_cmd_view_get(&view, 1, &val);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(val.type, ARSDK_ARG_TYPE_I8);
+	CU_ASSERT_EQUAL(val.data.i8, INT8_MIN);
+	res = arsdk_cmd_view_get(&view, 6, &val);
+	CU_ASSERT_EQUAL(res, -ENOENT);
+	arsdk_cmd_clear(&cmd);
+
+	/* offsets kept for the same description */
+	res = arsdk_cmd_enc_Ardrone3_Piloting_PCMD(&cmd, 0, 0, 0, 0, 42, 7);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_view_init(&view, &cmd,
+			&g_arsdk_cmd_desc_Ardrone3_Piloting_PCMD);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_view_get(&view, 4, &val);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(val.data.i8, 42);
+
+	/* truncated buffer */
+	res = pomp_buffer_set_len(cmd.buf, 4 + 4);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_view_init(&view, &cmd,
+			&g_arsdk_cmd_desc_Ardrone3_Piloting_PCMD);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+	CU_ASSERT_PTR_NULL(view.desc);
+	res = arsdk_cmd_view_get(&view, 4, &val);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+
+	/* wrong command, the previous one is no more viewed */
+	arsdk_cmd_clear(&cmd);
+	res = arsdk_cmd_enc_Ardrone3_Piloting_PCMD(&cmd, 0, 0, 0, 0, 42, 7);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_view_init(&view, &cmd,
+			&g_arsdk_cmd_desc_Ardrone3_Piloting_PCMD);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_view_init(&view, &cmd,
+			&g_arsdk_cmd_desc_Ardrone3_Piloting_MoveBy);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+	CU_ASSERT_PTR_NULL(view.desc);
+	CU_ASSERT_PTR_NULL(view.cdata);
+	res = arsdk_cmd_view_get(&view, 4, &val);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+	arsdk_cmd_clear(&cmd);
+
+	/* strings */
+	res = arsdk_cmd_enc_Common_Common_CurrentDateTime(&cmd, "T000000");
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_view_init(&view, &cmd,
+			&g_arsdk_cmd_desc_Common_Common_CurrentDateTime);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(view.fixed, 0);
+	res = arsdk_cmd_view_get(&view, 0, &val);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(val.type, ARSDK_ARG_TYPE_STRING);
+	CU_ASSERT_STRING_EQUAL(val.data.cstr, "T000000");
+	arsdk_cmd_clear(&cmd);
+}
+
+/** */
+static void test_enc_dec_batch(void)
+{
+	int res = 0;
+	size_t i = 0;
+	struct arsdk_cmd cmds[100];
+	uint8_t flag[100];
+	int8_t gaz[100];
+	uint32_t ts[100];
+	const char *datetime[2];
+	void *columns[6] = {flag, NULL, NULL, NULL, gaz, ts};
+
+	/* fixed size arguments, more than one chunk */
+	for (i = 0; i < 100; i++) {
+		res = arsdk_cmd_enc_Ardrone3_Piloting_PCMD(&cmds[i],
+				(uint8_t)(i & 1), 0, 0, 0, (int8_t)(i - 50),
+				(uint32_t)(i * 1000));
+		CU_ASSERT_EQUAL(res, 0);
+	}
+	res = arsdk_cmd_dec_batch(cmds, 100,
+			&g_arsdk_cmd_desc_Ardrone3_Piloting_PCMD, columns);
+	CU_ASSERT_EQUAL(res, 0);
+	for (i = 0; i < 100; i++) {
+		CU_ASSERT_EQUAL(flag[i], i & 1);
+		CU_ASSERT_EQUAL(gaz[i], (int8_t)(i - 50));
+		CU_ASSERT_EQUAL(ts[i], i * 1000);
+	}
+
+	/* wrong command */
+	res = arsdk_cmd_dec_batch(cmds, 100,
+			&g_arsdk_cmd_desc_Ardrone3_Piloting_MoveBy, columns);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+
+	/* truncated buffer */
+	res = pomp_buffer_set_len(cmds[70].buf, 4 + 4);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_dec_batch(cmds, 100,
+			&g_arsdk_cmd_desc_Ardrone3_Piloting_PCMD, columns);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+	for (i = 0; i < 100; i++)
+		arsdk_cmd_clear(&cmds[i]);
+
+	/* strings */
+	res = arsdk_cmd_enc_Common_Common_CurrentDateTime(&cmds[0], "T000000");
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_cmd_enc_Common_Common_CurrentDateTime(&cmds[1], "T123456");
+	CU_ASSERT_EQUAL(res, 0);
+	columns[0] = (void *)datetime;
+	res = arsdk_cmd_dec_batch(cmds, 2,
+			&g_arsdk_cmd_desc_Common_Common_CurrentDateTime, columns);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_STRING_EQUAL(datetime[0], "T000000");
+	CU_ASSERT_STRING_EQUAL(datetime[1], "T123456");
+	arsdk_cmd_clear(&cmds[0]);
+	arsdk_cmd_clear(&cmds[1]);
+}
+
 /** */
 static void test_enc_dec(void)
 {
@@ -1099,6 +1535,14 @@ static void test_enc_dec(void)
 	test_enc_dec_bad_cmd();
 	test_enc_dec_bad_arg();
 	test_enc_dec_bad_buf();
+
+	test_enc_dec_into();
+	test_enc_dec_find_desc();
+	test_enc_dec_generated();
+	test_enc_dec_generated_args();
+	test_enc_dec_fmt();
+	test_enc_dec_view();
+	test_enc_dec_batch();
 }
 
 /* Disable some gcc warnings for test suite descriptions */
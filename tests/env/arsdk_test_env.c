@@ -39,6 +39,8 @@ struct arsdk_test_env {
 	struct pomp_loop *loop;
 	int running;
 	enum arsdk_backend_type backend_type;
+	uint32_t dev_pack_max_size;
+	uint32_t ctrl_pack_max_size;
 
 	struct arsdk_test_env_dev *dev;
 	struct arsdk_test_env_ctrl *ctrl;
@@ -79,16 +81,31 @@ int arsdk_test_env_destroy(struct arsdk_test_env *env)
 	return 0;
 }
 
+int arsdk_test_env_set_pack_max_size(struct arsdk_test_env *env,
+		uint32_t dev_pack_max_size,
+		uint32_t ctrl_pack_max_size)
+{
+	CU_ASSERT_PTR_NOT_NULL_FATAL(env);
+
+	TST_LOG_FUNC();
+
+	env->dev_pack_max_size = dev_pack_max_size;
+	env->ctrl_pack_max_size = ctrl_pack_max_size;
+	return 0;
+}
+
 int arsdk_test_env_start(struct arsdk_test_env *env)
 {
 	TST_LOG_FUNC();
 
 	int res = arsdk_test_env_dev_new(env->loop, env->backend_type,
-			&env->cbs.device_cbs,&env->dev);
+			env->dev_pack_max_size, &env->cbs.device_cbs,
+			&env->dev);
 	CU_ASSERT_EQUAL_FATAL(res, 0);
 
 	res = arsdk_test_env_ctrl_new(env->loop, env->backend_type,
-			&env->cbs.ctrl_cbs, &env->ctrl);
+			env->ctrl_pack_max_size, &env->cbs.ctrl_cbs,
+			&env->ctrl);
 	CU_ASSERT_EQUAL_FATAL(res, 0);
 
 	return 0;
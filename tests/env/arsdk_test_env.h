@@ -43,6 +43,10 @@ int arsdk_test_env_new(enum arsdk_backend_type backend_type,
 
 int arsdk_test_env_destroy(struct arsdk_test_env *env);
 
+int arsdk_test_env_set_pack_max_size(struct arsdk_test_env *env,
+		uint32_t dev_pack_max_size,
+		uint32_t ctrl_pack_max_size);
+
 int arsdk_test_env_start(struct arsdk_test_env *env);
 
 int arsdk_test_env_stop(struct arsdk_test_env *env);
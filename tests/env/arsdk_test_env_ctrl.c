@@ -36,6 +36,7 @@ struct arsdk_test_env_ctrl {
 	struct pomp_loop             *loop;
 	struct arsdk_ctrl            *ctrl;
 	enum arsdk_backend_type      backend_type;
+	uint32_t                     pack_max_size;
 	struct {
 		struct {
 			struct arsdkctrl_backend_net    *backend;
@@ -203,6 +204,8 @@ static void backend_create_net(struct arsdk_test_env_ctrl *self,
 	int res = 0;
 	struct arsdkctrl_backend_net_cfg backend_net_cfg = {
 		.stream_supported = 1,
+		.pack_max_size = self->pack_max_size,
+		.pmtu_probe = self->pack_max_size != 0,
 	};
 	res = arsdkctrl_backend_net_new(self->ctrl, &backend_net_cfg,
 			&self->transport.net.backend);
@@ -387,6 +390,7 @@ static void backend_destroy(struct arsdk_test_env_ctrl *self)
 
 int arsdk_test_env_ctrl_new(struct pomp_loop *loop,
 		enum arsdk_backend_type backend_type,
+		uint32_t pack_max_size,
 		struct arsdk_device_conn_cbs *cbs,
 		struct arsdk_test_env_ctrl **ret_ctrl)
 {
@@ -398,6 +402,7 @@ int arsdk_test_env_ctrl_new(struct pomp_loop *loop,
 	CU_ASSERT_PTR_NOT_NULL_FATAL(self);
 
 	self->backend_type = backend_type;
+	self->pack_max_size = pack_max_size;
 	self->loop = loop;
 	self->cbs = *cbs;
 
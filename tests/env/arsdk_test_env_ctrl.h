@@ -32,6 +32,7 @@ struct arsdk_test_env_ctrl;
 
 int arsdk_test_env_ctrl_new(struct pomp_loop *loop,
 		enum arsdk_backend_type backend_type,
+		uint32_t pack_max_size,
 		struct arsdk_device_conn_cbs *cbs,
 		struct arsdk_test_env_ctrl **ret_ctrl);
 
@@ -38,6 +38,7 @@ struct arsdk_test_env_dev {
 	struct pomp_loop             *loop;
 	struct arsdk_mngr            *mngr;
 	enum arsdk_backend_type      backend_type;
+	uint32_t                     pack_max_size;
 	struct {
 		struct {
 			struct arsdk_backend_net     *backend;
@@ -190,7 +191,10 @@ static void backend_create_net(struct arsdk_test_env_dev *self,
 	int res = 0;
 	uint16_t net_listen_port = 44444;
 
-	struct arsdk_backend_net_cfg backend_net_cfg = {};
+	struct arsdk_backend_net_cfg backend_net_cfg = {
+		.pack_max_size = self->pack_max_size,
+		.pmtu_probe = self->pack_max_size != 0,
+	};
 	res = arsdk_backend_net_new(self->mngr, &backend_net_cfg,
 			&self->transport.net.backend);
 	CU_ASSERT_EQUAL_FATAL(res, 0);
@@ -393,6 +397,7 @@ static void backend_destroy(struct arsdk_test_env_dev *self)
 
 int arsdk_test_env_dev_new(struct pomp_loop *loop,
 		enum arsdk_backend_type backend_type,
+		uint32_t pack_max_size,
 		struct arsdk_peer_conn_cbs *cbs,
 		struct arsdk_test_env_dev **ret_device)
 {
@@ -404,6 +409,7 @@ int arsdk_test_env_dev_new(struct pomp_loop *loop,
 	CU_ASSERT_PTR_NOT_NULL_FATAL(self);
 
 	self->backend_type = backend_type;
+	self->pack_max_size = pack_max_size;
 	self->loop = loop;
 	self->cbs = *cbs;
 
@@ -32,6 +32,7 @@ struct arsdk_test_env_dev;
 
 int arsdk_test_env_dev_new(struct pomp_loop *loop,
 		enum arsdk_backend_type backend_type,
+		uint32_t pack_max_size,
 		struct arsdk_peer_conn_cbs *cbs,
 		struct arsdk_test_env_dev **ret_device);
 
@@ -233,6 +233,7 @@ def gen_cmd_desc_h(ctx, out):
                         _to_c_name(featureObj.name),
                         _to_c_name(msgObj.name))
     out.write("extern ARSDK_API const struct arsdk_cmd_desc * const * const *g_arsdk_cmd_desc_table[];\n")
+    out.write("extern ARSDK_API const struct arsdk_cmd_desc_prj_index g_arsdk_cmd_desc_index[256];\n")
 
     # Include guard
     out.write("\n#endif /* ARSDK_CMD_DESC_H_ */\n")
@@ -259,12 +260,12 @@ def gen_cmd_desc_c(ctx, out):
     for featureId in sorted(ctx.featuresById.keys()):
         featureObj = ctx.featuresById[featureId]
 
-        # Enum descriptions
+        # Enum descriptions, sorted by value for lookups
         for enum in featureObj.enums:
             out.write("static const struct arsdk_enum_desc s_enum_desc_%s_%s[] = {\n",
                         _to_c_name(featureObj.name),
                         _to_c_name(enum.name))
-            for enumVal in enum.values:
+            for enumVal in sorted(enum.values, key=lambda v: v.value):
                 out.write("\t{\"%s\", ARSDK_%s_%s_%s},\n",
                         _to_c_enum(enumVal.name),
                         _to_c_enum(featureObj.name),
@@ -409,6 +410,8 @@ def gen_cmd_desc_c(ctx, out):
     out.write("\tNULL,\n")
     out.write("};\n\n")
 
+    gen_cmd_desc_index_c(ctx, out)
+
     out.write("#ifdef __clang__\n")
     out.write("#pragma clang diagnostic pop\n")
     out.write("#elif defined(__GNUC__)\n")
@@ -420,6 +423,72 @@ def gen_cmd_desc_c(ctx, out):
     out.write("\treturn g_arsdk_cmd_desc_table;\n")
     out.write("}\n")
 
+#===============================================================================
+#===============================================================================
+def gen_cmd_desc_index_c(ctx, out):
+    # Direct index: project id -> class id -> command id -> descriptor.
+    # Unknown ids are either out of range or NULL (zero-initialized).
+    for featureId in sorted(ctx.featuresById.keys()):
+        featureObj = ctx.featuresById[featureId]
+
+        if featureObj.classes:
+            for classId in sorted(featureObj.classesById.keys()):
+                classObj = featureObj.classesById[classId]
+                out.write("static const struct arsdk_cmd_desc * const s_arsdk_cmd_desc_%s_%s_index[] = {\n",
+                        _to_c_name(featureObj.name),
+                        _to_c_name(classObj.name))
+                for cmdId in sorted(classObj.cmdsById.keys()):
+                    cmdObj = classObj.cmdsById[cmdId]
+                    out.write("\t[%d] = &g_arsdk_cmd_desc_%s_%s_%s,\n",
+                            cmdId,
+                            _to_c_name(featureObj.name),
+                            _to_c_name(classObj.name),
+                            _to_c_name(cmdObj.name))
+                if len(classObj.cmdsById) == 0:
+                    out.write("\tNULL,\n")
+                out.write("};\n\n")
+
+            out.write("static const struct arsdk_cmd_desc_cls_index s_arsdk_cmd_desc_%s_index[] = {\n",
+                    _to_c_name(featureObj.name))
+            for classId in sorted(featureObj.classesById.keys()):
+                classObj = featureObj.classesById[classId]
+                indexName = "s_arsdk_cmd_desc_%s_%s_index" % (
+                        _to_c_name(featureObj.name),
+                        _to_c_name(classObj.name))
+                out.write("\t[%d] = {\n\t\t%s,\n\t\tsizeof(%s) / sizeof(%s[0])\n\t},\n",
+                        classId, indexName, indexName, indexName)
+            out.write("};\n\n")
+        else:
+            out.write("static const struct arsdk_cmd_desc * const s_arsdk_cmd_desc_%s_Default_index[] = {\n",
+                    _to_c_name(featureObj.name))
+            msgsById = featureObj.getMsgsById()
+            for msgId in sorted(msgsById.keys()):
+                msgObj = msgsById[msgId]
+                out.write("\t[%d] = &g_arsdk_cmd_desc_%s_%s,\n",
+                        msgId,
+                        _to_c_name(featureObj.name),
+                        _to_c_name(msgObj.name))
+            if len(msgsById) == 0:
+                out.write("\tNULL,\n")
+            out.write("};\n\n")
+
+            indexName = "s_arsdk_cmd_desc_%s_Default_index" % (
+                    _to_c_name(featureObj.name))
+            out.write("static const struct arsdk_cmd_desc_cls_index s_arsdk_cmd_desc_%s_index[] = {\n",
+                    _to_c_name(featureObj.name))
+            out.write("\t[ARSDK_CLS_DEFAULT] = {\n\t\t%s,\n\t\tsizeof(%s) / sizeof(%s[0])\n\t},\n",
+                    indexName, indexName, indexName)
+            out.write("};\n\n")
+
+    out.write("/*extern*/ const struct arsdk_cmd_desc_prj_index g_arsdk_cmd_desc_index[256] = {\n")
+    for featureId in sorted(ctx.featuresById.keys()):
+        featureObj = ctx.featuresById[featureId]
+        indexName = "s_arsdk_cmd_desc_%s_index" % _to_c_name(featureObj.name)
+        out.write("\t[ARSDK_PRJ_%s] = {\n\t\t%s,\n\t\tsizeof(%s) / sizeof(%s[0])\n\t},\n",
+                _to_c_enum(featureObj.name),
+                indexName, indexName, indexName)
+    out.write("};\n\n")
+
 #===============================================================================
 #===============================================================================
 def gen_cmd_dec_h(ctx, out):
@@ -466,9 +535,64 @@ def gen_cmd_dec_h(ctx, out):
             out.write(");\n")
             out.write("}\n\n")
 
+            # Arguments structure and its decoder
+            if len(msgObj.args) == 0:
+                continue
+            out.write("struct arsdk_cmd_%s_%s_args {\n",
+                    _to_c_name(featureObj.name),
+                    msgName)
+            for argObj in msgObj.args:
+                if isinstance(argObj.argType, arsdkparser.ArEnum):
+                    out.write("\tint32_t _%s;\n", argObj.name)
+                elif isinstance(argObj.argType, arsdkparser.ArBitfield):
+                    out.write("\t%s _%s;\n",
+                            _get_arg_type_c_name(argObj.argType.btfType),
+                            argObj.name)
+                elif argObj.argType == arsdkparser.ArArgType.BINARY:
+                    out.write("\tstruct arsdk_binary _%s;\n", argObj.name)
+                elif argObj.argType == arsdkparser.ArArgType.STRING:
+                    out.write("\tconst char *_%s;\n", argObj.name)
+                else:
+                    out.write("\t%s _%s;\n",
+                            _get_arg_type_c_name(argObj.argType),
+                            argObj.name)
+            out.write("};\n\n")
+
+            out.write("ARSDK_API int\n")
+            out.write("__attribute__ ((warn_unused_result))\n")
+            _gen_cmd_dec_args_proto(featureObj, msgObj, out)
+            out.write(";\n\n")
+
     # Include guard
     out.write("\n#endif /* ARSDK_CMD_DEC_H_ */\n")
 
+#===============================================================================
+#===============================================================================
+def _gen_cmd_dec_args_proto(featureObj, msgObj, out):
+    out.write("arsdk_cmd_dec_%s_%s_args(\n",
+            _to_c_name(featureObj.name),
+            _get_msg_name(msgObj))
+    out.write("\t\tconst struct arsdk_cmd *cmd,\n")
+    out.write("\t\tstruct arsdk_cmd_%s_%s_args *args)",
+            _to_c_name(featureObj.name),
+            _get_msg_name(msgObj))
+
+def _get_arg_dec_func(argType):
+    # (reader, cast of the read value)
+    table = {
+        arsdkparser.ArArgType.I8: ("dec_u8", "(int8_t)"),
+        arsdkparser.ArArgType.U8: ("dec_u8", ""),
+        arsdkparser.ArArgType.I16: ("dec_u16", "(int16_t)"),
+        arsdkparser.ArArgType.U16: ("dec_u16", ""),
+        arsdkparser.ArArgType.I32: ("dec_u32", "(int32_t)"),
+        arsdkparser.ArArgType.U32: ("dec_u32", ""),
+        arsdkparser.ArArgType.I64: ("dec_u64", "(int64_t)"),
+        arsdkparser.ArArgType.U64: ("dec_u64", ""),
+        arsdkparser.ArArgType.FLOAT: ("dec_f32", ""),
+        arsdkparser.ArArgType.DOUBLE: ("dec_f64", ""),
+    }
+    return table[argType]
+
 #===============================================================================
 #===============================================================================
 def gen_cmd_dec_c(ctx, out):
@@ -477,8 +601,341 @@ def gen_cmd_dec_c(ctx, out):
     out.write("#define ULOG_TAG arsdk\n")
     out.write("#include \"arsdk/internal/arsdk_log.h\"\n")
     out.write("\n")
+
+    # Little endian readers
+    out.write("static inline uint8_t dec_u8(const uint8_t *p)\n")
+    out.write("{\n")
+    out.write("\treturn p[0];\n")
+    out.write("}\n\n")
+    out.write("static inline uint16_t dec_u16(const uint8_t *p)\n")
+    out.write("{\n")
+    out.write("\treturn (uint16_t)(p[0] | (p[1] << 8));\n")
+    out.write("}\n\n")
+    out.write("static inline uint32_t dec_u32(const uint8_t *p)\n")
+    out.write("{\n")
+    out.write("\treturn (uint32_t)p[0] | ((uint32_t)p[1] << 8) |\n")
+    out.write("\t\t((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);\n")
+    out.write("}\n\n")
+    out.write("static inline uint64_t dec_u64(const uint8_t *p)\n")
+    out.write("{\n")
+    out.write("\treturn (uint64_t)dec_u32(p) | ((uint64_t)dec_u32(p + 4) << 32);\n")
+    out.write("}\n\n")
+    out.write("static inline float dec_f32(const uint8_t *p)\n")
+    out.write("{\n")
+    out.write("\tunion {\n\t\tfloat f32;\n\t\tuint32_t u32;\n\t} d;\n")
+    out.write("\td.u32 = dec_u32(p);\n")
+    out.write("\treturn d.f32;\n")
+    out.write("}\n\n")
+    out.write("static inline double dec_f64(const uint8_t *p)\n")
+    out.write("{\n")
+    out.write("\tunion {\n\t\tdouble f64;\n\t\tuint64_t u64;\n\t} d;\n")
+    out.write("\td.u64 = dec_u64(p);\n")
+    out.write("\treturn d.f64;\n")
+    out.write("}\n\n")
+
+    # Header check, return the data and its length
+    out.write("static int dec_header(const struct arsdk_cmd *cmd,\n")
+    out.write("\t\tuint8_t prj_id, uint8_t cls_id, uint16_t cmd_id,\n")
+    out.write("\t\tconst uint8_t **p, size_t *len)\n")
+    out.write("{\n")
+    out.write("\tint res = 0;\n")
+    out.write("\tconst void *cdata = NULL;\n")
+    out.write("\n")
+    out.write("\tARSDK_RETURN_ERR_IF_FAILED(cmd != NULL, -EINVAL);\n")
+    out.write("\tARSDK_RETURN_ERR_IF_FAILED(cmd->buf != NULL, -EINVAL);\n")
+    out.write("\n")
+    out.write("\tres = pomp_buffer_get_cdata(cmd->buf, &cdata, len, NULL);\n")
+    out.write("\tif (res < 0)\n")
+    out.write("\t\treturn res;\n")
+    out.write("\t*p = cdata;\n")
+    out.write("\n")
+    out.write("\tif (*len < 4 || dec_u8(*p) != prj_id ||\n")
+    out.write("\t\t\tdec_u8(*p + 1) != cls_id ||\n")
+    out.write("\t\t\tdec_u16(*p + 2) != cmd_id) {\n")
+    out.write("\t\tARSDK_LOGW(\"decoder: command id mismatch\");\n")
+    out.write("\t\treturn -EINVAL;\n")
+    out.write("\t}\n")
+    out.write("\treturn 0;\n")
+    out.write("}\n\n")
+
+    # Null terminated string, returned as a view in the buffer
+    out.write("static int dec_cstr(const uint8_t *p, size_t len, size_t *off,\n")
+    out.write("\t\tconst char **v)\n")
+    out.write("{\n")
+    out.write("\tconst uint8_t *end = memchr(p + *off, '\\0', len - *off);\n")
+    out.write("\tif (end == NULL) {\n")
+    out.write("\t\tARSDK_LOGW(\"decoder: string not null terminated\");\n")
+    out.write("\t\treturn -EINVAL;\n")
+    out.write("\t}\n")
+    out.write("\t*v = (const char *)(p + *off);\n")
+    out.write("\t*off = (size_t)(end - p) + 1;\n")
+    out.write("\treturn 0;\n")
+    out.write("}\n\n")
+
+    # Binary, returned as a view in the buffer
+    out.write("static int dec_binary(const uint8_t *p, size_t len, size_t *off,\n")
+    out.write("\t\tstruct arsdk_binary *v)\n")
+    out.write("{\n")
+    out.write("\tif (len - *off < 4)\n")
+    out.write("\t\treturn -EINVAL;\n")
+    out.write("\tv->len = dec_u32(p + *off);\n")
+    out.write("\tif (len - *off - 4 < v->len)\n")
+    out.write("\t\treturn -EINVAL;\n")
+    out.write("\tv->cdata = p + *off + 4;\n")
+    out.write("\t*off += 4 + v->len;\n")
+    out.write("\treturn 0;\n")
+    out.write("}\n\n")
+
     for featureId in sorted(ctx.featuresById.keys()):
         featureObj = ctx.featuresById[featureId]
+        for msgObj in featureObj.getMsgs():
+            if len(msgObj.args) == 0:
+                continue
+
+            prjId = "ARSDK_PRJ_%s" % _to_c_enum(featureObj.name)
+            if msgObj.cls:
+                clsId = "ARSDK_CLS_%s_%s" % (
+                        _to_c_enum(featureObj.name),
+                        _to_c_enum(msgObj.cls.name))
+                cmdId = "ARSDK_CMD_%s_%s_%s" % (
+                        _to_c_enum(featureObj.name),
+                        _to_c_enum(msgObj.cls.name),
+                        _to_c_enum(msgObj.name))
+            else:
+                clsId = "ARSDK_CLS_DEFAULT"
+                cmdId = "ARSDK_CMD_%s_%s" % (
+                        _to_c_enum(featureObj.name),
+                        _to_c_enum(msgObj.name))
+
+            # Split arguments in runs of fixed size arguments, each run
+            # ending with an optional variable size argument
+            runs = [([], None)]
+            for argObj in msgObj.args:
+                if argObj.argType in (arsdkparser.ArArgType.STRING,
+                        arsdkparser.ArArgType.BINARY):
+                    runs[-1] = (runs[-1][0], argObj)
+                    runs.append(([], None))
+                else:
+                    runs[-1][0].append(argObj)
+
+            out.write("/*extern*/ int\n")
+            _gen_cmd_dec_args_proto(featureObj, msgObj, out)
+            out.write("\n{\n")
+            out.write("\tint res = 0;\n")
+            out.write("\tconst uint8_t *p = NULL;\n")
+            out.write("\tsize_t len = 0;\n")
+            out.write("\tsize_t off = 4;\n")
+            out.write("\n")
+            out.write("\tARSDK_RETURN_ERR_IF_FAILED(args != NULL, -EINVAL);\n")
+            out.write("\n")
+            out.write("\tres = dec_header(cmd, %s, %s,\n\t\t\t%s, &p, &len);\n",
+                    prjId, clsId, cmdId)
+            out.write("\tif (res < 0)\n")
+            out.write("\t\treturn res;\n")
+
+            for (fixedArgs, varArg) in runs:
+                if len(fixedArgs) != 0:
+                    runLen = 0
+                    for argObj in fixedArgs:
+                        if isinstance(argObj.argType, arsdkparser.ArEnum):
+                            runLen += 4
+                        elif isinstance(argObj.argType, arsdkparser.ArBitfield):
+                            runLen += _get_arg_type_size(argObj.argType.btfType)
+                        else:
+                            runLen += _get_arg_type_size(argObj.argType)
+                    out.write("\n")
+                    out.write("\tif (len - off < %d)\n", runLen)
+                    out.write("\t\treturn -EINVAL;\n")
+                    argOff = 0
+                    for argObj in fixedArgs:
+                        if isinstance(argObj.argType, arsdkparser.ArEnum):
+                            func, cast, size = "dec_u32", "(int32_t)", 4
+                        elif isinstance(argObj.argType, arsdkparser.ArBitfield):
+                            func, cast = _get_arg_dec_func(argObj.argType.btfType)
+                            size = _get_arg_type_size(argObj.argType.btfType)
+                        else:
+                            func, cast = _get_arg_dec_func(argObj.argType)
+                            size = _get_arg_type_size(argObj.argType)
+                        out.write("\targs->_%s = %s%s(p + off + %d);\n",
+                                argObj.name, cast, func, argOff)
+                        argOff += size
+                    if varArg is not None:
+                        out.write("\toff += %d;\n", runLen)
+
+                if varArg is None:
+                    continue
+                out.write("\n")
+                if varArg.argType == arsdkparser.ArArgType.STRING:
+                    out.write("\tres = dec_cstr(p, len, &off, &args->_%s);\n",
+                            varArg.name)
+                else:
+                    out.write("\tres = dec_binary(p, len, &off, &args->_%s);\n",
+                            varArg.name)
+                out.write("\tif (res < 0)\n")
+                out.write("\t\treturn res;\n")
+
+            out.write("\n")
+            out.write("\treturn 0;\n")
+            out.write("}\n\n")
+
+#===============================================================================
+#===============================================================================
+def _get_arg_type_size(argType):
+    table = {
+        arsdkparser.ArArgType.I8: 1,
+        arsdkparser.ArArgType.U8: 1,
+        arsdkparser.ArArgType.I16: 2,
+        arsdkparser.ArArgType.U16: 2,
+        arsdkparser.ArArgType.I32: 4,
+        arsdkparser.ArArgType.U32: 4,
+        arsdkparser.ArArgType.I64: 8,
+        arsdkparser.ArArgType.U64: 8,
+        arsdkparser.ArArgType.FLOAT: 4,
+        arsdkparser.ArArgType.DOUBLE: 8,
+    }
+    return table[argType]
+
+def _get_arg_enc_func(argType):
+    # (writer, cast of the value before writing)
+    table = {
+        arsdkparser.ArArgType.I8: ("enc_u8", "(uint8_t)"),
+        arsdkparser.ArArgType.U8: ("enc_u8", ""),
+        arsdkparser.ArArgType.I16: ("enc_u16", "(uint16_t)"),
+        arsdkparser.ArArgType.U16: ("enc_u16", ""),
+        arsdkparser.ArArgType.I32: ("enc_u32", "(uint32_t)"),
+        arsdkparser.ArArgType.U32: ("enc_u32", ""),
+        arsdkparser.ArArgType.I64: ("enc_u64", "(uint64_t)"),
+        arsdkparser.ArArgType.U64: ("enc_u64", ""),
+        arsdkparser.ArArgType.FLOAT: ("enc_f32", ""),
+        arsdkparser.ArArgType.DOUBLE: ("enc_f64", ""),
+    }
+    return table[argType]
+
+def _gen_cmd_enc_proto(featureObj, msgObj, out):
+    out.write("arsdk_cmd_enc_%s_%s(\n",
+            _to_c_name(featureObj.name),
+            _get_msg_name(msgObj))
+    out.write("\t\tstruct arsdk_cmd *cmd")
+    for argObj in msgObj.args:
+        if isinstance(argObj.argType, arsdkparser.ArEnum):
+            # FIXME: use a real enum type
+            out.write(",\n\t\tint32_t")
+        elif isinstance(argObj.argType, arsdkparser.ArBitfield):
+            out.write(",\n\t\t%s",
+                    _get_arg_type_c_name(argObj.argType.btfType))
+        elif argObj.argType == arsdkparser.ArArgType.BINARY:
+            out.write(",\n\t\tconst struct arsdk_binary *")
+        else:
+            out.write(",\n\t\t%s", _get_arg_type_c_name(argObj.argType))
+
+        if argObj.argType != arsdkparser.ArArgType.STRING:
+            out.write(" ")
+        out.write("_%s" % argObj.name)
+    out.write(")")
+
+def _get_msg_ids(featureObj, msgObj):
+    prjId = "ARSDK_PRJ_%s" % _to_c_enum(featureObj.name)
+    if msgObj.cls:
+        clsId = "ARSDK_CLS_%s_%s" % (
+                _to_c_enum(featureObj.name),
+                _to_c_enum(msgObj.cls.name))
+        cmdId = "ARSDK_CMD_%s_%s_%s" % (
+                _to_c_enum(featureObj.name),
+                _to_c_enum(msgObj.cls.name),
+                _to_c_enum(msgObj.name))
+    else:
+        clsId = "ARSDK_CLS_DEFAULT"
+        cmdId = "ARSDK_CMD_%s_%s" % (
+                _to_c_enum(featureObj.name),
+                _to_c_enum(msgObj.name))
+    return prjId, clsId, cmdId
+
+# Declares 'p' and computes the encoded size of a command in 'len'
+def _gen_cmd_enc_len(msgObj, out, check):
+    # Size of the header and fixed size arguments
+    fixedLen = 4
+    for argObj in msgObj.args:
+        if isinstance(argObj.argType, arsdkparser.ArEnum):
+            fixedLen += 4
+        elif isinstance(argObj.argType, arsdkparser.ArBitfield):
+            fixedLen += _get_arg_type_size(argObj.argType.btfType)
+        elif argObj.argType == arsdkparser.ArArgType.STRING:
+            pass
+        elif argObj.argType == arsdkparser.ArArgType.BINARY:
+            fixedLen += 4
+        else:
+            fixedLen += _get_arg_type_size(argObj.argType)
+
+    out.write("\tuint8_t *p = NULL;\n")
+    out.write("\tsize_t len = %d;\n", fixedLen)
+    for argObj in msgObj.args:
+        if argObj.argType == arsdkparser.ArArgType.STRING:
+            out.write("\tsize_t len_%s = 0;\n", argObj.name)
+    out.write("\n")
+    out.write("\tARSDK_RETURN_ERR_IF_FAILED(%s, -EINVAL);\n", check)
+
+    # Variable size arguments
+    for argObj in msgObj.args:
+        if argObj.argType == arsdkparser.ArArgType.STRING:
+            out.write("\n\tif (_%s == NULL)\n", argObj.name)
+            out.write("\t\t_%s = \"\";\n", argObj.name)
+            out.write("\tlen_%s = strlen(_%s) + 1;\n",
+                    argObj.name, argObj.name)
+            out.write("\tlen += len_%s;\n", argObj.name)
+        elif argObj.argType == arsdkparser.ArArgType.BINARY:
+            out.write("\n\tARSDK_RETURN_ERR_IF_FAILED(_%s != NULL, -EINVAL);\n",
+                    argObj.name)
+            out.write("\tlen += _%s->len;\n", argObj.name)
+    out.write("\n")
+
+# Writes the header and the arguments of a command from 'p'
+def _gen_cmd_enc_write(msgObj, out, prjId, clsId, cmdId, indent="\t"):
+    out.write("%sp = enc_u8(p, %s);\n", indent, prjId)
+    out.write("%sp = enc_u8(p, %s);\n", indent, clsId)
+    out.write("%sp = enc_u16(p, %s);\n", indent, cmdId)
+    for argObj in msgObj.args:
+        if isinstance(argObj.argType, arsdkparser.ArEnum):
+            out.write("%sp = enc_u32(p, (uint32_t)_%s);\n",
+                    indent, argObj.name)
+        elif isinstance(argObj.argType, arsdkparser.ArBitfield):
+            func, cast = _get_arg_enc_func(argObj.argType.btfType)
+            out.write("%sp = %s(p, %s_%s);\n",
+                    indent, func, cast, argObj.name)
+        elif argObj.argType == arsdkparser.ArArgType.STRING:
+            out.write("%sp = enc_data(p, _%s, len_%s);\n",
+                    indent, argObj.name, argObj.name)
+        elif argObj.argType == arsdkparser.ArArgType.BINARY:
+            out.write("%sp = enc_u32(p, _%s->len);\n", indent, argObj.name)
+            out.write("%sp = enc_data(p, _%s->cdata, _%s->len);\n",
+                    indent, argObj.name, argObj.name)
+        else:
+            func, cast = _get_arg_enc_func(argObj.argType)
+            out.write("%sp = %s(p, %s_%s);\n",
+                    indent, func, cast, argObj.name)
+
+def _gen_cmd_send_proto(featureObj, msgObj, out):
+    out.write("arsdk_cmd_send_%s_%s(\n",
+            _to_c_name(featureObj.name),
+            _get_msg_name(msgObj))
+    out.write("\t\tstruct arsdk_cmd_itf *itf,\n")
+    out.write("\t\tarsdk_cmd_itf_cmd_send_status_cb_t send_status,\n")
+    out.write("\t\tvoid *userdata")
+    for argObj in msgObj.args:
+        if isinstance(argObj.argType, arsdkparser.ArEnum):
+            # FIXME: use a real enum type
+            out.write(",\n\t\tint32_t")
+        elif isinstance(argObj.argType, arsdkparser.ArBitfield):
+            out.write(",\n\t\t%s",
+                    _get_arg_type_c_name(argObj.argType.btfType))
+        elif argObj.argType == arsdkparser.ArArgType.BINARY:
+            out.write(",\n\t\tconst struct arsdk_binary *")
+        else:
+            out.write(",\n\t\t%s", _get_arg_type_c_name(argObj.argType))
+
+        if argObj.argType != arsdkparser.ArArgType.STRING:
+            out.write(" ")
+        out.write("_%s" % argObj.name)
+    out.write(")")
 
 #===============================================================================
 #===============================================================================
@@ -490,39 +947,9 @@ def gen_cmd_enc_h(ctx, out):
     for featureId in sorted(ctx.featuresById.keys()):
         featureObj = ctx.featuresById[featureId]
         for msgObj in featureObj.getMsgs():
-            msgName = _to_c_name(msgObj.name) if msgObj.cls == None else \
-                    _to_c_name(msgObj.cls.name)+'_'+_to_c_name(msgObj.name)
-
-            out.write("static inline int\n")
-            out.write("arsdk_cmd_enc_%s_%s(\n",
-                    _to_c_name(featureObj.name),
-                    msgName)
-            out.write("\t\tstruct arsdk_cmd *cmd")
-            for argObj in msgObj.args:
-                if isinstance(argObj.argType, arsdkparser.ArEnum):
-                    # FIXME: use a real enum type
-                    out.write(",\n\t\tint32_t")
-                elif isinstance(argObj.argType, arsdkparser.ArBitfield):
-                    out.write(",\n\t\t%s",
-                            _get_arg_type_c_name(argObj.argType.btfType))
-                elif argObj.argType == arsdkparser.ArArgType.BINARY:
-                    out.write(",\n\t\tconst struct arsdk_binary *")
-                else:
-                    out.write(",\n\t\t%s", _get_arg_type_c_name(argObj.argType))
-
-                if argObj.argType != arsdkparser.ArArgType.STRING:
-                    out.write(" ")
-                out.write("_%s" % argObj.name)
-            else:
-                out.write(") {\n")
-                out.write("\treturn arsdk_cmd_enc(cmd,\n")
-                out.write("\t\t\t&g_arsdk_cmd_desc_%s_%s",
-                        _to_c_name(featureObj.name),
-                        msgName)
-                for argObj in msgObj.args:
-                    out.write(",\n\t\t\t_%s" % argObj.name)
-                out.write(");\n")
-                out.write("}\n\n")
+            out.write("ARSDK_API int\n")
+            _gen_cmd_enc_proto(featureObj, msgObj, out)
+            out.write(";\n\n")
 
     # Include guard
     out.write("\n#endif /* ARSDK_CMD_ENC_H_ */\n")
@@ -531,9 +958,145 @@ def gen_cmd_enc_h(ctx, out):
 #===============================================================================
 def gen_cmd_enc_c(ctx, out):
     out.write('#include "arsdk/arsdk.h"\n')
+    out.write("/* Log header */\n")
+    out.write("#define ULOG_TAG arsdk\n")
+    out.write("#include \"arsdk/internal/arsdk_log.h\"\n")
     out.write("\n")
+
+    # Little endian writers, return the position after the written value
+    out.write("static inline uint8_t *enc_u8(uint8_t *p, uint8_t v)\n")
+    out.write("{\n")
+    out.write("\tp[0] = v;\n")
+    out.write("\treturn p + 1;\n")
+    out.write("}\n\n")
+    out.write("static inline uint8_t *enc_u16(uint8_t *p, uint16_t v)\n")
+    out.write("{\n")
+    out.write("\tp[0] = (uint8_t)v;\n")
+    out.write("\tp[1] = (uint8_t)(v >> 8);\n")
+    out.write("\treturn p + 2;\n")
+    out.write("}\n\n")
+    out.write("static inline uint8_t *enc_u32(uint8_t *p, uint32_t v)\n")
+    out.write("{\n")
+    out.write("\tp[0] = (uint8_t)v;\n")
+    out.write("\tp[1] = (uint8_t)(v >> 8);\n")
+    out.write("\tp[2] = (uint8_t)(v >> 16);\n")
+    out.write("\tp[3] = (uint8_t)(v >> 24);\n")
+    out.write("\treturn p + 4;\n")
+    out.write("}\n\n")
+    out.write("static inline uint8_t *enc_u64(uint8_t *p, uint64_t v)\n")
+    out.write("{\n")
+    out.write("\tp = enc_u32(p, (uint32_t)v);\n")
+    out.write("\treturn enc_u32(p, (uint32_t)(v >> 32));\n")
+    out.write("}\n\n")
+    out.write("static inline uint8_t *enc_f32(uint8_t *p, float v)\n")
+    out.write("{\n")
+    out.write("\tunion {\n\t\tfloat f32;\n\t\tuint32_t u32;\n\t} d;\n")
+    out.write("\td.f32 = v;\n")
+    out.write("\treturn enc_u32(p, d.u32);\n")
+    out.write("}\n\n")
+    out.write("static inline uint8_t *enc_f64(uint8_t *p, double v)\n")
+    out.write("{\n")
+    out.write("\tunion {\n\t\tdouble f64;\n\t\tuint64_t u64;\n\t} d;\n")
+    out.write("\td.f64 = v;\n")
+    out.write("\treturn enc_u64(p, d.u64);\n")
+    out.write("}\n\n")
+    out.write("static inline uint8_t *enc_data(uint8_t *p, const void *v, size_t n)\n")
+    out.write("{\n")
+    out.write("\tif (n != 0)\n")
+    out.write("\t\tmemcpy(p, v, n);\n")
+    out.write("\treturn p + n;\n")
+    out.write("}\n\n")
+
+    # Allocate the exact size and get a writable pointer on it
+    out.write("static struct pomp_buffer *enc_alloc(size_t len, uint8_t **p)\n")
+    out.write("{\n")
+    out.write("\tint res = 0;\n")
+    out.write("\tvoid *data = NULL;\n")
+    out.write("\tstruct pomp_buffer *buf = pomp_buffer_new(len);\n")
+    out.write("\tif (buf == NULL)\n")
+    out.write("\t\treturn NULL;\n")
+    out.write("\tres = pomp_buffer_get_data(buf, &data, NULL, NULL);\n")
+    out.write("\tif (res < 0) {\n")
+    out.write("\t\tpomp_buffer_unref(buf);\n")
+    out.write("\t\treturn NULL;\n")
+    out.write("\t}\n")
+    out.write("\t*p = data;\n")
+    out.write("\treturn buf;\n")
+    out.write("}\n\n")
+
+    # Finalize buffer and attach it to the command
+    out.write("static int enc_finish(struct arsdk_cmd *cmd, struct pomp_buffer *buf,\n")
+    out.write("\t\tsize_t len, uint8_t prj_id, uint8_t cls_id, uint16_t cmd_id)\n")
+    out.write("{\n")
+    out.write("\tint res = pomp_buffer_set_len(buf, len);\n")
+    out.write("\tif (res < 0) {\n")
+    out.write("\t\tpomp_buffer_unref(buf);\n")
+    out.write("\t\treturn res;\n")
+    out.write("\t}\n")
+    out.write("\tarsdk_cmd_init(cmd);\n")
+    out.write("\tcmd->prj_id = prj_id;\n")
+    out.write("\tcmd->cls_id = cls_id;\n")
+    out.write("\tcmd->cmd_id = cmd_id;\n")
+    out.write("\tcmd->id = ARSDK_CMD_FULL_ID(prj_id, cls_id, cmd_id);\n")
+    out.write("\tcmd->buf = buf;\n")
+    out.write("\treturn 0;\n")
+    out.write("}\n\n")
+
     for featureId in sorted(ctx.featuresById.keys()):
         featureObj = ctx.featuresById[featureId]
+        for msgObj in featureObj.getMsgs():
+            prjId, clsId, cmdId = _get_msg_ids(featureObj, msgObj)
+
+            out.write("/*extern*/ int\n")
+            _gen_cmd_enc_proto(featureObj, msgObj, out)
+            out.write("\n{\n")
+            out.write("\tstruct pomp_buffer *buf = NULL;\n")
+            _gen_cmd_enc_len(msgObj, out, "cmd != NULL")
+            out.write("\tbuf = enc_alloc(len, &p);\n")
+            out.write("\tif (buf == NULL)\n")
+            out.write("\t\treturn -ENOMEM;\n")
+            out.write("\n")
+            _gen_cmd_enc_write(msgObj, out, prjId, clsId, cmdId)
+            out.write("\n")
+            out.write("\treturn enc_finish(cmd, buf, len,\n\t\t\t%s,\n\t\t\t%s,\n\t\t\t%s);\n",
+                    prjId, clsId, cmdId)
+            out.write("}\n\n")
+
+            if msgObj.bufferType != arsdkparser.ArCmdBufferType.NON_ACK:
+                continue
+
+            # Encoded directly in the pack when possible
+            out.write("/*extern*/ int\n")
+            _gen_cmd_send_proto(featureObj, msgObj, out)
+            out.write("\n{\n")
+            out.write("\tint res = 0;\n")
+            out.write("\tstruct arsdk_cmd cmd;\n")
+            _gen_cmd_enc_len(msgObj, out, "itf != NULL")
+            out.write("\tres = arsdk_cmd_itf_send_enc_begin(itf,\n")
+            out.write("\t\t\t&g_arsdk_cmd_desc_%s_%s,\n",
+                    _to_c_name(featureObj.name),
+                    _get_msg_name(msgObj))
+            out.write("\t\t\tlen, &p);\n")
+            out.write("\tif (res == 0) {\n")
+            _gen_cmd_enc_write(msgObj, out, prjId, clsId, cmdId, "\t\t")
+            out.write("\t\treturn arsdk_cmd_itf_send_enc_end(itf, send_status, userdata);\n")
+            out.write("\t} else if (res != -EAGAIN) {\n")
+            out.write("\t\treturn res;\n")
+            out.write("\t}\n")
+            out.write("\n")
+            out.write("\tarsdk_cmd_init(&cmd);\n")
+            out.write("\tres = arsdk_cmd_enc_%s_%s(\n",
+                    _to_c_name(featureObj.name),
+                    _get_msg_name(msgObj))
+            out.write("\t\t\t&cmd")
+            for argObj in msgObj.args:
+                out.write(",\n\t\t\t_%s" % argObj.name)
+            out.write(");\n")
+            out.write("\tif (res == 0)\n")
+            out.write("\t\tres = arsdk_cmd_itf_send(itf, &cmd, send_status, userdata);\n")
+            out.write("\tarsdk_cmd_clear(&cmd);\n")
+            out.write("\treturn res;\n")
+            out.write("}\n\n")
 
 #===============================================================================
 #===============================================================================
@@ -545,35 +1108,22 @@ def gen_cmd_send_h(ctx, out):
     for featureId in sorted(ctx.featuresById.keys()):
         featureObj = ctx.featuresById[featureId]
         for msgObj in featureObj.getMsgs():
-            msgName = _to_c_name(msgObj.name) if msgObj.cls == None else \
-                    _to_c_name(msgObj.cls.name)+'_'+_to_c_name(msgObj.name)
-            out.write("static inline int\narsdk_cmd_send_%s_%s(\n",
-                    _to_c_name(featureObj.name),
-                    msgName)
-            out.write("\t\tstruct arsdk_cmd_itf *itf,\n")
-            out.write("\t\tarsdk_cmd_itf_cmd_send_status_cb_t send_status,\n")
-            out.write("\t\tvoid *userdata")
-            for argObj in msgObj.args:
-                if isinstance(argObj.argType, arsdkparser.ArEnum):
-                    # FIXME: use a real enum type
-                    out.write(",\n\t\tint32_t")
-                elif isinstance(argObj.argType, arsdkparser.ArBitfield):
-                    out.write(",\n\t\t%s",
-                        _get_arg_type_c_name(argObj.argType.btfType))
-                elif argObj.argType == arsdkparser.ArArgType.BINARY:
-                    out.write(",\n\t\tconst struct arsdk_binary *")
-                else:
-                    out.write(",\n\t\t%s", _get_arg_type_c_name(argObj.argType))
-                if argObj.argType != arsdkparser.ArArgType.STRING :
-                    out.write(" ")
-                out.write("_%s" % argObj.name)
-            out.write(") {\n")
+            if msgObj.bufferType == arsdkparser.ArCmdBufferType.NON_ACK:
+                # Encoded directly in the pack when possible, see
+                # gen_cmd_enc_c
+                out.write("ARSDK_API int\n")
+                _gen_cmd_send_proto(featureObj, msgObj, out)
+                out.write(";\n\n")
+                continue
+            out.write("static inline int\n")
+            _gen_cmd_send_proto(featureObj, msgObj, out)
+            out.write(" {\n")
             out.write("\tint res = 0;\n")
             out.write("\tstruct arsdk_cmd cmd;\n")
             out.write("\tarsdk_cmd_init(&cmd);\n")
             out.write("\tres = arsdk_cmd_enc_%s_%s(\n",
                     _to_c_name(featureObj.name),
-                    msgName)
+                    _get_msg_name(msgObj))
             out.write("\t\t\t&cmd")
             for argObj in msgObj.args:
                 out.write(",\n\t\t\t_%s" % argObj.name)